@@ -0,0 +1,645 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+/*
+ * Benchmark of mln_json_decode, mln_json_pool_decode, mln_json_encode and
+ * mln_json_parse.
+ *
+ * Without arguments it runs over built-in corpora shaped like the usual JSON
+ * benchmark inputs (twitter.json, canada.json and citm_catalog.json) plus a
+ * deeply nested and a very wide document. Files given on the command line are
+ * benchmarked as well, so the original corpora can be passed in directly:
+ *
+ *   bench/json_bench [-t ms] [-s scale] [-b] [file ...]
+ *
+ * -t is the minimal running time of each operation, -s multiplies the size of
+ * the built-in corpora and -b skips them.
+ *
+ * For each corpus and operation it prints the throughput over the text size
+ * (except for mln_json_parse which only looks up one value), the time per
+ * document, the number of heap allocations per document and the
+ * peak number of heap bytes allocated by one operation. The allocation
+ * figures come from counting wrappers of malloc and friends and are only
+ * available with glibc.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "mln_json.h"
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#define BENCH_COUNT_ALLOC
+#endif
+
+#define BENCH_PATH_MAX_DEPTH 32
+#define BENCH_PARSE_BATCH    64
+
+typedef struct {
+    char                  *data;
+    size_t                 len;
+    size_t                 size;
+} bench_buf_t;
+
+typedef struct {
+    char                  *name;
+    bench_buf_t            text;
+    bench_buf_t            path;
+} bench_corpus_t;
+
+typedef struct {
+    mln_u64_t              ns;
+    mln_u64_t              n;
+    mln_u64_t              allocs;
+    mln_u64_t              peak;
+} bench_result_t;
+
+static void bench_buf_reserve(bench_buf_t *b, size_t n);
+static void bench_buf_append(bench_buf_t *b, const char *s, size_t n);
+static void bench_buf_printf(bench_buf_t *b, const char *fmt, ...);
+static mln_u64_t bench_rand(void);
+static void bench_gen_word(bench_buf_t *b, int n);
+static void bench_gen_twitter(bench_buf_t *b, int scale);
+static void bench_gen_canada(bench_buf_t *b, int scale);
+static void bench_gen_citm(bench_buf_t *b, int scale);
+static void bench_gen_deep(bench_buf_t *b, int scale);
+static void bench_gen_wide(bench_buf_t *b, int scale);
+static int bench_load(bench_corpus_t *c, char *file);
+static int bench_last_member(mln_json_t *key, mln_json_t *val, void *data);
+static void bench_path(bench_corpus_t *c, mln_json_t *j);
+static int bench_parse_iterator(mln_json_t *j, void *data);
+static mln_u64_t bench_now(void);
+static void bench_stat_begin(void);
+static void bench_stat_end(bench_result_t *r);
+static int bench_decode(bench_corpus_t *c, mln_u64_t min_ns, bench_result_t *r);
+static int bench_pool_decode(bench_corpus_t *c, mln_u64_t min_ns, bench_result_t *r);
+static int bench_encode(bench_corpus_t *c, mln_u64_t min_ns, bench_result_t *r);
+static int bench_parse(bench_corpus_t *c, mln_u64_t min_ns, bench_result_t *r);
+static void bench_report(bench_corpus_t *c, char *op, mln_u64_t bytes, bench_result_t *r, int ok);
+static void bench_run(bench_corpus_t *c, mln_u64_t min_ns);
+
+static mln_u64_t bench_seed = 0x9e3779b97f4a7c15ULL;
+
+/*
+ * allocation counting
+ */
+#if defined(BENCH_COUNT_ALLOC)
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+static mln_u64_t bench_allocs = 0;
+static mln_s64_t bench_live = 0;
+static mln_s64_t bench_peak = 0;
+
+static inline void bench_account(void *p, mln_s64_t sign)
+{
+    if (p == NULL) return;
+    bench_live += sign * (mln_s64_t)malloc_usable_size(p);
+    if (bench_live > bench_peak) bench_peak = bench_live;
+}
+
+void *malloc(size_t size)
+{
+    void *p = __libc_malloc(size);
+    ++bench_allocs;
+    bench_account(p, 1);
+    return p;
+}
+
+void *calloc(size_t n, size_t size)
+{
+    void *p = __libc_calloc(n, size);
+    ++bench_allocs;
+    bench_account(p, 1);
+    return p;
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    void *p;
+    bench_account(ptr, -1);
+    p = __libc_realloc(ptr, size);
+    ++bench_allocs;
+    bench_account(p == NULL && size? ptr: p, 1);
+    return p;
+}
+
+void free(void *ptr)
+{
+    bench_account(ptr, -1);
+    __libc_free(ptr);
+}
+
+static mln_u64_t bench_allocs_base;
+static mln_s64_t bench_live_base;
+
+static void bench_stat_begin(void)
+{
+    bench_allocs_base = bench_allocs;
+    bench_live_base = bench_peak = bench_live;
+}
+
+static void bench_stat_end(bench_result_t *r)
+{
+    r->allocs = bench_allocs - bench_allocs_base;
+    r->peak = bench_peak - bench_live_base;
+}
+#else
+static void bench_stat_begin(void)
+{
+}
+
+static void bench_stat_end(bench_result_t *r)
+{
+    r->allocs = r->peak = 0;
+}
+#endif
+
+/*
+ * corpora
+ */
+static void bench_buf_reserve(bench_buf_t *b, size_t n)
+{
+    if (b->len + n + 1 <= b->size) return;
+    while (b->len + n + 1 > b->size) b->size = b->size? b->size << 1: 4096;
+    if ((b->data = (char *)realloc(b->data, b->size)) == NULL) {
+        fprintf(stderr, "No memory.\n");
+        exit(1);
+    }
+}
+
+static void bench_buf_append(bench_buf_t *b, const char *s, size_t n)
+{
+    bench_buf_reserve(b, n);
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+    b->data[b->len] = 0;
+}
+
+static void bench_buf_printf(bench_buf_t *b, const char *fmt, ...)
+{
+    char tmp[512];
+    int n;
+    va_list args;
+
+    va_start(args, fmt);
+    n = vsnprintf(tmp, sizeof(tmp), fmt, args);
+    va_end(args);
+    bench_buf_append(b, tmp, n < (int)sizeof(tmp)? n: (int)sizeof(tmp) - 1);
+}
+
+static mln_u64_t bench_rand(void)
+{
+    bench_seed ^= bench_seed << 13;
+    bench_seed ^= bench_seed >> 7;
+    bench_seed ^= bench_seed << 17;
+    return bench_seed;
+}
+
+static void bench_gen_word(bench_buf_t *b, int n)
+{
+    static const char *words[] = {
+        "melon", "json", "the", "quick", "brown", "fox", "jumps", "over",
+        "lazy", "dog", "\\u3053\\u3093\\u306b\\u3061\\u306f", "\xe6\x97\xa5\xe6\x9c\xac",
+        "caf\xc3\xa9", "line\\nbreak", "\\\"quoted\\\"", "http:\\/\\/t.co\\/x",
+    };
+    int i;
+
+    for (i = 0; i < n; ++i) {
+        const char *w = words[bench_rand() % (sizeof(words) / sizeof(words[0]))];
+        if (i) bench_buf_append(b, " ", 1);
+        bench_buf_append(b, w, strlen(w));
+    }
+}
+
+/*
+ * Tweets: many medium objects with long strings, escapes and non-ASCII text.
+ */
+static void bench_gen_twitter(bench_buf_t *b, int scale)
+{
+    int i, n = 200 * scale, k;
+
+    bench_buf_printf(b, "{\"statuses\":[");
+    for (i = 0; i < n; ++i) {
+        mln_u64_t id = 505874924095815681ULL + bench_rand() % 1000000;
+        if (i) bench_buf_append(b, ",", 1);
+        bench_buf_printf(b, "{\"metadata\":{\"result_type\":\"recent\",\"iso_language_code\":\"ja\"},");
+        bench_buf_printf(b, "\"created_at\":\"Sun Aug 31 00:29:15 +0000 2014\",\"id\":%llu,\"id_str\":\"%llu\",\"text\":\"",
+                         (unsigned long long)id, (unsigned long long)id);
+        bench_gen_word(b, 8 + bench_rand() % 16);
+        bench_buf_printf(b, "\",\"source\":\"<a href=\\\"http:\\/\\/twitter.com\\\" rel=\\\"nofollow\\\">Twitter<\\/a>\",");
+        bench_buf_printf(b, "\"truncated\":false,\"in_reply_to_status_id\":null,\"user\":{\"id\":%llu,\"name\":\"",
+                         (unsigned long long)(bench_rand() % 3000000000ULL));
+        bench_gen_word(b, 2);
+        bench_buf_printf(b, "\",\"screen_name\":\"user_%d\",\"location\":\"\",\"description\":\"", i);
+        bench_gen_word(b, 4 + bench_rand() % 12);
+        bench_buf_printf(b, "\",\"url\":null,\"protected\":false,\"followers_count\":%d,\"friends_count\":%d,"
+                            "\"created_at\":\"Sun Jul 13 17:51:15 +0000 2014\",\"utc_offset\":-36000,\"verified\":false,"
+                            "\"profile_background_color\":\"C0DEED\",\"default_profile\":true},",
+                         (int)(bench_rand() % 100000), (int)(bench_rand() % 5000));
+        bench_buf_printf(b, "\"geo\":null,\"coordinates\":null,\"retweet_count\":%d,\"favorite_count\":%d,\"entities\":{\"hashtags\":[",
+                         (int)(bench_rand() % 1000), (int)(bench_rand() % 1000));
+        for (k = bench_rand() % 4; k > 0; --k) {
+            bench_buf_printf(b, "{\"text\":\"tag%d\",\"indices\":[%d,%d]}%s", k, k * 7, k * 7 + 5, k > 1? ",": "");
+        }
+        bench_buf_printf(b, "],\"symbols\":[],\"urls\":[],\"user_mentions\":[]},\"favorited\":false,\"retweeted\":false,\"lang\":\"ja\"}");
+    }
+    bench_buf_printf(b, "],\"search_metadata\":{\"completed_in\":0.087,\"max_id\":505874924095815681,"
+                        "\"query\":\"%%E4%%B8%%80\",\"count\":%d,\"since_id\":0}}", n);
+}
+
+/*
+ * Geometry: a few large arrays of coordinate pairs with full precision floats.
+ */
+static void bench_gen_canada(bench_buf_t *b, int scale)
+{
+    int r, i, rings = 40 * scale, points = 1200;
+    double lon = -65.613616999999977, lat = 43.420273000000009;
+
+    bench_buf_printf(b, "{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"Feature\",\"properties\":{\"name\":\"Canada\"},"
+                        "\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[");
+    for (r = 0; r < rings; ++r) {
+        bench_buf_append(b, r? ",[": "[", r? 2: 1);
+        for (i = 0; i < points; ++i) {
+            lon += ((double)(bench_rand() % 2000) - 1000.0) / 1e6;
+            lat += ((double)(bench_rand() % 2000) - 1000.0) / 1e6;
+            bench_buf_printf(b, "%s[%.17g,%.17g]", i? ",": "", lon, lat);
+        }
+        bench_buf_append(b, "]", 1);
+    }
+    bench_buf_printf(b, "]}}]}");
+}
+
+/*
+ * Catalog: objects keyed by numeric ids, many small integers and short arrays.
+ */
+static void bench_gen_citm(bench_buf_t *b, int scale)
+{
+    int i, k, n = 180 * scale;
+
+    bench_buf_printf(b, "{\"areaNames\":{");
+    for (i = 0; i < n; ++i) {
+        bench_buf_printf(b, "%s\"%d\":\"", i? ",": "", 205705993 + i);
+        bench_gen_word(b, 2);
+        bench_buf_append(b, "\"", 1);
+    }
+    bench_buf_printf(b, "},\"events\":{");
+    for (i = 0; i < n; ++i) {
+        bench_buf_printf(b, "%s\"%d\":{\"description\":null,\"id\":%d,\"logo\":\"\\/images\\/UE0AAAAACEKo6QAAAAZDSVRN\",\"name\":\"",
+                         i? ",": "", 138586341 + i, 138586341 + i);
+        bench_gen_word(b, 3);
+        bench_buf_printf(b, "\",\"subTitle\":null,\"subjectCode\":null,\"subtopicIds\":[337184269,337184283],\"topicIds\":[324846099,107888604]}");
+    }
+    bench_buf_printf(b, "},\"performances\":[");
+    for (i = 0; i < n * 4; ++i) {
+        bench_buf_printf(b, "%s{\"eventId\":%d,\"id\":%d,\"logo\":null,\"name\":null,\"prices\":[",
+                         i? ",": "", 138586341 + i % n, 339887544 + i);
+        for (k = 0; k < 3; ++k) {
+            bench_buf_printf(b, "%s{\"amount\":%d,\"audienceSubCategoryId\":337100890,\"seatCategoryId\":%d}",
+                             k? ",": "", 90250 - k * 23750, 338937295 + k);
+        }
+        bench_buf_printf(b, "],\"seatCategories\":[");
+        for (k = 0; k < 3; ++k) {
+            bench_buf_printf(b, "%s{\"areas\":[{\"areaId\":205705999,\"blockIds\":[]},{\"areaId\":205705998,\"blockIds\":[]}],"
+                                "\"seatCategoryId\":%d}", k? ",": "", 338937295 + k);
+        }
+        bench_buf_printf(b, "],\"seatMapImage\":null,\"start\":%llu,\"venueCode\":\"PLEYEL_PLEYEL\"}",
+                         1372701600000ULL + (unsigned long long)i * 86400000ULL);
+    }
+    bench_buf_printf(b, "],\"venueNames\":{\"PLEYEL_PLEYEL\":\"Salle Pleyel\"}}");
+}
+
+/*
+ * Nesting: alternating objects and arrays, each level holding a few scalars.
+ */
+static void bench_gen_deep(bench_buf_t *b, int scale)
+{
+    int i, depth = 500;
+
+    for (i = 0; i < depth; ++i) {
+        bench_buf_printf(b, "{\"level\":%d,\"name\":\"n%d\",\"child\":[%d,", i, i, i);
+    }
+    bench_buf_printf(b, "null");
+    for (i = 0; i < depth; ++i) {
+        bench_buf_append(b, "]}", 2);
+    }
+    (void)scale;
+}
+
+/*
+ * Width: one object with many members and one long array of scalars.
+ */
+static void bench_gen_wide(bench_buf_t *b, int scale)
+{
+    int i, n = 50000 * scale;
+
+    bench_buf_printf(b, "{\"members\":{");
+    for (i = 0; i < n; ++i) {
+        bench_buf_printf(b, "%s\"key_%08x\":%d", i? ",": "", (unsigned)(bench_rand() & 0xffffffff), i);
+    }
+    bench_buf_printf(b, "},\"values\":[");
+    for (i = 0; i < n; ++i) {
+        switch (i & 3) {
+            case 0: bench_buf_printf(b, "%s%d", i? ",": "", (int)(bench_rand() % 100000)); break;
+            case 1: bench_buf_printf(b, ",%.6f", (double)(bench_rand() % 1000000) / 1000.0); break;
+            case 2: bench_buf_printf(b, ",\"v%d\"", i); break;
+            default: bench_buf_append(b, i & 4? ",true": ",false", i & 4? 5: 6); break;
+        }
+    }
+    bench_buf_printf(b, "]}");
+}
+
+static int bench_load(bench_corpus_t *c, char *file)
+{
+    FILE *fp;
+    long n;
+    char *name;
+
+    if ((fp = fopen(file, "rb")) == NULL) {
+        fprintf(stderr, "Open %s failed.\n", file);
+        return -1;
+    }
+    if (fseek(fp, 0, SEEK_END) < 0 || (n = ftell(fp)) < 0 || fseek(fp, 0, SEEK_SET) < 0) {
+        fprintf(stderr, "Read %s failed.\n", file);
+        fclose(fp);
+        return -1;
+    }
+    bench_buf_reserve(&(c->text), n);
+    if (fread(c->text.data, 1, n, fp) != (size_t)n) {
+        fprintf(stderr, "Read %s failed.\n", file);
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    c->text.len = n;
+    c->text.data[n] = 0;
+    name = strrchr(file, '/');
+    c->name = name == NULL? file: name + 1;
+    return 0;
+}
+
+/*
+ * The expression for mln_json_parse is built from the loaded tree by
+ * following the last member or element at each level, so that large objects
+ * go through their index and large arrays are subscripted at their end.
+ */
+static int bench_last_member(mln_json_t *key, mln_json_t *val, void *data)
+{
+    mln_json_kv_t *kv = (mln_json_kv_t *)data;
+    kv->key = *key;
+    kv->val = *val;
+    return 0;
+}
+
+static void bench_path(bench_corpus_t *c, mln_json_t *j)
+{
+    int depth;
+    mln_json_kv_t kv;
+    mln_string_t *key;
+    mln_uauto_t n;
+
+    for (depth = 0; depth < BENCH_PATH_MAX_DEPTH; ++depth) {
+        if (mln_json_is_object(j)) {
+            if (!mln_array_nelts(&(mln_json_object_data_get(j)->kvs))) break;
+            mln_json_object_iterate(j, bench_last_member, &kv);
+            key = mln_json_string_data_get(&(kv.key));
+            if (memchr(key->data, '.', key->len) != NULL) break;
+            if (depth) bench_buf_append(&(c->path), ".", 1);
+            bench_buf_append(&(c->path), (char *)key->data, key->len);
+            j = mln_json_obj_search(j, key);
+        } else if (mln_json_is_array(j)) {
+            if (!(n = mln_json_array_length(j))) break;
+            bench_buf_printf(&(c->path), "%s%lu", depth? ".": "", (unsigned long)(n - 1));
+            j = mln_json_array_search(j, n - 1);
+        } else {
+            break;
+        }
+    }
+}
+
+static int bench_parse_iterator(mln_json_t *j, void *data)
+{
+    ++(*(mln_u64_t *)data);
+    return 0;
+}
+
+/*
+ * operations
+ */
+static mln_u64_t bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (mln_u64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int bench_decode(bench_corpus_t *c, mln_u64_t min_ns, bench_result_t *r)
+{
+    mln_json_t j;
+    mln_string_t s;
+    mln_u64_t t;
+
+    mln_string_nset(&s, c->text.data, c->text.len);
+
+    bench_stat_begin();
+    if (mln_json_decode(&s, &j) < 0) return -1;
+    bench_stat_end(r);
+    mln_json_destroy(&j);
+
+    for (r->ns = r->n = 0; r->ns < min_ns; ++(r->n)) {
+        t = bench_now();
+        mln_json_decode(&s, &j);
+        r->ns += bench_now() - t;
+        mln_json_destroy(&j);
+    }
+    return 0;
+}
+
+static int bench_pool_decode(bench_corpus_t *c, mln_u64_t min_ns, bench_result_t *r)
+{
+    mln_json_t j;
+    mln_string_t s;
+    mln_alloc_t *pool;
+    mln_u64_t t;
+
+    mln_string_nset(&s, c->text.data, c->text.len);
+
+    bench_stat_begin();
+    if ((pool = mln_alloc_init(NULL)) == NULL) return -1;
+    if (mln_json_pool_decode(pool, &s, &j) < 0) {
+        mln_alloc_destroy(pool);
+        return -1;
+    }
+    bench_stat_end(r);
+    mln_alloc_destroy(pool);
+
+    for (r->ns = r->n = 0; r->ns < min_ns; ++(r->n)) {
+        t = bench_now();
+        if ((pool = mln_alloc_init(NULL)) == NULL) return -1;
+        mln_json_pool_decode(pool, &s, &j);
+        r->ns += bench_now() - t;
+        mln_alloc_destroy(pool);
+    }
+    return 0;
+}
+
+static int bench_encode(bench_corpus_t *c, mln_u64_t min_ns, bench_result_t *r)
+{
+    mln_json_t j;
+    mln_string_t s, *out;
+    mln_u64_t t;
+
+    mln_string_nset(&s, c->text.data, c->text.len);
+    if (mln_json_decode(&s, &j) < 0) return -1;
+
+    bench_stat_begin();
+    if ((out = mln_json_encode(&j)) == NULL) {
+        mln_json_destroy(&j);
+        return -1;
+    }
+    bench_stat_end(r);
+    mln_string_free(out);
+
+    for (r->ns = r->n = 0; r->ns < min_ns; ++(r->n)) {
+        t = bench_now();
+        out = mln_json_encode(&j);
+        r->ns += bench_now() - t;
+        mln_string_free(out);
+    }
+    mln_json_destroy(&j);
+    return 0;
+}
+
+static int bench_parse(bench_corpus_t *c, mln_u64_t min_ns, bench_result_t *r)
+{
+    mln_json_t j;
+    mln_string_t s, exp;
+    mln_u64_t t, hits = 0;
+    int i;
+
+    mln_string_nset(&s, c->text.data, c->text.len);
+    if (mln_json_decode(&s, &j) < 0) return -1;
+    if (!c->path.len) bench_path(c, &j);
+    mln_string_nset(&exp, c->path.data == NULL? "": c->path.data, c->path.len);
+
+    bench_stat_begin();
+    if (!exp.len || mln_json_parse(&j, &exp, bench_parse_iterator, &hits) < 0 || hits != 1) {
+        mln_json_destroy(&j);
+        return -1;
+    }
+    bench_stat_end(r);
+
+    for (r->ns = r->n = 0; r->ns < min_ns; r->n += BENCH_PARSE_BATCH) {
+        t = bench_now();
+        for (i = 0; i < BENCH_PARSE_BATCH; ++i) {
+            mln_json_parse(&j, &exp, bench_parse_iterator, &hits);
+        }
+        r->ns += bench_now() - t;
+    }
+    mln_json_destroy(&j);
+    return 0;
+}
+
+static void bench_report(bench_corpus_t *c, char *op, mln_u64_t bytes, bench_result_t *r, int ok)
+{
+    double sec, ns;
+
+    if (!ok) {
+        printf("%-14s %-12s failed\n", c->name, op);
+        return;
+    }
+    sec = (double)r->ns / 1e9;
+    ns = (double)r->ns / (double)r->n;
+    if (bytes) {
+        printf("%-14s %-12s %10.1f %14.0f", c->name, op, (double)bytes * (double)r->n / sec / 1e6, ns);
+    } else {
+        printf("%-14s %-12s %10s %14.0f", c->name, op, "-", ns);
+    }
+#if defined(BENCH_COUNT_ALLOC)
+    printf(" %12llu %12.1f\n", (unsigned long long)r->allocs, (double)r->peak / 1024.0);
+#else
+    printf(" %12s %12s\n", "-", "-");
+#endif
+}
+
+static void bench_run(bench_corpus_t *c, mln_u64_t min_ns)
+{
+    bench_result_t r;
+
+    printf("%s: %.1f KB\n", c->name, (double)c->text.len / 1024.0);
+    bench_report(c, "decode", c->text.len, &r, bench_decode(c, min_ns, &r) == 0);
+    bench_report(c, "pool_decode", c->text.len, &r, bench_pool_decode(c, min_ns, &r) == 0);
+    bench_report(c, "encode", c->text.len, &r, bench_encode(c, min_ns, &r) == 0);
+    bench_report(c, "parse", 0, &r, bench_parse(c, min_ns, &r) == 0);
+    if (c->path.len) printf("%-14s parse path: %.*s\n", "", (int)c->path.len > 64? 64: (int)c->path.len, c->path.data);
+}
+
+int main(int argc, char *argv[])
+{
+    static struct {
+        char *name;
+        void (*gen)(bench_buf_t *, int);
+    } builtin[] = {
+        {"twitter", bench_gen_twitter},
+        {"canada", bench_gen_canada},
+        {"citm_catalog", bench_gen_citm},
+        {"deep", bench_gen_deep},
+        {"wide", bench_gen_wide},
+    };
+    bench_corpus_t c;
+    mln_u64_t min_ns = 1000000000ULL;
+    int i, files, scale = 1, with_builtin = 1, failed = 0;
+    struct rusage ru;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; ++i) {
+        if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+            min_ns = (mln_u64_t)atoi(argv[++i]) * 1000000ULL;
+        } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            if ((scale = atoi(argv[++i])) <= 0) scale = 1;
+        } else if (!strcmp(argv[i], "-b")) {
+            with_builtin = 0;
+        } else {
+            fprintf(stderr, "Usage: %s [-t ms] [-s scale] [-b] [file ...]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    files = i;
+
+    printf("%-14s %-12s %10s %14s %12s %12s\n", "corpus", "op", "MB/s", "ns/doc", "allocs/doc", "peak KB");
+
+    if (with_builtin) {
+        for (i = 0; i < (int)(sizeof(builtin) / sizeof(builtin[0])); ++i) {
+            memset(&c, 0, sizeof(c));
+            c.name = builtin[i].name;
+            builtin[i].gen(&(c.text), scale);
+            bench_run(&c, min_ns);
+            free(c.text.data);
+            free(c.path.data);
+        }
+    }
+
+    for (i = files; i < argc; ++i) {
+        memset(&c, 0, sizeof(c));
+        if (bench_load(&c, argv[i]) < 0) {
+            failed = 1;
+        } else {
+            bench_run(&c, min_ns);
+        }
+        free(c.text.data);
+        free(c.path.data);
+    }
+
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+        printf("max resident set size: %ld KB\n", ru.ru_maxrss);
+    }
+    return failed;
+}
@@ -5,6 +5,8 @@
 #ifndef __MLN_ARRAY_H
 #define __MLN_ARRAY_H
 
+#include <stdlib.h>
+#include <string.h>
 #include "mln_types.h"
 #include "mln_utils.h"
 
@@ -43,5 +45,161 @@ extern void mln_array_reset(mln_array_t *arr);
 extern void *mln_array_push(mln_array_t *arr) __NONNULL1(1);
 extern void *mln_array_pushn(mln_array_t *arr, mln_size_t n) __NONNULL1(1);
 extern void mln_array_pop(mln_array_t *arr);
+
+/*
+ * Typed array
+ *
+ * MLN_ARRAY_TYPE defines prefix##_t, an array of type whose first n elements are
+ * kept in the structure itself, so an array that never holds more than n elements
+ * never allocates. elts points into the structure until the array outgrows it,
+ * so an array must not be copied or moved while it is in use.
+ * mln_array_elts and mln_array_nelts work on typed arrays as well.
+ */
+typedef void *(*array_pool_realloc_handler)(void *, void *, mln_size_t);
+
+struct mln_array_type_attr {
+    void                       *pool;
+    array_pool_alloc_handler    pool_alloc;
+    array_pool_free_handler     pool_free;
+    array_pool_realloc_handler  pool_realloc;/*optional*/
+    array_free                  free;
+};
+
+#define MLN_ARRAY_TYPE(prefix, type, n) \
+    typedef struct {\
+        type                       *elts;\
+        mln_size_t                  nelts;\
+        mln_size_t                  nalloc;\
+        void                       *pool;\
+        array_pool_alloc_handler    pool_alloc;\
+        array_pool_free_handler     pool_free;\
+        array_pool_realloc_handler  pool_realloc;\
+        array_free                  free;\
+        type                        small[n];\
+    } prefix##_t
+
+#define MLN_ARRAY_FUNC_DECLARE(prefix, type, func_attr) \
+    func_attr void prefix##_init(prefix##_t *a, struct mln_array_type_attr *attr);\
+    func_attr void prefix##_destroy(prefix##_t *a);\
+    func_attr void prefix##_reset(prefix##_t *a);\
+    func_attr int prefix##_reserve(prefix##_t *a, mln_size_t n);\
+    func_attr type *prefix##_push(prefix##_t *a);\
+    func_attr type *prefix##_pushn(prefix##_t *a, mln_size_t n);\
+    func_attr type *prefix##_insert(prefix##_t *a, mln_size_t pos, mln_size_t n);\
+    func_attr void prefix##_erase(prefix##_t *a, mln_size_t pos, mln_size_t n);\
+    func_attr void prefix##_pop(prefix##_t *a);
+
+#define MLN_ARRAY_FUNC_DEFINE(prefix, type, func_attr) \
+    func_attr void prefix##_init(prefix##_t *a, struct mln_array_type_attr *attr)\
+    {\
+        a->elts = a->small;\
+        a->nelts = 0;\
+        a->nalloc = sizeof(a->small) / sizeof(type);\
+        if (attr == NULL || attr->pool == NULL) {\
+            a->pool = NULL;\
+            a->pool_alloc = NULL;\
+            a->pool_free = NULL;\
+            a->pool_realloc = NULL;\
+        } else {\
+            a->pool = attr->pool;\
+            a->pool_alloc = attr->pool_alloc;\
+            a->pool_free = attr->pool_free;\
+            a->pool_realloc = attr->pool_realloc;\
+        }\
+        a->free = attr == NULL? NULL: attr->free;\
+    }\
+    func_attr void prefix##_reset(prefix##_t *a)\
+    {\
+        type *p;\
+        type *end;\
+        if (a->free != NULL) {\
+            for (p = a->elts, end = p + a->nelts; p < end; ++p)\
+                a->free(p);\
+        }\
+        a->nelts = 0;\
+    }\
+    func_attr void prefix##_destroy(prefix##_t *a)\
+    {\
+        if (a == NULL) return;\
+        prefix##_reset(a);\
+        if (a->elts != a->small) {\
+            if (a->pool != NULL) a->pool_free(a->elts);\
+            else free(a->elts);\
+            a->elts = a->small;\
+            a->nalloc = sizeof(a->small) / sizeof(type);\
+        }\
+    }\
+    func_attr int prefix##_reserve(prefix##_t *a, mln_size_t n)\
+    {\
+        type *ptr;\
+        mln_size_t num = a->nalloc;\
+        if (n <= num) return 0;\
+        while (num < n) {\
+            if (num > ((mln_size_t)~0 / sizeof(type)) >> 1) return -1;\
+            num <<= 1;\
+        }\
+        if (a->elts == a->small) {\
+            if (a->pool != NULL) ptr = (type *)a->pool_alloc(a->pool, num * sizeof(type));\
+            else ptr = (type *)malloc(num * sizeof(type));\
+            if (ptr == NULL) return -1;\
+            memcpy(ptr, a->elts, a->nelts * sizeof(type));\
+        } else if (a->pool == NULL) {\
+            if ((ptr = (type *)realloc(a->elts, num * sizeof(type))) == NULL) return -1;\
+        } else if (a->pool_realloc != NULL) {\
+            if ((ptr = (type *)a->pool_realloc(a->pool, a->elts, num * sizeof(type))) == NULL) return -1;\
+        } else {\
+            if ((ptr = (type *)a->pool_alloc(a->pool, num * sizeof(type))) == NULL) return -1;\
+            memcpy(ptr, a->elts, a->nelts * sizeof(type));\
+            a->pool_free(a->elts);\
+        }\
+        a->elts = ptr;\
+        a->nalloc = num;\
+        return 0;\
+    }\
+    func_attr type *prefix##_push(prefix##_t *a)\
+    {\
+        if (a->nelts >= a->nalloc && prefix##_reserve(a, a->nelts + 1) < 0) return NULL;\
+        return &(a->elts[a->nelts++]);\
+    }\
+    func_attr type *prefix##_pushn(prefix##_t *a, mln_size_t n)\
+    {\
+        type *ptr;\
+        if (n > a->nalloc - a->nelts) {\
+            if (n > (mln_size_t)~0 - a->nelts || prefix##_reserve(a, a->nelts + n) < 0) return NULL;\
+        }\
+        ptr = a->elts + a->nelts;\
+        a->nelts += n;\
+        return ptr;\
+    }\
+    func_attr type *prefix##_insert(prefix##_t *a, mln_size_t pos, mln_size_t n)\
+    {\
+        if (pos > a->nelts) return NULL;\
+        if (n > a->nalloc - a->nelts) {\
+            if (n > (mln_size_t)~0 - a->nelts || prefix##_reserve(a, a->nelts + n) < 0) return NULL;\
+        }\
+        memmove(a->elts + pos + n, a->elts + pos, (a->nelts - pos) * sizeof(type));\
+        a->nelts += n;\
+        return a->elts + pos;\
+    }\
+    func_attr void prefix##_erase(prefix##_t *a, mln_size_t pos, mln_size_t n)\
+    {\
+        type *p;\
+        type *end;\
+        if (pos >= a->nelts) return;\
+        if (n > a->nelts - pos) n = a->nelts - pos;\
+        if (a->free != NULL) {\
+            for (p = a->elts + pos, end = p + n; p < end; ++p)\
+                a->free(p);\
+        }\
+        memmove(a->elts + pos, a->elts + pos + n, (a->nelts - pos - n) * sizeof(type));\
+        a->nelts -= n;\
+    }\
+    func_attr void prefix##_pop(prefix##_t *a)\
+    {\
+        if (!a->nelts) return;\
+        if (a->free != NULL) a->free(&(a->elts[a->nelts - 1]));\
+        --a->nelts;\
+    }
+
 #endif
 
@@ -0,0 +1,71 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+#ifndef __MLN_ART_H
+#define __MLN_ART_H
+
+#include "mln_types.h"
+#include "mln_string.h"
+
+/*
+ * Number of prefix bytes stored in a node. A longer prefix is only partly
+ * stored, the rest is read from a leaf below the node when needed.
+ */
+#define M_ART_PREFIX  12
+
+typedef void (*art_free_data)(void *);
+typedef int (*art_iterate_handler)(mln_string_t *key, void *val, void *udata);
+typedef void *(*art_pool_alloc_handler)(void *, mln_size_t);
+typedef void (*art_pool_free_handler)(void *);
+
+struct mln_art_attr {
+    void                      *pool;
+    art_pool_alloc_handler     pool_alloc;
+    art_pool_free_handler      pool_free;
+    art_free_data              data_free;
+};
+
+typedef struct {
+    void                      *val;
+    mln_string_t               key;/*key.data points to the bytes stored after the leaf*/
+} mln_art_leaf_t;
+
+/*
+ * The header shared by the four node types. leaf is the entry whose key
+ * ends right after the prefix of this node, so a key may be a prefix of
+ * other keys.
+ */
+typedef struct {
+    mln_u8_t                   type;
+    mln_u16_t                  nr;/*number of children*/
+    mln_u32_t                  prefix_len;
+    mln_u8_t                   prefix[M_ART_PREFIX];
+    mln_art_leaf_t            *leaf;
+} mln_art_node_t;
+
+typedef struct {
+    void                      *pool;
+    art_pool_alloc_handler     pool_alloc;
+    art_pool_free_handler      pool_free;
+    art_free_data              data_free;
+    void                      *root;/*a node or a tagged leaf*/
+    mln_uauto_t                nr_node;
+} mln_art_t;
+
+#define mln_art_node_num(t)   ((t)->nr_node)
+
+extern mln_art_t *mln_art_new(struct mln_art_attr *attr);
+extern void mln_art_free(mln_art_t *t);
+extern void mln_art_reset(mln_art_t *t) __NONNULL1(1);
+extern int mln_art_insert(mln_art_t *t, mln_string_t *key, void *val) __NONNULL2(1,2);
+extern int mln_art_delete(mln_art_t *t, mln_string_t *key) __NONNULL2(1,2);
+extern void *mln_art_search(mln_art_t *t, mln_string_t *key) __NONNULL2(1,2);
+extern void *mln_art_longest_prefix(mln_art_t *t, mln_string_t *key, mln_size_t *len) __NONNULL2(1,2);
+extern int mln_art_iterate(mln_art_t *t, art_iterate_handler handler, void *udata) __NONNULL2(1,2);
+extern int
+mln_art_prefix_iterate(mln_art_t *t, mln_string_t *prefix, art_iterate_handler handler, void *udata) __NONNULL3(1,2,3);
+
+#endif
+
@@ -0,0 +1,78 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+#ifndef __MLN_BPTREE_H
+#define __MLN_BPTREE_H
+
+#include "mln_types.h"
+
+/*
+ * Maximum number of entries in a leaf, and of children in an inner node.
+ * The keys of a node then take two 64-byte cache lines.
+ */
+#define M_BPTREE_ORDER      16
+#define M_BPTREE_MAX_HEIGHT 32
+
+typedef struct mln_bptree_node_s mln_bptree_node_t;
+typedef void (*bptree_free_data)(void *);
+typedef int (*bptree_iterate_handler)(mln_u64_t key, void *val, void *udata);
+typedef void *(*bptree_pool_alloc_handler)(void *, mln_size_t);
+typedef void (*bptree_pool_free_handler)(void *);
+
+struct mln_bptree_attr {
+    void                      *pool;
+    bptree_pool_alloc_handler  pool_alloc;
+    bptree_pool_free_handler   pool_free;
+    bptree_free_data           data_free;
+};
+
+/*
+ * A leaf holds nr keys and values, an inner node holds nr keys and nr+1
+ * children. All keys in children[i] are between keys[i-1] and keys[i].
+ */
+struct mln_bptree_node_s {
+    mln_u32_t                  leaf:1;
+    mln_u32_t                  nr:31;
+    mln_bptree_node_t         *next;/*the next leaf*/
+    mln_u64_t                  keys[M_BPTREE_ORDER];
+    void                      *ptrs[M_BPTREE_ORDER];/*values or children*/
+};
+
+typedef struct {
+    void                      *pool;
+    bptree_pool_alloc_handler  pool_alloc;
+    bptree_pool_free_handler   pool_free;
+    bptree_free_data           data_free;
+    mln_bptree_node_t         *root;
+    mln_bptree_node_t         *head;/*the leftmost leaf, never freed before the tree*/
+    mln_uauto_t                nr_node;
+    mln_u32_t                  height;
+} mln_bptree_t;
+
+typedef struct {
+    mln_bptree_node_t         *leaf;
+    mln_u32_t                  index;
+} mln_bptree_iter_t;
+
+#define mln_bptree_node_num(ptree)   ((ptree)->nr_node)
+#define mln_bptree_iter_key(it)      ((it)->leaf->keys[(it)->index])
+#define mln_bptree_iter_val(it)      ((it)->leaf->ptrs[(it)->index])
+
+extern mln_bptree_t *mln_bptree_new(struct mln_bptree_attr *attr);
+extern void mln_bptree_free(mln_bptree_t *t);
+extern void mln_bptree_reset(mln_bptree_t *t) __NONNULL1(1);
+extern int mln_bptree_insert(mln_bptree_t *t, mln_u64_t key, void *val) __NONNULL1(1);
+extern int mln_bptree_delete(mln_bptree_t *t, mln_u64_t key, void *val) __NONNULL1(1);
+extern int mln_bptree_load(mln_bptree_t *t, mln_u64_t *keys, void **vals, mln_size_t n) __NONNULL2(1,2);
+extern int mln_bptree_search(mln_bptree_t *t, mln_u64_t key, mln_bptree_iter_t *it) __NONNULL2(1,3);
+extern int mln_bptree_lower_bound(mln_bptree_t *t, mln_u64_t key, mln_bptree_iter_t *it) __NONNULL2(1,3);
+extern int mln_bptree_min(mln_bptree_t *t, mln_bptree_iter_t *it) __NONNULL2(1,2);
+extern int mln_bptree_successor(mln_bptree_t *t, mln_bptree_iter_t *it) __NONNULL2(1,2);
+extern int mln_bptree_iterate(mln_bptree_t *t, bptree_iterate_handler handler, void *udata) __NONNULL2(1,2);
+extern int
+mln_bptree_range(mln_bptree_t *t, mln_u64_t low, mln_u64_t high, bptree_iterate_handler handler, void *udata) __NONNULL2(1,4);
+
+#endif
+
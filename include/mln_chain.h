@@ -11,6 +11,12 @@
 #include "mln_alloc.h"
 #include "mln_file.h"
 
+typedef struct mln_buf_shared_s {
+    mln_u8ptr_t         data;
+    mln_size_t          size;
+    mln_u32_t           refs;
+} mln_buf_shared_t;
+
 typedef struct mln_buf_s {
     mln_u8ptr_t         left_pos;
     mln_u8ptr_t         pos;
@@ -18,6 +24,7 @@ typedef struct mln_buf_s {
     mln_u8ptr_t         start;
     mln_u8ptr_t         end;
     struct mln_buf_s   *shadow;
+    mln_buf_shared_t   *shared;
     mln_off_t           file_left_pos;
     mln_off_t           file_pos;
     mln_off_t           file_last;
@@ -63,6 +70,10 @@ extern mln_chain_t *mln_chain_new(mln_alloc_t *pool);
 extern void mln_buf_pool_release(mln_buf_t *b);
 extern void mln_chain_pool_release(mln_chain_t *c);
 extern void mln_chain_pool_release_all(mln_chain_t *c);
+extern mln_buf_shared_t *mln_buf_shared_new(mln_size_t size);
+extern mln_buf_shared_t *mln_buf_shared_ref(mln_buf_shared_t *s) __NONNULL1(1);
+extern void mln_buf_shared_free(mln_buf_shared_t *s);
+extern mln_chain_t *mln_chain_shared_new(mln_alloc_t *pool, mln_buf_shared_t *s) __NONNULL2(1,2);
 
 
 #endif
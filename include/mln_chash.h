@@ -0,0 +1,65 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+#ifndef __MLN_CHASH_H
+#define __MLN_CHASH_H
+
+#include <pthread.h>
+#include "mln_types.h"
+#include "mln_hash.h"
+
+#define M_CHASH_DEFAULT_STRIPES 16
+#define M_CHASH_MAX_STRIPES     65536
+#define M_CHASH_ROUTE_LEN       0x80000000U/*len seen by hash() when selecting a stripe*/
+
+typedef void (*chash_access_handler)(void * /*val*/, void *);
+typedef int (*chash_iterate_handler)(void * /*key*/, void * /*val*/, void *);
+
+/*
+ * Each stripe is padded to its own cache lines,
+ * so threads working on different stripes do not share lock cache lines.
+ */
+typedef union {
+    struct {
+        pthread_rwlock_t     lock;
+        mln_hash_t          *h;
+    } s;
+    mln_u8_t                 padding[128];
+} mln_chash_stripe_t;
+
+typedef struct {
+    mln_chash_stripe_t      *stripes;
+    mln_u32_t                nr_stripes;
+    mln_u32_t                mask;
+    /*
+     * Only len, open_addressing and hash are set. It is passed to hash()
+     * for selecting the stripe of a key, and never modified after creation.
+     */
+    mln_hash_t               route;
+} mln_chash_t;
+
+extern mln_chash_t *
+mln_chash_new(struct mln_hash_attr *attr, mln_u32_t nr_stripes, mln_u32_t mode) __NONNULL1(1);
+extern void mln_chash_free(mln_chash_t *ch, mln_hash_flag_t flg);
+extern void *
+mln_chash_search(mln_chash_t *ch, void *key) __NONNULL2(1,2);
+extern int
+mln_chash_access(mln_chash_t *ch, void *key, chash_access_handler handler, void *udata) __NONNULL3(1,2,3);
+extern int
+mln_chash_key_exist(mln_chash_t *ch, void *key) __NONNULL2(1,2);
+extern int
+mln_chash_insert(mln_chash_t *ch, void *key, void *val) __NONNULL2(1,2);
+extern int
+mln_chash_update(mln_chash_t *ch, void *key, void *val) __NONNULL3(1,2,3);
+extern void *
+mln_chash_change_value(mln_chash_t *ch, void *key, void *new_value) __NONNULL2(1,2);
+extern void
+mln_chash_remove(mln_chash_t *ch, void *key, mln_hash_flag_t flg) __NONNULL2(1,2);
+extern int
+mln_chash_iterate(mln_chash_t *ch, chash_iterate_handler handler, void *udata) __NONNULL2(1,2);
+extern mln_u64_t mln_chash_nr_nodes(mln_chash_t *ch) __NONNULL1(1);
+
+#endif
+
@@ -0,0 +1,108 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+#ifndef __MLN_DHEAP_H
+#define __MLN_DHEAP_H
+
+#include "mln_types.h"
+
+/*
+ * A slot takes 16 bytes, so the 4 children of an element fill one 64-byte cache line.
+ */
+#define M_DHEAP_ARITY      4
+#define M_DHEAP_INIT_SIZE  64
+
+/*
+ * The same as fheap_cmp.
+ * return value: 0 - p1 < p2   !0 - p1 >= p2
+ */
+typedef int (*dheap_cmp)(const void *, const void *);
+/*
+ * the left argument is the destination and the right
+ * one is the source.
+ */
+typedef void (*dheap_copy)(void *, void *);
+typedef void (*dheap_key_free)(void *);
+typedef void *(*dheap_pool_alloc_handler)(void *, mln_size_t);
+typedef void (*dheap_pool_free_handler)(void *);
+
+struct mln_dheap_attr {
+    void                     *pool;
+    dheap_pool_alloc_handler  pool_alloc;
+    dheap_pool_free_handler   pool_free;
+    dheap_cmp                 cmp;
+    dheap_copy                copy;
+    dheap_key_free            key_free;
+};
+
+/*
+ * A node is the handle of an element, index is its current position in the array.
+ */
+typedef struct {
+    void                     *key;
+    mln_size_t                index;
+    mln_u32_t                 nofree:1;
+} mln_dheap_node_t;
+
+typedef struct {
+    void                     *key;
+    mln_dheap_node_t         *node;
+} mln_dheap_slot_t;
+
+typedef struct {
+    void                     *buf;
+    /*
+     * buf rounded up to a cache line plus M_DHEAP_ARITY - 1 slots,
+     * so the children of every element start at a cache line.
+     */
+    mln_dheap_slot_t         *base;
+    mln_size_t                num;
+    mln_size_t                size;
+    dheap_cmp                 cmp;
+    dheap_copy                copy;
+    dheap_key_free            key_free;
+    void                     *pool;
+    dheap_pool_alloc_handler  pool_alloc;
+    dheap_pool_free_handler   pool_free;
+} mln_dheap_t;
+
+#define mln_dheap_node_init(dn, k) ({\
+    (dn)->key = (k);\
+    (dn)->index = 0;\
+    (dn)->nofree = 1;\
+    (dn);\
+})
+
+#define mln_dheap_node_key(node)   ((node)->key)
+#define mln_dheap_minimum(dh)      ((dh)->num? (dh)->base[0].node: NULL)
+#define mln_dheap_node_num(dh)     ((dh)->num)
+
+extern mln_dheap_t *
+mln_dheap_new(struct mln_dheap_attr *attr);
+extern void
+mln_dheap_free(mln_dheap_t *dh);
+/*
+ * return value: -1 - no memory   0 - on success
+ */
+extern int
+mln_dheap_insert(mln_dheap_t *dh, mln_dheap_node_t *dn) __NONNULL2(1,2);
+extern mln_dheap_node_t *
+mln_dheap_extract_min(mln_dheap_t *dh) __NONNULL1(1);
+/*
+ * return value: -1 - key error   0 - on success
+ */
+extern int
+mln_dheap_decrease_key(mln_dheap_t *dh, mln_dheap_node_t *node, void *key) __NONNULL3(1,2,3);
+extern void
+mln_dheap_delete(mln_dheap_t *dh, mln_dheap_node_t *node) __NONNULL2(1,2);
+
+/*mln_dheap_node_t*/
+extern mln_dheap_node_t *
+mln_dheap_node_new(mln_dheap_t *dh, void *key) __NONNULL2(1,2);
+extern void
+mln_dheap_node_free(mln_dheap_t *dh, mln_dheap_node_t *dn) __NONNULL1(1);
+
+#endif
+
@@ -23,7 +23,7 @@
 #include <unistd.h>
 #include <signal.h>
 #include "mln_rbtree.h"
-#include "mln_fheap.h"
+#include "mln_pheap.h"
 
 /*common*/
 #define M_EV_HASH_LEN 64
@@ -51,7 +51,7 @@
 
 typedef struct mln_event_s      mln_event_t;
 typedef struct mln_event_desc_s mln_event_desc_t;
-typedef mln_fheap_node_t        mln_event_timer_t;
+typedef mln_pheap_node_t        mln_event_timer_t;/*was mln_fheap_node_t, only pass it to mln_event_timer_cancel*/
 
 typedef void (*ev_fd_handler)  (mln_event_t *, int, void *);
 typedef void (*ev_tm_handler)  (mln_event_t *, void *);
@@ -83,7 +83,7 @@ typedef struct mln_event_fd_s {
     ev_fd_handler            err_handler;
     void                    *timeout_data;
     ev_fd_handler            timeout_handler;
-    mln_fheap_node_t        *timeout_node;
+    mln_pheap_node_t        *timeout_node;
     mln_u64_t                end_us;
 } mln_event_fd_t;
 
@@ -132,8 +132,8 @@ struct mln_event_s {
     mln_event_desc_t        *ev_fd_wait_tail;
     mln_event_desc_t        *ev_fd_active_head;
     mln_event_desc_t        *ev_fd_active_tail;
-    mln_fheap_t             *ev_fd_timeout_heap;
-    mln_fheap_t             *ev_timer_heap;
+    mln_pheap_t             *ev_fd_timeout_heap;
+    mln_pheap_t             *ev_timer_heap;
 };
 
 #define mln_event_break_set(ev) ((ev)->is_break = 1);
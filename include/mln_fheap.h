@@ -202,6 +202,8 @@ mln_fheap_remove_child(mln_fheap_node_t **root)
     if (cmp == NULL) cmp = (fh)->cmp;\
     mln_fheap_add_child(&((fh)->root_list), (fn));\
     (fn)->parent = NULL;\
+    (fn)->degree = 0;\
+    (fn)->mark = FHEAP_FALSE;\
     if ((fh)->min == NULL) {\
         (fh)->min = (fn);\
     } else {\
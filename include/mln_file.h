@@ -20,7 +20,7 @@ typedef struct mln_file_s {
     mln_u32_t          is_tmp:1;
     mln_string_t      *file_path;
     mln_fileset_t     *fset;
-    mln_rbtree_node_t *node;
+    mln_rbtree_link_t  link;
     size_t             refer_cnt;
     size_t             size;
     time_t             mtime;
@@ -30,7 +30,7 @@ typedef struct mln_file_s {
 
 struct mln_fileset_s {
     mln_alloc_t       *pool;
-    mln_rbtree_t      *reg_file_tree;
+    mln_rbtree_head_t  reg_file_tree;
     mln_file_t        *reg_free_head;
     mln_file_t        *reg_free_tail;
     mln_size_t         max_file;
@@ -41,6 +41,13 @@ struct mln_hash_attr {
     hash_pool_free_handler   pool_free;
 };
 
+/*
+ * modes of mln_hash_init_mode and mln_hash_new_mode,
+ * mln_hash_init and mln_hash_new use none of them.
+ */
+#define M_HASH_OPEN_ADDRESSING   0x1/*slots probed by control bytes instead of bucket lists*/
+#define M_HASH_INCREMENTAL       0x2/*buckets are moved step by step when resizing*/
+
 typedef struct mln_hash_entry_s {
     struct mln_hash_entry_s *prev;
     struct mln_hash_entry_s *next;
@@ -59,6 +66,11 @@ struct mln_hash_mgr_s {
     mln_hash_entry_t        *tail;
 };
 
+typedef struct {
+    void                    *key;
+    void                    *val;
+} mln_hash_slot_t;
+
 struct mln_hash_s {
     mln_hash_mgr_t          *tbl;
     mln_u64_t                len;
@@ -70,19 +82,43 @@ struct mln_hash_s {
     mln_u32_t                threshold;
     mln_u32_t                expandable:1;
     mln_u32_t                calc_prime:1;
+    mln_u32_t                open_addressing:1;
+    mln_u32_t                incremental:1;
+    mln_u32_t                iterating:1;
+    mln_u32_t                iter_removed:1;
     void                    *pool;
     hash_pool_alloc_handler  pool_alloc;
     hash_pool_free_handler   pool_free;
     mln_hash_entry_t        *iter_head;
     mln_hash_entry_t        *iter_tail;
     mln_hash_entry_t        *iter;
+    /*
+     * incremental resizing: buckets of old_tbl below rehash_pos have been
+     * moved into tbl, the others are still in use.
+     */
+    mln_hash_mgr_t          *old_tbl;
+    mln_u64_t                old_len;
+    mln_u64_t                rehash_pos;
+    /*
+     * open addressing: len is the number of slots, a power of 2. Each slot has
+     * a control byte holding 7 bits of its hash, or marking it empty or deleted.
+     */
+    mln_u8ptr_t              ctrl;
+    mln_hash_slot_t         *slots;
+    mln_u64_t                growth_left;/*insertions left before resizing*/
+    mln_u64_t                iter_slot;
+    mln_hash_flag_t          iter_flag;
 };
 
 extern int
 mln_hash_init(mln_hash_t *h, struct mln_hash_attr *attr) __NONNULL2(1,2);
+extern int
+mln_hash_init_mode(mln_hash_t *h, struct mln_hash_attr *attr, mln_u32_t mode) __NONNULL2(1,2);
 extern void mln_hash_destroy(mln_hash_t *h, mln_hash_flag_t flg);
 extern mln_hash_t *
 mln_hash_new(struct mln_hash_attr *attr) __NONNULL1(1);
+extern mln_hash_t *
+mln_hash_new_mode(struct mln_hash_attr *attr, mln_u32_t mode) __NONNULL1(1);
 extern void
 mln_hash_free(mln_hash_t *h, mln_hash_flag_t flg);
 extern void *
@@ -108,5 +144,27 @@ mln_hash_change_value(mln_hash_t *h, void *key, void *new_value) __NONNULL2(1,2)
 extern int mln_hash_key_exist(mln_hash_t *h, void *key) __NONNULL2(1,2);
 extern void mln_hash_reset(mln_hash_t *h, mln_hash_flag_t flg) __NONNULL1(1);
 
+/*
+ * Built-in hash functions.
+ * They are seeded by a random value chosen once per process, so collisions
+ * can not be predicted from outside. The handlers reduce the result by
+ * masking if len is a power of 2, otherwise by modulo, and return the full
+ * hash value to open addressing tables.
+ */
+extern mln_u64_t mln_hash_seed(void);
+extern void mln_hash_seed_set(mln_u64_t seed);
+extern mln_u64_t mln_hash_bytes(const void *data, mln_size_t len, mln_u64_t seed);
+extern mln_u64_t mln_hash_bytes_case(const void *data, mln_size_t len, mln_u64_t seed);
+extern mln_u64_t mln_hash_string(mln_hash_t *h, void *key) __NONNULL2(1,2);
+extern mln_u64_t mln_hash_string_case(mln_hash_t *h, void *key) __NONNULL2(1,2);
+extern mln_u64_t mln_hash_ptr(mln_hash_t *h, void *key) __NONNULL1(1);
+extern mln_u64_t mln_hash_u32(mln_hash_t *h, void *key) __NONNULL2(1,2);
+extern mln_u64_t mln_hash_u64(mln_hash_t *h, void *key) __NONNULL2(1,2);
+extern int mln_hash_string_cmp(mln_hash_t *h, void *key1, void *key2) __NONNULL3(1,2,3);
+extern int mln_hash_string_case_cmp(mln_hash_t *h, void *key1, void *key2) __NONNULL3(1,2,3);
+extern int mln_hash_ptr_cmp(mln_hash_t *h, void *key1, void *key2) __NONNULL1(1);
+extern int mln_hash_u32_cmp(mln_hash_t *h, void *key1, void *key2) __NONNULL3(1,2,3);
+extern int mln_hash_u64_cmp(mln_hash_t *h, void *key1, void *key2) __NONNULL3(1,2,3);
+
 #endif
 
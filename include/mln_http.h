@@ -10,7 +10,7 @@
 #include "mln_string.h"
 #include "mln_alloc.h"
 
-#define M_HTTP_HASH_LEN                        31
+#define M_HTTP_HASH_LEN                        32
 #define M_HTTP_GENERATE_ALLOC_SIZE             1024
 
 /*http type*/
@@ -0,0 +1,280 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+#ifndef __MLN_HTTP2_H
+#define __MLN_HTTP2_H
+
+#include "mln_connection.h"
+#include "mln_string.h"
+#include "mln_chain.h"
+#include "mln_alloc.h"
+#include "mln_array.h"
+#include "mln_rbtree.h"
+
+/*
+ * return value
+ */
+#define M_HTTP2_RET_OK                        0
+#define M_HTTP2_RET_DONE                      1
+#define M_HTTP2_RET_ERROR                     2
+/*
+ * endpoint type
+ */
+#define M_HTTP2_SERVER                        1
+#define M_HTTP2_CLIENT                        2
+/*
+ * frame type
+ */
+#define M_HTTP2_FRAME_DATA                    0x0
+#define M_HTTP2_FRAME_HEADERS                 0x1
+#define M_HTTP2_FRAME_PRIORITY                0x2
+#define M_HTTP2_FRAME_RST_STREAM              0x3
+#define M_HTTP2_FRAME_SETTINGS                0x4
+#define M_HTTP2_FRAME_PUSH_PROMISE            0x5
+#define M_HTTP2_FRAME_PING                    0x6
+#define M_HTTP2_FRAME_GOAWAY                  0x7
+#define M_HTTP2_FRAME_WINDOW_UPDATE           0x8
+#define M_HTTP2_FRAME_CONTINUATION            0x9
+/*
+ * frame flags
+ */
+#define M_HTTP2_FLAG_NONE                     0x0
+#define M_HTTP2_FLAG_END_STREAM               0x1
+#define M_HTTP2_FLAG_ACK                      0x1
+#define M_HTTP2_FLAG_END_HEADERS              0x4
+#define M_HTTP2_FLAG_PADDED                   0x8
+#define M_HTTP2_FLAG_PRIORITY                 0x20
+/*
+ * settings identifier
+ */
+#define M_HTTP2_SETTINGS_HEADER_TABLE_SIZE    0x1
+#define M_HTTP2_SETTINGS_ENABLE_PUSH          0x2
+#define M_HTTP2_SETTINGS_MAX_CONCURRENT       0x3
+#define M_HTTP2_SETTINGS_INITIAL_WINDOW_SIZE  0x4
+#define M_HTTP2_SETTINGS_MAX_FRAME_SIZE       0x5
+#define M_HTTP2_SETTINGS_MAX_HEADER_LIST_SIZE 0x6
+/*
+ * error code
+ */
+#define M_HTTP2_NO_ERROR                      0x0
+#define M_HTTP2_PROTOCOL_ERROR                0x1
+#define M_HTTP2_INTERNAL_ERROR                0x2
+#define M_HTTP2_FLOW_CONTROL_ERROR            0x3
+#define M_HTTP2_SETTINGS_TIMEOUT              0x4
+#define M_HTTP2_STREAM_CLOSED                 0x5
+#define M_HTTP2_FRAME_SIZE_ERROR              0x6
+#define M_HTTP2_REFUSED_STREAM                0x7
+#define M_HTTP2_CANCEL                        0x8
+#define M_HTTP2_COMPRESSION_ERROR             0x9
+#define M_HTTP2_CONNECT_ERROR                 0xa
+#define M_HTTP2_ENHANCE_YOUR_CALM             0xb
+#define M_HTTP2_INADEQUATE_SECURITY           0xc
+#define M_HTTP2_HTTP_1_1_REQUIRED             0xd
+/*
+ * default values (RFC 7540 section 6.5.2)
+ */
+#define M_HTTP2_FRAME_HEADER_LEN              9
+#define M_HTTP2_DEFAULT_TABLE_SIZE            4096
+#define M_HTTP2_DEFAULT_WINDOW_SIZE           65535
+#define M_HTTP2_DEFAULT_FRAME_SIZE            16384
+#define M_HTTP2_MAX_FRAME_SIZE                16777215
+#define M_HTTP2_MAX_WINDOW_SIZE               0x7fffffff
+#define M_HTTP2_DEFAULT_MAX_STREAMS           100
+#define M_HTTP2_DEFAULT_HEADER_LIST_SIZE      65536
+
+enum mln_http2_stream_state {
+    M_HTTP2_STATE_IDLE = 0,
+    M_HTTP2_STATE_OPEN,
+    M_HTTP2_STATE_HALF_CLOSED_LOCAL,
+    M_HTTP2_STATE_HALF_CLOSED_REMOTE,
+    M_HTTP2_STATE_CLOSED
+};
+
+typedef struct mln_http2_s        mln_http2_t;
+typedef struct mln_http2_stream_s mln_http2_stream_t;
+
+typedef struct {
+    mln_string_t                *name;
+    mln_string_t                *value;
+} mln_http2_field_t;
+
+/*
+ * HPACK context (RFC 7541).
+ * The dynamic table is a ring buffer, entries[head] is the newest entry.
+ */
+typedef struct {
+    mln_alloc_t                 *pool;
+    mln_http2_field_t           *entries;
+    mln_size_t                   nalloc;
+    mln_size_t                   head;
+    mln_size_t                   nentries;
+    mln_size_t                   size;
+    mln_size_t                   max_size;
+    mln_size_t                   limit;
+    mln_u32_t                    update:1;
+} mln_http2_hpack_t;
+
+struct mln_http2_settings {
+    mln_u32_t                    header_table_size;
+    mln_u32_t                    enable_push;
+    mln_u32_t                    max_concurrent_streams;
+    mln_u32_t                    initial_window_size;
+    mln_u32_t                    max_frame_size;
+    mln_u32_t                    max_header_list_size;
+};
+
+/*
+ * mln_http2_headers_handler is called when a complete header block is received,
+ * mln_http2_data_handler is called for every DATA frame payload,
+ * mln_http2_window_handler is called when the send window of a stream is opened
+ * (stream is NULL if it is the connection window),
+ * mln_http2_close_handler is called just before a stream is freed.
+ * A handler returns M_HTTP2_RET_OK to continue, otherwise the stream will be reset.
+ */
+typedef int  (*mln_http2_headers_handler)(mln_http2_t *, mln_http2_stream_t *, int /*end_stream*/);
+typedef int  (*mln_http2_data_handler)(mln_http2_t *, mln_http2_stream_t *, mln_u8ptr_t, mln_size_t, int /*end_stream*/);
+typedef void (*mln_http2_window_handler)(mln_http2_t *, mln_http2_stream_t *);
+typedef void (*mln_http2_close_handler)(mln_http2_t *, mln_http2_stream_t *, mln_u32_t /*error code*/);
+
+struct mln_http2_stream_s {
+    mln_u32_t                    id;
+    enum mln_http2_stream_state  state;
+    mln_s64_t                    send_window;
+    mln_s64_t                    recv_window;
+    mln_array_t                 *fields;
+    void                        *data;
+    mln_rbtree_node_t            node;
+};
+
+struct mln_http2_s {
+    mln_tcp_conn_t              *connection;
+    mln_alloc_t                 *pool;
+    void                        *data;
+    mln_http2_hpack_t            decoder;
+    mln_http2_hpack_t            encoder;
+    struct mln_http2_settings    local;
+    struct mln_http2_settings    remote;
+    mln_rbtree_t                *streams;
+    mln_s64_t                    send_window;
+    mln_s64_t                    recv_window;
+    mln_u32_t                    nr_streams;
+    mln_u32_t                    last_peer_id;
+    mln_u32_t                    next_id;
+    mln_u32_t                    error;
+    mln_u8ptr_t                  hblock;
+    mln_size_t                   hblock_len;
+    mln_size_t                   hblock_size;
+    mln_u32_t                    hblock_stream;
+    mln_u32_t                    hblock_end_stream:1;
+    mln_u32_t                    type:2;
+    mln_u32_t                    preface:1;
+    mln_u32_t                    goaway_sent:1;
+    mln_u32_t                    goaway_recv:1;
+    mln_http2_headers_handler    headers_handler;
+    mln_http2_data_handler       data_handler;
+    mln_http2_window_handler     window_handler;
+    mln_http2_close_handler      close_handler;
+};
+
+#define mln_http2_connection_get(h2)          ((h2)->connection)
+#define mln_http2_pool_get(h2)                ((h2)->pool)
+#define mln_http2_data_get(h2)                ((h2)->data)
+#define mln_http2_data_set(h2,d)              (h2)->data = (d)
+#define mln_http2_error_get(h2)               ((h2)->error)
+#define mln_http2_local_settings_get(h2)      (&((h2)->local))
+#define mln_http2_remote_settings_get(h2)     (&((h2)->remote))
+#define mln_http2_send_window_get(h2)         ((h2)->send_window)
+#define mln_http2_headers_handler_set(h2,h)   (h2)->headers_handler = (h)
+#define mln_http2_data_handler_set(h2,h)      (h2)->data_handler = (h)
+#define mln_http2_window_handler_set(h2,h)    (h2)->window_handler = (h)
+#define mln_http2_close_handler_set(h2,h)     (h2)->close_handler = (h)
+
+#define mln_http2_stream_id_get(s)            ((s)->id)
+#define mln_http2_stream_state_get(s)         ((s)->state)
+#define mln_http2_stream_data_get(s)          ((s)->data)
+#define mln_http2_stream_data_set(s,d)        (s)->data = (d)
+#define mln_http2_stream_send_window_get(s)   ((s)->send_window)
+#define mln_http2_stream_fields_get(s)        ((mln_http2_field_t *)mln_array_elts((s)->fields))
+#define mln_http2_stream_nfields_get(s)       mln_array_nelts((s)->fields)
+
+/*
+ * HPACK
+ */
+extern int mln_http2_hpack_init(mln_http2_hpack_t *hp, mln_alloc_t *pool, mln_size_t max_size) __NONNULL2(1,2);
+extern void mln_http2_hpack_destroy(mln_http2_hpack_t *hp);
+extern void mln_http2_hpack_size_set(mln_http2_hpack_t *hp, mln_size_t max_size) __NONNULL1(1);
+/*
+ * mln_http2_hpack_decode():
+ * Decode a complete header block, decoded fields are appended to 'fields'
+ * whose element type is mln_http2_field_t.
+ */
+extern int mln_http2_hpack_decode(mln_http2_hpack_t *hp, mln_u8ptr_t buf, mln_size_t len, mln_array_t *fields) __NONNULL3(1,2,4);
+/*
+ * mln_http2_hpack_encode():
+ * Encode fields into 'out'. The return value is the number of bytes written,
+ * or 0 if 'size' is not enough. (name length + value length + 18) bytes for each
+ * field plus 6 bytes are always enough.
+ */
+extern mln_size_t mln_http2_hpack_encode(mln_http2_hpack_t *hp, mln_http2_field_t *fields, mln_size_t n, mln_u8ptr_t out, mln_size_t size) __NONNULL2(1,4);
+extern mln_size_t mln_http2_huffman_encode_length(mln_u8ptr_t in, mln_size_t len);
+extern mln_size_t mln_http2_huffman_encode(mln_u8ptr_t in, mln_size_t len, mln_u8ptr_t out);
+/*
+ * mln_http2_huffman_decode():
+ * 'out' should be at least (len * 8 / 5) bytes.
+ * Return the number of decoded bytes, -1 on error.
+ */
+extern mln_sauto_t mln_http2_huffman_decode(mln_u8ptr_t in, mln_size_t len, mln_u8ptr_t out);
+
+/*
+ * HTTP/2 connection
+ */
+extern mln_http2_t *mln_http2_init(mln_tcp_conn_t *connection, mln_u32_t type, void *data) __NONNULL1(1);
+extern void mln_http2_destroy(mln_http2_t *h2);
+/*
+ * mln_http2_parse():
+ * Parse all complete frames in 'in'. Control frames are answered automatically,
+ * and the answers are appended into the send chain of the connection.
+ * M_HTTP2_RET_OK - need more data.
+ * M_HTTP2_RET_DONE - peer sent GOAWAY.
+ * M_HTTP2_RET_ERROR - connection error, GOAWAY has been appended to the send chain,
+ *                     error code can be got via mln_http2_error_get().
+ */
+extern int mln_http2_parse(mln_http2_t *h2, mln_chain_t **in) __NONNULL2(1,2);
+/*
+ * mln_http2_preface_generate():
+ * Client sends connection preface and SETTINGS, server only sends SETTINGS.
+ */
+extern int mln_http2_preface_generate(mln_http2_t *h2) __NONNULL1(1);
+extern int mln_http2_settings_generate(mln_http2_t *h2) __NONNULL1(1);
+extern int mln_http2_ping_generate(mln_http2_t *h2, mln_u8ptr_t opaque, int ack) __NONNULL2(1,2);
+extern int mln_http2_goaway_generate(mln_http2_t *h2, mln_u32_t error) __NONNULL1(1);
+extern int mln_http2_window_update_generate(mln_http2_t *h2, mln_http2_stream_t *stream, mln_u32_t increment) __NONNULL1(1);
+extern int mln_http2_rst_stream_generate(mln_http2_t *h2, mln_http2_stream_t *stream, mln_u32_t error) __NONNULL2(1,2);
+extern int mln_http2_headers_generate(mln_http2_t *h2, \
+                                      mln_http2_stream_t *stream, \
+                                      mln_http2_field_t *fields, \
+                                      mln_size_t n, \
+                                      int end_stream) __NONNULL3(1,2,3);
+/*
+ * mln_http2_data_generate():
+ * At most min(stream window, connection window) bytes are framed,
+ * the number of framed bytes is returned by 'sent'. The rest should be
+ * sent again in window_handler. END_STREAM is only set if all data is framed.
+ */
+extern int mln_http2_data_generate(mln_http2_t *h2, \
+                                   mln_http2_stream_t *stream, \
+                                   mln_u8ptr_t buf, \
+                                   mln_size_t len, \
+                                   int end_stream, \
+                                   mln_size_t *sent) __NONNULL2(1,2);
+
+/*
+ * streams
+ */
+extern mln_http2_stream_t *mln_http2_stream_new(mln_http2_t *h2) __NONNULL1(1);
+extern mln_http2_stream_t *mln_http2_stream_search(mln_http2_t *h2, mln_u32_t id) __NONNULL1(1);
+extern mln_string_t *mln_http2_field_get(mln_http2_stream_t *stream, mln_string_t *name) __NONNULL2(1,2);
+extern int mln_http2_field_append(mln_alloc_t *pool, mln_array_t *fields, mln_string_t *name, mln_string_t *value) __NONNULL4(1,2,3,4);
+
+#endif
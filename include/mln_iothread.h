@@ -6,11 +6,18 @@
 #define __MLN_IOTHREAD_H
 
 #include "mln_types.h"
+#include "mln_ring.h"
 #include <pthread.h>
 
 typedef struct mln_iothread_msg_s mln_iothread_msg_t;
 typedef struct mln_iothread_s     mln_iothread_t;
 
+/*
+ * Messages are passed through lock-free rings, the locked lists
+ * only hold the messages that arrive while a ring is full.
+ */
+#define M_IOTHREAD_RING_LEN 1024
+
 typedef enum {
     io_thread,
     user_thread
@@ -51,6 +58,12 @@ struct mln_iothread_s {
     mln_u32_t                   nthread;
     mln_iothread_msg_t         *user_head;
     mln_iothread_msg_t         *user_tail;
+    mln_ring_t                 *io_ring;
+    mln_ring_t                 *user_ring;
+    mln_u32_t                   io_pending;/*a notification byte is on the way*/
+    mln_u32_t                   user_pending;
+    mln_u32_t                   io_overflow;/*the locked list is in use*/
+    mln_u32_t                   user_overflow;
 };
 
 #define mln_iothread_sockfd_get(p,t)   ((t) == io_thread? (p)->io_fd: (p)->user_fd)
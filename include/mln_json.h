@@ -9,15 +9,41 @@
 #include <stdlib.h>
 #include "mln_string.h"
 #include "mln_array.h"
-#include "mln_rbtree.h"
+#include "mln_chain.h"
 
 #define M_JSON_LEN              31
+#define M_JSON_OBJ_SMALL        8/*objects with more members than this are hash-indexed*/
+#define M_JSON_STREAM_STACK_SMALL 8/*nesting levels a stream keeps without allocation*/
+#define M_JSON_STREAM_TOKEN_SMALL 64/*token bytes a stream keeps without allocation*/
 
 #define M_JSON_V_FALSE          0
 #define M_JSON_V_TRUE           1
 #define M_JSON_V_NULL           NULL
 
+/*representations of M_JSON_NUM*/
+#define M_JSON_NUM_DOUBLE       0
+#define M_JSON_NUM_INT          1
+#define M_JSON_NUM_UINT         2/*integers larger than the maximum of mln_s64_t*/
+
+/*return values of mln_json_stream_parse*/
+#define M_JSON_STREAM_NOTYET    0
+#define M_JSON_STREAM_DONE      1
+#define M_JSON_STREAM_ERROR     2
+
+/*flags of mln_json_encode_buf and mln_json_encode_chain*/
+#define M_JSON_ENCODE_PRETTY    0x1
+#define M_JSON_ENCODE_CBOR      0x2
+#define M_JSON_ENCODE_MSGPACK   0x4
+
+/*flags of mln_json_cbor_decode and mln_json_msgpack_decode*/
+#define M_JSON_DECODE_REF       0x1/*strings refer to the input instead of being copied*/
+
+#define M_JSON_PATH_MAX_STEPS   63
+
 typedef struct mln_json_s mln_json_t;
+typedef struct mln_json_obj_s mln_json_obj_t;
+typedef struct mln_json_path_s mln_json_path_t;
+typedef struct mln_json_path_expr_s mln_json_path_expr_t;
 typedef int (*mln_json_iterator_t)(mln_json_t *, void *);
 typedef int (*mln_json_object_iterator_t)(mln_json_t * /*key*/, mln_json_t * /*val*/, void *);
 typedef int (*mln_json_array_iterator_t)(mln_json_t *, void *);
@@ -36,11 +62,14 @@ enum json_type {
 
 struct mln_json_s {
     enum json_type               type;
+    mln_u32_t                    num_type;/*M_JSON_NUM_DOUBLE if it is 0*/
     union {
-        mln_rbtree_t     *m_j_obj;
+        mln_json_obj_t   *m_j_obj;
         mln_array_t      *m_j_array;
         mln_string_t     *m_j_string;
         double            m_j_number;
+        mln_s64_t         m_j_int;
+        mln_u64_t         m_j_uint;
         mln_u8_t          m_j_true;
         mln_u8_t          m_j_false;
         mln_u8ptr_t       m_j_null;
@@ -50,14 +79,107 @@ struct mln_json_s {
 typedef struct {
     mln_json_t                   key;
     mln_json_t                   val;
-    mln_rbtree_node_t            node;
+    mln_u32_t                    hash;/*only valid when the object is indexed*/
 } mln_json_kv_t;
 
+/*
+ * Members are stored in insertion order. Small objects are searched linearly,
+ * the larger ones through an open addressing index of member positions.
+ * This replaces the rbtree objects were kept in, mln_json_kv_t has no rbtree
+ * node any more.
+ */
+struct mln_json_obj_s {
+    mln_array_t                  kvs;
+    mln_u32_t                   *index;/*slots hold position + 1, 0 means empty*/
+    mln_u32_t                    mask;
+};
+
 struct mln_json_call_attr {
     mln_json_call_func_t         callback;
     void                        *data;
 };
 
+typedef struct {
+    mln_u8ptr_t                  data;
+    mln_u64_t                    len;
+    mln_u64_t                    pos;/*the first character of the value*/
+} mln_json_lazy_t;
+
+typedef struct {
+    mln_json_t                   val;/*the object or array being filled*/
+    mln_json_t                   key;/*the key waiting for its value*/
+} mln_json_stream_frame_t;
+
+MLN_ARRAY_TYPE(mln_json_stream_stack, mln_json_stream_frame_t, M_JSON_STREAM_STACK_SMALL);
+MLN_ARRAY_TYPE(mln_json_stream_token, mln_u8_t, M_JSON_STREAM_TOKEN_SMALL);
+
+typedef struct {
+    mln_alloc_t                 *pool;
+    mln_json_t                   root;
+    mln_json_stream_stack_t      stack;
+    mln_json_stream_token_t      token;/*the string or scalar received so far*/
+    mln_u32_t                    state:4;
+    mln_u32_t                    is_key:1;
+    mln_u32_t                    escaped:1;
+} mln_json_stream_t;
+
+enum json_path_sel_type {
+    M_JSON_PATH_NAME = 0,
+    M_JSON_PATH_INDEX,
+    M_JSON_PATH_SLICE,
+    M_JSON_PATH_WILDCARD,
+    M_JSON_PATH_FILTER
+};
+
+enum json_path_op {
+    M_JSON_PATH_OR = 0,
+    M_JSON_PATH_AND,
+    M_JSON_PATH_NOT,
+    M_JSON_PATH_EXIST,
+    M_JSON_PATH_EQ,
+    M_JSON_PATH_NE,
+    M_JSON_PATH_LT,
+    M_JSON_PATH_LE,
+    M_JSON_PATH_GT,
+    M_JSON_PATH_GE
+};
+
+typedef struct {
+    enum json_path_sel_type      type;
+    mln_u32_t                    has_start:1;
+    mln_u32_t                    has_end:1;
+    mln_string_t                *name;
+    mln_s64_t                    start;/*also the index*/
+    mln_s64_t                    end;
+    mln_s64_t                    step;
+    mln_json_path_expr_t        *filter;
+} mln_json_path_sel_t;
+
+typedef struct {
+    mln_json_path_sel_t         *sels;
+    mln_u32_t                    nsels;
+    mln_u32_t                    descendant:1;
+    mln_u32_t                    need_len:1;/*some selector needs the array length*/
+} mln_json_path_step_t;
+
+struct mln_json_path_s {
+    mln_json_path_step_t        *steps;
+    mln_u32_t                    nsteps;
+};
+
+typedef struct {
+    mln_json_path_t             *rel;/*a path relative to @, NULL for a literal*/
+    mln_json_t                   literal;
+} mln_json_path_operand_t;
+
+struct mln_json_path_expr_s {
+    enum json_path_op            op;
+    mln_json_path_expr_t        *left;/*operands of ||, && and !*/
+    mln_json_path_expr_t        *right;
+    mln_json_path_operand_t      lhs;/*operands of existence tests and comparisons*/
+    mln_json_path_operand_t      rhs;
+};
+
 #define mln_json_is_object(json)                 ((json)->type == M_JSON_OBJECT)
 #define mln_json_is_array(json)                  ((json)->type == M_JSON_ARRAY)
 #define mln_json_is_string(json)                 ((json)->type == M_JSON_STRING)
@@ -66,20 +188,33 @@ struct mln_json_call_attr {
 #define mln_json_is_false(json)                  ((json)->type == M_JSON_FALSE)
 #define mln_json_is_null(json)                   ((json)->type == M_JSON_NULL)
 #define mln_json_is_none(json)                   ((json)->type == M_JSON_NONE)
+#define mln_json_is_int(json)                    ((json)->type == M_JSON_NUM && (json)->num_type == M_JSON_NUM_INT)
+#define mln_json_is_uint(json)                   ((json)->type == M_JSON_NUM && (json)->num_type == M_JSON_NUM_UINT)
 
 #define mln_json_object_data_get(json)           ((json)->data.m_j_obj)
 #define mln_json_array_data_get(json)            ((json)->data.m_j_array)
 #define mln_json_string_data_get(json)           ((json)->data.m_j_string)
-#define mln_json_number_data_get(json)           ((json)->data.m_j_number)
+#define mln_json_number_data_get(json)           ({\
+    mln_json_t *__json = (json);\
+    __json->num_type == M_JSON_NUM_INT? (double)__json->data.m_j_int: \
+        (__json->num_type == M_JSON_NUM_UINT? (double)__json->data.m_j_uint: __json->data.m_j_number);\
+})
+#define mln_json_number_data_set(json, n)        ({\
+    mln_json_t *__json = (json);\
+    __json->num_type = M_JSON_NUM_DOUBLE;\
+    __json->data.m_j_number = (double)(n);\
+})
+#define mln_json_int_data_get(json)              ((json)->data.m_j_int)
+#define mln_json_uint_data_get(json)             ((json)->data.m_j_uint)
 #define mln_json_true_data_get(json)             ((json)->data.m_j_true)
 #define mln_json_false_data_get(json)            ((json)->data.m_j_false)
 #define mln_json_null_data_get(json)             ((json)->data.m_j_null)
 
-#define mln_json_none_type_set(json)             (json)->type = M_JSON_NONE
+#define mln_json_none_type_set(json)             ((json)->type = M_JSON_NONE, (json)->num_type = M_JSON_NUM_DOUBLE)
 #define mln_json_object_type_set(json)           (json)->type = M_JSON_OBJECT
 #define mln_json_array_type_set(json)            (json)->type = M_JSON_ARRAY
 #define mln_json_string_type_set(json)           (json)->type = M_JSON_STRING
-#define mln_json_number_type_set(json)           (json)->type = M_JSON_NUM
+#define mln_json_number_type_set(json)           ((json)->type = M_JSON_NUM, (json)->num_type = M_JSON_NUM_DOUBLE)
 #define mln_json_true_type_set(json)             (json)->type = M_JSON_TRUE
 #define mln_json_false_type_set(json)            (json)->type = M_JSON_FALSE
 #define mln_json_null_type_set(json)             (json)->type = M_JSON_NULL
@@ -95,6 +230,18 @@ struct mln_json_call_attr {
     mln_json_number_type_set(json);\
     json->data.m_j_number = (double)(n);\
 })
+#define mln_json_int_init(j, n)                ({\
+    mln_json_t *json = (j);\
+    mln_json_number_type_set(json);\
+    json->num_type = M_JSON_NUM_INT;\
+    json->data.m_j_int = (mln_s64_t)(n);\
+})
+#define mln_json_uint_init(j, n)               ({\
+    mln_json_t *json = (j);\
+    mln_json_number_type_set(json);\
+    json->num_type = M_JSON_NUM_UINT;\
+    json->data.m_j_uint = (mln_u64_t)(n);\
+})
 #define mln_json_true_init(j)                  ({\
     mln_json_t *json = (j);\
     mln_json_true_type_set(json);\
@@ -111,7 +258,9 @@ struct mln_json_call_attr {
     json->data.m_j_null = NULL;\
 })
 extern int mln_json_obj_init(mln_json_t *j) __NONNULL1(1);
+extern int mln_json_obj_pool_init(mln_json_t *j, mln_alloc_t *pool) __NONNULL2(1,2);
 extern int mln_json_array_init(mln_json_t *j) __NONNULL1(1);
+extern int mln_json_array_pool_init(mln_json_t *j, mln_alloc_t *pool) __NONNULL2(1,2);
 extern void mln_json_destroy(mln_json_t *j);
 #define mln_json_reset(j)                      ({\
     mln_json_t *json = (j);\
@@ -128,8 +277,27 @@ extern int mln_json_array_append(mln_json_t *j, mln_json_t *value) __NONNULL2(1,
 extern int mln_json_array_update(mln_json_t *j, mln_json_t *value, mln_uauto_t index) __NONNULL2(1,2);
 extern void mln_json_array_remove(mln_json_t *j, mln_uauto_t index);
 extern int mln_json_decode(mln_string_t *jstr, mln_json_t *out);
+extern int mln_json_pool_decode(mln_alloc_t *pool, mln_string_t *jstr, mln_json_t *out);
+extern int mln_json_lazy_init(mln_json_lazy_t *l, mln_string_t *jstr) __NONNULL2(1,2);
+extern enum json_type mln_json_lazy_type(mln_json_lazy_t *l) __NONNULL1(1);
+extern int mln_json_lazy_obj_search(mln_json_lazy_t *l, mln_string_t *key, mln_json_lazy_t *out) __NONNULL3(1,2,3);
+extern int mln_json_lazy_array_search(mln_json_lazy_t *l, mln_uauto_t index, mln_json_lazy_t *out) __NONNULL2(1,3);
+extern int mln_json_lazy_decode(mln_json_lazy_t *l, mln_alloc_t *pool, mln_json_t *out) __NONNULL2(1,3);
+extern int mln_json_stream_init(mln_json_stream_t *s, mln_alloc_t *pool) __NONNULL1(1);
+extern void mln_json_stream_destroy(mln_json_stream_t *s);
+extern int mln_json_stream_parse(mln_json_stream_t *s, mln_chain_t **in, mln_json_t *out) __NONNULL3(1,2,3);
 extern mln_string_t *mln_json_encode(mln_json_t *j);
+extern mln_size_t mln_json_encode_buf(mln_json_t *j, mln_u8ptr_t buf, mln_size_t size, mln_u32_t flags);
+extern int mln_json_encode_chain(mln_json_t *j, mln_alloc_t *pool, mln_chain_t **out_head, mln_chain_t **out_tail, mln_u32_t flags) __NONNULL3(2,3,4);
+extern mln_string_t *mln_json_cbor_encode(mln_json_t *j);
+extern int mln_json_cbor_decode(mln_alloc_t *pool, mln_string_t *in, mln_json_t *out, mln_u32_t flags) __NONNULL2(2,3);
+extern mln_string_t *mln_json_msgpack_encode(mln_json_t *j);
+extern int mln_json_msgpack_decode(mln_alloc_t *pool, mln_string_t *in, mln_json_t *out, mln_u32_t flags) __NONNULL2(2,3);
 extern int mln_json_parse(mln_json_t *j, mln_string_t *exp, mln_json_iterator_t iterator, void *data) __NONNULL2(1,2);
+extern mln_json_path_t *mln_json_path_compile(mln_string_t *exp) __NONNULL1(1);
+extern void mln_json_path_free(mln_json_path_t *path);
+extern int mln_json_path_search(mln_json_path_t *path, mln_json_t *j, mln_json_iterator_t iterator, void *data) __NONNULL2(1,2);
+extern int mln_json_path_decode(mln_json_path_t *path, mln_alloc_t *pool, mln_string_t *jstr, mln_json_iterator_t iterator, void *data) __NONNULL2(1,3);
 extern int mln_json_generate(mln_json_t *j, char *fmt, ...) __NONNULL2(1,2);
 extern int mln_json_object_iterate(mln_json_t *j, mln_json_object_iterator_t it, void *data) __NONNULL2(1,2);
 
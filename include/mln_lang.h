@@ -16,7 +16,7 @@
 #include "mln_alloc.h"
 #include "mln_array.h"
 
-#define M_LANG_ARRAY_PREALLOC      32
+#define M_LANG_ARGS_SMALL          4/*arguments kept in a function or a call without allocation*/
 #define M_LANG_CACHE_COUNT         65535
 #define M_LANG_SYMBOL_TABLE_LEN    371
 #define M_LANG_STEP_OUT            -1
@@ -73,6 +73,8 @@ typedef void (* import_destroy_t)(mln_lang_t *);
 /* pipe */
 typedef int (*mln_lang_ctx_pipe_recv_cb_t)(mln_lang_ctx_t *, mln_lang_val_t *);
 
+MLN_ARRAY_TYPE(mln_lang_var_array, mln_lang_var_t *, M_LANG_ARGS_SMALL);
+
 
 struct mln_lang_hash_s {
     mln_lang_hash_bucket_t          *bucket;
@@ -290,8 +292,8 @@ typedef enum {
 
 struct mln_lang_func_detail_s {
     mln_lang_exp_t                  *exp;
-    mln_array_t                      args;
-    mln_array_t                      closure;
+    mln_lang_var_array_t             args;
+    mln_lang_var_array_t             closure;
     mln_lang_func_type_t             type;
     union {
         mln_lang_internal        process;
@@ -346,7 +348,7 @@ struct mln_lang_funccall_val_s {
     mln_string_t                    *name;
     mln_lang_func_detail_t          *prototype;
     mln_lang_val_t                  *object;
-    mln_array_t                      args;
+    mln_lang_var_array_t             args;
 };
 
 struct mln_lang_array_s {
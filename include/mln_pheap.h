@@ -0,0 +1,249 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+#ifndef __MLN_PHEAP_H
+#define __MLN_PHEAP_H
+
+#include "mln_types.h"
+
+/*
+ * The same as fheap_cmp.
+ * return value: 0 - p1 < p2   !0 - p1 >= p2
+ */
+typedef int (*pheap_cmp)(const void *, const void *);
+/*
+ * the left argument is the destination and the right
+ * one is the source.
+ */
+typedef void (*pheap_copy)(void *, void *);
+typedef void (*pheap_key_free)(void *);
+typedef void *(*pheap_pool_alloc_handler)(void *, mln_size_t);
+typedef void (*pheap_pool_free_handler)(void *);
+
+struct mln_pheap_attr {
+    void                     *pool;
+    pheap_pool_alloc_handler  pool_alloc;
+    pheap_pool_free_handler   pool_free;
+    pheap_cmp                 cmp;
+    pheap_copy                copy;
+    pheap_key_free            key_free;
+};
+
+/*
+ * prev is the parent if the node is the first child, otherwise the left sibling.
+ */
+typedef struct mln_pheap_node_s {
+    void                     *key;
+    struct mln_pheap_node_s  *prev;
+    struct mln_pheap_node_s  *next;
+    struct mln_pheap_node_s  *child;
+    mln_u32_t                 nofree:1;
+} mln_pheap_node_t;
+
+typedef struct {
+    mln_pheap_node_t         *root;
+    pheap_cmp                 cmp;
+    pheap_copy                copy;
+    pheap_key_free            key_free;
+    mln_size_t                num;
+    void                     *pool;
+    pheap_pool_alloc_handler  pool_alloc;
+    pheap_pool_free_handler   pool_free;
+} mln_pheap_t;
+
+/*
+ * for internal
+ */
+static inline mln_pheap_node_t *
+mln_pheap_meld(mln_pheap_node_t *a, mln_pheap_node_t *b, pheap_cmp cmp)
+{
+    mln_pheap_node_t *tmp;
+    if (!cmp(b->key, a->key)) {
+        tmp = a;
+        a = b;
+        b = tmp;
+    }
+    b->prev = a;
+    b->next = a->child;
+    if (a->child != NULL) a->child->prev = b;
+    a->child = b;
+    a->prev = a->next = NULL;
+    return a;
+}
+
+/*
+ * Two-pass pairing: meld the siblings in pairs from left to right,
+ * then meld the results from right to left.
+ */
+static inline mln_pheap_node_t *
+mln_pheap_merge_pairs(mln_pheap_node_t *first, pheap_cmp cmp)
+{
+    mln_pheap_node_t *a, *b, *next, *list = NULL;
+
+    if (first == NULL) return NULL;
+    while (first != NULL) {
+        a = first;
+        if ((b = a->next) == NULL) {
+            a->next = list;
+            list = a;
+            break;
+        }
+        next = b->next;
+        a = mln_pheap_meld(a, b, cmp);
+        a->next = list;
+        list = a;
+        first = next;
+    }
+    a = list;
+    list = list->next;
+    while (list != NULL) {
+        next = list->next;
+        a = mln_pheap_meld(list, a, cmp);
+        list = next;
+    }
+    a->prev = a->next = NULL;
+    return a;
+}
+
+static inline void
+mln_pheap_cut(mln_pheap_node_t *node)
+{
+    if (node->prev->child == node) node->prev->child = node->next;
+    else node->prev->next = node->next;
+    if (node->next != NULL) node->next->prev = node->prev;
+    node->prev = node->next = NULL;
+}
+
+#define mln_pheap_inline_insert(ph, pn, compare) ({\
+    pheap_cmp cmp = (pheap_cmp)(compare);\
+    if (cmp == NULL) cmp = (ph)->cmp;\
+    (pn)->prev = (pn)->next = (pn)->child = NULL;\
+    if ((ph)->root == NULL) (ph)->root = (pn);\
+    else (ph)->root = mln_pheap_meld((ph)->root, (pn), cmp);\
+    ++((ph)->num);\
+})
+
+#define mln_pheap_inline_extract_min(ph, compare) ({\
+    pheap_cmp cmp = (pheap_cmp)(compare);\
+    if (cmp == NULL) cmp = (ph)->cmp;\
+    mln_pheap_node_t *z = (ph)->root;\
+    if (z != NULL) {\
+        (ph)->root = mln_pheap_merge_pairs(z->child, cmp);\
+        z->child = NULL;\
+        --((ph)->num);\
+    }\
+    z;\
+})
+
+#define mln_pheap_inline_decrease_key(ph, node, k, cpy, compare) ({\
+    pheap_cmp cmp = (pheap_cmp)(compare);\
+    if (cmp == NULL) cmp = (ph)->cmp;\
+    pheap_copy cp = (pheap_copy)(cpy);\
+    if (cp == NULL) cp = (ph)->copy;\
+    int r = 0;\
+    if (!cmp((node)->key, (k))) {\
+        r = -1;\
+    } else {\
+        cp((node)->key, (k));\
+        if ((node) != (ph)->root) {\
+            mln_pheap_cut((node));\
+            (ph)->root = mln_pheap_meld((ph)->root, (node), cmp);\
+        }\
+    }\
+    r;\
+})
+
+#define mln_pheap_inline_delete(ph, node, compare) ({\
+    pheap_cmp cmp = (pheap_cmp)(compare);\
+    if (cmp == NULL) cmp = (ph)->cmp;\
+    mln_pheap_node_t *sub;\
+    if ((node) == (ph)->root) {\
+        (ph)->root = mln_pheap_merge_pairs((node)->child, cmp);\
+    } else {\
+        mln_pheap_cut((node));\
+        sub = mln_pheap_merge_pairs((node)->child, cmp);\
+        if (sub != NULL) (ph)->root = mln_pheap_meld((ph)->root, sub, cmp);\
+    }\
+    (node)->child = NULL;\
+    --((ph)->num);\
+})
+
+#define mln_pheap_inline_node_free(ph, pn, freer) ({\
+    pheap_key_free f = (pheap_key_free)(freer);\
+    if (f == NULL) f = (ph)->key_free;\
+    if ((pn) != NULL) {\
+        if (f != NULL && (pn)->key != NULL)\
+            f((pn)->key);\
+        if (!(pn)->nofree) {\
+           if ((ph)->pool != NULL) (ph)->pool_free((pn));\
+           else free((pn));\
+        }\
+    }\
+})
+
+/*
+ * Children are spliced into the sibling list before their parent is freed,
+ * so no comparison is needed.
+ */
+#define mln_pheap_inline_free(ph, freer) ({\
+    if ((ph) != NULL) {\
+        mln_pheap_node_t *pn = (ph)->root, *c, *next;\
+        while (pn != NULL) {\
+            if ((c = pn->child) != NULL) {\
+                while (c->next != NULL) c = c->next;\
+                c->next = pn->next;\
+                next = pn->child;\
+            } else {\
+                next = pn->next;\
+            }\
+            mln_pheap_inline_node_free((ph), pn, freer);\
+            pn = next;\
+        }\
+        if ((ph)->pool != NULL) (ph)->pool_free((ph));\
+        else free((ph));\
+    }\
+})
+
+#define mln_pheap_node_init(pn, k) ({\
+    (pn)->key = (k);\
+    (pn)->prev = NULL;\
+    (pn)->next = NULL;\
+    (pn)->child = NULL;\
+    (pn)->nofree = 1;\
+    (pn);\
+})
+
+
+/*
+ * external
+ */
+#define mln_pheap_node_key(node)   ((node)->key)
+#define mln_pheap_minimum(ph)      ((ph)->root)
+#define mln_pheap_node_num(ph)     ((ph)->num)
+
+extern mln_pheap_t *
+mln_pheap_new(struct mln_pheap_attr *attr);
+extern void
+mln_pheap_free(mln_pheap_t *ph);
+extern void
+mln_pheap_insert(mln_pheap_t *ph, mln_pheap_node_t *pn) __NONNULL2(1,2);
+extern mln_pheap_node_t *
+mln_pheap_extract_min(mln_pheap_t *ph) __NONNULL1(1);
+/*
+ * return value: -1 - key error   0 - on success
+ */
+extern int
+mln_pheap_decrease_key(mln_pheap_t *ph, mln_pheap_node_t *node, void *key) __NONNULL3(1,2,3);
+extern void
+mln_pheap_delete(mln_pheap_t *ph, mln_pheap_node_t *node) __NONNULL2(1,2);
+
+/*mln_pheap_node_t*/
+extern mln_pheap_node_t *
+mln_pheap_node_new(mln_pheap_t *ph, void *key) __NONNULL2(1,2);
+extern void
+mln_pheap_node_free(mln_pheap_t *ph, mln_pheap_node_t *pn) __NONNULL1(1);
+
+#endif
+
@@ -266,5 +266,98 @@ extern mln_rbtree_node_t *mln_rbtree_node_new(mln_rbtree_t *t, void *data) __NON
 extern void mln_rbtree_node_free(mln_rbtree_t *t, mln_rbtree_node_t *n) __NONNULL2(1,2);
 
 extern int mln_rbtree_iterate(mln_rbtree_t *t, rbtree_iterate_handler handler, void *udata) __NONNULL2(1,2);
+
+/*
+ * Intrusive usage
+ *
+ * mln_rbtree_link_t is embedded in the user's structure and the tree head
+ * mln_rbtree_head_t can be embedded as well, so no memory is allocated at all.
+ * A link only holds three words: the color is kept in the lowest bit of the
+ * parent pointer, and empty children are NULL instead of a sentinel node.
+ * The type specific functions are generated by MLN_RBTREE_LINK_DEFINE, whose
+ * compare is called directly and may be inlined.
+ */
+typedef struct mln_rbtree_link_s {
+    mln_uauto_t                parent_color;
+    struct mln_rbtree_link_s  *left;
+    struct mln_rbtree_link_s  *right;
+} mln_rbtree_link_t;
+
+typedef struct {
+    mln_rbtree_link_t         *root;
+    mln_rbtree_link_t         *min;
+    mln_uauto_t                nr_node;
+} mln_rbtree_head_t;
+
+#define mln_rbtree_head_init(h)   ((h)->root = (h)->min = NULL, (h)->nr_node = 0)
+#define mln_rbtree_head_num(h)    ((h)->nr_node)
+#define mln_rbtree_head_empty(h)  ((h)->root == NULL)
+#define mln_rbtree_link_parent(l) ((mln_rbtree_link_t *)((l)->parent_color & ~(mln_uauto_t)1))
+
+extern void mln_rbtree_link_insert_fixup(mln_rbtree_head_t *h, mln_rbtree_link_t *l) __NONNULL2(1,2);
+extern void mln_rbtree_link_erase(mln_rbtree_head_t *h, mln_rbtree_link_t *l) __NONNULL2(1,2);
+extern mln_rbtree_link_t *mln_rbtree_link_next(mln_rbtree_link_t *l) __NONNULL1(1);
+extern mln_rbtree_link_t *mln_rbtree_link_prev(mln_rbtree_link_t *l) __NONNULL1(1);
+
+/*
+ * compare(const type *, const type *) returns the same as rbtree_cmp.
+ * Elements equal to an existing one are inserted after it.
+ */
+#define MLN_RBTREE_LINK_DECLARE(prefix, type, func_attr) \
+    func_attr void prefix##_insert(mln_rbtree_head_t *h, type *node);\
+    func_attr type *prefix##_search(mln_rbtree_head_t *h, const type *key);\
+    func_attr void prefix##_delete(mln_rbtree_head_t *h, type *node);\
+    func_attr type *prefix##_min(mln_rbtree_head_t *h);\
+    func_attr type *prefix##_next(type *node);\
+    func_attr type *prefix##_prev(type *node);
+
+#define MLN_RBTREE_LINK_DEFINE(prefix, type, func_attr, member, compare) \
+    func_attr void prefix##_insert(mln_rbtree_head_t *h, type *node)\
+    {\
+        mln_rbtree_link_t **p = &(h->root), *parent = NULL, *l = &(node->member);\
+        int leftmost = 1;\
+        while (*p != NULL) {\
+            parent = *p;\
+            if (compare(node, mln_container_of(parent, type, member)) < 0) {\
+                p = &(parent->left);\
+            } else {\
+                p = &(parent->right);\
+                leftmost = 0;\
+            }\
+        }\
+        l->parent_color = (mln_uauto_t)parent;/*red*/\
+        l->left = l->right = NULL;\
+        *p = l;\
+        if (leftmost) h->min = l;\
+        ++(h->nr_node);\
+        mln_rbtree_link_insert_fixup(h, l);\
+    }\
+    func_attr type *prefix##_search(mln_rbtree_head_t *h, const type *key)\
+    {\
+        mln_rbtree_link_t *l = h->root;\
+        int ret;\
+        while (l != NULL) {\
+            ret = compare(key, mln_container_of(l, type, member));\
+            if (ret == 0) return mln_container_of(l, type, member);\
+            l = ret < 0? l->left: l->right;\
+        }\
+        return NULL;\
+    }\
+    func_attr void prefix##_delete(mln_rbtree_head_t *h, type *node)\
+    {\
+        mln_rbtree_link_erase(h, &(node->member));\
+    }\
+    func_attr type *prefix##_min(mln_rbtree_head_t *h)\
+    {\
+        return mln_container_of(h->min, type, member);\
+    }\
+    func_attr type *prefix##_next(type *node)\
+    {\
+        return mln_container_of(mln_rbtree_link_next(&(node->member)), type, member);\
+    }\
+    func_attr type *prefix##_prev(type *node)\
+    {\
+        return mln_container_of(mln_rbtree_link_prev(&(node->member)), type, member);\
+    }
 #endif
 
@@ -0,0 +1,63 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+#ifndef __MLN_RING_H
+#define __MLN_RING_H
+
+#include "mln_types.h"
+
+/*
+ * ring types
+ */
+#define M_RING_SPSC 0 /*single producer, single consumer*/
+#define M_RING_MPSC 1 /*multiple producers, single consumer*/
+#define M_RING_MPMC 2 /*multiple producers, multiple consumers*/
+
+/*
+ * MPSC and MPMC rings use a sequence number per cell (Vyukov's bounded queue):
+ * a cell at position pos is free for the producer of pos if seq == pos,
+ * and ready for the consumer of pos if seq == pos + 1.
+ */
+typedef struct {
+    mln_uauto_t              seq;
+    void                    *data;
+} mln_ring_cell_t;
+
+/*
+ * Each index is padded to its own cache lines, so producers and consumers
+ * do not share lines. cache is the last index of the other side seen by
+ * a SPSC producer or consumer, it saves reading the line of the other side.
+ */
+typedef union {
+    struct {
+        mln_uauto_t          pos;
+        mln_uauto_t          cache;
+    } s;
+    mln_u8_t                 padding[128];
+} mln_ring_index_t;
+
+typedef struct {
+    mln_ring_index_t         tail;/*written by producers*/
+    mln_ring_index_t         head;/*written by consumers*/
+    union {
+        void               **slots;/*SPSC*/
+        mln_ring_cell_t     *cells;/*MPSC and MPMC*/
+    } u;
+    mln_uauto_t              mask;
+    mln_u32_t                type;
+} mln_ring_t;
+
+#define mln_ring_size(r)     ((r)->mask + 1)
+
+extern mln_ring_t *mln_ring_new(mln_u32_t type, mln_uauto_t size);
+extern void mln_ring_free(mln_ring_t *r);
+extern int mln_ring_push(mln_ring_t *r, void *data) __NONNULL1(1);
+extern int mln_ring_pop(mln_ring_t *r, void **data) __NONNULL2(1,2);
+extern mln_uauto_t mln_ring_push_batch(mln_ring_t *r, void **data, mln_uauto_t n) __NONNULL2(1,2);
+extern mln_uauto_t mln_ring_pop_batch(mln_ring_t *r, void **data, mln_uauto_t n) __NONNULL2(1,2);
+extern mln_uauto_t mln_ring_count(mln_ring_t *r) __NONNULL1(1);
+
+#endif
+
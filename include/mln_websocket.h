@@ -20,6 +20,7 @@
 #define M_WS_RET_FAILED                   1
 #define M_WS_RET_NOTWS                    2
 #define M_WS_RET_NOTYET                   3
+#define M_WS_RET_DECLINED                 4
 /*
  * status code
  */
@@ -55,7 +56,28 @@
 #define M_WS_FLAG_SERVER                  0x8
 
 typedef struct mln_websocket_s mln_websocket_t;
+typedef struct mln_websocket_deflate_s mln_websocket_deflate_t;
 typedef int (*mln_ws_extension_handle)(mln_websocket_t *);
+/*
+ * data and len are a slice of message payload, flags are M_WS_FLAG_NEW and M_WS_FLAG_END.
+ */
+typedef int (*mln_ws_stream_handle)(mln_websocket_t *, mln_u8ptr_t, mln_size_t, mln_u32_t);
+
+/*
+ * permessage-deflate (RFC 7692), only available if Melon is built with MLN_ZLIB.
+ */
+#define M_WS_DEFLATE_MAX_MESSAGE_SIZE     (64 * 1024 * 1024)/*inflate limit if max_message_size is 0*/
+struct mln_websocket_deflate_attr {
+    int                      level;/*zlib compression level, -1 ~ 9*/
+    int                      mem_level;/*zlib memory level, 1 ~ 9, 0 means 8*/
+    mln_u32_t                server_max_window_bits;/*8 ~ 15*/
+    mln_u32_t                client_max_window_bits;/*8 ~ 15*/
+    mln_u32_t                server_no_context_takeover:1;
+    mln_u32_t                client_no_context_takeover:1;
+    mln_size_t               threshold;/*messages shorter than this are sent uncompressed*/
+    mln_u8ptr_t              dictionary;/*preset dictionary shared by both endpoints, NULL if not used*/
+    mln_size_t               dictionary_len;
+};
 
 struct mln_websocket_s {
     mln_http_t              *http;
@@ -68,7 +90,19 @@ struct mln_websocket_s {
 
     void                    *data;
     void                    *content;
+    mln_chain_t             *content_chain;/*holds the received buf which content points to*/
     mln_ws_extension_handle  extension_handler;
+    mln_websocket_deflate_t *deflate;/*NULL if permessage-deflate is not negotiated*/
+    mln_ws_stream_handle     stream_handler;
+    mln_u64_t                max_message_size;/*0 means no limit*/
+    mln_u64_t                message_len;/*payload length of the message received so far*/
+    mln_u64_t                frame_left;/*payload length of the streaming frame not read yet*/
+    mln_u64_t                frame_offset;/*payload length of the streaming frame read already*/
+    mln_u32_t                in_message:1;
+    mln_u32_t                in_frame:1;
+    mln_u32_t                stream_compressed:1;/*the message being received is compressed*/
+    mln_u32_t                stream_end:1;/*M_WS_FLAG_END of the streaming frame is delivered*/
+    mln_u32_t                message_opcode:4;
     mln_u64_t                content_len;
     mln_u16_t                content_free:1;
     mln_u16_t                fin:1;
@@ -98,6 +132,11 @@ struct mln_websocket_s {
 #define mln_websocket_get_content(ws)          ((ws)->content)
 #define mln_websocket_set_ext_handler(ws,h)    ((ws)->extension_handler = (h))
 #define mln_websocket_get_ext_handler(ws)      ((ws)->extension_handler)
+#define mln_websocket_get_deflate(ws)          ((ws)->deflate)
+#define mln_websocket_set_stream_handler(ws,h) ((ws)->stream_handler = (h))
+#define mln_websocket_get_stream_handler(ws)   ((ws)->stream_handler)
+#define mln_websocket_set_max_message_size(ws,s) ((ws)->max_message_size = (s))
+#define mln_websocket_get_max_message_size(ws) ((ws)->max_message_size)
 #define mln_websocket_set_rsv1(ws)             ((ws)->rsv1 = 1)
 #define mln_websocket_reset_rsv1(ws)           ((ws)->rsv1 = 0)
 #define mln_websocket_get_rsv1(ws)             ((ws)->rsv1)
@@ -141,6 +180,8 @@ extern int mln_websocket_handshake_response_generate(mln_websocket_t *ws, \
 extern int mln_websocket_handshake_request_generate(mln_websocket_t *ws, \
                                                     mln_chain_t **chead, \
                                                     mln_chain_t **ctail) __NONNULL3(1,2,3);
+extern int mln_websocket_deflate_offer(mln_websocket_t *ws, struct mln_websocket_deflate_attr *attr) __NONNULL2(1,2);
+extern int mln_websocket_deflate_negotiate(mln_websocket_t *ws, struct mln_websocket_deflate_attr *attr) __NONNULL2(1,2);
 
 extern int mln_websocket_text_generate(mln_websocket_t *ws, \
                                        mln_chain_t **out_cnode, \
@@ -161,5 +202,11 @@ extern int mln_websocket_ping_generate(mln_websocket_t *ws, mln_chain_t **out_cn
 extern int mln_websocket_pong_generate(mln_websocket_t *ws, mln_chain_t **out_cnode, mln_u32_t flags) __NONNULL2(1,2);
 extern int mln_websocket_generate(mln_websocket_t *ws, mln_chain_t **out_cnode) __NONNULL1(1);
 extern int mln_websocket_parse(mln_websocket_t *ws, mln_chain_t **in) __NONNULL1(1);
+extern int mln_websocket_stream_parse(mln_websocket_t *ws, mln_chain_t **in) __NONNULL2(1,2);
+extern mln_buf_shared_t *mln_websocket_broadcast_generate(mln_u32_t opcode, \
+                                                          void *buf, \
+                                                          mln_size_t len, \
+                                                          mln_u32_t flags);
+extern int mln_websocket_broadcast_append(mln_tcp_conn_t *tc, mln_buf_shared_t *frame) __NONNULL2(1,2);
 
 #endif
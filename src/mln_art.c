@@ -0,0 +1,911 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "mln_art.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define M_ART_NODE4    0
+#define M_ART_NODE16   1
+#define M_ART_NODE48   2
+#define M_ART_NODE256  3
+
+/*
+ * A child slot holds either a node or a leaf, leaves are told apart by
+ * the lowest bit of the pointer.
+ */
+#define mln_art_is_leaf(p) ((mln_uauto_t)(p) & 1)
+#define mln_art_leaf(p)    ((mln_art_leaf_t *)((mln_uauto_t)(p) & ~(mln_uauto_t)1))
+#define mln_art_tag(l)     ((void *)((mln_uauto_t)(l) | 1))
+#define mln_art_min(a,b)   ((a) < (b)? (a): (b))
+
+/*
+ * node4 and node16 keep their keys sorted. node48 maps a byte to a slot
+ * by index, 0 means no child, otherwise the slot is index - 1.
+ */
+typedef struct {
+    mln_art_node_t             n;
+    mln_u8_t                   keys[4];
+    void                      *children[4];
+} mln_art_node4_t;
+
+typedef struct {
+    mln_art_node_t             n;
+    mln_u8_t                   keys[16];
+    void                      *children[16];
+} mln_art_node16_t;
+
+typedef struct {
+    mln_art_node_t             n;
+    mln_u8_t                   index[256];
+    void                      *children[48];
+} mln_art_node48_t;
+
+typedef struct {
+    mln_art_node_t             n;
+    void                      *children[256];
+} mln_art_node256_t;
+
+static mln_size_t mln_art_node_size[] = {
+    sizeof(mln_art_node4_t),
+    sizeof(mln_art_node16_t),
+    sizeof(mln_art_node48_t),
+    sizeof(mln_art_node256_t)
+};
+
+/*static declarations*/
+static inline mln_art_leaf_t *mln_art_leaf_new(mln_art_t *t, mln_string_t *key, void *val) __NONNULL2(1,2);
+static inline void mln_art_leaf_free(mln_art_t *t, mln_art_leaf_t *l) __NONNULL2(1,2);
+static inline mln_art_node_t *mln_art_node_new(mln_art_t *t, mln_u8_t type) __NONNULL1(1);
+static inline void mln_art_node_free(mln_art_t *t, mln_art_node_t *n) __NONNULL2(1,2);
+static void mln_art_destroy(mln_art_t *t, void *p) __NONNULL2(1,2);
+static inline int mln_art_leaf_match(mln_art_leaf_t *l, mln_u8ptr_t key, mln_size_t len) __NONNULL1(1);
+static inline void **mln_art_find_child(mln_art_node_t *n, mln_u8_t c) __NONNULL1(1);
+static inline void *mln_art_first_child(mln_art_node_t *n, mln_u8_t *c) __NONNULL2(1,2);
+static mln_art_leaf_t *mln_art_minimum(mln_art_node_t *n) __NONNULL1(1);
+static mln_size_t
+mln_art_prefix_mismatch(mln_art_node_t *n, mln_u8ptr_t key, mln_size_t len, mln_size_t depth) __NONNULL1(1);
+static void mln_art_copy_header(mln_art_node_t *dest, mln_art_node_t *src) __NONNULL2(1,2);
+static mln_art_node_t *mln_art_grow(mln_art_t *t, mln_art_node_t *n) __NONNULL2(1,2);
+static void mln_art_shrink(mln_art_t *t, void **ref, mln_art_node_t *n) __NONNULL3(1,2,3);
+static int mln_art_add_child(mln_art_t *t, void **ref, mln_art_node_t *n, mln_u8_t c, void *child) __NONNULL3(1,2,3);
+static void mln_art_remove_child(mln_art_t *t, void **ref, mln_art_node_t *n, mln_u8_t c) __NONNULL3(1,2,3);
+static void mln_art_collapse(mln_art_t *t, void **ref, mln_art_node_t *n) __NONNULL3(1,2,3);
+static int mln_art_iterate_node(void *p, art_iterate_handler handler, void *udata) __NONNULL2(1,2);
+
+mln_art_t *mln_art_new(struct mln_art_attr *attr)
+{
+    mln_art_t *t;
+
+    if (attr == NULL || attr->pool == NULL) {
+        t = (mln_art_t *)malloc(sizeof(mln_art_t));
+    } else {
+        t = (mln_art_t *)attr->pool_alloc(attr->pool, sizeof(mln_art_t));
+    }
+    if (t == NULL) return NULL;
+    if (attr == NULL) {
+        t->pool = NULL;
+        t->pool_alloc = NULL;
+        t->pool_free = NULL;
+        t->data_free = NULL;
+    } else {
+        t->pool = attr->pool;
+        t->pool_alloc = attr->pool_alloc;
+        t->pool_free = attr->pool_free;
+        t->data_free = attr->data_free;
+    }
+    t->root = NULL;
+    t->nr_node = 0;
+    return t;
+}
+
+void mln_art_free(mln_art_t *t)
+{
+    if (t == NULL) return;
+
+    if (t->root != NULL) mln_art_destroy(t, t->root);
+    if (t->pool != NULL) t->pool_free(t);
+    else free(t);
+}
+
+void mln_art_reset(mln_art_t *t)
+{
+    if (t->root != NULL) mln_art_destroy(t, t->root);
+    t->root = NULL;
+    t->nr_node = 0;
+}
+
+static void mln_art_destroy(mln_art_t *t, void *p)
+{
+    mln_art_node_t *n;
+    mln_art_leaf_t *l;
+    void **children;
+    mln_u32_t i, nr;
+
+    if (mln_art_is_leaf(p)) {
+        l = mln_art_leaf(p);
+        if (t->data_free != NULL) t->data_free(l->val);
+        mln_art_leaf_free(t, l);
+        return;
+    }
+    n = (mln_art_node_t *)p;
+    switch (n->type) {
+        case M_ART_NODE4:
+            children = ((mln_art_node4_t *)n)->children;
+            nr = n->nr;
+            break;
+        case M_ART_NODE16:
+            children = ((mln_art_node16_t *)n)->children;
+            nr = n->nr;
+            break;
+        case M_ART_NODE48:
+            children = ((mln_art_node48_t *)n)->children;
+            nr = 48;
+            break;
+        default:
+            children = ((mln_art_node256_t *)n)->children;
+            nr = 256;
+            break;
+    }
+    for (i = 0; i < nr; ++i) {
+        if (children[i] != NULL) mln_art_destroy(t, children[i]);
+    }
+    if (n->leaf != NULL) mln_art_destroy(t, mln_art_tag(n->leaf));
+    mln_art_node_free(t, n);
+}
+
+static inline mln_art_leaf_t *mln_art_leaf_new(mln_art_t *t, mln_string_t *key, void *val)
+{
+    mln_art_leaf_t *l;
+    mln_size_t size = sizeof(mln_art_leaf_t) + key->len;
+
+    if (t->pool != NULL) {
+        l = (mln_art_leaf_t *)t->pool_alloc(t->pool, size);
+    } else {
+        l = (mln_art_leaf_t *)malloc(size);
+    }
+    if (l == NULL) return NULL;
+    l->val = val;
+    mln_string_nset(&(l->key), l + 1, key->len);
+    memcpy(l->key.data, key->data, key->len);
+    return l;
+}
+
+static inline void mln_art_leaf_free(mln_art_t *t, mln_art_leaf_t *l)
+{
+    if (t->pool != NULL) t->pool_free(l);
+    else free(l);
+}
+
+static inline mln_art_node_t *mln_art_node_new(mln_art_t *t, mln_u8_t type)
+{
+    mln_art_node_t *n;
+    mln_size_t size = mln_art_node_size[type];
+
+    if (t->pool != NULL) {
+        n = (mln_art_node_t *)t->pool_alloc(t->pool, size);
+    } else {
+        n = (mln_art_node_t *)malloc(size);
+    }
+    if (n == NULL) return NULL;
+    memset(n, 0, size);
+    n->type = type;
+    return n;
+}
+
+static inline void mln_art_node_free(mln_art_t *t, mln_art_node_t *n)
+{
+    if (t->pool != NULL) t->pool_free(n);
+    else free(n);
+}
+
+static inline int mln_art_leaf_match(mln_art_leaf_t *l, mln_u8ptr_t key, mln_size_t len)
+{
+    return l->key.len == len && !memcmp(l->key.data, key, len);
+}
+
+/*
+ * child lookup
+ */
+static inline void **mln_art_find_child(mln_art_node_t *n, mln_u8_t c)
+{
+    switch (n->type) {
+        case M_ART_NODE4:
+        {
+            mln_art_node4_t *n4 = (mln_art_node4_t *)n;
+            mln_u32_t i;
+
+            for (i = 0; i < n->nr; ++i) {
+                if (n4->keys[i] == c) return &(n4->children[i]);
+            }
+            return NULL;
+        }
+        case M_ART_NODE16:
+        {
+            mln_art_node16_t *n16 = (mln_art_node16_t *)n;
+#if defined(__SSE2__)
+            __m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8((char)c), _mm_loadu_si128((const __m128i *)n16->keys));
+            mln_u32_t mask = (mln_u32_t)_mm_movemask_epi8(cmp) & ((1U << n->nr) - 1);
+
+            return mask? &(n16->children[__builtin_ctz(mask)]): NULL;
+#else
+            mln_u32_t i;
+
+            for (i = 0; i < n->nr && n16->keys[i] <= c; ++i) {
+                if (n16->keys[i] == c) return &(n16->children[i]);
+            }
+            return NULL;
+#endif
+        }
+        case M_ART_NODE48:
+        {
+            mln_art_node48_t *n48 = (mln_art_node48_t *)n;
+
+            return n48->index[c]? &(n48->children[n48->index[c] - 1]): NULL;
+        }
+        default:
+        {
+            mln_art_node256_t *n256 = (mln_art_node256_t *)n;
+
+            return n256->children[c] != NULL? &(n256->children[c]): NULL;
+        }
+    }
+}
+
+static inline void *mln_art_first_child(mln_art_node_t *n, mln_u8_t *c)
+{
+    mln_u32_t i;
+
+    switch (n->type) {
+        case M_ART_NODE4:
+            *c = ((mln_art_node4_t *)n)->keys[0];
+            return ((mln_art_node4_t *)n)->children[0];
+        case M_ART_NODE16:
+            *c = ((mln_art_node16_t *)n)->keys[0];
+            return ((mln_art_node16_t *)n)->children[0];
+        case M_ART_NODE48:
+        {
+            mln_art_node48_t *n48 = (mln_art_node48_t *)n;
+
+            for (i = 0; !n48->index[i]; ++i)
+                ;
+            *c = i;
+            return n48->children[n48->index[i] - 1];
+        }
+        default:
+        {
+            mln_art_node256_t *n256 = (mln_art_node256_t *)n;
+
+            for (i = 0; n256->children[i] == NULL; ++i)
+                ;
+            *c = i;
+            return n256->children[i];
+        }
+    }
+}
+
+/*
+ * Every node has a leaf or at least one child, so the smallest key below
+ * a node is found by following the first children.
+ */
+static mln_art_leaf_t *mln_art_minimum(mln_art_node_t *n)
+{
+    void *p;
+    mln_u8_t c;
+
+    while (n->leaf == NULL) {
+        p = mln_art_first_child(n, &c);
+        if (mln_art_is_leaf(p)) return mln_art_leaf(p);
+        n = (mln_art_node_t *)p;
+    }
+    return n->leaf;
+}
+
+/*
+ * Return the number of prefix bytes of n matched by key from depth.
+ * The bytes not stored in the node are read from its minimum leaf, every
+ * key below n shares them.
+ */
+static mln_size_t
+mln_art_prefix_mismatch(mln_art_node_t *n, mln_u8ptr_t key, mln_size_t len, mln_size_t depth)
+{
+    mln_art_leaf_t *l;
+    mln_size_t max = mln_art_min(n->prefix_len, M_ART_PREFIX), i;
+
+    if (max > len - depth) max = len - depth;
+    for (i = 0; i < max; ++i) {
+        if (n->prefix[i] != key[depth + i]) return i;
+    }
+    if (n->prefix_len > M_ART_PREFIX) {
+        l = mln_art_minimum(n);
+        max = mln_art_min(n->prefix_len, len - depth);
+        for (; i < max; ++i) {
+            if (l->key.data[depth + i] != key[depth + i]) return i;
+        }
+    }
+    return i;
+}
+
+/*
+ * grow & shrink
+ */
+static void mln_art_copy_header(mln_art_node_t *dest, mln_art_node_t *src)
+{
+    dest->nr = src->nr;
+    dest->prefix_len = src->prefix_len;
+    memcpy(dest->prefix, src->prefix, M_ART_PREFIX);
+    dest->leaf = src->leaf;
+}
+
+static mln_art_node_t *mln_art_grow(mln_art_t *t, mln_art_node_t *n)
+{
+    mln_art_node_t *nn;
+    mln_u32_t i;
+
+    if ((nn = mln_art_node_new(t, n->type + 1)) == NULL) return NULL;
+    mln_art_copy_header(nn, n);
+    switch (n->type) {
+        case M_ART_NODE4:
+        {
+            mln_art_node4_t *n4 = (mln_art_node4_t *)n;
+            mln_art_node16_t *n16 = (mln_art_node16_t *)nn;
+
+            memcpy(n16->keys, n4->keys, n->nr);
+            memcpy(n16->children, n4->children, n->nr * sizeof(void *));
+            break;
+        }
+        case M_ART_NODE16:
+        {
+            mln_art_node16_t *n16 = (mln_art_node16_t *)n;
+            mln_art_node48_t *n48 = (mln_art_node48_t *)nn;
+
+            for (i = 0; i < n->nr; ++i) {
+                n48->index[n16->keys[i]] = i + 1;
+                n48->children[i] = n16->children[i];
+            }
+            break;
+        }
+        default:
+        {
+            mln_art_node48_t *n48 = (mln_art_node48_t *)n;
+            mln_art_node256_t *n256 = (mln_art_node256_t *)nn;
+
+            for (i = 0; i < 256; ++i) {
+                if (n48->index[i]) n256->children[i] = n48->children[n48->index[i] - 1];
+            }
+            break;
+        }
+    }
+    mln_art_node_free(t, n);
+    return nn;
+}
+
+/*
+ * Shrink at a lower count than the one that made the node grow, so a node
+ * at the boundary is not reallocated on every insert and delete.
+ * If the smaller node can not be allocated, the bigger one is kept.
+ */
+static void mln_art_shrink(mln_art_t *t, void **ref, mln_art_node_t *n)
+{
+    mln_art_node_t *nn;
+    mln_u32_t i, j;
+
+    if ((n->type == M_ART_NODE16 && n->nr > 3) || \
+        (n->type == M_ART_NODE48 && n->nr > 12) || \
+        (n->type == M_ART_NODE256 && n->nr > 36))
+    {
+        return;
+    }
+    if ((nn = mln_art_node_new(t, n->type - 1)) == NULL) return;
+    mln_art_copy_header(nn, n);
+    switch (n->type) {
+        case M_ART_NODE16:
+        {
+            mln_art_node16_t *n16 = (mln_art_node16_t *)n;
+            mln_art_node4_t *n4 = (mln_art_node4_t *)nn;
+
+            memcpy(n4->keys, n16->keys, n->nr);
+            memcpy(n4->children, n16->children, n->nr * sizeof(void *));
+            break;
+        }
+        case M_ART_NODE48:
+        {
+            mln_art_node48_t *n48 = (mln_art_node48_t *)n;
+            mln_art_node16_t *n16 = (mln_art_node16_t *)nn;
+
+            for (i = 0, j = 0; i < 256; ++i) {
+                if (!n48->index[i]) continue;
+                n16->keys[j] = i;
+                n16->children[j++] = n48->children[n48->index[i] - 1];
+            }
+            break;
+        }
+        default:
+        {
+            mln_art_node256_t *n256 = (mln_art_node256_t *)n;
+            mln_art_node48_t *n48 = (mln_art_node48_t *)nn;
+
+            for (i = 0, j = 0; i < 256; ++i) {
+                if (n256->children[i] == NULL) continue;
+                n48->children[j++] = n256->children[i];
+                n48->index[i] = j;
+            }
+            break;
+        }
+    }
+    mln_art_node_free(t, n);
+    *ref = nn;
+}
+
+/*
+ * add & remove children
+ */
+static int mln_art_add_child(mln_art_t *t, void **ref, mln_art_node_t *n, mln_u8_t c, void *child)
+{
+    mln_u8_t *keys;
+    void **children;
+    mln_u32_t i;
+
+    if ((n->type == M_ART_NODE4 && n->nr == 4) || \
+        (n->type == M_ART_NODE16 && n->nr == 16) || \
+        (n->type == M_ART_NODE48 && n->nr == 48))
+    {
+        if ((n = mln_art_grow(t, n)) == NULL) return -1;
+        *ref = n;
+    }
+
+    switch (n->type) {
+        case M_ART_NODE4:
+            keys = ((mln_art_node4_t *)n)->keys;
+            children = ((mln_art_node4_t *)n)->children;
+            goto sorted;
+        case M_ART_NODE16:
+            keys = ((mln_art_node16_t *)n)->keys;
+            children = ((mln_art_node16_t *)n)->children;
+sorted:
+            for (i = n->nr; i > 0 && keys[i - 1] > c; --i) {
+                keys[i] = keys[i - 1];
+                children[i] = children[i - 1];
+            }
+            keys[i] = c;
+            children[i] = child;
+            break;
+        case M_ART_NODE48:
+        {
+            mln_art_node48_t *n48 = (mln_art_node48_t *)n;
+
+            for (i = 0; n48->children[i] != NULL; ++i)
+                ;
+            n48->children[i] = child;
+            n48->index[c] = i + 1;
+            break;
+        }
+        default:
+            ((mln_art_node256_t *)n)->children[c] = child;
+            break;
+    }
+    ++(n->nr);
+    return 0;
+}
+
+static void mln_art_remove_child(mln_art_t *t, void **ref, mln_art_node_t *n, mln_u8_t c)
+{
+    mln_u8_t *keys;
+    void **children;
+    mln_u32_t i;
+
+    switch (n->type) {
+        case M_ART_NODE4:
+            keys = ((mln_art_node4_t *)n)->keys;
+            children = ((mln_art_node4_t *)n)->children;
+            goto sorted;
+        case M_ART_NODE16:
+            keys = ((mln_art_node16_t *)n)->keys;
+            children = ((mln_art_node16_t *)n)->children;
+sorted:
+            for (i = 0; keys[i] != c; ++i)
+                ;
+            for (; i + 1 < n->nr; ++i) {
+                keys[i] = keys[i + 1];
+                children[i] = children[i + 1];
+            }
+            break;
+        case M_ART_NODE48:
+        {
+            mln_art_node48_t *n48 = (mln_art_node48_t *)n;
+
+            n48->children[n48->index[c] - 1] = NULL;
+            n48->index[c] = 0;
+            break;
+        }
+        default:
+            ((mln_art_node256_t *)n)->children[c] = NULL;
+            break;
+    }
+    --(n->nr);
+    mln_art_collapse(t, ref, n);
+}
+
+/*
+ * Keep the tree path compressed after a removal: a node left with only a
+ * leaf, or with only one child, is replaced by it.
+ */
+static void mln_art_collapse(mln_art_t *t, void **ref, mln_art_node_t *n)
+{
+    mln_art_node_t *child;
+    mln_u8_t buf[M_ART_PREFIX], c;
+    mln_u32_t len;
+    void *p;
+
+    if (n->nr == 0) {
+        *ref = n->leaf == NULL? NULL: mln_art_tag(n->leaf);
+        mln_art_node_free(t, n);
+        return;
+    }
+    if (n->nr > 1 || n->leaf != NULL) {
+        if (n->type != M_ART_NODE4) mln_art_shrink(t, ref, n);
+        return;
+    }
+
+    p = mln_art_first_child(n, &c);
+    if (!mln_art_is_leaf(p)) {
+        /*the prefix of the child becomes prefix of n + c + prefix of child*/
+        child = (mln_art_node_t *)p;
+        len = n->prefix_len;
+        if (len < M_ART_PREFIX) {
+            memcpy(buf, n->prefix, len);
+            buf[len++] = c;
+            if (len < M_ART_PREFIX)
+                memcpy(buf + len, child->prefix, mln_art_min(child->prefix_len, M_ART_PREFIX - len));
+            memcpy(child->prefix, buf, M_ART_PREFIX);
+        } else {
+            memcpy(child->prefix, n->prefix, M_ART_PREFIX);
+        }
+        child->prefix_len += n->prefix_len + 1;
+    }
+    *ref = p;
+    mln_art_node_free(t, n);
+}
+
+/*
+ * insert
+ */
+int mln_art_insert(mln_art_t *t, mln_string_t *key, void *val)
+{
+    void **ref = &(t->root), **child, *p;
+    mln_art_leaf_t *l, *nl;
+    mln_art_node_t *n, *nn;
+    mln_u8ptr_t k = key->data;
+    mln_size_t len = key->len, depth = 0, i, max;
+    mln_u8_t c;
+
+    if ((nl = mln_art_leaf_new(t, key, val)) == NULL) return -1;
+
+    while (1) {
+        p = *ref;
+        if (p == NULL) {
+            *ref = mln_art_tag(nl);
+            break;
+        }
+
+        if (mln_art_is_leaf(p)) {
+            l = mln_art_leaf(p);
+            if (mln_art_leaf_match(l, k, len)) goto replace;
+            /*split the leaf by a node whose prefix is the common part of both keys*/
+            max = mln_art_min(l->key.len, len);
+            for (i = depth; i < max && l->key.data[i] == k[i]; ++i)
+                ;
+            if ((nn = mln_art_node_new(t, M_ART_NODE4)) == NULL) goto err;
+            nn->prefix_len = i - depth;
+            memcpy(nn->prefix, k + depth, mln_art_min(i - depth, M_ART_PREFIX));
+            if (l->key.len == i) nn->leaf = l;
+            else mln_art_add_child(t, ref, nn, l->key.data[i], p);
+            if (len == i) nn->leaf = nl;
+            else mln_art_add_child(t, ref, nn, k[i], mln_art_tag(nl));
+            *ref = nn;
+            break;
+        }
+
+        n = (mln_art_node_t *)p;
+        if (n->prefix_len) {
+            i = mln_art_prefix_mismatch(n, k, len, depth);
+            if (i < n->prefix_len) {
+                /*split the prefix of n at the first different byte*/
+                if ((nn = mln_art_node_new(t, M_ART_NODE4)) == NULL) goto err;
+                nn->prefix_len = i;
+                memcpy(nn->prefix, n->prefix, mln_art_min(i, M_ART_PREFIX));
+                if (n->prefix_len <= M_ART_PREFIX) {
+                    c = n->prefix[i];
+                    n->prefix_len -= i + 1;
+                    memmove(n->prefix, n->prefix + i + 1, n->prefix_len);
+                } else {
+                    l = mln_art_minimum(n);
+                    c = l->key.data[depth + i];
+                    n->prefix_len -= i + 1;
+                    memcpy(n->prefix, l->key.data + depth + i + 1, mln_art_min(n->prefix_len, M_ART_PREFIX));
+                }
+                mln_art_add_child(t, ref, nn, c, n);
+                if (len == depth + i) nn->leaf = nl;
+                else mln_art_add_child(t, ref, nn, k[depth + i], mln_art_tag(nl));
+                *ref = nn;
+                break;
+            }
+            depth += n->prefix_len;
+        }
+
+        if (depth == len) {
+            if ((l = n->leaf) != NULL) goto replace;
+            n->leaf = nl;
+            break;
+        }
+
+        if ((child = mln_art_find_child(n, k[depth])) == NULL) {
+            if (mln_art_add_child(t, ref, n, k[depth], mln_art_tag(nl)) < 0) goto err;
+            break;
+        }
+        ref = child;
+        ++depth;
+    }
+    ++(t->nr_node);
+    return 0;
+
+replace:
+    /*the key exists, only its value is replaced*/
+    if (t->data_free != NULL && l->val != val) t->data_free(l->val);
+    l->val = val;
+    mln_art_leaf_free(t, nl);
+    return 0;
+
+err:
+    mln_art_leaf_free(t, nl);
+    return -1;
+}
+
+/*
+ * delete
+ */
+int mln_art_delete(mln_art_t *t, mln_string_t *key)
+{
+    void **ref = &(t->root), **child, *p = t->root;
+    mln_art_node_t *n;
+    mln_art_leaf_t *l;
+    mln_u8ptr_t k = key->data;
+    mln_size_t len = key->len, depth = 0;
+
+    if (p == NULL) return -1;
+    if (mln_art_is_leaf(p)) {
+        l = mln_art_leaf(p);
+        if (!mln_art_leaf_match(l, k, len)) return -1;
+        t->root = NULL;
+        goto out;
+    }
+
+    while (1) {
+        n = (mln_art_node_t *)p;
+        if (n->prefix_len) {
+            if (len - depth < n->prefix_len) return -1;
+            if (memcmp(n->prefix, k + depth, mln_art_min(n->prefix_len, M_ART_PREFIX))) return -1;
+            depth += n->prefix_len;
+        }
+
+        if (depth == len) {
+            if ((l = n->leaf) == NULL || !mln_art_leaf_match(l, k, len)) return -1;
+            n->leaf = NULL;
+            mln_art_collapse(t, ref, n);
+            goto out;
+        }
+
+        if ((child = mln_art_find_child(n, k[depth])) == NULL) return -1;
+        p = *child;
+        if (mln_art_is_leaf(p)) {
+            l = mln_art_leaf(p);
+            if (!mln_art_leaf_match(l, k, len)) return -1;
+            mln_art_remove_child(t, ref, n, k[depth]);
+            goto out;
+        }
+        ref = child;
+        ++depth;
+    }
+
+out:
+    mln_art_leaf_free(t, l);
+    --(t->nr_node);
+    return 0;
+}
+
+/*
+ * search
+ */
+void *mln_art_search(mln_art_t *t, mln_string_t *key)
+{
+    void *p = t->root, **child;
+    mln_art_node_t *n;
+    mln_art_leaf_t *l;
+    mln_u8ptr_t k = key->data;
+    mln_size_t len = key->len, depth = 0, checked = 0;
+
+    /*
+     * checked is the length of the key part known to be equal to the path,
+     * it falls behind depth once a prefix not stored in full is skipped.
+     */
+    while (p != NULL) {
+        if (mln_art_is_leaf(p)) {
+            l = mln_art_leaf(p);
+            if (l->key.len != len || memcmp(l->key.data + checked, k + checked, len - checked)) return NULL;
+            return l->val;
+        }
+
+        n = (mln_art_node_t *)p;
+        if (n->prefix_len) {
+            if (len - depth < n->prefix_len) return NULL;
+            if (memcmp(n->prefix, k + depth, mln_art_min(n->prefix_len, M_ART_PREFIX))) return NULL;
+            if (checked == depth && n->prefix_len <= M_ART_PREFIX) checked += n->prefix_len;
+            depth += n->prefix_len;
+        }
+
+        if (depth == len) {
+            if ((l = n->leaf) == NULL) return NULL;
+            if (checked < depth && memcmp(l->key.data + checked, k + checked, len - checked)) return NULL;
+            return l->val;
+        }
+
+        if ((child = mln_art_find_child(n, k[depth])) == NULL) return NULL;
+        if (checked == depth) ++checked;
+        ++depth;
+        p = *child;
+    }
+    return NULL;
+}
+
+void *mln_art_longest_prefix(mln_art_t *t, mln_string_t *key, mln_size_t *len)
+{
+    void *p = t->root, **child;
+    mln_art_node_t *n;
+    mln_art_leaf_t *l, *found = NULL;
+    mln_u8ptr_t k = key->data;
+    mln_size_t klen = key->len, depth = 0, checked = 0;
+
+    /*
+     * The keys that are prefixes of key all lie on its path. Once a leaf on
+     * the path does not match, the path has left key at a skipped prefix
+     * byte, and no key further down can match either.
+     */
+    while (p != NULL) {
+        if (mln_art_is_leaf(p)) {
+            l = mln_art_leaf(p);
+            if (l->key.len <= klen && !memcmp(l->key.data + checked, k + checked, l->key.len - checked))
+                found = l;
+            break;
+        }
+
+        n = (mln_art_node_t *)p;
+        if (n->prefix_len) {
+            if (klen - depth < n->prefix_len) break;
+            if (memcmp(n->prefix, k + depth, mln_art_min(n->prefix_len, M_ART_PREFIX))) break;
+            if (checked == depth && n->prefix_len <= M_ART_PREFIX) checked += n->prefix_len;
+            depth += n->prefix_len;
+        }
+
+        if ((l = n->leaf) != NULL) {
+            if (checked < depth && memcmp(l->key.data + checked, k + checked, depth - checked)) break;
+            found = l;
+            checked = depth;
+        }
+
+        if (depth == klen) break;
+        if ((child = mln_art_find_child(n, k[depth])) == NULL) break;
+        if (checked == depth) ++checked;
+        ++depth;
+        p = *child;
+    }
+
+    if (found == NULL) return NULL;
+    if (len != NULL) *len = found->key.len;
+    return found->val;
+}
+
+/*
+ * scan
+ */
+static int mln_art_iterate_node(void *p, art_iterate_handler handler, void *udata)
+{
+    mln_art_node_t *n;
+    mln_art_leaf_t *l;
+    mln_u32_t i;
+
+    if (mln_art_is_leaf(p)) {
+        l = mln_art_leaf(p);
+        return handler(&(l->key), l->val, udata) < 0? -1: 0;
+    }
+
+    n = (mln_art_node_t *)p;
+    if ((l = n->leaf) != NULL && handler(&(l->key), l->val, udata) < 0) return -1;
+    switch (n->type) {
+        case M_ART_NODE4:
+        {
+            mln_art_node4_t *n4 = (mln_art_node4_t *)n;
+
+            for (i = 0; i < n->nr; ++i) {
+                if (mln_art_iterate_node(n4->children[i], handler, udata) < 0) return -1;
+            }
+            break;
+        }
+        case M_ART_NODE16:
+        {
+            mln_art_node16_t *n16 = (mln_art_node16_t *)n;
+
+            for (i = 0; i < n->nr; ++i) {
+                if (mln_art_iterate_node(n16->children[i], handler, udata) < 0) return -1;
+            }
+            break;
+        }
+        case M_ART_NODE48:
+        {
+            mln_art_node48_t *n48 = (mln_art_node48_t *)n;
+
+            for (i = 0; i < 256; ++i) {
+                if (!n48->index[i]) continue;
+                if (mln_art_iterate_node(n48->children[n48->index[i] - 1], handler, udata) < 0) return -1;
+            }
+            break;
+        }
+        default:
+        {
+            mln_art_node256_t *n256 = (mln_art_node256_t *)n;
+
+            for (i = 0; i < 256; ++i) {
+                if (n256->children[i] == NULL) continue;
+                if (mln_art_iterate_node(n256->children[i], handler, udata) < 0) return -1;
+            }
+            break;
+        }
+    }
+    return 0;
+}
+
+int mln_art_iterate(mln_art_t *t, art_iterate_handler handler, void *udata)
+{
+    if (t->root == NULL) return 0;
+    return mln_art_iterate_node(t->root, handler, udata);
+}
+
+int mln_art_prefix_iterate(mln_art_t *t, mln_string_t *prefix, art_iterate_handler handler, void *udata)
+{
+    void *p = t->root, **child;
+    mln_art_node_t *n;
+    mln_art_leaf_t *l;
+    mln_u8ptr_t k = prefix->data;
+    mln_size_t len = prefix->len, depth = 0, i;
+
+    while (p != NULL) {
+        if (mln_art_is_leaf(p)) {
+            l = mln_art_leaf(p);
+            if (l->key.len < len || memcmp(l->key.data, k, len)) return 0;
+            return handler(&(l->key), l->val, udata) < 0? -1: 0;
+        }
+
+        n = (mln_art_node_t *)p;
+        if (depth == len) break;
+        if (n->prefix_len) {
+            i = mln_art_prefix_mismatch(n, k, len, depth);
+            if (i < n->prefix_len) {
+                /*prefix ends inside the prefix of n*/
+                if (depth + i == len) break;
+                return 0;
+            }
+            depth += n->prefix_len;
+            if (depth == len) break;
+        }
+        if ((child = mln_art_find_child(n, k[depth])) == NULL) return 0;
+        ++depth;
+        p = *child;
+    }
+    if (p == NULL) return 0;
+    return mln_art_iterate_node(p, handler, udata);
+}
+
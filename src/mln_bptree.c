@@ -0,0 +1,548 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "mln_bptree.h"
+
+#define M_BPTREE_MIN_LEAF  (M_BPTREE_ORDER / 2)
+#define M_BPTREE_MIN_INNER (M_BPTREE_ORDER / 2 - 1)
+
+/*static declarations*/
+static inline mln_bptree_node_t *mln_bptree_node_new(mln_bptree_t *t, int leaf) __NONNULL1(1);
+static inline void mln_bptree_node_free(mln_bptree_t *t, mln_bptree_node_t *n) __NONNULL2(1,2);
+static void mln_bptree_destroy(mln_bptree_t *t, mln_bptree_node_t *n, int keep_head) __NONNULL2(1,2);
+static inline mln_u32_t mln_bptree_lower(mln_bptree_node_t *n, mln_u64_t key) __NONNULL1(1);
+static inline mln_u32_t mln_bptree_upper(mln_bptree_node_t *n, mln_u64_t key) __NONNULL1(1);
+static void mln_bptree_rebalance(mln_bptree_t *t, mln_bptree_node_t **path, mln_u32_t *pos, int h) __NONNULL3(1,2,3);
+
+mln_bptree_t *mln_bptree_new(struct mln_bptree_attr *attr)
+{
+    mln_bptree_t *t;
+
+    if (attr == NULL || attr->pool == NULL) {
+        t = (mln_bptree_t *)malloc(sizeof(mln_bptree_t));
+    } else {
+        t = (mln_bptree_t *)attr->pool_alloc(attr->pool, sizeof(mln_bptree_t));
+    }
+    if (t == NULL) return NULL;
+    if (attr == NULL) {
+        t->pool = NULL;
+        t->pool_alloc = NULL;
+        t->pool_free = NULL;
+        t->data_free = NULL;
+    } else {
+        t->pool = attr->pool;
+        t->pool_alloc = attr->pool_alloc;
+        t->pool_free = attr->pool_free;
+        t->data_free = attr->data_free;
+    }
+    t->nr_node = 0;
+    t->height = 1;
+    if ((t->head = mln_bptree_node_new(t, 1)) == NULL) {
+        if (t->pool != NULL) t->pool_free(t);
+        else free(t);
+        return NULL;
+    }
+    t->root = t->head;
+    return t;
+}
+
+void mln_bptree_free(mln_bptree_t *t)
+{
+    if (t == NULL) return;
+
+    mln_bptree_destroy(t, t->root, 0);
+    if (t->pool != NULL) t->pool_free(t);
+    else free(t);
+}
+
+void mln_bptree_reset(mln_bptree_t *t)
+{
+    mln_bptree_destroy(t, t->root, 1);
+    t->head->nr = 0;
+    t->head->next = NULL;
+    t->root = t->head;
+    t->height = 1;
+    t->nr_node = 0;
+}
+
+static void mln_bptree_destroy(mln_bptree_t *t, mln_bptree_node_t *n, int keep_head)
+{
+    mln_u32_t i;
+
+    if (n->leaf) {
+        if (t->data_free != NULL) {
+            for (i = 0; i < n->nr; ++i)
+                t->data_free(n->ptrs[i]);
+        }
+    } else {
+        for (i = 0; i <= n->nr; ++i)
+            mln_bptree_destroy(t, (mln_bptree_node_t *)(n->ptrs[i]), keep_head);
+    }
+    if (!keep_head || n != t->head) mln_bptree_node_free(t, n);
+}
+
+static inline mln_bptree_node_t *mln_bptree_node_new(mln_bptree_t *t, int leaf)
+{
+    mln_bptree_node_t *n;
+
+    if (t->pool != NULL) {
+        n = (mln_bptree_node_t *)t->pool_alloc(t->pool, sizeof(mln_bptree_node_t));
+    } else {
+        n = (mln_bptree_node_t *)malloc(sizeof(mln_bptree_node_t));
+    }
+    if (n == NULL) return NULL;
+    n->leaf = leaf;
+    n->nr = 0;
+    n->next = NULL;
+    return n;
+}
+
+static inline void mln_bptree_node_free(mln_bptree_t *t, mln_bptree_node_t *n)
+{
+    if (t->pool != NULL) t->pool_free(n);
+    else free(n);
+}
+
+/*
+ * Count the keys less than (lower) or not greater than (upper) key.
+ * Nodes are small, so a branch-free linear count beats a binary search.
+ */
+static inline mln_u32_t mln_bptree_lower(mln_bptree_node_t *n, mln_u64_t key)
+{
+    mln_u32_t i, cnt = 0, nr = n->nr;
+    mln_u64_t *keys = n->keys;
+
+    for (i = 0; i < nr; ++i) cnt += keys[i] < key;
+    return cnt;
+}
+
+static inline mln_u32_t mln_bptree_upper(mln_bptree_node_t *n, mln_u64_t key)
+{
+    mln_u32_t i, cnt = 0, nr = n->nr;
+    mln_u64_t *keys = n->keys;
+
+    for (i = 0; i < nr; ++i) cnt += keys[i] <= key;
+    return cnt;
+}
+
+/*
+ * insert
+ */
+int mln_bptree_insert(mln_bptree_t *t, mln_u64_t key, void *val)
+{
+    mln_bptree_node_t *path[M_BPTREE_MAX_HEIGHT], *spare[M_BPTREE_MAX_HEIGHT + 1];
+    mln_u32_t pos[M_BPTREE_MAX_HEIGHT];
+    mln_u64_t tkeys[M_BPTREE_ORDER + 1], sep;
+    void *tptrs[M_BPTREE_ORDER + 2];
+    mln_bptree_node_t *n = t->root, *p, *q, *child;
+    mln_u32_t i, ci, nr, left;
+    int h = 0, need, nspare = 0;
+
+    while (!n->leaf) {
+        i = mln_bptree_upper(n, key);
+        path[h] = n;
+        pos[h++] = i;
+        n = (mln_bptree_node_t *)(n->ptrs[i]);
+    }
+    i = mln_bptree_upper(n, key);
+
+    if (n->nr < M_BPTREE_ORDER) {
+        memmove(&n->keys[i + 1], &n->keys[i], (n->nr - i) * sizeof(mln_u64_t));
+        memmove(&n->ptrs[i + 1], &n->ptrs[i], (n->nr - i) * sizeof(void *));
+        n->keys[i] = key;
+        n->ptrs[i] = val;
+        ++(n->nr);
+        ++(t->nr_node);
+        return 0;
+    }
+
+    /*
+     * Allocate every node the split needs before touching the tree,
+     * so a failed allocation leaves it unchanged.
+     */
+    for (need = h - 1; need >= 0 && path[need]->nr == M_BPTREE_ORDER - 1; --need)
+        ;
+    need = need < 0? h + 2: h - need;
+    if (need > M_BPTREE_MAX_HEIGHT) return -1;
+    for (; nspare < need; ++nspare) {
+        if ((spare[nspare] = mln_bptree_node_new(t, nspare == 0)) == NULL) {
+            while (nspare-- > 0) mln_bptree_node_free(t, spare[nspare]);
+            return -1;
+        }
+    }
+    nspare = 0;
+
+    /*split the leaf*/
+    memcpy(tkeys, n->keys, i * sizeof(mln_u64_t));
+    memcpy(tptrs, n->ptrs, i * sizeof(void *));
+    tkeys[i] = key;
+    tptrs[i] = val;
+    memcpy(&tkeys[i + 1], &n->keys[i], (M_BPTREE_ORDER - i) * sizeof(mln_u64_t));
+    memcpy(&tptrs[i + 1], &n->ptrs[i], (M_BPTREE_ORDER - i) * sizeof(void *));
+    left = (M_BPTREE_ORDER + 1) / 2;
+    q = spare[nspare++];
+    memcpy(n->keys, tkeys, left * sizeof(mln_u64_t));
+    memcpy(n->ptrs, tptrs, left * sizeof(void *));
+    q->nr = M_BPTREE_ORDER + 1 - left;
+    memcpy(q->keys, &tkeys[left], q->nr * sizeof(mln_u64_t));
+    memcpy(q->ptrs, &tptrs[left], q->nr * sizeof(void *));
+    n->nr = left;
+    q->next = n->next;
+    n->next = q;
+    ++(t->nr_node);
+    sep = q->keys[0];
+    child = q;
+
+    /*push the separator up*/
+    while (h > 0) {
+        p = path[--h];
+        ci = pos[h];
+        nr = p->nr;
+        if (nr < M_BPTREE_ORDER - 1) {
+            memmove(&p->keys[ci + 1], &p->keys[ci], (nr - ci) * sizeof(mln_u64_t));
+            memmove(&p->ptrs[ci + 2], &p->ptrs[ci + 1], (nr - ci) * sizeof(void *));
+            p->keys[ci] = sep;
+            p->ptrs[ci + 1] = child;
+            ++(p->nr);
+            return 0;
+        }
+        memcpy(tkeys, p->keys, ci * sizeof(mln_u64_t));
+        tkeys[ci] = sep;
+        memcpy(&tkeys[ci + 1], &p->keys[ci], (nr - ci) * sizeof(mln_u64_t));
+        memcpy(tptrs, p->ptrs, (ci + 1) * sizeof(void *));
+        tptrs[ci + 1] = child;
+        memcpy(&tptrs[ci + 2], &p->ptrs[ci + 1], (nr - ci) * sizeof(void *));
+        /*nr + 1 keys and nr + 2 children, the middle key goes up*/
+        left = (nr + 1) / 2;
+        q = spare[nspare++];
+        memcpy(p->keys, tkeys, left * sizeof(mln_u64_t));
+        memcpy(p->ptrs, tptrs, (left + 1) * sizeof(void *));
+        p->nr = left;
+        q->nr = nr - left;
+        memcpy(q->keys, &tkeys[left + 1], q->nr * sizeof(mln_u64_t));
+        memcpy(q->ptrs, &tptrs[left + 1], (q->nr + 1) * sizeof(void *));
+        sep = tkeys[left];
+        child = q;
+    }
+
+    /*grow a new root*/
+    p = spare[nspare];
+    p->nr = 1;
+    p->keys[0] = sep;
+    p->ptrs[0] = t->root;
+    p->ptrs[1] = child;
+    t->root = p;
+    ++(t->height);
+    return 0;
+}
+
+/*
+ * delete
+ */
+int mln_bptree_delete(mln_bptree_t *t, mln_u64_t key, void *val)
+{
+    mln_bptree_node_t *path[M_BPTREE_MAX_HEIGHT];
+    mln_u32_t pos[M_BPTREE_MAX_HEIGHT];
+    mln_bptree_node_t *n = t->root;
+    mln_u32_t i;
+    int h = 0, up;
+
+    while (!n->leaf) {
+        i = mln_bptree_lower(n, key);
+        path[h] = n;
+        pos[h++] = i;
+        n = (mln_bptree_node_t *)(n->ptrs[i]);
+    }
+    i = mln_bptree_lower(n, key);
+
+    /*
+     * Duplicate keys may continue in the following leaves,
+     * the path is moved along with them for rebalancing.
+     */
+    while (1) {
+        if (i >= n->nr) {
+            for (up = h - 1; up >= 0 && pos[up] == path[up]->nr; --up)
+                ;
+            if (up < 0) return -1;
+            n = (mln_bptree_node_t *)(path[up]->ptrs[++pos[up]]);
+            for (++up; up < h; ++up) {
+                path[up] = n;
+                pos[up] = 0;
+                n = (mln_bptree_node_t *)(n->ptrs[0]);
+            }
+            i = 0;
+            continue;
+        }
+        if (n->keys[i] != key) return -1;
+        if (n->ptrs[i] == val) break;
+        ++i;
+    }
+
+    memmove(&n->keys[i], &n->keys[i + 1], (n->nr - i - 1) * sizeof(mln_u64_t));
+    memmove(&n->ptrs[i], &n->ptrs[i + 1], (n->nr - i - 1) * sizeof(void *));
+    --(n->nr);
+    --(t->nr_node);
+    if (n->nr < M_BPTREE_MIN_LEAF && h > 0) mln_bptree_rebalance(t, path, pos, h);
+    return 0;
+}
+
+/*
+ * Fix the underflowed node under path[h-1] by borrowing from or merging with a sibling.
+ * The left node of a merge is kept, so the head leaf is never freed.
+ */
+static void mln_bptree_rebalance(mln_bptree_t *t, mln_bptree_node_t **path, mln_u32_t *pos, int h)
+{
+    mln_bptree_node_t *n, *p, *l, *r;
+    mln_u32_t ci, min, s;
+
+    n = (mln_bptree_node_t *)(path[h - 1]->ptrs[pos[h - 1]]);
+    for (; h > 0; n = p, --h) {
+        min = n->leaf? M_BPTREE_MIN_LEAF: M_BPTREE_MIN_INNER;
+        if (n->nr >= min) break;
+        p = path[h - 1];
+        ci = pos[h - 1];
+        l = ci > 0? (mln_bptree_node_t *)(p->ptrs[ci - 1]): NULL;
+        r = ci < p->nr? (mln_bptree_node_t *)(p->ptrs[ci + 1]): NULL;
+
+        if (l != NULL && l->nr > min) {
+            if (n->leaf) {
+                memmove(&n->keys[1], n->keys, n->nr * sizeof(mln_u64_t));
+                memmove(&n->ptrs[1], n->ptrs, n->nr * sizeof(void *));
+                n->keys[0] = l->keys[l->nr - 1];
+                n->ptrs[0] = l->ptrs[l->nr - 1];
+                p->keys[ci - 1] = n->keys[0];
+            } else {
+                memmove(&n->keys[1], n->keys, n->nr * sizeof(mln_u64_t));
+                memmove(&n->ptrs[1], n->ptrs, (n->nr + 1) * sizeof(void *));
+                n->keys[0] = p->keys[ci - 1];
+                n->ptrs[0] = l->ptrs[l->nr];
+                p->keys[ci - 1] = l->keys[l->nr - 1];
+            }
+            --(l->nr);
+            ++(n->nr);
+            return;
+        }
+
+        if (r != NULL && r->nr > min) {
+            if (n->leaf) {
+                n->keys[n->nr] = r->keys[0];
+                n->ptrs[n->nr] = r->ptrs[0];
+                memmove(r->keys, &r->keys[1], (r->nr - 1) * sizeof(mln_u64_t));
+                memmove(r->ptrs, &r->ptrs[1], (r->nr - 1) * sizeof(void *));
+                p->keys[ci] = r->keys[0];
+            } else {
+                n->keys[n->nr] = p->keys[ci];
+                n->ptrs[n->nr + 1] = r->ptrs[0];
+                p->keys[ci] = r->keys[0];
+                memmove(r->keys, &r->keys[1], (r->nr - 1) * sizeof(mln_u64_t));
+                memmove(r->ptrs, &r->ptrs[1], r->nr * sizeof(void *));
+            }
+            --(r->nr);
+            ++(n->nr);
+            return;
+        }
+
+        /*merge r into l, s is the index of their separator in p*/
+        if (l != NULL) {
+            r = n;
+            s = ci - 1;
+        } else {
+            l = n;
+            s = ci;
+        }
+        if (l->leaf) {
+            memcpy(&l->keys[l->nr], r->keys, r->nr * sizeof(mln_u64_t));
+            memcpy(&l->ptrs[l->nr], r->ptrs, r->nr * sizeof(void *));
+            l->nr += r->nr;
+            l->next = r->next;
+        } else {
+            l->keys[l->nr] = p->keys[s];
+            memcpy(&l->keys[l->nr + 1], r->keys, r->nr * sizeof(mln_u64_t));
+            memcpy(&l->ptrs[l->nr + 1], r->ptrs, (r->nr + 1) * sizeof(void *));
+            l->nr += r->nr + 1;
+        }
+        mln_bptree_node_free(t, r);
+        memmove(&p->keys[s], &p->keys[s + 1], (p->nr - s - 1) * sizeof(mln_u64_t));
+        memmove(&p->ptrs[s + 1], &p->ptrs[s + 2], (p->nr - s - 1) * sizeof(void *));
+        --(p->nr);
+    }
+
+    n = t->root;
+    if (!n->leaf && n->nr == 0) {
+        t->root = (mln_bptree_node_t *)(n->ptrs[0]);
+        --(t->height);
+        mln_bptree_node_free(t, n);
+    }
+}
+
+/*
+ * bulk load
+ */
+int mln_bptree_load(mln_bptree_t *t, mln_u64_t *keys, void **vals, mln_size_t n)
+{
+    mln_bptree_node_t **nodes, *node;
+    mln_u64_t *mins;
+    mln_size_t i, j, k, cnt, total, nr_parent, base, extra, off, level_start, level_cnt;
+    mln_u32_t height;
+
+    if (t->nr_node) return -1;
+    for (i = 1; i < n; ++i) {
+        if (keys[i] < keys[i - 1]) return -1;
+    }
+    if (n <= M_BPTREE_ORDER) {
+        memcpy(t->head->keys, keys, n * sizeof(mln_u64_t));
+        if (vals != NULL) memcpy(t->head->ptrs, vals, n * sizeof(void *));
+        else memset(t->head->ptrs, 0, n * sizeof(void *));
+        t->head->nr = n;
+        t->nr_node = n;
+        return 0;
+    }
+
+    /*count the nodes of every level, all of them are allocated first*/
+    total = cnt = (n + M_BPTREE_ORDER - 1) / M_BPTREE_ORDER;
+    while (cnt > 1) {
+        cnt = (cnt + M_BPTREE_ORDER - 1) / M_BPTREE_ORDER;
+        total += cnt;
+    }
+    if ((nodes = (mln_bptree_node_t **)malloc(total * sizeof(mln_bptree_node_t *))) == NULL)
+        return -1;
+    if ((mins = (mln_u64_t *)malloc(total * sizeof(mln_u64_t))) == NULL) {
+        free(nodes);
+        return -1;
+    }
+    cnt = (n + M_BPTREE_ORDER - 1) / M_BPTREE_ORDER;
+    nodes[0] = t->head;
+    for (i = 1; i < total; ++i) {
+        if ((nodes[i] = mln_bptree_node_new(t, i < cnt)) == NULL) {
+            while (--i > 0) mln_bptree_node_free(t, nodes[i]);
+            free(mins);
+            free(nodes);
+            return -1;
+        }
+    }
+
+    /*
+     * Entries are spread evenly, so every node but the root is at least half full.
+     */
+    base = n / cnt;
+    extra = n % cnt;
+    for (i = 0, off = 0; i < cnt; ++i) {
+        node = nodes[i];
+        node->nr = base + (i < extra);
+        memcpy(node->keys, &keys[off], node->nr * sizeof(mln_u64_t));
+        if (vals != NULL) memcpy(node->ptrs, &vals[off], node->nr * sizeof(void *));
+        else memset(node->ptrs, 0, node->nr * sizeof(void *));
+        node->next = i + 1 < cnt? nodes[i + 1]: NULL;
+        mins[i] = node->keys[0];
+        off += node->nr;
+    }
+
+    height = 1;
+    level_start = 0;
+    level_cnt = cnt;
+    while (level_cnt > 1) {
+        nr_parent = (level_cnt + M_BPTREE_ORDER - 1) / M_BPTREE_ORDER;
+        base = level_cnt / nr_parent;
+        extra = level_cnt % nr_parent;
+        k = level_start;
+        for (i = 0; i < nr_parent; ++i) {
+            node = nodes[level_start + level_cnt + i];
+            cnt = base + (i < extra);
+            mins[level_start + level_cnt + i] = mins[k];
+            for (j = 0; j < cnt; ++j, ++k) {
+                node->ptrs[j] = nodes[k];
+                if (j) node->keys[j - 1] = mins[k];
+            }
+            node->nr = cnt - 1;
+        }
+        level_start += level_cnt;
+        level_cnt = nr_parent;
+        ++height;
+    }
+
+    t->root = nodes[level_start];
+    t->height = height;
+    t->nr_node = n;
+    free(mins);
+    free(nodes);
+    return 0;
+}
+
+/*
+ * search
+ */
+int mln_bptree_lower_bound(mln_bptree_t *t, mln_u64_t key, mln_bptree_iter_t *it)
+{
+    mln_bptree_node_t *n = t->root;
+    mln_u32_t i;
+
+    while (!n->leaf)
+        n = (mln_bptree_node_t *)(n->ptrs[mln_bptree_lower(n, key)]);
+    i = mln_bptree_lower(n, key);
+    if (i >= n->nr) {
+        if ((n = n->next) == NULL) return -1;
+        i = 0;
+    }
+    it->leaf = n;
+    it->index = i;
+    return 0;
+}
+
+int mln_bptree_search(mln_bptree_t *t, mln_u64_t key, mln_bptree_iter_t *it)
+{
+    if (mln_bptree_lower_bound(t, key, it) < 0) return -1;
+    return mln_bptree_iter_key(it) == key? 0: -1;
+}
+
+int mln_bptree_min(mln_bptree_t *t, mln_bptree_iter_t *it)
+{
+    if (!t->nr_node) return -1;
+    it->leaf = t->head;
+    it->index = 0;
+    return 0;
+}
+
+int mln_bptree_successor(mln_bptree_t *t, mln_bptree_iter_t *it)
+{
+    if (++(it->index) < it->leaf->nr) return 0;
+    if ((it->leaf = it->leaf->next) == NULL) return -1;
+    it->index = 0;
+    return 0;
+}
+
+/*
+ * scan
+ */
+int mln_bptree_iterate(mln_bptree_t *t, bptree_iterate_handler handler, void *udata)
+{
+    mln_bptree_node_t *n;
+    mln_u32_t i;
+
+    for (n = t->head; n != NULL; n = n->next) {
+        for (i = 0; i < n->nr; ++i) {
+            if (handler(n->keys[i], n->ptrs[i], udata) < 0) return -1;
+        }
+    }
+    return 0;
+}
+
+int mln_bptree_range(mln_bptree_t *t, mln_u64_t low, mln_u64_t high, bptree_iterate_handler handler, void *udata)
+{
+    mln_bptree_iter_t it;
+    mln_bptree_node_t *n;
+    mln_u32_t i;
+
+    if (low > high || mln_bptree_lower_bound(t, low, &it) < 0) return 0;
+    for (n = it.leaf, i = it.index; n != NULL; n = n->next, i = 0) {
+        for (; i < n->nr; ++i) {
+            if (n->keys[i] > high) return 0;
+            if (handler(n->keys[i], n->ptrs[i], udata) < 0) return -1;
+        }
+    }
+    return 0;
+}
+
@@ -3,6 +3,7 @@
  * Copyright (C) Niklaus F.Schen.
  */
 
+#include <stdlib.h>
 #include "mln_chain.h"
 
 mln_buf_t *mln_buf_new(mln_alloc_t *pool)
@@ -11,6 +12,7 @@ mln_buf_t *mln_buf_new(mln_alloc_t *pool)
     b->left_pos = b->pos = b->last = NULL;
     b->start = b->end = NULL;
     b->shadow = NULL;
+    b->shared = NULL;
     b->file_left_pos = b->file_pos = b->file_last = 0;
     b->file = NULL;
     b->temporary = b->in_memory = b->in_file = 0;
@@ -33,6 +35,12 @@ void mln_buf_pool_release(mln_buf_t *b)
 {
     if (b == NULL) return;
 
+    if (b->shared != NULL) {
+        mln_buf_shared_free(b->shared);
+        mln_alloc_free(b);
+        return;
+    }
+
     if (b->shadow != NULL || b->temporary) {
         mln_alloc_free(b);
         return;
@@ -90,3 +98,50 @@ void mln_chain_pool_release_all(mln_chain_t *c)
     }
 }
 
+
+/*
+ * Shared buf.
+ * The memory is not allocated from any pool, so it can be referenced by
+ * the bufs of different pools (connections), and it is freed when the
+ * last reference is released.
+ */
+mln_buf_shared_t *mln_buf_shared_new(mln_size_t size)
+{
+    mln_buf_shared_t *s = (mln_buf_shared_t *)malloc(sizeof(mln_buf_shared_t) + size);
+    if (s == NULL) return NULL;
+    s->data = (mln_u8ptr_t)(s + 1);
+    s->size = size;
+    s->refs = 1;
+    return s;
+}
+
+mln_buf_shared_t *mln_buf_shared_ref(mln_buf_shared_t *s)
+{
+    __sync_add_and_fetch(&s->refs, 1);
+    return s;
+}
+
+void mln_buf_shared_free(mln_buf_shared_t *s)
+{
+    if (s == NULL) return;
+    if (!__sync_sub_and_fetch(&s->refs, 1)) free(s);
+}
+
+mln_chain_t *mln_chain_shared_new(mln_alloc_t *pool, mln_buf_shared_t *s)
+{
+    mln_chain_t *c;
+    mln_buf_t *b;
+
+    if ((c = mln_chain_new(pool)) == NULL) return NULL;
+    if ((b = mln_buf_new(pool)) == NULL) {
+        mln_chain_pool_release(c);
+        return NULL;
+    }
+    c->buf = b;
+    b->left_pos = b->pos = b->start = s->data;
+    b->last = b->end = s->data + s->size;
+    b->in_memory = 1;
+    b->last_buf = 1;
+    b->shared = mln_buf_shared_ref(s);
+    return c;
+}
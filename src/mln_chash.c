@@ -0,0 +1,236 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "mln_chash.h"
+
+static inline mln_chash_stripe_t *mln_chash_stripe(mln_chash_t *ch, void *key) __NONNULL2(1,2);
+static int mln_chash_stripe_iterate(mln_hash_t *h, chash_iterate_handler handler, void *udata) __NONNULL2(1,2);
+
+
+mln_chash_t *mln_chash_new(struct mln_hash_attr *attr, mln_u32_t nr_stripes, mln_u32_t mode)
+{
+    mln_chash_t *ch;
+    mln_chash_stripe_t *s;
+    struct mln_hash_attr hattr;
+    mln_u32_t n = 1, i;
+
+    if (attr->hash == NULL || attr->cmp == NULL) return NULL;
+    if (nr_stripes == 0) nr_stripes = M_CHASH_DEFAULT_STRIPES;
+    if (nr_stripes > M_CHASH_MAX_STRIPES) nr_stripes = M_CHASH_MAX_STRIPES;
+    while (n < nr_stripes) n <<= 1;
+
+    if ((ch = (mln_chash_t *)malloc(sizeof(mln_chash_t))) == NULL) return NULL;
+    if ((ch->stripes = (mln_chash_stripe_t *)calloc(n, sizeof(mln_chash_stripe_t))) == NULL) {
+        free(ch);
+        return NULL;
+    }
+    ch->nr_stripes = n;
+    ch->mask = n - 1;
+    memset(&ch->route, 0, sizeof(mln_hash_t));
+    /*the built-in handlers return the full hash to open addressing tables*/
+    ch->route.len = M_CHASH_ROUTE_LEN;
+    ch->route.open_addressing = 1;
+    ch->route.hash = attr->hash;
+    ch->route.cmp = attr->cmp;
+
+    /*
+     * Lookups only hold the read lock, so the stripes must never change
+     * anything while searching. That rules out the incremental mode,
+     * whose lookups move buckets.
+     */
+    mode &= ~M_HASH_INCREMENTAL;
+    hattr = *attr;
+    hattr.len_base = (attr->len_base + n - 1) / n;
+    if (hattr.len_base == 0) hattr.len_base = 1;
+
+    for (i = 0; i < n; ++i) {
+        s = &ch->stripes[i];
+        if (pthread_rwlock_init(&s->s.lock, NULL) != 0) goto err;
+        if ((s->s.h = mln_hash_new_mode(&hattr, mode)) == NULL) {
+            pthread_rwlock_destroy(&s->s.lock);
+            goto err;
+        }
+    }
+    return ch;
+
+err:
+    while (i-- > 0) {
+        s = &ch->stripes[i];
+        mln_hash_free(s->s.h, M_HASH_F_NONE);
+        pthread_rwlock_destroy(&s->s.lock);
+    }
+    free(ch->stripes);
+    free(ch);
+    return NULL;
+}
+
+void mln_chash_free(mln_chash_t *ch, mln_hash_flag_t flg)
+{
+    if (ch == NULL) return;
+
+    mln_u32_t i;
+    mln_chash_stripe_t *s;
+
+    for (i = 0; i < ch->nr_stripes; ++i) {
+        s = &ch->stripes[i];
+        mln_hash_free(s->s.h, flg);
+        pthread_rwlock_destroy(&s->s.lock);
+    }
+    free(ch->stripes);
+    free(ch);
+}
+
+/*
+ * The stripes reduce the same hash by their own length, so the stripe is taken
+ * from the middle bits of a multiplicative remix, which depend on all of the
+ * low bits. Taking the low bits instead leaves a stripe only the buckets whose
+ * index has those bits.
+ */
+static inline mln_chash_stripe_t *mln_chash_stripe(mln_chash_t *ch, void *key)
+{
+    mln_u64_t v = ch->route.hash(&ch->route, key) * 0x9e3779b97f4a7c15ULL;
+    return &ch->stripes[(v >> 32) & ch->mask];
+}
+
+void *mln_chash_search(mln_chash_t *ch, void *key)
+{
+    void *val;
+    mln_chash_stripe_t *s = mln_chash_stripe(ch, key);
+
+    pthread_rwlock_rdlock(&s->s.lock);
+    val = mln_hash_search(s->s.h, key);
+    pthread_rwlock_unlock(&s->s.lock);
+    return val;
+}
+
+int mln_chash_access(mln_chash_t *ch, void *key, chash_access_handler handler, void *udata)
+{
+    void *val;
+    mln_chash_stripe_t *s = mln_chash_stripe(ch, key);
+    int rc = -1;
+
+    pthread_rwlock_rdlock(&s->s.lock);
+    if ((val = mln_hash_search(s->s.h, key)) != NULL) {
+        handler(val, udata);
+        rc = 0;
+    }
+    pthread_rwlock_unlock(&s->s.lock);
+    return rc;
+}
+
+int mln_chash_key_exist(mln_chash_t *ch, void *key)
+{
+    int rc;
+    mln_chash_stripe_t *s = mln_chash_stripe(ch, key);
+
+    pthread_rwlock_rdlock(&s->s.lock);
+    rc = mln_hash_key_exist(s->s.h, key);
+    pthread_rwlock_unlock(&s->s.lock);
+    return rc;
+}
+
+int mln_chash_insert(mln_chash_t *ch, void *key, void *val)
+{
+    int rc;
+    mln_chash_stripe_t *s = mln_chash_stripe(ch, key);
+
+    pthread_rwlock_wrlock(&s->s.lock);
+    rc = mln_hash_insert(s->s.h, key, val);
+    pthread_rwlock_unlock(&s->s.lock);
+    return rc;
+}
+
+int mln_chash_update(mln_chash_t *ch, void *key, void *val)
+{
+    int rc;
+    mln_chash_stripe_t *s = mln_chash_stripe(ch, *(void **)key);
+
+    pthread_rwlock_wrlock(&s->s.lock);
+    rc = mln_hash_update(s->s.h, key, val);
+    pthread_rwlock_unlock(&s->s.lock);
+    return rc;
+}
+
+void *mln_chash_change_value(mln_chash_t *ch, void *key, void *new_value)
+{
+    void *val;
+    mln_chash_stripe_t *s = mln_chash_stripe(ch, key);
+
+    pthread_rwlock_wrlock(&s->s.lock);
+    val = mln_hash_change_value(s->s.h, key, new_value);
+    pthread_rwlock_unlock(&s->s.lock);
+    return val;
+}
+
+void mln_chash_remove(mln_chash_t *ch, void *key, mln_hash_flag_t flg)
+{
+    mln_chash_stripe_t *s = mln_chash_stripe(ch, key);
+
+    pthread_rwlock_wrlock(&s->s.lock);
+    mln_hash_remove(s->s.h, key, flg);
+    pthread_rwlock_unlock(&s->s.lock);
+}
+
+/*
+ * mln_chash_iterate
+ *
+ * Stripes are visited one by one, each under its read lock. Other threads
+ * may keep updating the stripes not being visited, so the result is not a
+ * snapshot of the whole table, but every element present during the whole
+ * iteration is visited exactly once.
+ * mln_hash_iterate is not used because it records its position in the table,
+ * which is not allowed under a read lock.
+ */
+int mln_chash_iterate(mln_chash_t *ch, chash_iterate_handler handler, void *udata)
+{
+    mln_u32_t i;
+    mln_chash_stripe_t *s;
+    int rc = 0;
+
+    for (i = 0; i < ch->nr_stripes; ++i) {
+        s = &ch->stripes[i];
+        pthread_rwlock_rdlock(&s->s.lock);
+        rc = mln_chash_stripe_iterate(s->s.h, handler, udata);
+        pthread_rwlock_unlock(&s->s.lock);
+        if (rc < 0) break;
+    }
+    return rc;
+}
+
+static int mln_chash_stripe_iterate(mln_hash_t *h, chash_iterate_handler handler, void *udata)
+{
+    mln_u64_t i;
+    mln_hash_entry_t *he;
+
+    if (h->open_addressing) {
+        for (i = 0; i < h->len; ++i) {
+            if (h->ctrl[i] & 0x80) continue;
+            if (handler(h->slots[i].key, h->slots[i].val, udata) < 0) return -1;
+        }
+        return 0;
+    }
+    for (he = h->iter_head; he != NULL; he = he->iter_next) {
+        if (handler(he->key, he->val, udata) < 0) return -1;
+    }
+    return 0;
+}
+
+mln_u64_t mln_chash_nr_nodes(mln_chash_t *ch)
+{
+    mln_u32_t i;
+    mln_chash_stripe_t *s;
+    mln_u64_t n = 0;
+
+    for (i = 0; i < ch->nr_stripes; ++i) {
+        s = &ch->stripes[i];
+        pthread_rwlock_rdlock(&s->s.lock);
+        n += s->s.h->nr_nodes;
+        pthread_rwlock_unlock(&s->s.lock);
+    }
+    return n;
+}
+
@@ -0,0 +1,190 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mln_dheap.h"
+
+#define M_DHEAP_ALIGN 64
+
+static int mln_dheap_grow(mln_dheap_t *dh) __NONNULL1(1);
+static inline void mln_dheap_sift_up(mln_dheap_t *dh, mln_size_t i) __NONNULL1(1);
+static inline void mln_dheap_sift_down(mln_dheap_t *dh, mln_size_t i) __NONNULL1(1);
+
+
+mln_dheap_t *mln_dheap_new(struct mln_dheap_attr *attr)
+{
+    mln_dheap_t *dh;
+
+    /*unlike pheap and fheap, there is no inline API working without cmp*/
+    if (attr == NULL || attr->cmp == NULL) return NULL;
+
+    if (attr->pool != NULL)
+        dh = (mln_dheap_t *)attr->pool_alloc(attr->pool, sizeof(mln_dheap_t));
+    else
+        dh = (mln_dheap_t *)malloc(sizeof(mln_dheap_t));
+    if (dh == NULL) return NULL;
+
+    dh->pool = attr->pool;
+    dh->pool_alloc = attr->pool_alloc;
+    dh->pool_free = attr->pool_free;
+    dh->cmp = attr->cmp;
+    dh->copy = attr->copy;
+    dh->key_free = attr->key_free;
+    dh->buf = NULL;
+    dh->base = NULL;
+    dh->num = 0;
+    dh->size = 0;
+    if (mln_dheap_grow(dh) < 0) {
+        if (dh->pool != NULL) dh->pool_free(dh);
+        else free(dh);
+        return NULL;
+    }
+    return dh;
+}
+
+void mln_dheap_free(mln_dheap_t *dh)
+{
+    if (dh == NULL) return;
+
+    mln_size_t i;
+    for (i = 0; i < dh->num; ++i)
+        mln_dheap_node_free(dh, dh->base[i].node);
+    free(dh->buf);
+    if (dh->pool != NULL) dh->pool_free(dh);
+    else free(dh);
+}
+
+/*
+ * The array is always allocated by malloc, since it is resized
+ * and has to be aligned by hand.
+ */
+static int mln_dheap_grow(mln_dheap_t *dh)
+{
+    mln_size_t size = dh->size? dh->size << 1: M_DHEAP_INIT_SIZE;
+    void *buf;
+    mln_dheap_slot_t *base;
+
+    if (size < dh->size) return -1;
+    buf = malloc((size + M_DHEAP_ARITY - 1) * sizeof(mln_dheap_slot_t) + M_DHEAP_ALIGN);
+    if (buf == NULL) return -1;
+    base = (mln_dheap_slot_t *)(((mln_uptr_t)buf + M_DHEAP_ALIGN - 1) & ~((mln_uptr_t)M_DHEAP_ALIGN - 1));
+    base += M_DHEAP_ARITY - 1;
+    if (dh->num) memcpy(base, dh->base, dh->num * sizeof(mln_dheap_slot_t));
+    free(dh->buf);
+    dh->buf = buf;
+    dh->base = base;
+    dh->size = size;
+    return 0;
+}
+
+static inline void mln_dheap_sift_up(mln_dheap_t *dh, mln_size_t i)
+{
+    mln_dheap_slot_t *base = dh->base, e = base[i];
+    dheap_cmp cmp = dh->cmp;
+    mln_size_t p;
+
+    while (i > 0) {
+        p = (i - 1) / M_DHEAP_ARITY;
+        if (cmp(e.key, base[p].key)) break;
+        base[i] = base[p];
+        base[i].node->index = i;
+        i = p;
+    }
+    base[i] = e;
+    e.node->index = i;
+}
+
+static inline void mln_dheap_sift_down(mln_dheap_t *dh, mln_size_t i)
+{
+    mln_dheap_slot_t *base = dh->base, e = base[i];
+    dheap_cmp cmp = dh->cmp;
+    mln_size_t c, j, best, end, num = dh->num;
+
+    while ((c = i * M_DHEAP_ARITY + 1) < num) {
+        end = c + M_DHEAP_ARITY;
+        if (end > num) end = num;
+        for (best = c, j = c + 1; j < end; ++j) {
+            if (!cmp(base[j].key, base[best].key)) best = j;
+        }
+        if (cmp(base[best].key, e.key)) break;
+        base[i] = base[best];
+        base[i].node->index = i;
+        i = best;
+    }
+    base[i] = e;
+    e.node->index = i;
+}
+
+int mln_dheap_insert(mln_dheap_t *dh, mln_dheap_node_t *dn)
+{
+    if (dh->num >= dh->size && mln_dheap_grow(dh) < 0) return -1;
+    dh->base[dh->num].key = dn->key;
+    dh->base[dh->num].node = dn;
+    mln_dheap_sift_up(dh, dh->num++);
+    return 0;
+}
+
+mln_dheap_node_t *mln_dheap_extract_min(mln_dheap_t *dh)
+{
+    if (!dh->num) return NULL;
+
+    mln_dheap_node_t *dn = dh->base[0].node;
+    if (--(dh->num)) {
+        dh->base[0] = dh->base[dh->num];
+        mln_dheap_sift_down(dh, 0);
+    }
+    return dn;
+}
+
+int mln_dheap_decrease_key(mln_dheap_t *dh, mln_dheap_node_t *node, void *key)
+{
+    if (!dh->cmp(node->key, key)) return -1;
+    dh->copy(node->key, key);
+    mln_dheap_sift_up(dh, node->index);
+    return 0;
+}
+
+void mln_dheap_delete(mln_dheap_t *dh, mln_dheap_node_t *node)
+{
+    mln_size_t i = node->index;
+
+    if (i == --(dh->num)) return;
+    dh->base[i] = dh->base[dh->num];
+    if (i > 0 && !dh->cmp(dh->base[i].key, dh->base[(i - 1) / M_DHEAP_ARITY].key))
+        mln_dheap_sift_up(dh, i);
+    else
+        mln_dheap_sift_down(dh, i);
+}
+
+/*mln_dheap_node_t*/
+mln_dheap_node_t *mln_dheap_node_new(mln_dheap_t *dh, void *key)
+{
+    mln_dheap_node_t *dn;
+
+    if (dh->pool != NULL)
+        dn = (mln_dheap_node_t *)dh->pool_alloc(dh->pool, sizeof(mln_dheap_node_t));
+    else
+        dn = (mln_dheap_node_t *)malloc(sizeof(mln_dheap_node_t));
+    if (dn == NULL) return NULL;
+
+    dn->key = key;
+    dn->index = 0;
+    dn->nofree = 0;
+    return dn;
+}
+
+void mln_dheap_node_free(mln_dheap_t *dh, mln_dheap_node_t *dn)
+{
+    if (dn == NULL) return;
+    if (dh->key_free != NULL && dn->key != NULL)
+        dh->key_free(dn->key);
+    if (!dn->nofree) {
+        if (dh->pool != NULL) dh->pool_free(dn);
+        else free(dn);
+    }
+}
+
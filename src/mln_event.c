@@ -29,12 +29,8 @@ static int
 mln_event_rbtree_fd_cmp(const void *k1, const void *k2) __NONNULL2(1,2);
 static inline int
 mln_event_fd_timeout_cmp(const void *k1, const void *k2);
-static inline void
-mln_event_fd_timeout_copy(void *k1, void *k2);
 static inline int
-mln_event_fheap_timer_cmp(const void *k1, const void *k2) __NONNULL2(1,2);
-static inline void
-mln_event_fheap_timer_copy(void *k1, void *k2) __NONNULL2(1,2);
+mln_event_pheap_timer_cmp(const void *k1, const void *k2) __NONNULL2(1,2);
 static inline void
 mln_event_fd_nonblock_set(int fd);
 static inline void
@@ -66,13 +62,6 @@ mln_event_fd_append_set(mln_event_t *event, \
 static int
 mln_event_fd_timeout_set(mln_event_t *ev, mln_event_desc_t *ed, int timeout_ms);
 
-/*varliables*/
-mln_event_desc_t fheap_min = {
-    NULL, NULL, NULL, NULL,
-    M_EV_TM, 0,
-    {(mln_event_tm_t){NULL, NULL, 0}},
-};
-
 mln_event_t *mln_event_new(void)
 {
     int rc;
@@ -92,19 +81,19 @@ mln_event_t *mln_event_new(void)
     ev->ev_fd_active_head = NULL;
     ev->ev_fd_active_tail = NULL;
 
-    ev->ev_fd_timeout_heap = mln_fheap_new(&fheap_min, NULL);
+    ev->ev_fd_timeout_heap = mln_pheap_new(NULL);
     if (ev->ev_fd_timeout_heap == NULL) {
         goto err2;
     }
     /*timer heap*/
-    struct mln_fheap_attr fattr;
-    fattr.pool = NULL;
-    fattr.pool_alloc = NULL;
-    fattr.pool_free = NULL;
-    fattr.cmp = mln_event_fheap_timer_cmp;
-    fattr.copy = mln_event_fheap_timer_copy;
-    fattr.key_free = mln_event_desc_free;
-    ev->ev_timer_heap = mln_fheap_new(&fheap_min, &fattr);
+    struct mln_pheap_attr pattr;
+    pattr.pool = NULL;
+    pattr.pool_alloc = NULL;
+    pattr.pool_free = NULL;
+    pattr.cmp = mln_event_pheap_timer_cmp;
+    pattr.copy = NULL;
+    pattr.key_free = mln_event_desc_free;
+    ev->ev_timer_heap = mln_pheap_new(&pattr);
     if (ev->ev_timer_heap == NULL) {
         goto err3;
     }
@@ -156,9 +145,9 @@ mln_event_t *mln_event_new(void)
     return ev;
 
 err4:
-    mln_fheap_inline_free(ev->ev_timer_heap, mln_event_fheap_timer_cmp, mln_event_desc_free);
+    mln_pheap_inline_free(ev->ev_timer_heap, mln_event_desc_free);
 err3:
-    mln_fheap_inline_free(ev->ev_fd_timeout_heap, mln_event_fd_timeout_cmp, NULL);
+    mln_pheap_inline_free(ev->ev_fd_timeout_heap, NULL);
 err2:
     mln_rbtree_free(ev->ev_fd_tree);
 err1:
@@ -170,7 +159,7 @@ void mln_event_free(mln_event_t *ev)
 {
     if (ev == NULL) return;
     mln_event_desc_t *ed;
-    mln_fheap_inline_free(ev->ev_fd_timeout_heap, mln_event_fd_timeout_cmp, NULL);
+    mln_pheap_inline_free(ev->ev_fd_timeout_heap, NULL);
     mln_rbtree_free(ev->ev_fd_tree);
     while ((ed = ev->ev_fd_wait_head) != NULL) {
         ev_fd_wait_chain_del(&(ev->ev_fd_wait_head), \
@@ -178,7 +167,7 @@ void mln_event_free(mln_event_t *ev)
                              ed);
         mln_event_desc_free(ed);
     }
-    mln_fheap_inline_free(ev->ev_timer_heap, mln_event_fheap_timer_cmp, mln_event_desc_free);
+    mln_pheap_inline_free(ev->ev_timer_heap, mln_event_desc_free);
 #if defined(MLN_EPOLL)
     close(ev->epollfd);
     close(ev->unusedfd);
@@ -226,13 +215,13 @@ mln_event_timer_t *mln_event_timer_set(mln_event_t *event, \
     ed->next = NULL;
     ed->act_prev = NULL;
     ed->act_next = NULL;
-    mln_fheap_node_t *fn = mln_fheap_node_new(event->ev_timer_heap, ed);
+    mln_pheap_node_t *fn = mln_pheap_node_new(event->ev_timer_heap, ed);
     if (fn == NULL) {
         free(ed);
         return NULL;
     }
     pthread_mutex_lock(&event->timer_lock);
-    mln_fheap_inline_insert(event->ev_timer_heap, fn, mln_event_fheap_timer_cmp);
+    mln_pheap_inline_insert(event->ev_timer_heap, fn, mln_event_pheap_timer_cmp);
     pthread_mutex_unlock(&event->timer_lock);
     return fn;
 }
@@ -240,8 +229,8 @@ mln_event_timer_t *mln_event_timer_set(mln_event_t *event, \
 void mln_event_timer_cancel(mln_event_t *event, mln_event_timer_t *timer)
 {
     pthread_mutex_lock(&event->timer_lock);
-    mln_fheap_inline_delete(event->ev_timer_heap, timer, mln_event_fheap_timer_copy, mln_event_fheap_timer_cmp);
-    mln_fheap_inline_node_free(event->ev_timer_heap, timer, mln_event_desc_free);
+    mln_pheap_inline_delete(event->ev_timer_heap, timer, mln_event_pheap_timer_cmp);
+    mln_pheap_inline_node_free(event->ev_timer_heap, timer, mln_event_desc_free);
     pthread_mutex_unlock(&event->timer_lock);
 }
 
@@ -252,32 +241,32 @@ static inline void mln_event_timer_process(mln_event_t *event)
     gettimeofday(&tv, NULL);
     now = tv.tv_sec * 1000000 + tv.tv_usec;
     mln_event_desc_t *ed;
-    mln_fheap_node_t *fn;
+    mln_pheap_node_t *fn;
 
 lp:
     if (pthread_mutex_trylock(&event->timer_lock))
         return;
 
-    fn = mln_fheap_minimum(event->ev_timer_heap);
+    fn = mln_pheap_minimum(event->ev_timer_heap);
     if (fn == NULL) {
         pthread_mutex_unlock(&event->timer_lock);
         return;
     }
 
-    ed = (mln_event_desc_t *)mln_fheap_node_key(fn);
+    ed = (mln_event_desc_t *)mln_pheap_node_key(fn);
     if (ed->data.tm.end_tm > now) {
         pthread_mutex_unlock(&event->timer_lock);
         return;
     }
 
-    fn = mln_fheap_inline_extract_min(event->ev_timer_heap, mln_event_fheap_timer_cmp);
+    fn = mln_pheap_inline_extract_min(event->ev_timer_heap, mln_event_pheap_timer_cmp);
 
     pthread_mutex_unlock(&event->timer_lock);
 
     if (ed->data.tm.handler != NULL)
         ed->data.tm.handler(event, ed->data.tm.data);
 
-    mln_fheap_inline_node_free(event->ev_timer_heap, fn, mln_event_desc_free);
+    mln_pheap_inline_node_free(event->ev_timer_heap, fn, mln_event_desc_free);
 
     if (!event->is_break)
         goto lp;
@@ -612,30 +601,30 @@ mln_event_fd_timeout_set(mln_event_t *ev, mln_event_desc_t *ed, int timeout_ms)
     mln_event_fd_t *ef = &(ed->data.fd);
     if (timeout_ms == M_EV_UNLIMITED) {
         if (ef->timeout_node != NULL) {
-            mln_fheap_inline_delete(ev->ev_fd_timeout_heap, ef->timeout_node, mln_event_fd_timeout_copy, mln_event_fd_timeout_cmp);
-            mln_fheap_inline_node_free(ev->ev_fd_timeout_heap, ef->timeout_node, NULL);
+            mln_pheap_inline_delete(ev->ev_fd_timeout_heap, ef->timeout_node, mln_event_fd_timeout_cmp);
+            mln_pheap_inline_node_free(ev->ev_fd_timeout_heap, ef->timeout_node, NULL);
             ef->timeout_node = NULL;
             ef->end_us = 0;
         }
         return 0;
     }
-    mln_fheap_node_t *fn;
+    mln_pheap_node_t *fn;
     struct timeval tv;
     memset(&tv, 0, sizeof(tv));
     gettimeofday(&tv, NULL);
     if (ef->timeout_node == NULL) {
         ef->end_us = tv.tv_sec*1000000+tv.tv_usec+timeout_ms*1000;
-        fn = mln_fheap_node_new(ev->ev_fd_timeout_heap, ed);
+        fn = mln_pheap_node_new(ev->ev_fd_timeout_heap, ed);
         if (fn == NULL) {
             return -1;
         }
         ef->timeout_node = fn;
-        mln_fheap_inline_insert(ev->ev_fd_timeout_heap, fn, mln_event_fd_timeout_cmp);
+        mln_pheap_inline_insert(ev->ev_fd_timeout_heap, fn, mln_event_fd_timeout_cmp);
     } else {
         fn = ef->timeout_node;
-        mln_fheap_inline_delete(ev->ev_fd_timeout_heap, fn, mln_event_fd_timeout_copy, mln_event_fd_timeout_cmp);
+        mln_pheap_inline_delete(ev->ev_fd_timeout_heap, fn, mln_event_fd_timeout_cmp);
         ef->end_us = tv.tv_sec*1000000+tv.tv_usec+timeout_ms*1000;
-        mln_fheap_inline_insert(ev->ev_fd_timeout_heap, fn, mln_event_fd_timeout_cmp);
+        mln_pheap_inline_insert(ev->ev_fd_timeout_heap, fn, mln_event_fd_timeout_cmp);
     }
     return 0;
 }
@@ -654,8 +643,8 @@ mln_event_fd_clr_set(mln_event_t *event, int fd)
     }
     ed = (mln_event_desc_t *)mln_rbtree_node_data_get(rn);
     if (ed->data.fd.timeout_node != NULL) {
-        mln_fheap_inline_delete(event->ev_fd_timeout_heap, ed->data.fd.timeout_node, mln_event_fd_timeout_copy, mln_event_fd_timeout_cmp);
-        mln_fheap_inline_node_free(event->ev_fd_timeout_heap, ed->data.fd.timeout_node, NULL);
+        mln_pheap_inline_delete(event->ev_fd_timeout_heap, ed->data.fd.timeout_node, mln_event_fd_timeout_cmp);
+        mln_pheap_inline_node_free(event->ev_fd_timeout_heap, ed->data.fd.timeout_node, NULL);
         ed->data.fd.timeout_node = NULL;
         ed->data.fd.end_us = 0;
     }
@@ -1177,8 +1166,8 @@ lp:
                                ed);
         ef = &(ed->data.fd);
         if (ef->timeout_node != NULL) {
-            mln_fheap_inline_delete(event->ev_fd_timeout_heap, ef->timeout_node, mln_event_fd_timeout_copy, mln_event_fd_timeout_cmp);
-            mln_fheap_inline_node_free(event->ev_fd_timeout_heap, ef->timeout_node, NULL);
+            mln_pheap_inline_delete(event->ev_fd_timeout_heap, ef->timeout_node, mln_event_fd_timeout_cmp);
+            mln_pheap_inline_node_free(event->ev_fd_timeout_heap, ef->timeout_node, NULL);
             ef->timeout_node = NULL;
             ef->end_us = 0;
         }
@@ -1242,7 +1231,7 @@ static inline void mln_event_fd_timeout_process(mln_event_t *event)
     gettimeofday(&tv, NULL);
     now = tv.tv_sec * 1000000 + tv.tv_usec;
     mln_event_desc_t *ed;
-    mln_fheap_node_t *fn;
+    mln_pheap_node_t *fn;
     mln_event_fd_t *ef;
     ev_fd_handler h;
     void *data;
@@ -1252,12 +1241,12 @@ lp:
     if (pthread_mutex_trylock(&event->fd_lock))
         return;
 
-    fn = mln_fheap_minimum(event->ev_fd_timeout_heap);
+    fn = mln_pheap_minimum(event->ev_fd_timeout_heap);
     if (fn == NULL) {
         pthread_mutex_unlock(&event->fd_lock);
         return;
     }
-    ed = (mln_event_desc_t *)mln_fheap_node_key(fn);
+    ed = (mln_event_desc_t *)mln_pheap_node_key(fn);
     ef = &(ed->data.fd);
     if (ef->in_active) {
         ev_fd_active_chain_del(&(event->ev_fd_active_head), \
@@ -1270,8 +1259,8 @@ lp:
         return;
     }
     ef->in_process = 1;
-    mln_fheap_inline_delete(event->ev_fd_timeout_heap, fn, mln_event_fd_timeout_copy, mln_event_fd_timeout_cmp);
-    mln_fheap_inline_node_free(event->ev_fd_timeout_heap, fn, NULL);
+    mln_pheap_inline_delete(event->ev_fd_timeout_heap, fn, mln_event_fd_timeout_cmp);
+    mln_pheap_inline_node_free(event->ev_fd_timeout_heap, fn, NULL);
     ed->data.fd.timeout_node = NULL;
 
     if (ed->data.fd.timeout_handler != NULL) {
@@ -1305,7 +1294,7 @@ mln_event_rbtree_fd_cmp(const void *k1, const void *k2)
 }
 
 /*
- * fheap functions
+ * pheap functions
  */
 static inline int
 mln_event_fd_timeout_cmp(const void *k1, const void *k2)
@@ -1316,16 +1305,8 @@ mln_event_fd_timeout_cmp(const void *k1, const void *k2)
     return 1;
 }
 
-static inline void
-mln_event_fd_timeout_copy(void *k1, void *k2)
-{
-    mln_event_desc_t *ed1 = (mln_event_desc_t *)k1;
-    mln_event_desc_t *ed2 = (mln_event_desc_t *)k2;
-    ed1->data.fd.end_us = ed2->data.fd.end_us;
-}
-
 static inline int
-mln_event_fheap_timer_cmp(const void *k1, const void *k2)
+mln_event_pheap_timer_cmp(const void *k1, const void *k2)
 {
     mln_event_desc_t *ed1 = (mln_event_desc_t *)k1;
     mln_event_desc_t *ed2 = (mln_event_desc_t *)k2;
@@ -1333,14 +1314,6 @@ mln_event_fheap_timer_cmp(const void *k1, const void *k2)
     return 1;
 }
 
-static inline void
-mln_event_fheap_timer_copy(void *k1, void *k2)
-{
-    mln_event_desc_t *ed1 = (mln_event_desc_t *)k1;
-    mln_event_desc_t *ed2 = (mln_event_desc_t *)k2;
-    ed1->data.tm.end_tm = ed2->data.tm.end_tm;
-}
-
 /*
  * chains
  */
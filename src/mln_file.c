@@ -15,12 +15,13 @@
 MLN_CHAIN_FUNC_DECLARE(reg_file, \
                        mln_file_t, \
                        static inline void,);
-static int mln_file_set_cmp(const void *data1, const void *data2);
+static inline int mln_file_set_cmp(const mln_file_t *f1, const mln_file_t *f2);
 static void mln_file_free(void *pfile);
+MLN_RBTREE_LINK_DECLARE(mln_file_tree, mln_file_t, static inline)
+MLN_RBTREE_LINK_DEFINE(mln_file_tree, mln_file_t, static inline, link, mln_file_set_cmp)
 
 mln_fileset_t *mln_fileset_init(mln_size_t max_file)
 {
-    struct mln_rbtree_attr attr;
     mln_fileset_t *fs;
 
     fs = (mln_fileset_t *)malloc(sizeof(mln_fileset_t));
@@ -34,27 +35,15 @@ mln_fileset_t *mln_fileset_init(mln_size_t max_file)
         return NULL;
     }
 
-    attr.pool = NULL;
-    attr.pool_alloc = NULL;
-    attr.pool_free = NULL;
-    attr.cmp = mln_file_set_cmp;
-    attr.data_free = mln_file_free;
-    if ((fs->reg_file_tree = mln_rbtree_new(&attr)) == NULL) {
-        mln_alloc_destroy(fs->pool);
-        free(fs);
-        return NULL;
-    }
-
+    mln_rbtree_head_init(&(fs->reg_file_tree));
     fs->reg_free_head = fs->reg_free_tail = NULL;
     fs->max_file = max_file;
 
     return fs;
 }
 
-static int mln_file_set_cmp(const void *data1, const void *data2)
+static inline int mln_file_set_cmp(const mln_file_t *f1, const mln_file_t *f2)
 {
-    mln_file_t *f1 = (mln_file_t *)data1;
-    mln_file_t *f2 = (mln_file_t *)data2;
     return mln_string_strcmp(f1->file_path, f2->file_path);
 }
 
@@ -62,8 +51,11 @@ void mln_fileset_destroy(mln_fileset_t *fs)
 {
     if (fs == NULL) return;
 
-    if (fs->reg_file_tree != NULL)
-        mln_rbtree_free(fs->reg_file_tree);
+    mln_file_t *f;
+    while ((f = mln_file_tree_min(&(fs->reg_file_tree))) != NULL) {
+        mln_file_tree_delete(&(fs->reg_file_tree), f);
+        mln_file_free(f);
+    }
     if (fs->pool != NULL)
         mln_alloc_destroy(fs->pool);
     free(fs);
@@ -72,14 +64,12 @@ void mln_fileset_destroy(mln_fileset_t *fs)
 
 mln_file_t *mln_file_open(mln_fileset_t *fs, const char *filepath)
 {
-    mln_rbtree_node_t *rn;
     mln_file_t *f, tmpf;
     mln_string_t path;
 
     mln_string_set(&path, filepath);
     tmpf.file_path = &path;
-    rn = mln_rbtree_search(fs->reg_file_tree, &tmpf);
-    if (mln_rbtree_null(rn, fs->reg_file_tree)) {
+    if ((f = mln_file_tree_search(&(fs->reg_file_tree), &tmpf)) == NULL) {
         struct stat st;
 
         if ((f = (mln_file_t *)mln_alloc_m(fs->pool, sizeof(mln_file_t))) == NULL) {
@@ -108,16 +98,7 @@ mln_file_t *mln_file_open(mln_fileset_t *fs, const char *filepath)
         f->refer_cnt = 0;
         reg_file_chain_add(&(fs->reg_free_head), &(fs->reg_free_tail), f);
         f->fset = fs;
-        if ((rn = mln_rbtree_node_new(fs->reg_file_tree, f)) == NULL) {
-            close(f->fd);
-            mln_string_free(f->file_path);
-            mln_alloc_free(f);
-            return NULL;
-        }
-        mln_rbtree_insert(fs->reg_file_tree, rn);
-        f->node = rn;
-    } else {
-        f = (mln_file_t *)mln_rbtree_node_data_get(rn);
+        mln_file_tree_insert(&(fs->reg_file_tree), f);
     }
 
     if (f->refer_cnt++ == 0) {
@@ -147,11 +128,11 @@ void mln_file_close(mln_file_t *pfile)
     fs = pfile->fset;
     reg_file_chain_add(&(fs->reg_free_head), &(fs->reg_free_tail), pfile);
 
-    if (mln_rbtree_node_num(fs->reg_file_tree) > fs->max_file) {
+    if (mln_rbtree_head_num(&(fs->reg_file_tree)) > fs->max_file) {
         pfile = fs->reg_free_head;
         reg_file_chain_del(&(fs->reg_free_head), &(fs->reg_free_tail), pfile);
-        mln_rbtree_delete(fs->reg_file_tree, pfile->node);
-        mln_rbtree_node_free(fs->reg_file_tree, pfile->node);
+        mln_file_tree_delete(&(fs->reg_file_tree), pfile);
+        mln_file_free(pfile);
     }
 }
 
@@ -197,7 +178,6 @@ mln_file_t *mln_file_tmp_open(mln_alloc_t *pool)
     f->refer_cnt = 0;
     f->prev = f->next = NULL;
     f->fset = NULL;
-    f->node = NULL;
 lp:
     gettimeofday(&now, NULL);
     suffix = now.tv_sec * 1000000 + now.tv_usec;
@@ -6,8 +6,22 @@
 #include <stdlib.h>
 #include "mln_prime_generator.h"
 #include "mln_hash.h"
+#include "mln_string.h"
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define M_HASH_GROUP            16
+#define M_HASH_CTRL_EMPTY       0x80
+#define M_HASH_CTRL_DELETED     0xfe
+#define M_HASH_SLOT_NONE        (~0ULL)
+#define M_HASH_IS_FULL(c)       (!((c) & 0x80))
+#define M_HASH_MAX_LOAD(cap)    ((cap) - ((cap) >> 3))/*7/8*/
+#define M_HASH_REHASH_EMPTY     16/*empty buckets skipped by one rehash step at most*/
 
 MLN_CHAIN_FUNC_DECLARE(mln_hash_entry_iter, \
                        mln_hash_entry_t, \
@@ -25,9 +39,32 @@ static inline void
 mln_hash_expand(mln_hash_t *h) __NONNULL1(1);
 static inline void
 mln_move_hash_entry(mln_hash_t *h, mln_hash_mgr_t *old_tbl, mln_u32_t old_len) __NONNULL2(1,2);
+static inline void mln_hash_resize(mln_hash_t *h) __NONNULL1(1);
+static inline void mln_hash_rehash_step(mln_hash_t *h) __NONNULL1(1);
+static inline mln_hash_mgr_t *mln_hash_bucket(mln_hash_t *h, void *key) __NONNULL2(1,2);
+static void mln_hash_tbl_free(mln_hash_t *h, mln_hash_mgr_t *tbl, mln_u64_t len, mln_hash_flag_t flg) __NONNULL1(1);
+static int mln_hash_oa_init(mln_hash_t *h, struct mln_hash_attr *attr) __NONNULL2(1,2);
+static void mln_hash_oa_destroy(mln_hash_t *h, mln_hash_flag_t flg) __NONNULL1(1);
+static int mln_hash_oa_resize(mln_hash_t *h, mln_u64_t cap) __NONNULL1(1);
+static inline mln_u64_t mln_hash_oa_code(mln_hash_t *h, void *key) __NONNULL2(1,2);
+static inline mln_u64_t mln_hash_oa_find(mln_hash_t *h, void *key, mln_u64_t code, mln_u64_t after) __NONNULL2(1,2);
+static inline int mln_hash_oa_add(mln_hash_t *h, void *key, void *val, mln_u64_t code) __NONNULL1(1);
+static inline void mln_hash_oa_erase(mln_hash_t *h, mln_u64_t i, mln_hash_flag_t flg) __NONNULL1(1);
+static inline void mln_hash_kv_free(mln_hash_t *h, void *key, void *val, mln_hash_flag_t flg) __NONNULL1(1);
+static void *mln_hash_oa_search_iterator(mln_hash_t *h, void *key, int **ctx) __NONNULL3(1,2,3);
+static int mln_hash_oa_update(mln_hash_t *h, void **k, void **v) __NONNULL3(1,2,3);
+static void mln_hash_oa_remove(mln_hash_t *h, void *key, mln_hash_flag_t flg) __NONNULL2(1,2);
+static int mln_hash_oa_iterate(mln_hash_t *h, hash_iterate_handler handler, void *udata) __NONNULL1(1);
 
 int mln_hash_init(mln_hash_t *h, struct mln_hash_attr *attr)
 {
+    return mln_hash_init_mode(h, attr, 0);
+}
+
+int mln_hash_init_mode(mln_hash_t *h, struct mln_hash_attr *attr, mln_u32_t mode)
+{
+    if (mode & M_HASH_OPEN_ADDRESSING) return mln_hash_oa_init(h, attr);
+
     h->pool = attr->pool;
     h->pool_alloc = attr->pool_alloc;
     h->pool_free = attr->pool_free;
@@ -48,6 +85,11 @@ int mln_hash_init(mln_hash_t *h, struct mln_hash_attr *attr)
     h->threshold = attr->calc_prime? mln_prime_generate(h->len << 1): h->len << 1;
     h->expandable = attr->expandable;
     h->calc_prime = attr->calc_prime;
+    h->open_addressing = 0;
+    h->incremental = (mode & M_HASH_INCREMENTAL)? 1: 0;
+    h->iterating = h->iter_removed = 0;
+    h->old_tbl = NULL;
+    h->old_len = h->rehash_pos = 0;
     if (h->len == 0 || \
         h->hash == NULL || \
         h->cmp == NULL)
@@ -65,6 +107,12 @@ int mln_hash_init(mln_hash_t *h, struct mln_hash_attr *attr)
 
 mln_hash_t *
 mln_hash_new(struct mln_hash_attr *attr)
+{
+    return mln_hash_new_mode(attr, 0);
+}
+
+mln_hash_t *
+mln_hash_new_mode(struct mln_hash_attr *attr, mln_u32_t mode)
 {
     mln_hash_t *h;
     if (attr->pool != NULL) {
@@ -74,6 +122,15 @@ mln_hash_new(struct mln_hash_attr *attr)
     }
     if (h == NULL) return NULL;
 
+    if (mode & M_HASH_OPEN_ADDRESSING) {
+        if (mln_hash_oa_init(h, attr) < 0) {
+            if (attr->pool != NULL) attr->pool_free(h);
+            else free(h);
+            return NULL;
+        }
+        return h;
+    }
+
     h->pool = attr->pool;
     h->pool_alloc = attr->pool_alloc;
     h->pool_free = attr->pool_free;
@@ -97,6 +154,11 @@ mln_hash_new(struct mln_hash_attr *attr)
     h->threshold = attr->calc_prime? mln_prime_generate(h->len << 1): h->len << 1;
     h->expandable = attr->expandable;
     h->calc_prime = attr->calc_prime;
+    h->open_addressing = 0;
+    h->incremental = (mode & M_HASH_INCREMENTAL)? 1: 0;
+    h->iterating = h->iter_removed = 0;
+    h->old_tbl = NULL;
+    h->old_len = h->rehash_pos = 0;
     if (h->len == 0 || \
         h->hash == NULL || \
         h->cmp == NULL)
@@ -117,10 +179,20 @@ mln_hash_new(struct mln_hash_attr *attr)
 void mln_hash_destroy(mln_hash_t *h, mln_hash_flag_t flg)
 {
     if (h == NULL) return;
+    if (h->open_addressing) {
+        mln_hash_oa_destroy(h, flg);
+        return;
+    }
+
+    mln_hash_tbl_free(h, h->tbl, h->len, flg);
+    if (h->old_tbl != NULL) mln_hash_tbl_free(h, h->old_tbl, h->old_len, flg);
+}
 
+static void mln_hash_tbl_free(mln_hash_t *h, mln_hash_mgr_t *tbl, mln_u64_t len, mln_hash_flag_t flg)
+{
     mln_hash_entry_t *he, *fr;
-    mln_hash_mgr_t *mgr, *mgr_end = h->tbl + h->len;
-    for (mgr = h->tbl; mgr < mgr_end; ++mgr) {
+    mln_hash_mgr_t *mgr, *mgr_end = tbl + len;
+    for (mgr = tbl; mgr < mgr_end; ++mgr) {
         he = mgr->head;
         while (he != NULL) {
             fr = he;
@@ -128,26 +200,22 @@ void mln_hash_destroy(mln_hash_t *h, mln_hash_flag_t flg)
             mln_hash_entry_free(h, fr, flg);
         }
     }
-    if (h->pool != NULL) h->pool_free(h->tbl);
-    else free(h->tbl);
+    if (h->pool != NULL) h->pool_free(tbl);
+    else free(tbl);
 }
 
 void mln_hash_free(mln_hash_t *h, mln_hash_flag_t flg)
 {
     if (h == NULL) return;
-
-    mln_hash_entry_t *he, *fr;
-    mln_hash_mgr_t *mgr, *mgr_end = h->tbl + h->len;
-    for (mgr = h->tbl; mgr < mgr_end; ++mgr) {
-        he = mgr->head;
-        while (he != NULL) {
-            fr = he;
-            he = he->next;
-            mln_hash_entry_free(h, fr, flg);
-        }
+    if (h->open_addressing) {
+        mln_hash_oa_destroy(h, flg);
+        if (h->pool != NULL) h->pool_free(h);
+        else free(h);
+        return;
     }
-    if (h->pool != NULL) h->pool_free(h->tbl);
-    else free(h->tbl);
+
+    mln_hash_tbl_free(h, h->tbl, h->len, flg);
+    if (h->old_tbl != NULL) mln_hash_tbl_free(h, h->old_tbl, h->old_len, flg);
     if (h->pool != NULL) h->pool_free(h);
     else free(h);
 }
@@ -156,8 +224,10 @@ int mln_hash_update(mln_hash_t *h, void *key, void *val)
 {
     void **k = (void **)key;
     void **v = (void **)val;
-    mln_u32_t index = h->hash(h, *k);
-    mln_hash_mgr_t *mgr = &(h->tbl[index]);
+    if (h->open_addressing) return mln_hash_oa_update(h, k, v);
+    if (h->old_tbl != NULL) mln_hash_rehash_step(h);
+
+    mln_hash_mgr_t *mgr = mln_hash_bucket(h, *k);
     mln_hash_entry_t *he;
     for (he = mgr->head; he != NULL; he = he->next) {
         if (h->cmp(h, *k, he->key)) break;
@@ -174,11 +244,9 @@ int mln_hash_update(mln_hash_t *h, void *key, void *val)
         return 0;
     }
 
-    if (h->expandable && h->nr_nodes > h->threshold) {
-        mln_hash_expand(h);
-    }
-    if (h->expandable && h->nr_nodes <= (h->threshold >> 3)) {
-        mln_hash_reduce(h);
+    if (h->expandable && h->old_tbl == NULL) {
+        mln_hash_resize(h);
+        mgr = mln_hash_bucket(h, *k);
     }
     he = mln_hash_entry_new(h, mgr, *k, *v);
     if (he == NULL) return -1;
@@ -191,14 +259,11 @@ int mln_hash_update(mln_hash_t *h, void *key, void *val)
 
 int mln_hash_insert(mln_hash_t *h, void *key, void *val)
 {
-    if (h->expandable && h->nr_nodes > h->threshold) {
-        mln_hash_expand(h);
-    }
-    if (h->expandable && h->nr_nodes <= (h->threshold >> 3)) {
-        mln_hash_reduce(h);
-    }
-    mln_u32_t index = h->hash(h, key);
-    mln_hash_mgr_t *mgr = &(h->tbl[index]);
+    if (h->open_addressing) return mln_hash_oa_add(h, key, val, mln_hash_oa_code(h, key));
+
+    if (h->old_tbl != NULL) mln_hash_rehash_step(h);
+    else if (h->expandable) mln_hash_resize(h);
+    mln_hash_mgr_t *mgr = mln_hash_bucket(h, key);
     mln_hash_entry_t *he = mln_hash_entry_new(h, mgr, key, val);
     if (he == NULL) return -1;
     mln_hash_entry_chain_add(&(mgr->head), &(mgr->tail), he);
@@ -225,6 +290,12 @@ static inline void mln_hash_reduce(mln_hash_t *h)
         return;
     }
     h->threshold = h->calc_prime? mln_prime_generate(h->threshold >> 1): h->threshold >> 1;
+    if (h->incremental) {
+        h->old_tbl = old_tbl;
+        h->old_len = len;
+        h->rehash_pos = 0;
+        return;
+    }
     mln_move_hash_entry(h, old_tbl, len);
     if (h->pool != NULL) h->pool_free(old_tbl);
     else free(old_tbl);
@@ -248,6 +319,12 @@ static inline void mln_hash_expand(mln_hash_t *h)
     }
     h->threshold = h->calc_prime? mln_prime_generate(h->threshold << 1): \
                                   ((h->threshold << 1) - 1);
+    if (h->incremental) {
+        h->old_tbl = old_tbl;
+        h->old_len = len;
+        h->rehash_pos = 0;
+        return;
+    }
     mln_move_hash_entry(h, old_tbl, len);
     if (h->pool != NULL) h->pool_free(old_tbl);
     else free(old_tbl);
@@ -266,15 +343,80 @@ mln_move_hash_entry(mln_hash_t *h, mln_hash_mgr_t *old_tbl, mln_u32_t old_len)
             mln_hash_entry_chain_del(&(old_tbl->head), &(old_tbl->tail), he);
             index = h->hash(h, he->key);
             new_mgr = &(h->tbl[index]);
+            he->mgr = new_mgr;
             mln_hash_entry_chain_add(&(new_mgr->head), &(new_mgr->tail), he);
         }
     }
 }
 
+static inline void mln_hash_resize(mln_hash_t *h)
+{
+    if (h->nr_nodes > h->threshold) {
+        mln_hash_expand(h);
+    } else if (h->nr_nodes <= (h->threshold >> 3)) {
+        mln_hash_reduce(h);
+    }
+}
+
+/*
+ * incremental resizing
+ *
+ * In incremental mode, expanding or reducing only allocates the new bucket
+ * array. The entries are then moved one old bucket at a time, by each insert,
+ * update, remove, search, key test and value change, so that no single call
+ * has to rehash the whole table. Until an old bucket is moved, its keys are
+ * still looked up and inserted there, which keeps duplicate keys together and
+ * in order.
+ */
+static inline void mln_hash_rehash_step(mln_hash_t *h)
+{
+    mln_hash_mgr_t *mgr;
+    int empty = M_HASH_REHASH_EMPTY;
+
+    while (h->rehash_pos < h->old_len) {
+        mgr = &(h->old_tbl[(h->rehash_pos)++]);
+        if (mgr->head != NULL) {
+            mln_move_hash_entry(h, mgr, 1);
+            break;
+        }
+        if (--empty <= 0) break;
+    }
+    if (h->rehash_pos >= h->old_len) {
+        if (h->pool != NULL) h->pool_free(h->old_tbl);
+        else free(h->old_tbl);
+        h->old_tbl = NULL;
+        h->old_len = h->rehash_pos = 0;
+    }
+}
+
+/*
+ * The hash handler computes the index from h->len, so len is switched to the
+ * old length to locate a key among the buckets not moved yet.
+ */
+static inline mln_hash_mgr_t *mln_hash_bucket(mln_hash_t *h, void *key)
+{
+    if (h->old_tbl != NULL) {
+        mln_u64_t len = h->len, index;
+        h->len = h->old_len;
+        index = h->hash(h, key);
+        h->len = len;
+        if (index >= h->rehash_pos) return &(h->old_tbl[index]);
+    }
+    return &(h->tbl[h->hash(h, key)]);
+}
+
 void *mln_hash_change_value(mln_hash_t *h, void *key, void *new_value)
 {
-    mln_u32_t index = h->hash(h, key);
-    mln_hash_mgr_t *mgr = &(h->tbl[index]);
+    if (h->open_addressing) {
+        mln_u64_t i = mln_hash_oa_find(h, key, mln_hash_oa_code(h, key), M_HASH_SLOT_NONE);
+        if (i == M_HASH_SLOT_NONE) return NULL;
+        void *retval = h->slots[i].val;
+        h->slots[i].val = new_value;
+        return retval;
+    }
+    if (h->old_tbl != NULL) mln_hash_rehash_step(h);
+
+    mln_hash_mgr_t *mgr = mln_hash_bucket(h, key);
     mln_hash_entry_t *he;
     for (he = mgr->head; he != NULL; he = he->next) {
         if (h->cmp(h, key, he->key)) break;
@@ -287,8 +429,14 @@ void *mln_hash_change_value(mln_hash_t *h, void *key, void *new_value)
 
 void *mln_hash_search(mln_hash_t *h, void *key)
 {
-    mln_u32_t index = h->hash(h, key);
-    mln_hash_mgr_t *mgr = &(h->tbl[index]);
+    if (h->open_addressing) {
+        mln_u64_t i = mln_hash_oa_find(h, key, mln_hash_oa_code(h, key), M_HASH_SLOT_NONE);
+        if (i == M_HASH_SLOT_NONE || (h->iter_removed && i == h->iter_slot)) return NULL;
+        return h->slots[i].val;
+    }
+    if (h->old_tbl != NULL) mln_hash_rehash_step(h);
+
+    mln_hash_mgr_t *mgr = mln_hash_bucket(h, key);
     mln_hash_entry_t *he;
     for (he = mgr->head; he != NULL; he = he->next) {
         if (h->cmp(h, key, he->key)) break;
@@ -299,33 +447,33 @@ void *mln_hash_search(mln_hash_t *h, void *key)
 
 void *mln_hash_search_iterator(mln_hash_t *h, void *key, int **ctx)
 {
-    if (*ctx != NULL) {
-        mln_hash_entry_t *he = *((mln_hash_entry_t **)ctx);
-        for (; he != NULL; he = he->next) {
-            if (h->cmp(h, key, he->key)) break;
-        }
-        if (he == NULL || he->removed) {
-            *ctx = NULL;
-            return NULL;
-        }
-        *ctx = (int *)(he->next);
-        return he->val;
-    }
-    mln_u32_t index = h->hash(h, key);
-    mln_hash_mgr_t *mgr = &(h->tbl[index]);
+    if (h->open_addressing) return mln_hash_oa_search_iterator(h, key, ctx);
+
+    /*ctx holds the entry found last time*/
     mln_hash_entry_t *he;
-    for (he = mgr->head; he != NULL; he = he->next) {
+    if (*ctx != NULL) he = (*((mln_hash_entry_t **)ctx))->next;
+    else he = mln_hash_bucket(h, key)->head;
+
+    for (; he != NULL; he = he->next) {
         if (h->cmp(h, key, he->key)) break;
     }
-    if (he == NULL || he->removed) return NULL;
-    *ctx = (int *)(he->next);
+    if (he == NULL || he->removed) {
+        *ctx = NULL;
+        return NULL;
+    }
+    *ctx = (int *)he;
     return he->val;
 }
 
 void mln_hash_remove(mln_hash_t *h, void *key, mln_hash_flag_t flg)
 {
-    mln_u32_t index = h->hash(h, key);
-    mln_hash_mgr_t *mgr = &(h->tbl[index]);
+    if (h->open_addressing) {
+        mln_hash_oa_remove(h, key, flg);
+        return;
+    }
+    if (h->old_tbl != NULL) mln_hash_rehash_step(h);
+
+    mln_hash_mgr_t *mgr = mln_hash_bucket(h, key);
     mln_hash_entry_t *he;
 
     for (he = mgr->head; he != NULL; he = he->next) {
@@ -369,57 +517,71 @@ static inline void
 mln_hash_entry_free(mln_hash_t *h, mln_hash_entry_t *he, mln_hash_flag_t flg)
 {
     if (he == NULL) return;
+    mln_hash_kv_free(h, he->key, he->val, flg);
+    if (h->pool != NULL) h->pool_free(he);
+    else free(he);
+}
+
+static inline void mln_hash_kv_free(mln_hash_t *h, void *key, void *val, mln_hash_flag_t flg)
+{
     switch (flg) {
         case M_HASH_F_VAL:
             if (h->free_val != NULL)
-                h->free_val(he->val);
+                h->free_val(val);
             break;
         case M_HASH_F_KEY:
             if (h->free_key != NULL)
-                h->free_key(he->key);
+                h->free_key(key);
             break;
         case M_HASH_F_KV:
             if (h->free_val != NULL)
-                h->free_val(he->val);
+                h->free_val(val);
             if (h->free_key != NULL)
-                h->free_key(he->key);
+                h->free_key(key);
             break;
         default: break;
     }
-    if (h->pool != NULL) h->pool_free(he);
-    else free(he);
 }
 
 int mln_hash_iterate(mln_hash_t *h, hash_iterate_handler handler, void *udata)
 {
+    if (h->open_addressing) return mln_hash_oa_iterate(h, handler, udata);
+
     mln_hash_entry_t *he = h->iter_head, *cur;
+    int rc = 0;
 
     while (he != NULL) {
         h->iter = cur = he;
-        he = he->iter_next;
 
-        if (cur->removed) continue;
-
-        if (handler != NULL && handler(h, cur->key, cur->val, udata) < 0) {
-            h->iter = NULL;
-            return -1;
-        }
+        /*
+         * The handler may remove any entry, so the next one is taken after it
+         * returns. The current one is only marked and removed here.
+         */
+        if (!cur->removed && handler != NULL && handler(h, cur->key, cur->val, udata) < 0)
+            rc = -1;
 
+        he = cur->iter_next;
         if (cur->removed) {
             mln_hash_entry_chain_del(&(cur->mgr->head), &(cur->mgr->tail), cur);
             mln_hash_entry_iter_chain_del(&(h->iter_head), &(h->iter_tail), cur);
             --(h->nr_nodes);
             mln_hash_entry_free(h, cur, cur->remove_flag);
         }
+        if (rc < 0) break;
     }
     h->iter = NULL;
-    return 0;
+    return rc;
 }
 
 int mln_hash_key_exist(mln_hash_t *h, void *key)
 {
-    mln_u32_t index = h->hash(h, key);
-    mln_hash_mgr_t *mgr = &(h->tbl[index]);
+    if (h->open_addressing) {
+        mln_u64_t i = mln_hash_oa_find(h, key, mln_hash_oa_code(h, key), M_HASH_SLOT_NONE);
+        return i != M_HASH_SLOT_NONE && !(h->iter_removed && i == h->iter_slot);
+    }
+    if (h->old_tbl != NULL) mln_hash_rehash_step(h);
+
+    mln_hash_mgr_t *mgr = mln_hash_bucket(h, key);
     mln_hash_entry_t *he;
     for (he = mgr->head; he != NULL; he = he->next) {
         if (!he->removed && h->cmp(h, key, he->key)) return 1;
@@ -429,6 +591,19 @@ int mln_hash_key_exist(mln_hash_t *h, void *key)
 
 void mln_hash_reset(mln_hash_t *h, mln_hash_flag_t flg)
 {
+    if (h->open_addressing) {
+        mln_u64_t i;
+        for (i = 0; i < h->len; ++i) {
+            if (M_HASH_IS_FULL(h->ctrl[i]))
+                mln_hash_kv_free(h, h->slots[i].key, h->slots[i].val, flg);
+        }
+        memset(h->ctrl, M_HASH_CTRL_EMPTY, h->len + M_HASH_GROUP - 1);
+        h->nr_nodes = 0;
+        h->growth_left = M_HASH_MAX_LOAD(h->len);
+        h->iter_removed = 0;
+        return;
+    }
+
     mln_hash_mgr_t *mgr, *end;
     mgr = h->tbl;
     end = h->tbl + h->len;
@@ -439,9 +614,583 @@ void mln_hash_reset(mln_hash_t *h, mln_hash_flag_t flg)
             mln_hash_entry_free(h, he, flg);
         }
     }
+    if (h->old_tbl != NULL) {
+        mln_hash_tbl_free(h, h->old_tbl, h->old_len, flg);
+        h->old_tbl = NULL;
+        h->old_len = h->rehash_pos = 0;
+    }
+
+    h->nr_nodes = 0;
+    h->iter = h->iter_head = h->iter_tail = NULL;
+}
+
+/*
+ * open addressing
+ *
+ * A SwissTable-like layout: keys and values are stored inline in a power of 2
+ * array of slots, and a separate array of control bytes is probed a group of
+ * 16 slots at a time. A full slot's control byte keeps 7 bits of its hash, so
+ * most mismatching slots are skipped without calling cmp. The first group of
+ * control bytes is copied after the last one, so a group can be loaded at any
+ * slot without wrapping around.
+ */
+#if defined(__SSE2__)
+static inline mln_u32_t mln_hash_group_match(mln_u8ptr_t ctrl, mln_u8_t c)
+{
+    __m128i g = _mm_loadu_si128((const __m128i *)ctrl);
+    return (mln_u32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char)c)));
+}
+
+static inline mln_u32_t mln_hash_group_empty(mln_u8ptr_t ctrl)
+{
+    return mln_hash_group_match(ctrl, M_HASH_CTRL_EMPTY);
+}
+
+static inline mln_u32_t mln_hash_group_free(mln_u8ptr_t ctrl)
+{
+    /*empty (-128) and deleted (-2) are the only control bytes less than -1*/
+    __m128i g = _mm_loadu_si128((const __m128i *)ctrl);
+    return (mln_u32_t)_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), g));
+}
+#else
+#define M_HASH_LSB 0x0101010101010101ULL
+#define M_HASH_MSB 0x8080808080808080ULL
+
+static inline mln_u64_t mln_hash_group_word(mln_u8ptr_t ctrl)
+{
+    mln_u64_t w;
+    memcpy(&w, ctrl, sizeof(w));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    w = __builtin_bswap64(w);
+#endif
+    return w;
+}
+
+/*
+ * Gather the top bit of each byte into the low 8 bits, byte i to bit i.
+ */
+static inline mln_u32_t mln_hash_group_bits(mln_u64_t m)
+{
+    return (mln_u32_t)(((m >> 7) * 0x0102040810204080ULL) >> 56);
+}
+
+static inline mln_u32_t mln_hash_group_match(mln_u8ptr_t ctrl, mln_u8_t c)
+{
+    /*may report a byte next to a matched one, cmp filters it out*/
+    mln_u64_t lo = mln_hash_group_word(ctrl) ^ (M_HASH_LSB * c);
+    mln_u64_t hi = mln_hash_group_word(ctrl + 8) ^ (M_HASH_LSB * c);
+    return mln_hash_group_bits((lo - M_HASH_LSB) & ~lo & M_HASH_MSB) | \
+           (mln_hash_group_bits((hi - M_HASH_LSB) & ~hi & M_HASH_MSB) << 8);
+}
+
+static inline mln_u32_t mln_hash_group_empty(mln_u8ptr_t ctrl)
+{
+    /*empty is the only control byte with bit 7 set and bit 1 clear*/
+    mln_u64_t lo = mln_hash_group_word(ctrl), hi = mln_hash_group_word(ctrl + 8);
+    return mln_hash_group_bits(lo & ~(lo << 6) & M_HASH_MSB) | \
+           (mln_hash_group_bits(hi & ~(hi << 6) & M_HASH_MSB) << 8);
+}
+
+static inline mln_u32_t mln_hash_group_free(mln_u8ptr_t ctrl)
+{
+    /*empty and deleted have bit 7 set and bit 0 clear*/
+    mln_u64_t lo = mln_hash_group_word(ctrl), hi = mln_hash_group_word(ctrl + 8);
+    return mln_hash_group_bits(lo & ~(lo << 7) & M_HASH_MSB) | \
+           (mln_hash_group_bits(hi & ~(hi << 7) & M_HASH_MSB) << 8);
+}
+#endif
+
+static inline void mln_hash_ctrl_set(mln_hash_t *h, mln_u64_t i, mln_u8_t c)
+{
+    h->ctrl[i] = c;
+    if (i < M_HASH_GROUP - 1) h->ctrl[h->len + i] = c;
+}
+
+/*
+ * The handler's result is mixed, so it may be a full hash code as well as a
+ * value already reduced by len.
+ */
+static inline mln_u64_t mln_hash_oa_code(mln_hash_t *h, void *key)
+{
+    mln_u64_t v = h->hash(h, key);
+    v ^= v >> 33;
+    v *= 0xff51afd7ed558ccdULL;
+    v ^= v >> 33;
+    v *= 0xc4ceb9fe1a85ec53ULL;
+    v ^= v >> 33;
+    return v;
+}
 
+static int mln_hash_oa_alloc(mln_hash_t *h, mln_u64_t cap)
+{
+    mln_size_t size = cap * sizeof(mln_hash_slot_t) + cap + M_HASH_GROUP - 1;
+    mln_hash_slot_t *slots;
+
+    if (h->pool != NULL) slots = (mln_hash_slot_t *)h->pool_alloc(h->pool, size);
+    else slots = (mln_hash_slot_t *)malloc(size);
+    if (slots == NULL) return -1;
+
+    h->slots = slots;
+    h->ctrl = (mln_u8ptr_t)(slots + cap);
+    h->len = cap;
+    h->growth_left = M_HASH_MAX_LOAD(cap);
+    memset(h->ctrl, M_HASH_CTRL_EMPTY, cap + M_HASH_GROUP - 1);
+    return 0;
+}
+
+static int mln_hash_oa_init(mln_hash_t *h, struct mln_hash_attr *attr)
+{
+    mln_u64_t cap = M_HASH_GROUP;
+
+    if (attr->hash == NULL || attr->cmp == NULL) return -1;
+
+    h->pool = attr->pool;
+    h->pool_alloc = attr->pool_alloc;
+    h->pool_free = attr->pool_free;
+    h->hash = attr->hash;
+    h->cmp = attr->cmp;
+    h->free_key = attr->free_key;
+    h->free_val = attr->free_val;
+    h->tbl = NULL;
     h->nr_nodes = 0;
+    h->expandable = attr->expandable;
+    h->calc_prime = 0;
+    h->open_addressing = 1;
+    h->incremental = 0;
+    h->iterating = h->iter_removed = 0;
+    h->old_tbl = NULL;
+    h->old_len = h->rehash_pos = 0;
     h->iter = h->iter_head = h->iter_tail = NULL;
+    h->iter_slot = 0;
+    h->iter_flag = M_HASH_F_NONE;
+
+    /*len_base is the number of elements expected*/
+    while (M_HASH_MAX_LOAD(cap) < attr->len_base) cap <<= 1;
+    h->threshold = cap;/*the table does not shrink below it*/
+    return mln_hash_oa_alloc(h, cap);
+}
+
+static void mln_hash_oa_destroy(mln_hash_t *h, mln_hash_flag_t flg)
+{
+    mln_u64_t i;
+
+    if (flg != M_HASH_F_NONE) {
+        for (i = 0; i < h->len; ++i) {
+            if (M_HASH_IS_FULL(h->ctrl[i]))
+                mln_hash_kv_free(h, h->slots[i].key, h->slots[i].val, flg);
+        }
+    }
+    if (h->pool != NULL) h->pool_free(h->slots);
+    else free(h->slots);
+}
+
+static inline mln_u64_t mln_hash_oa_free_slot(mln_hash_t *h, mln_u64_t code)
+{
+    mln_u64_t mask = h->len - 1, pos = code & mask, step = 0;
+    mln_u32_t m;
+
+    while (!(m = mln_hash_group_free(h->ctrl + pos))) {
+        step += M_HASH_GROUP;
+        pos = (pos + step) & mask;
+    }
+    return (pos + __builtin_ctz(m)) & mask;
+}
+
+static int mln_hash_oa_resize(mln_hash_t *h, mln_u64_t cap)
+{
+    mln_hash_slot_t *old = h->slots;
+    mln_u8ptr_t old_ctrl = h->ctrl;
+    mln_u64_t i, j, old_len = h->len, left = h->growth_left;
+
+    if (mln_hash_oa_alloc(h, cap) < 0) {
+        h->slots = old;
+        h->ctrl = old_ctrl;
+        h->len = old_len;
+        h->growth_left = left;
+        return -1;
+    }
+    for (i = 0; i < old_len; ++i) {
+        if (!M_HASH_IS_FULL(old_ctrl[i])) continue;
+        mln_u64_t code = mln_hash_oa_code(h, old[i].key);
+        j = mln_hash_oa_free_slot(h, code);
+        mln_hash_ctrl_set(h, j, (mln_u8_t)(code >> 57));
+        h->slots[j] = old[i];
+    }
+    h->growth_left -= h->nr_nodes;
+    if (h->pool != NULL) h->pool_free(old);
+    else free(old);
+    return 0;
+}
+
+/*
+ * Find the first full slot of key along its probe sequence, or the first one
+ * after slot 'after' when continuing a search for duplicate keys.
+ */
+static inline mln_u64_t mln_hash_oa_find(mln_hash_t *h, void *key, mln_u64_t code, mln_u64_t after)
+{
+    mln_u64_t mask = h->len - 1, pos = code & mask, step = 0, i;
+    mln_u8_t tag = (mln_u8_t)(code >> 57);
+    mln_u32_t m;
+
+    while (1) {
+        m = mln_hash_group_match(h->ctrl + pos, tag);
+        while (m) {
+            i = (pos + __builtin_ctz(m)) & mask;
+            m &= m - 1;
+            if (after != M_HASH_SLOT_NONE) {
+                if (i == after) after = M_HASH_SLOT_NONE;
+                continue;
+            }
+            if (h->ctrl[i] == tag && h->cmp(h, key, h->slots[i].key)) return i;
+        }
+        if (mln_hash_group_empty(h->ctrl + pos)) return M_HASH_SLOT_NONE;
+        step += M_HASH_GROUP;
+        if (step > mask) return M_HASH_SLOT_NONE;
+        pos = (pos + step) & mask;
+    }
+}
+
+static inline int mln_hash_oa_add(mln_hash_t *h, void *key, void *val, mln_u64_t code)
+{
+    mln_u64_t i;
+
+    if (!h->growth_left) {
+        /*
+         * Slots must not move under mln_hash_oa_iterate, so the table is filled
+         * beyond its load until the iteration ends, and fails only when full.
+         */
+        if (h->iterating) {
+            if ((mln_u64_t)h->nr_nodes >= h->len) return -1;
+        } else {
+            /*rehash in place if deleted slots take up much of the table*/
+            mln_u64_t cap = (mln_u64_t)h->nr_nodes << 1 > M_HASH_MAX_LOAD(h->len)? h->len << 1: h->len;
+            if (mln_hash_oa_resize(h, cap) < 0) return -1;
+            /*the handler may reduce its result by len, which has just changed*/
+            code = mln_hash_oa_code(h, key);
+        }
+    }
+    i = mln_hash_oa_free_slot(h, code);
+    if (h->ctrl[i] == M_HASH_CTRL_EMPTY && h->growth_left) --(h->growth_left);
+    mln_hash_ctrl_set(h, i, (mln_u8_t)(code >> 57));
+    h->slots[i].key = key;
+    h->slots[i].val = val;
+    ++(h->nr_nodes);
+    return 0;
+}
+
+/*
+ * A slot becomes empty again if no probe can have passed it, i.e. no group of
+ * 16 slots around it has been full all the time; otherwise it is a tombstone.
+ */
+static inline void mln_hash_oa_erase(mln_hash_t *h, mln_u64_t i, mln_hash_flag_t flg)
+{
+    mln_u64_t mask = h->len - 1;
+    mln_u32_t after = mln_hash_group_empty(h->ctrl + i);
+    mln_u32_t before = mln_hash_group_empty(h->ctrl + ((i - M_HASH_GROUP) & mask));
+    void *key = h->slots[i].key, *val = h->slots[i].val;
+
+    if (after && before && \
+        __builtin_ctz(after) + (__builtin_clz(before) - (32 - M_HASH_GROUP)) < M_HASH_GROUP)
+    {
+        mln_hash_ctrl_set(h, i, M_HASH_CTRL_EMPTY);
+        ++(h->growth_left);
+    } else {
+        mln_hash_ctrl_set(h, i, M_HASH_CTRL_DELETED);
+    }
+    --(h->nr_nodes);
+    mln_hash_kv_free(h, key, val, flg);
+}
+
+static void *mln_hash_oa_search_iterator(mln_hash_t *h, void *key, int **ctx)
+{
+    mln_u64_t after = *ctx == NULL? M_HASH_SLOT_NONE: (mln_u64_t)(mln_uauto_t)(*ctx) - 1;
+    mln_u64_t i = mln_hash_oa_find(h, key, mln_hash_oa_code(h, key), after);
+
+    while (i != M_HASH_SLOT_NONE && h->iter_removed && i == h->iter_slot)
+        i = mln_hash_oa_find(h, key, mln_hash_oa_code(h, key), i);
+    if (i == M_HASH_SLOT_NONE) {
+        *ctx = NULL;
+        return NULL;
+    }
+    *ctx = (int *)(mln_uauto_t)(i + 1);
+    return h->slots[i].val;
+}
+
+static int mln_hash_oa_update(mln_hash_t *h, void **k, void **v)
+{
+    mln_u64_t code = mln_hash_oa_code(h, *k);
+    mln_u64_t i = mln_hash_oa_find(h, *k, code, M_HASH_SLOT_NONE);
+
+    if (i != M_HASH_SLOT_NONE) {
+        void *save_key = h->slots[i].key;
+        void *save_val = h->slots[i].val;
+        if (h->iter_removed && i == h->iter_slot) h->iter_removed = 0;
+        h->slots[i].key = *k;
+        h->slots[i].val = *v;
+        *k = save_key;
+        *v = save_val;
+        return 0;
+    }
+    if (mln_hash_oa_add(h, *k, *v, code) < 0) return -1;
+    *k = *v = NULL;
+    return 0;
+}
+
+static void mln_hash_oa_remove(mln_hash_t *h, void *key, mln_hash_flag_t flg)
+{
+    mln_u64_t i = mln_hash_oa_find(h, key, mln_hash_oa_code(h, key), M_HASH_SLOT_NONE);
+
+    if (i == M_HASH_SLOT_NONE) return;
+
+    if (h->iterating) {
+        /*the current element is removed after the handler returns*/
+        if (i == h->iter_slot) {
+            h->iter_removed = 1;
+            h->iter_flag = flg;
+            return;
+        }
+        mln_hash_oa_erase(h, i, flg);
+        return;
+    }
+
+    mln_hash_oa_erase(h, i, flg);
+    if (h->expandable && h->len > h->threshold && (mln_u64_t)h->nr_nodes < (h->len >> 3))
+        mln_hash_oa_resize(h, h->len >> 1);
+}
+
+static int mln_hash_oa_iterate(mln_hash_t *h, hash_iterate_handler handler, void *udata)
+{
+    mln_u64_t i;
+    int rc = 0;
+
+    h->iterating = 1;
+    for (i = 0; i < h->len; ++i) {
+        if (!M_HASH_IS_FULL(h->ctrl[i])) continue;
+
+        h->iter_slot = i;
+        h->iter_removed = 0;
+        if (handler != NULL && handler(h, h->slots[i].key, h->slots[i].val, udata) < 0) rc = -1;
+
+        if (h->iter_removed) {
+            h->iter_removed = 0;
+            mln_hash_oa_erase(h, i, h->iter_flag);
+        }
+        if (rc < 0) break;
+    }
+    h->iterating = 0;
+    return rc;
+}
+
+/*
+ * built-in hash functions
+ *
+ * The byte hash is wyhash: 16 bytes at a time are folded by a 64x64->128 bit
+ * multiplication, which is cheap on 64-bit CPUs and passes SMHasher.
+ * The case-insensitive version folds ASCII letters to lower case 8 bytes at a
+ * time before mixing, so 'Host' and 'host' get the same value.
+ */
+static const mln_u64_t mln_hash_secret[4] = {
+    0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
+};
+static mln_u64_t mln_hash_seed_val = 0;
+
+static inline void mln_hash_mum(mln_u64_t *a, mln_u64_t *b)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = *a;
+    r *= *b;
+    *a = (mln_u64_t)r;
+    *b = (mln_u64_t)(r >> 64);
+#else
+    mln_u64_t ha = *a >> 32, hb = *b >> 32, la = (mln_u32_t)*a, lb = (mln_u32_t)*b;
+    mln_u64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    mln_u64_t t = rl + (rm0 << 32), c = t < rl, lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline mln_u64_t mln_hash_mix(mln_u64_t a, mln_u64_t b)
+{
+    mln_hash_mum(&a, &b);
+    return a ^ b;
+}
+
+/*
+ * Set bit 5 of every byte in 'A'..'Z'.
+ */
+static inline mln_u64_t mln_hash_lower(mln_u64_t v)
+{
+    mln_u64_t h = v & 0x7f7f7f7f7f7f7f7fULL;
+    mln_u64_t ge_a = h + 0x3f3f3f3f3f3f3f3fULL;/*byte >= 'A'*/
+    mln_u64_t gt_z = h + 0x2525252525252525ULL;/*byte > 'Z'*/
+    return v | (((ge_a & ~gt_z & ~v) & 0x8080808080808080ULL) >> 2);
+}
+
+static inline mln_u64_t mln_hash_r8(const mln_u8_t *p, int fold)
+{
+    mln_u64_t v;
+    memcpy(&v, p, sizeof(v));
+    return fold? mln_hash_lower(v): v;
+}
+
+static inline mln_u64_t mln_hash_r4(const mln_u8_t *p, int fold)
+{
+    mln_u32_t v;
+    memcpy(&v, p, sizeof(v));
+    return fold? mln_hash_lower(v): v;
+}
+
+static inline mln_u64_t mln_hash_r3(const mln_u8_t *p, mln_size_t k, int fold)
+{
+    mln_u64_t v = ((mln_u64_t)p[0] << 16) | ((mln_u64_t)p[k >> 1] << 8) | p[k - 1];
+    return fold? mln_hash_lower(v): v;
+}
+
+/*
+ * fold is a constant at each call site, so the branches on it are removed.
+ */
+static inline mln_u64_t mln_hash_wy(const mln_u8_t *p, mln_size_t len, mln_u64_t seed, int fold)
+{
+    const mln_u64_t *s = mln_hash_secret;
+    mln_u64_t a, b, see1, see2;
+    mln_size_t i = len;
+
+    seed ^= mln_hash_mix(seed ^ s[0], s[1]);
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (mln_hash_r4(p, fold) << 32) | mln_hash_r4(p + ((len >> 3) << 2), fold);
+            b = (mln_hash_r4(p + len - 4, fold) << 32) | mln_hash_r4(p + len - 4 - ((len >> 3) << 2), fold);
+        } else if (len > 0) {
+            a = mln_hash_r3(p, len, fold);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        if (i > 48) {
+            see1 = see2 = seed;
+            do {
+                seed = mln_hash_mix(mln_hash_r8(p, fold) ^ s[1], mln_hash_r8(p + 8, fold) ^ seed);
+                see1 = mln_hash_mix(mln_hash_r8(p + 16, fold) ^ s[2], mln_hash_r8(p + 24, fold) ^ see1);
+                see2 = mln_hash_mix(mln_hash_r8(p + 32, fold) ^ s[3], mln_hash_r8(p + 40, fold) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = mln_hash_mix(mln_hash_r8(p, fold) ^ s[1], mln_hash_r8(p + 8, fold) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = mln_hash_r8(p + i - 16, fold);
+        b = mln_hash_r8(p + i - 8, fold);
+    }
+    a ^= s[1];
+    b ^= seed;
+    mln_hash_mum(&a, &b);
+    return mln_hash_mix(a ^ s[0] ^ len, b ^ s[1]);
+}
+
+static inline mln_u64_t mln_hash_index(mln_hash_t *h, mln_u64_t v)
+{
+    if (h->open_addressing) return v;
+    if (!(h->len & (h->len - 1))) return v & (h->len - 1);
+    return v % h->len;
+}
+
+mln_u64_t mln_hash_seed(void)
+{
+    mln_u64_t seed = mln_hash_seed_val;
+    if (seed) return seed;
+
+    FILE *fp;
+    struct timeval tv;
+    if ((fp = fopen("/dev/urandom", "rb")) != NULL) {
+        if (fread(&seed, sizeof(seed), 1, fp) != 1) seed = 0;
+        fclose(fp);
+    }
+    /*no random device, or it failed: use the time and the addresses randomized by ASLR*/
+    gettimeofday(&tv, NULL);
+    seed ^= ((mln_u64_t)tv.tv_sec << 20) ^ (mln_u64_t)tv.tv_usec ^ (mln_u64_t)clock();
+    seed ^= (mln_u64_t)(mln_uauto_t)&tv ^ ((mln_u64_t)(mln_uauto_t)&mln_hash_seed_val << 16);
+    seed = mln_hash_mix(seed ^ mln_hash_secret[2], mln_hash_secret[3]);
+    if (!seed) seed = mln_hash_secret[0];
+
+    /*all threads must use the same seed, the first one set wins*/
+    if (!__sync_bool_compare_and_swap(&mln_hash_seed_val, 0, seed))
+        seed = mln_hash_seed_val;
+    return seed;
+}
+
+void mln_hash_seed_set(mln_u64_t seed)
+{
+    mln_hash_seed_val = seed? seed: mln_hash_secret[0];
+}
+
+mln_u64_t mln_hash_bytes(const void *data, mln_size_t len, mln_u64_t seed)
+{
+    return mln_hash_wy((const mln_u8_t *)data, len, seed, 0);
+}
+
+mln_u64_t mln_hash_bytes_case(const void *data, mln_size_t len, mln_u64_t seed)
+{
+    return mln_hash_wy((const mln_u8_t *)data, len, seed, 1);
+}
+
+mln_u64_t mln_hash_string(mln_hash_t *h, void *key)
+{
+    mln_string_t *s = (mln_string_t *)key;
+    return mln_hash_index(h, mln_hash_wy(s->data, s->len, mln_hash_seed(), 0));
+}
+
+mln_u64_t mln_hash_string_case(mln_hash_t *h, void *key)
+{
+    mln_string_t *s = (mln_string_t *)key;
+    return mln_hash_index(h, mln_hash_wy(s->data, s->len, mln_hash_seed(), 1));
+}
+
+mln_u64_t mln_hash_ptr(mln_hash_t *h, void *key)
+{
+    return mln_hash_index(h, mln_hash_mix((mln_u64_t)(mln_uauto_t)key ^ mln_hash_secret[0], mln_hash_seed() ^ mln_hash_secret[1]));
+}
+
+mln_u64_t mln_hash_u32(mln_hash_t *h, void *key)
+{
+    return mln_hash_index(h, mln_hash_mix(*(mln_u32_t *)key ^ mln_hash_secret[0], mln_hash_seed() ^ mln_hash_secret[1]));
+}
+
+mln_u64_t mln_hash_u64(mln_hash_t *h, void *key)
+{
+    return mln_hash_index(h, mln_hash_mix(*(mln_u64_t *)key ^ mln_hash_secret[0], mln_hash_seed() ^ mln_hash_secret[1]));
+}
+
+int mln_hash_string_cmp(mln_hash_t *h, void *key1, void *key2)
+{
+    mln_string_t *s1 = (mln_string_t *)key1, *s2 = (mln_string_t *)key2;
+    return s1->len == s2->len && !memcmp(s1->data, s2->data, s1->len);
+}
+
+int mln_hash_string_case_cmp(mln_hash_t *h, void *key1, void *key2)
+{
+    return !mln_string_strcasecmp((mln_string_t *)key1, (mln_string_t *)key2);
+}
+
+int mln_hash_ptr_cmp(mln_hash_t *h, void *key1, void *key2)
+{
+    return key1 == key2;
+}
+
+int mln_hash_u32_cmp(mln_hash_t *h, void *key1, void *key2)
+{
+    return *(mln_u32_t *)key1 == *(mln_u32_t *)key2;
+}
+
+int mln_hash_u64_cmp(mln_hash_t *h, void *key1, void *key2)
+{
+    return *(mln_u64_t *)key1 == *(mln_u64_t *)key2;
 }
 
 MLN_CHAIN_FUNC_DEFINE(mln_hash_entry, \
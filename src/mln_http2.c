@@ -0,0 +1,1579 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mln_http2.h"
+
+typedef struct {
+    mln_string_t name;
+    mln_string_t value;
+} mln_http2_static_field_t;
+
+static mln_u8_t mln_http2_preface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+#define M_HTTP2_PREFACE_LEN (sizeof(mln_http2_preface) - 1)
+
+/*
+ * RFC 7541 Appendix A
+ */
+#define M_HTTP2_STATIC_TABLE_LEN 61
+static mln_http2_static_field_t mln_http2_static_table[M_HTTP2_STATIC_TABLE_LEN] = {
+    {mln_string(":authority"), mln_string("")},
+    {mln_string(":method"), mln_string("GET")},
+    {mln_string(":method"), mln_string("POST")},
+    {mln_string(":path"), mln_string("/")},
+    {mln_string(":path"), mln_string("/index.html")},
+    {mln_string(":scheme"), mln_string("http")},
+    {mln_string(":scheme"), mln_string("https")},
+    {mln_string(":status"), mln_string("200")},
+    {mln_string(":status"), mln_string("204")},
+    {mln_string(":status"), mln_string("206")},
+    {mln_string(":status"), mln_string("304")},
+    {mln_string(":status"), mln_string("400")},
+    {mln_string(":status"), mln_string("404")},
+    {mln_string(":status"), mln_string("500")},
+    {mln_string("accept-charset"), mln_string("")},
+    {mln_string("accept-encoding"), mln_string("gzip, deflate")},
+    {mln_string("accept-language"), mln_string("")},
+    {mln_string("accept-ranges"), mln_string("")},
+    {mln_string("accept"), mln_string("")},
+    {mln_string("access-control-allow-origin"), mln_string("")},
+    {mln_string("age"), mln_string("")},
+    {mln_string("allow"), mln_string("")},
+    {mln_string("authorization"), mln_string("")},
+    {mln_string("cache-control"), mln_string("")},
+    {mln_string("content-disposition"), mln_string("")},
+    {mln_string("content-encoding"), mln_string("")},
+    {mln_string("content-language"), mln_string("")},
+    {mln_string("content-length"), mln_string("")},
+    {mln_string("content-location"), mln_string("")},
+    {mln_string("content-range"), mln_string("")},
+    {mln_string("content-type"), mln_string("")},
+    {mln_string("cookie"), mln_string("")},
+    {mln_string("date"), mln_string("")},
+    {mln_string("etag"), mln_string("")},
+    {mln_string("expect"), mln_string("")},
+    {mln_string("expires"), mln_string("")},
+    {mln_string("from"), mln_string("")},
+    {mln_string("host"), mln_string("")},
+    {mln_string("if-match"), mln_string("")},
+    {mln_string("if-modified-since"), mln_string("")},
+    {mln_string("if-none-match"), mln_string("")},
+    {mln_string("if-range"), mln_string("")},
+    {mln_string("if-unmodified-since"), mln_string("")},
+    {mln_string("last-modified"), mln_string("")},
+    {mln_string("link"), mln_string("")},
+    {mln_string("location"), mln_string("")},
+    {mln_string("max-forwards"), mln_string("")},
+    {mln_string("proxy-authenticate"), mln_string("")},
+    {mln_string("proxy-authorization"), mln_string("")},
+    {mln_string("range"), mln_string("")},
+    {mln_string("referer"), mln_string("")},
+    {mln_string("refresh"), mln_string("")},
+    {mln_string("retry-after"), mln_string("")},
+    {mln_string("server"), mln_string("")},
+    {mln_string("set-cookie"), mln_string("")},
+    {mln_string("strict-transport-security"), mln_string("")},
+    {mln_string("transfer-encoding"), mln_string("")},
+    {mln_string("user-agent"), mln_string("")},
+    {mln_string("vary"), mln_string("")},
+    {mln_string("via"), mln_string("")},
+    {mln_string("www-authenticate"), mln_string("")},
+};
+
+/*
+ * RFC 7541 Appendix B
+ */
+static mln_u32_t mln_http2_huffman_codes[257] = {
+    0x1ff8, 0x7fffd8, 0xfffffe2, 0xfffffe3, 0xfffffe4, 0xfffffe5, 0xfffffe6, 0xfffffe7,
+    0xfffffe8, 0xffffea, 0x3ffffffc, 0xfffffe9, 0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec,
+    0xfffffed, 0xfffffee, 0xfffffef, 0xffffff0, 0xffffff1, 0xffffff2, 0x3ffffffe, 0xffffff3,
+    0xffffff4, 0xffffff5, 0xffffff6, 0xffffff7, 0xffffff8, 0xffffff9, 0xffffffa, 0xffffffb,
+    0x14, 0x3f8, 0x3f9, 0xffa, 0x1ff9, 0x15, 0xf8, 0x7fa,
+    0x3fa, 0x3fb, 0xf9, 0x7fb, 0xfa, 0x16, 0x17, 0x18,
+    0x0, 0x1, 0x2, 0x19, 0x1a, 0x1b, 0x1c, 0x1d,
+    0x1e, 0x1f, 0x5c, 0xfb, 0x7ffc, 0x20, 0xffb, 0x3fc,
+    0x1ffa, 0x21, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62,
+    0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a,
+    0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71, 0x72,
+    0xfc, 0x73, 0xfd, 0x1ffb, 0x7fff0, 0x1ffc, 0x3ffc, 0x22,
+    0x7ffd, 0x3, 0x23, 0x4, 0x24, 0x5, 0x25, 0x26,
+    0x27, 0x6, 0x74, 0x75, 0x28, 0x29, 0x2a, 0x7,
+    0x2b, 0x76, 0x2c, 0x8, 0x9, 0x2d, 0x77, 0x78,
+    0x79, 0x7a, 0x7b, 0x7ffe, 0x7fc, 0x3ffd, 0x1ffd, 0xffffffc,
+    0xfffe6, 0x3fffd2, 0xfffe7, 0xfffe8, 0x3fffd3, 0x3fffd4, 0x3fffd5, 0x7fffd9,
+    0x3fffd6, 0x7fffda, 0x7fffdb, 0x7fffdc, 0x7fffdd, 0x7fffde, 0xffffeb, 0x7fffdf,
+    0xffffec, 0xffffed, 0x3fffd7, 0x7fffe0, 0xffffee, 0x7fffe1, 0x7fffe2, 0x7fffe3,
+    0x7fffe4, 0x1fffdc, 0x3fffd8, 0x7fffe5, 0x3fffd9, 0x7fffe6, 0x7fffe7, 0xffffef,
+    0x3fffda, 0x1fffdd, 0xfffe9, 0x3fffdb, 0x3fffdc, 0x7fffe8, 0x7fffe9, 0x1fffde,
+    0x7fffea, 0x3fffdd, 0x3fffde, 0xfffff0, 0x1fffdf, 0x3fffdf, 0x7fffeb, 0x7fffec,
+    0x1fffe0, 0x1fffe1, 0x3fffe0, 0x1fffe2, 0x7fffed, 0x3fffe1, 0x7fffee, 0x7fffef,
+    0xfffea, 0x3fffe2, 0x3fffe3, 0x3fffe4, 0x7ffff0, 0x3fffe5, 0x3fffe6, 0x7ffff1,
+    0x3ffffe0, 0x3ffffe1, 0xfffeb, 0x7fff1, 0x3fffe7, 0x7ffff2, 0x3fffe8, 0x1ffffec,
+    0x3ffffe2, 0x3ffffe3, 0x3ffffe4, 0x7ffffde, 0x7ffffdf, 0x3ffffe5, 0xfffff1, 0x1ffffed,
+    0x7fff2, 0x1fffe3, 0x3ffffe6, 0x7ffffe0, 0x7ffffe1, 0x3ffffe7, 0x7ffffe2, 0xfffff2,
+    0x1fffe4, 0x1fffe5, 0x3ffffe8, 0x3ffffe9, 0xffffffd, 0x7ffffe3, 0x7ffffe4, 0x7ffffe5,
+    0xfffec, 0xfffff3, 0xfffed, 0x1fffe6, 0x3fffe9, 0x1fffe7, 0x1fffe8, 0x7ffff3,
+    0x3fffea, 0x3fffeb, 0x1ffffee, 0x1ffffef, 0xfffff4, 0xfffff5, 0x3ffffea, 0x7ffff4,
+    0x3ffffeb, 0x7ffffe6, 0x3ffffec, 0x3ffffed, 0x7ffffe7, 0x7ffffe8, 0x7ffffe9, 0x7ffffea,
+    0x7ffffeb, 0xffffffe, 0x7ffffec, 0x7ffffed, 0x7ffffee, 0x7ffffef, 0x7fffff0, 0x3ffffee,
+    0x3fffffff
+};
+
+static mln_u8_t mln_http2_huffman_lens[257] = {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+    6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+    5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+    13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+    15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+    6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+    30
+};
+
+/*
+ * The HPACK code is canonical, so decoding only needs the symbols sorted by
+ * (length, symbol) plus the first code and symbol offset of every length.
+ */
+static mln_u16_t mln_http2_huffman_syms[257] = {
+    48, 49, 50, 97, 99, 101, 105, 111, 115, 116, 32, 37, 45, 46, 47, 51,
+    52, 53, 54, 55, 56, 57, 61, 65, 95, 98, 100, 102, 103, 104, 108, 109,
+    110, 112, 114, 117, 58, 66, 67, 68, 69, 70, 71, 72, 73, 74, 75, 76,
+    77, 78, 79, 80, 81, 82, 83, 84, 85, 86, 87, 89, 106, 107, 113, 118,
+    119, 120, 121, 122, 38, 42, 44, 59, 88, 90, 33, 34, 40, 41, 63, 39,
+    43, 124, 35, 62, 0, 36, 64, 91, 93, 126, 94, 125, 60, 96, 123, 92,
+    195, 208, 128, 130, 131, 162, 184, 194, 224, 226, 153, 161, 167, 172, 176, 177,
+    179, 209, 216, 217, 227, 229, 230, 129, 132, 133, 134, 136, 146, 154, 156, 160,
+    163, 164, 169, 170, 173, 178, 181, 185, 186, 187, 189, 190, 196, 198, 228, 232,
+    233, 1, 135, 137, 138, 139, 140, 141, 143, 147, 149, 150, 151, 152, 155, 157,
+    158, 165, 166, 168, 174, 175, 180, 182, 183, 188, 191, 197, 231, 239, 9, 142,
+    144, 145, 148, 159, 171, 206, 215, 225, 236, 237, 199, 207, 234, 235, 192, 193,
+    200, 201, 202, 205, 210, 213, 218, 219, 238, 240, 242, 243, 255, 203, 204, 211,
+    212, 214, 221, 222, 223, 241, 244, 245, 246, 247, 248, 250, 251, 252, 253, 254,
+    2, 3, 4, 5, 6, 7, 8, 11, 12, 14, 15, 16, 17, 18, 19, 20,
+    21, 23, 24, 25, 26, 27, 28, 29, 30, 31, 127, 220, 249, 10, 13, 22,
+    256
+};
+
+static mln_u32_t mln_http2_huffman_first[31] = {
+    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x14, 0x5c,
+    0xf8, 0x0, 0x3f8, 0x7fa, 0xffa, 0x1ff8, 0x3ffc, 0x7ffc,
+    0x0, 0x0, 0x0, 0x7fff0, 0xfffe6, 0x1fffdc, 0x3fffd2, 0x7fffd8,
+    0xffffea, 0x1ffffec, 0x3ffffe0, 0x7ffffde, 0xfffffe2, 0x0, 0x3ffffffc
+};
+
+static mln_u16_t mln_http2_huffman_count[31] = {
+    0, 0, 0, 0, 0, 10, 26, 32, 6, 0, 5, 3, 2, 6, 2, 3,
+    0, 0, 0, 3, 8, 13, 26, 29, 12, 4, 15, 19, 29, 0, 4
+};
+
+static mln_u16_t mln_http2_huffman_offset[31] = {
+    0, 0, 0, 0, 0, 0, 10, 36, 68, 0, 74, 79, 82, 84, 90, 92,
+    0, 0, 0, 95, 98, 106, 119, 145, 174, 186, 190, 205, 224, 0, 253
+};
+
+static void mln_http2_field_free(void *data);
+static mln_string_t *mln_http2_string_static(mln_alloc_t *pool, mln_string_t *s);
+static mln_u8ptr_t mln_http2_int_encode(mln_u8ptr_t p, mln_u8_t flags, int prefix, mln_u64_t val);
+static int mln_http2_int_decode(mln_u8ptr_t *pp, mln_u8ptr_t end, int prefix, mln_u64_t *val);
+static mln_u8ptr_t mln_http2_string_encode(mln_u8ptr_t p, mln_string_t *s);
+static mln_string_t *mln_http2_string_decode(mln_alloc_t *pool, mln_u8ptr_t *pp, mln_u8ptr_t end);
+static mln_http2_field_t *mln_http2_hpack_entry(mln_http2_hpack_t *hp, mln_size_t index);
+static void mln_http2_hpack_evict(mln_http2_hpack_t *hp, mln_size_t need);
+static int mln_http2_hpack_add(mln_http2_hpack_t *hp, mln_string_t *name, mln_string_t *value);
+static int mln_http2_hpack_index(mln_http2_hpack_t *hp, mln_http2_field_t *f, mln_size_t *name_index);
+static int mln_http2_stream_cmp(const void *data1, const void *data2);
+static void mln_http2_stream_free(void *data);
+static mln_http2_stream_t *mln_http2_stream_create(mln_http2_t *h2, mln_u32_t id);
+static void mln_http2_stream_close(mln_http2_t *h2, mln_http2_stream_t *stream, mln_u32_t error);
+static void mln_http2_stream_end_remote(mln_http2_t *h2, mln_http2_stream_t *stream);
+static void mln_http2_stream_end_local(mln_http2_t *h2, mln_http2_stream_t *stream);
+static mln_chain_t *
+mln_http2_frame_new(mln_http2_t *h2, mln_u32_t len, mln_u8_t type, mln_u8_t flags, mln_u32_t id, mln_u8ptr_t *payload);
+static int mln_http2_rst_send(mln_http2_t *h2, mln_u32_t id, mln_u32_t error);
+static mln_size_t mln_http2_chain_size(mln_chain_t *c);
+static void mln_http2_chain_copy(mln_chain_t *c, mln_u8ptr_t out, mln_size_t n);
+static void mln_http2_chain_skip(mln_chain_t *c, mln_size_t n);
+static mln_u8ptr_t mln_http2_chain_contiguous(mln_chain_t *c, mln_size_t n);
+static int mln_http2_frame_process(mln_http2_t *h2, mln_u8_t type, mln_u8_t flags, mln_u32_t id, mln_u8ptr_t payload, mln_size_t len);
+static int mln_http2_frame_data(mln_http2_t *h2, mln_u8_t flags, mln_u32_t id, mln_u8ptr_t payload, mln_size_t len);
+static int mln_http2_frame_headers(mln_http2_t *h2, mln_u8_t flags, mln_u32_t id, mln_u8ptr_t payload, mln_size_t len);
+static int mln_http2_frame_continuation(mln_http2_t *h2, mln_u8_t flags, mln_u32_t id, mln_u8ptr_t payload, mln_size_t len);
+static int mln_http2_frame_rst_stream(mln_http2_t *h2, mln_u32_t id, mln_u8ptr_t payload, mln_size_t len);
+static int mln_http2_frame_settings(mln_http2_t *h2, mln_u8_t flags, mln_u32_t id, mln_u8ptr_t payload, mln_size_t len);
+static int mln_http2_frame_ping(mln_http2_t *h2, mln_u8_t flags, mln_u32_t id, mln_u8ptr_t payload, mln_size_t len);
+static int mln_http2_frame_goaway(mln_http2_t *h2, mln_u32_t id, mln_u8ptr_t payload, mln_size_t len);
+static int mln_http2_frame_window_update(mln_http2_t *h2, mln_u32_t id, mln_u8ptr_t payload, mln_size_t len);
+static int mln_http2_hblock_append(mln_http2_t *h2, mln_u8ptr_t buf, mln_size_t len);
+static int mln_http2_hblock_process(mln_http2_t *h2, mln_u32_t id, mln_u8ptr_t buf, mln_size_t len, int end_stream);
+
+#define mln_http2_get_u32(p) \
+    (((mln_u32_t)(p)[0] << 24) | ((mln_u32_t)(p)[1] << 16) | ((mln_u32_t)(p)[2] << 8) | (mln_u32_t)(p)[3])
+#define mln_http2_set_u32(p,v) ({\
+    mln_u32_t __v = (v);\
+    (p)[0] = (__v >> 24) & 0xff;\
+    (p)[1] = (__v >> 16) & 0xff;\
+    (p)[2] = (__v >> 8) & 0xff;\
+    (p)[3] = __v & 0xff;\
+})
+#define mln_http2_peer_stream(h2,id) \
+    ((h2)->type == M_HTTP2_SERVER? ((id) & 1): !((id) & 1))
+#define mln_http2_error_set(h2,e) ({ (h2)->error = (e); M_HTTP2_RET_ERROR; })
+
+
+/*
+ * Huffman
+ */
+mln_size_t mln_http2_huffman_encode_length(mln_u8ptr_t in, mln_size_t len)
+{
+    mln_u64_t bits = 0;
+    mln_u8ptr_t end = in + len;
+
+    for (; in < end; ++in)
+        bits += mln_http2_huffman_lens[*in];
+    return (bits + 7) >> 3;
+}
+
+mln_size_t mln_http2_huffman_encode(mln_u8ptr_t in, mln_size_t len, mln_u8ptr_t out)
+{
+    mln_u64_t acc = 0;
+    mln_u32_t nbits = 0;
+    mln_u8ptr_t p = out, end = in + len;
+
+    for (; in < end; ++in) {
+        acc = (acc << mln_http2_huffman_lens[*in]) | mln_http2_huffman_codes[*in];
+        nbits += mln_http2_huffman_lens[*in];
+        while (nbits >= 8) {
+            nbits -= 8;
+            *p++ = (acc >> nbits) & 0xff;
+        }
+    }
+    if (nbits) {
+        /*padding with the most significant bits of EOS*/
+        *p++ = ((acc << (8 - nbits)) | (0xff >> nbits)) & 0xff;
+    }
+    return p - out;
+}
+
+mln_sauto_t mln_http2_huffman_decode(mln_u8ptr_t in, mln_size_t len, mln_u8ptr_t out)
+{
+    mln_u32_t code = 0, l = 0, bit, idx;
+    mln_u8ptr_t p = out, end = in + len;
+    mln_u8_t c;
+
+    for (; in < end; ++in) {
+        c = *in;
+        for (bit = 0; bit < 8; ++bit) {
+            code = (code << 1) | ((c >> (7 - bit)) & 1);
+            if (++l > 30) return -1;
+            idx = code - mln_http2_huffman_first[l];
+            if (idx < mln_http2_huffman_count[l]) {
+                idx = mln_http2_huffman_syms[mln_http2_huffman_offset[l] + idx];
+                if (idx == 256) return -1;
+                *p++ = (mln_u8_t)idx;
+                code = l = 0;
+            }
+        }
+    }
+    /*padding must be shorter than 8 bits and consist of 1s*/
+    if (l > 7 || code != ((1U << l) - 1)) return -1;
+    return p - out;
+}
+
+
+/*
+ * HPACK
+ */
+int mln_http2_hpack_init(mln_http2_hpack_t *hp, mln_alloc_t *pool, mln_size_t max_size)
+{
+    hp->pool = pool;
+    hp->entries = NULL;
+    hp->nalloc = 0;
+    hp->head = 0;
+    hp->nentries = 0;
+    hp->size = 0;
+    hp->max_size = max_size;
+    hp->limit = max_size;
+    hp->update = 0;
+    return 0;
+}
+
+void mln_http2_hpack_destroy(mln_http2_hpack_t *hp)
+{
+    if (hp == NULL) return;
+
+    mln_http2_hpack_evict(hp, (mln_size_t)-1);
+    if (hp->entries != NULL) {
+        mln_alloc_free(hp->entries);
+        hp->entries = NULL;
+    }
+    hp->nalloc = 0;
+}
+
+void mln_http2_hpack_size_set(mln_http2_hpack_t *hp, mln_size_t max_size)
+{
+    hp->limit = max_size;
+    if (hp->max_size != max_size) {
+        hp->max_size = max_size;
+        mln_http2_hpack_evict(hp, 0);
+        hp->update = 1;
+    }
+}
+
+static void mln_http2_field_free(void *data)
+{
+    mln_http2_field_t *f = (mln_http2_field_t *)data;
+    mln_string_free(f->name);
+    mln_string_free(f->value);
+}
+
+/*
+ * Strings of the static table are never released, so they are only referenced.
+ */
+static mln_string_t *mln_http2_string_static(mln_alloc_t *pool, mln_string_t *s)
+{
+    mln_string_t *ret = mln_string_buf_pool_new(pool, s->data, s->len);
+    if (ret != NULL) ret->data_ref = 1;
+    return ret;
+}
+
+static mln_u8ptr_t mln_http2_int_encode(mln_u8ptr_t p, mln_u8_t flags, int prefix, mln_u64_t val)
+{
+    mln_u64_t max = (1 << prefix) - 1;
+
+    if (val < max) {
+        *p++ = flags | (mln_u8_t)val;
+        return p;
+    }
+    *p++ = flags | (mln_u8_t)max;
+    val -= max;
+    while (val >= 128) {
+        *p++ = (val & 0x7f) | 0x80;
+        val >>= 7;
+    }
+    *p++ = (mln_u8_t)val;
+    return p;
+}
+
+static int mln_http2_int_decode(mln_u8ptr_t *pp, mln_u8ptr_t end, int prefix, mln_u64_t *val)
+{
+    mln_u8ptr_t p = *pp;
+    mln_u64_t max = (1 << prefix) - 1, v;
+    mln_u32_t m = 0;
+
+    if (p >= end) return -1;
+    v = *p++ & max;
+    if (v == max) {
+        do {
+            if (p >= end || m > 28) return -1;
+            v += (mln_u64_t)(*p & 0x7f) << m;
+            m += 7;
+        } while (*p++ & 0x80);
+    }
+    *pp = p;
+    *val = v;
+    return 0;
+}
+
+static mln_u8ptr_t mln_http2_string_encode(mln_u8ptr_t p, mln_string_t *s)
+{
+    mln_size_t hlen = mln_http2_huffman_encode_length(s->data, s->len);
+
+    if (hlen < s->len) {
+        p = mln_http2_int_encode(p, 0x80, 7, hlen);
+        p += mln_http2_huffman_encode(s->data, s->len, p);
+    } else {
+        p = mln_http2_int_encode(p, 0, 7, s->len);
+        memcpy(p, s->data, s->len);
+        p += s->len;
+    }
+    return p;
+}
+
+static mln_string_t *mln_http2_string_decode(mln_alloc_t *pool, mln_u8ptr_t *pp, mln_u8ptr_t end)
+{
+    mln_u8ptr_t p = *pp;
+    mln_u64_t len;
+    mln_sauto_t n;
+    mln_string_t *s;
+    int huffman;
+
+    if (p >= end) return NULL;
+    huffman = *p & 0x80;
+    if (mln_http2_int_decode(&p, end, 7, &len) < 0) return NULL;
+    if (len > end - p) return NULL;
+
+    if (huffman) {
+        if ((s = mln_string_pool_alloc(pool, (len << 3) / 5 + 1)) == NULL) return NULL;
+        if ((n = mln_http2_huffman_decode(p, len, s->data)) < 0) {
+            mln_string_free(s);
+            return NULL;
+        }
+        s->len = n;
+    } else {
+        if ((s = mln_string_pool_alloc(pool, len)) == NULL) return NULL;
+        memcpy(s->data, p, len);
+    }
+    s->data[s->len] = 0;
+    *pp = p + len;
+    return s;
+}
+
+/*
+ * index starts from 0, which is the newest entry.
+ */
+static mln_http2_field_t *mln_http2_hpack_entry(mln_http2_hpack_t *hp, mln_size_t index)
+{
+    if (index >= hp->nentries) return NULL;
+    return &hp->entries[(hp->head + hp->nalloc - index) % hp->nalloc];
+}
+
+static void mln_http2_hpack_evict(mln_http2_hpack_t *hp, mln_size_t need)
+{
+    mln_http2_field_t *f;
+
+    while (hp->nentries && (need > hp->max_size || hp->size + need > hp->max_size)) {
+        f = mln_http2_hpack_entry(hp, hp->nentries - 1);
+        hp->size -= 32 + f->name->len + f->value->len;
+        mln_http2_field_free(f);
+        --(hp->nentries);
+    }
+}
+
+/*
+ * name and value will be referenced by the table.
+ */
+static int mln_http2_hpack_add(mln_http2_hpack_t *hp, mln_string_t *name, mln_string_t *value)
+{
+    mln_size_t size = 32 + name->len + value->len, i;
+    mln_http2_field_t *entries, *f;
+
+    mln_http2_hpack_evict(hp, size);
+    if (size > hp->max_size) return 0;
+
+    if (hp->nentries == hp->nalloc) {
+        mln_size_t n = hp->nalloc? hp->nalloc << 1: 16;
+        entries = (mln_http2_field_t *)mln_alloc_m(hp->pool, n * sizeof(mln_http2_field_t));
+        if (entries == NULL) return -1;
+        /*keep the oldest entry at 0 and the newest at nentries-1*/
+        for (i = 0; i < hp->nentries; ++i)
+            entries[i] = *mln_http2_hpack_entry(hp, hp->nentries - 1 - i);
+        if (hp->entries != NULL) mln_alloc_free(hp->entries);
+        hp->entries = entries;
+        hp->nalloc = n;
+        hp->head = hp->nentries? hp->nentries - 1: n - 1;
+    }
+
+    hp->head = (hp->head + 1) % hp->nalloc;
+    f = &hp->entries[hp->head];
+    f->name = mln_string_ref(name);
+    f->value = mln_string_ref(value);
+    ++(hp->nentries);
+    hp->size += size;
+    return 0;
+}
+
+/*
+ * Return the HPACK index of the entry equal to f, 0 if not found.
+ * name_index is set to the index of the first entry whose name equals f->name.
+ */
+static int mln_http2_hpack_index(mln_http2_hpack_t *hp, mln_http2_field_t *f, mln_size_t *name_index)
+{
+    mln_size_t i;
+    mln_http2_static_field_t *sf;
+    mln_http2_field_t *df;
+
+    *name_index = 0;
+    for (i = 0; i < M_HTTP2_STATIC_TABLE_LEN; ++i) {
+        sf = &mln_http2_static_table[i];
+        if (sf->name.len != f->name->len || memcmp(sf->name.data, f->name->data, f->name->len))
+            continue;
+        if (!*name_index) *name_index = i + 1;
+        if (sf->value.len == f->value->len && !memcmp(sf->value.data, f->value->data, f->value->len))
+            return i + 1;
+    }
+    for (i = 0; i < hp->nentries; ++i) {
+        df = mln_http2_hpack_entry(hp, i);
+        if (df->name->len != f->name->len || memcmp(df->name->data, f->name->data, f->name->len))
+            continue;
+        if (!*name_index) *name_index = i + 1 + M_HTTP2_STATIC_TABLE_LEN;
+        if (df->value->len == f->value->len && !memcmp(df->value->data, f->value->data, f->value->len))
+            return i + 1 + M_HTTP2_STATIC_TABLE_LEN;
+    }
+    return 0;
+}
+
+int mln_http2_hpack_decode(mln_http2_hpack_t *hp, mln_u8ptr_t buf, mln_size_t len, mln_array_t *fields)
+{
+    mln_u8ptr_t p = buf, end = buf + len;
+    mln_u64_t index;
+    mln_string_t *name = NULL, *value = NULL;
+    mln_http2_field_t *f;
+    mln_http2_static_field_t *sf;
+    int prefix, nfields = 0, indexing;
+    mln_u8_t c;
+
+    while (p < end) {
+        c = *p;
+        if (c & 0x80) {
+            /*indexed header field*/
+            if (mln_http2_int_decode(&p, end, 7, &index) < 0 || !index) return M_HTTP2_RET_ERROR;
+            if (index <= M_HTTP2_STATIC_TABLE_LEN) {
+                sf = &mln_http2_static_table[index - 1];
+                name = mln_http2_string_static(hp->pool, &sf->name);
+                value = mln_http2_string_static(hp->pool, &sf->value);
+            } else {
+                if ((f = mln_http2_hpack_entry(hp, index - 1 - M_HTTP2_STATIC_TABLE_LEN)) == NULL)
+                    return M_HTTP2_RET_ERROR;
+                name = mln_string_ref(f->name);
+                value = mln_string_ref(f->value);
+            }
+            if (name == NULL || value == NULL) goto err;
+            goto push;
+        } else if ((c & 0xe0) == 0x20) {
+            /*dynamic table size update, only allowed at the beginning of a header block*/
+            if (nfields || mln_http2_int_decode(&p, end, 5, &index) < 0 || index > hp->limit)
+                return M_HTTP2_RET_ERROR;
+            hp->max_size = index;
+            mln_http2_hpack_evict(hp, 0);
+            continue;
+        }
+
+        /*literal header field*/
+        if (c & 0x40) {
+            prefix = 6;
+            indexing = 1;
+        } else {
+            prefix = 4;
+            indexing = 0;
+        }
+        if (mln_http2_int_decode(&p, end, prefix, &index) < 0) return M_HTTP2_RET_ERROR;
+        if (index) {
+            if (index <= M_HTTP2_STATIC_TABLE_LEN) {
+                name = mln_http2_string_static(hp->pool, &mln_http2_static_table[index - 1].name);
+            } else {
+                if ((f = mln_http2_hpack_entry(hp, index - 1 - M_HTTP2_STATIC_TABLE_LEN)) == NULL)
+                    return M_HTTP2_RET_ERROR;
+                name = mln_string_ref(f->name);
+            }
+        } else {
+            name = mln_http2_string_decode(hp->pool, &p, end);
+        }
+        if (name == NULL) return M_HTTP2_RET_ERROR;
+        if ((value = mln_http2_string_decode(hp->pool, &p, end)) == NULL) {
+            mln_string_free(name);
+            return M_HTTP2_RET_ERROR;
+        }
+        if (indexing && mln_http2_hpack_add(hp, name, value) < 0) goto err;
+
+push:
+        if ((f = (mln_http2_field_t *)mln_array_push(fields)) == NULL) goto err;
+        f->name = name;
+        f->value = value;
+        ++nfields;
+    }
+    return M_HTTP2_RET_OK;
+
+err:
+    mln_string_free(name);
+    mln_string_free(value);
+    return M_HTTP2_RET_ERROR;
+}
+
+mln_size_t mln_http2_hpack_encode(mln_http2_hpack_t *hp, mln_http2_field_t *fields, mln_size_t n, mln_u8ptr_t out, mln_size_t size)
+{
+    mln_u8ptr_t p = out, end = out + size;
+    mln_http2_field_t *f, *fend = fields + n;
+    mln_size_t index, name_index;
+    mln_string_t *name, *value;
+
+    if (hp->update) {
+        if (end - p < 6) return 0;
+        p = mln_http2_int_encode(p, 0x20, 5, hp->max_size);
+        hp->update = 0;
+    }
+
+    for (f = fields; f < fend; ++f) {
+        if (end - p < f->name->len + f->value->len + 18) return 0;
+
+        index = mln_http2_hpack_index(hp, f, &name_index);
+        if (index) {
+            p = mln_http2_int_encode(p, 0x80, 7, index);
+            continue;
+        }
+
+        if (!mln_string_const_strcmp(f->name, "authorization") || \
+            !mln_string_const_strcmp(f->name, "proxy-authorization"))
+        {
+            /*literal header field never indexed*/
+            p = mln_http2_int_encode(p, 0x10, 4, name_index);
+            if (!name_index) p = mln_http2_string_encode(p, f->name);
+            p = mln_http2_string_encode(p, f->value);
+            continue;
+        }
+
+        /*literal header field with incremental indexing*/
+        p = mln_http2_int_encode(p, 0x40, 6, name_index);
+        if (!name_index) p = mln_http2_string_encode(p, f->name);
+        p = mln_http2_string_encode(p, f->value);
+
+        if (32 + f->name->len + f->value->len > hp->max_size) {
+            mln_http2_hpack_evict(hp, (mln_size_t)-1);
+            continue;
+        }
+        if ((name = mln_string_pool_dup(hp->pool, f->name)) == NULL) return 0;
+        if ((value = mln_string_pool_dup(hp->pool, f->value)) == NULL) {
+            mln_string_free(name);
+            return 0;
+        }
+        index = mln_http2_hpack_add(hp, name, value);
+        mln_string_free(name);
+        mln_string_free(value);
+        if (index) return 0;
+    }
+    return p - out;
+}
+
+
+/*
+ * streams
+ */
+static int mln_http2_stream_cmp(const void *data1, const void *data2)
+{
+    mln_u32_t id1 = ((mln_http2_stream_t *)data1)->id;
+    mln_u32_t id2 = ((mln_http2_stream_t *)data2)->id;
+    if (id1 > id2) return 1;
+    if (id1 < id2) return -1;
+    return 0;
+}
+
+static void mln_http2_stream_free(void *data)
+{
+    mln_http2_stream_t *stream = (mln_http2_stream_t *)data;
+    if (stream == NULL) return;
+    if (stream->fields != NULL) mln_array_free(stream->fields);
+    mln_alloc_free(stream);
+}
+
+static mln_http2_stream_t *mln_http2_stream_create(mln_http2_t *h2, mln_u32_t id)
+{
+    mln_http2_stream_t *stream;
+    struct mln_array_attr attr;
+
+    if ((stream = (mln_http2_stream_t *)mln_alloc_m(h2->pool, sizeof(mln_http2_stream_t))) == NULL)
+        return NULL;
+    attr.pool = h2->pool;
+    attr.pool_alloc = (array_pool_alloc_handler)mln_alloc_m;
+    attr.pool_free = (array_pool_free_handler)mln_alloc_free;
+    attr.free = mln_http2_field_free;
+    attr.size = sizeof(mln_http2_field_t);
+    attr.nalloc = 8;
+    if ((stream->fields = mln_array_new(&attr)) == NULL) {
+        mln_alloc_free(stream);
+        return NULL;
+    }
+    stream->id = id;
+    stream->state = M_HTTP2_STATE_IDLE;
+    stream->send_window = h2->remote.initial_window_size;
+    stream->recv_window = h2->local.initial_window_size;
+    stream->data = NULL;
+    mln_rbtree_node_init(&stream->node, stream);
+    mln_rbtree_inline_insert(h2->streams, &stream->node, mln_http2_stream_cmp);
+    ++(h2->nr_streams);
+    return stream;
+}
+
+mln_http2_stream_t *mln_http2_stream_new(mln_http2_t *h2)
+{
+    mln_http2_stream_t *stream;
+
+    if (h2->goaway_sent || h2->goaway_recv) return NULL;
+    if (h2->nr_streams >= h2->remote.max_concurrent_streams) return NULL;
+    if (h2->next_id > 0x7fffffff) return NULL;
+    if ((stream = mln_http2_stream_create(h2, h2->next_id)) == NULL) return NULL;
+    h2->next_id += 2;
+    return stream;
+}
+
+mln_http2_stream_t *mln_http2_stream_search(mln_http2_t *h2, mln_u32_t id)
+{
+    mln_http2_stream_t tmp;
+    mln_rbtree_node_t *rn;
+
+    tmp.id = id;
+    rn = mln_rbtree_inline_search(h2->streams, &tmp, mln_http2_stream_cmp);
+    if (mln_rbtree_null(rn, h2->streams)) return NULL;
+    return (mln_http2_stream_t *)mln_rbtree_node_data_get(rn);
+}
+
+/*
+ * The stream is freed after close_handler returned.
+ */
+static void mln_http2_stream_close(mln_http2_t *h2, mln_http2_stream_t *stream, mln_u32_t error)
+{
+    stream->state = M_HTTP2_STATE_CLOSED;
+    if (h2->close_handler != NULL) h2->close_handler(h2, stream, error);
+    mln_rbtree_delete(h2->streams, &stream->node);
+    --(h2->nr_streams);
+    mln_http2_stream_free(stream);
+}
+
+static void mln_http2_stream_end_remote(mln_http2_t *h2, mln_http2_stream_t *stream)
+{
+    if (stream->state == M_HTTP2_STATE_HALF_CLOSED_LOCAL)
+        mln_http2_stream_close(h2, stream, M_HTTP2_NO_ERROR);
+    else
+        stream->state = M_HTTP2_STATE_HALF_CLOSED_REMOTE;
+}
+
+static void mln_http2_stream_end_local(mln_http2_t *h2, mln_http2_stream_t *stream)
+{
+    if (stream->state == M_HTTP2_STATE_HALF_CLOSED_REMOTE)
+        mln_http2_stream_close(h2, stream, M_HTTP2_NO_ERROR);
+    else
+        stream->state = M_HTTP2_STATE_HALF_CLOSED_LOCAL;
+}
+
+mln_string_t *mln_http2_field_get(mln_http2_stream_t *stream, mln_string_t *name)
+{
+    mln_http2_field_t *f = mln_http2_stream_fields_get(stream);
+    mln_http2_field_t *fend = f + mln_http2_stream_nfields_get(stream);
+
+    for (; f < fend; ++f) {
+        if (!mln_string_strcasecmp(f->name, name)) return f->value;
+    }
+    return NULL;
+}
+
+int mln_http2_field_append(mln_alloc_t *pool, mln_array_t *fields, mln_string_t *name, mln_string_t *value)
+{
+    mln_http2_field_t *f;
+    mln_string_t *n, *v;
+
+    if ((n = mln_string_pool_dup(pool, name)) == NULL) return -1;
+    if ((v = mln_string_pool_dup(pool, value)) == NULL) {
+        mln_string_free(n);
+        return -1;
+    }
+    if ((f = (mln_http2_field_t *)mln_array_push(fields)) == NULL) {
+        mln_string_free(n);
+        mln_string_free(v);
+        return -1;
+    }
+    f->name = n;
+    f->value = v;
+    return 0;
+}
+
+
+/*
+ * connection
+ */
+mln_http2_t *mln_http2_init(mln_tcp_conn_t *connection, mln_u32_t type, void *data)
+{
+    mln_http2_t *h2;
+    struct mln_rbtree_attr rbattr;
+    mln_alloc_t *pool = mln_tcp_conn_pool_get(connection);
+
+    if (type != M_HTTP2_SERVER && type != M_HTTP2_CLIENT) return NULL;
+    if ((h2 = (mln_http2_t *)mln_alloc_m(pool, sizeof(mln_http2_t))) == NULL) return NULL;
+
+    rbattr.pool = pool;
+    rbattr.pool_alloc = (rbtree_pool_alloc_handler)mln_alloc_m;
+    rbattr.pool_free = (rbtree_pool_free_handler)mln_alloc_free;
+    rbattr.cmp = mln_http2_stream_cmp;
+    rbattr.data_free = NULL;
+    if ((h2->streams = mln_rbtree_new(&rbattr)) == NULL) {
+        mln_alloc_free(h2);
+        return NULL;
+    }
+
+    h2->connection = connection;
+    h2->pool = pool;
+    h2->data = data;
+    mln_http2_hpack_init(&h2->decoder, pool, M_HTTP2_DEFAULT_TABLE_SIZE);
+    mln_http2_hpack_init(&h2->encoder, pool, M_HTTP2_DEFAULT_TABLE_SIZE);
+    h2->local.header_table_size = M_HTTP2_DEFAULT_TABLE_SIZE;
+    h2->local.enable_push = 0;
+    h2->local.max_concurrent_streams = M_HTTP2_DEFAULT_MAX_STREAMS;
+    h2->local.initial_window_size = M_HTTP2_DEFAULT_WINDOW_SIZE;
+    h2->local.max_frame_size = M_HTTP2_DEFAULT_FRAME_SIZE;
+    h2->local.max_header_list_size = M_HTTP2_DEFAULT_HEADER_LIST_SIZE;
+    h2->remote.header_table_size = M_HTTP2_DEFAULT_TABLE_SIZE;
+    h2->remote.enable_push = 1;
+    h2->remote.max_concurrent_streams = (mln_u32_t)-1;
+    h2->remote.initial_window_size = M_HTTP2_DEFAULT_WINDOW_SIZE;
+    h2->remote.max_frame_size = M_HTTP2_DEFAULT_FRAME_SIZE;
+    h2->remote.max_header_list_size = (mln_u32_t)-1;
+    h2->send_window = M_HTTP2_DEFAULT_WINDOW_SIZE;
+    h2->recv_window = M_HTTP2_DEFAULT_WINDOW_SIZE;
+    h2->nr_streams = 0;
+    h2->last_peer_id = 0;
+    h2->next_id = type == M_HTTP2_CLIENT? 1: 2;
+    h2->error = M_HTTP2_NO_ERROR;
+    h2->hblock = NULL;
+    h2->hblock_len = h2->hblock_size = 0;
+    h2->hblock_stream = 0;
+    h2->hblock_end_stream = 0;
+    h2->type = type;
+    /*only server receives the connection preface*/
+    h2->preface = type == M_HTTP2_CLIENT? 1: 0;
+    h2->goaway_sent = h2->goaway_recv = 0;
+    h2->headers_handler = NULL;
+    h2->data_handler = NULL;
+    h2->window_handler = NULL;
+    h2->close_handler = NULL;
+    return h2;
+}
+
+void mln_http2_destroy(mln_http2_t *h2)
+{
+    if (h2 == NULL) return;
+
+    mln_rbtree_inline_free(h2->streams, mln_http2_stream_free);
+    mln_http2_hpack_destroy(&h2->decoder);
+    mln_http2_hpack_destroy(&h2->encoder);
+    if (h2->hblock != NULL) mln_alloc_free(h2->hblock);
+    mln_alloc_free(h2);
+}
+
+
+/*
+ * generators
+ */
+static mln_chain_t *
+mln_http2_frame_new(mln_http2_t *h2, mln_u32_t len, mln_u8_t type, mln_u8_t flags, mln_u32_t id, mln_u8ptr_t *payload)
+{
+    mln_chain_t *c;
+    mln_buf_t *b;
+    mln_u8ptr_t buf;
+    mln_alloc_t *pool = h2->pool;
+
+    if ((c = mln_chain_new(pool)) == NULL) return NULL;
+    if ((b = mln_buf_new(pool)) == NULL) {
+        mln_chain_pool_release(c);
+        return NULL;
+    }
+    c->buf = b;
+    if ((buf = (mln_u8ptr_t)mln_alloc_m(pool, M_HTTP2_FRAME_HEADER_LEN + len)) == NULL) {
+        mln_chain_pool_release(c);
+        return NULL;
+    }
+    b->left_pos = b->pos = b->start = buf;
+    b->end = b->last = buf + M_HTTP2_FRAME_HEADER_LEN + len;
+    b->in_memory = 1;
+    b->last_buf = 1;
+
+    buf[0] = (len >> 16) & 0xff;
+    buf[1] = (len >> 8) & 0xff;
+    buf[2] = len & 0xff;
+    buf[3] = type;
+    buf[4] = flags;
+    mln_http2_set_u32(buf + 5, id & 0x7fffffff);
+    if (payload != NULL) *payload = buf + M_HTTP2_FRAME_HEADER_LEN;
+    return c;
+}
+
+int mln_http2_preface_generate(mln_http2_t *h2)
+{
+    mln_chain_t *c;
+    mln_buf_t *b;
+
+    if (h2->type == M_HTTP2_CLIENT) {
+        if ((c = mln_chain_new(h2->pool)) == NULL) return M_HTTP2_RET_ERROR;
+        if ((b = mln_buf_new(h2->pool)) == NULL) {
+            mln_chain_pool_release(c);
+            return M_HTTP2_RET_ERROR;
+        }
+        c->buf = b;
+        /*the buf is released without its data*/
+        b->left_pos = b->pos = b->start = mln_http2_preface;
+        b->end = b->last = mln_http2_preface + M_HTTP2_PREFACE_LEN;
+        b->in_memory = 1;
+        b->temporary = 1;
+        b->last_buf = 1;
+        mln_tcp_conn_append(h2->connection, c, M_C_SEND);
+    }
+    return mln_http2_settings_generate(h2);
+}
+
+int mln_http2_settings_generate(mln_http2_t *h2)
+{
+    mln_chain_t *c;
+    mln_u8ptr_t p;
+    mln_u32_t i, settings[6][2] = {
+        {M_HTTP2_SETTINGS_HEADER_TABLE_SIZE, h2->local.header_table_size},
+        {M_HTTP2_SETTINGS_ENABLE_PUSH, h2->local.enable_push},
+        {M_HTTP2_SETTINGS_MAX_CONCURRENT, h2->local.max_concurrent_streams},
+        {M_HTTP2_SETTINGS_INITIAL_WINDOW_SIZE, h2->local.initial_window_size},
+        {M_HTTP2_SETTINGS_MAX_FRAME_SIZE, h2->local.max_frame_size},
+        {M_HTTP2_SETTINGS_MAX_HEADER_LIST_SIZE, h2->local.max_header_list_size},
+    };
+
+    if (h2->local.enable_push > 1 || \
+        h2->local.initial_window_size > M_HTTP2_MAX_WINDOW_SIZE || \
+        h2->local.max_frame_size < M_HTTP2_DEFAULT_FRAME_SIZE || \
+        h2->local.max_frame_size > M_HTTP2_MAX_FRAME_SIZE)
+    {
+        return M_HTTP2_RET_ERROR;
+    }
+
+    c = mln_http2_frame_new(h2, sizeof(settings) / sizeof(settings[0]) * 6, M_HTTP2_FRAME_SETTINGS, 0, 0, &p);
+    if (c == NULL) return M_HTTP2_RET_ERROR;
+    for (i = 0; i < sizeof(settings) / sizeof(settings[0]); ++i, p += 6) {
+        p[0] = (settings[i][0] >> 8) & 0xff;
+        p[1] = settings[i][0] & 0xff;
+        mln_http2_set_u32(p + 2, settings[i][1]);
+    }
+    mln_tcp_conn_append(h2->connection, c, M_C_SEND);
+    return M_HTTP2_RET_OK;
+}
+
+int mln_http2_ping_generate(mln_http2_t *h2, mln_u8ptr_t opaque, int ack)
+{
+    mln_chain_t *c;
+    mln_u8ptr_t p;
+
+    c = mln_http2_frame_new(h2, 8, M_HTTP2_FRAME_PING, ack? M_HTTP2_FLAG_ACK: 0, 0, &p);
+    if (c == NULL) return M_HTTP2_RET_ERROR;
+    memcpy(p, opaque, 8);
+    mln_tcp_conn_append(h2->connection, c, M_C_SEND);
+    return M_HTTP2_RET_OK;
+}
+
+int mln_http2_goaway_generate(mln_http2_t *h2, mln_u32_t error)
+{
+    mln_chain_t *c;
+    mln_u8ptr_t p;
+
+    if ((c = mln_http2_frame_new(h2, 8, M_HTTP2_FRAME_GOAWAY, 0, 0, &p)) == NULL)
+        return M_HTTP2_RET_ERROR;
+    mln_http2_set_u32(p, h2->last_peer_id);
+    mln_http2_set_u32(p + 4, error);
+    mln_tcp_conn_append(h2->connection, c, M_C_SEND);
+    h2->goaway_sent = 1;
+    return M_HTTP2_RET_OK;
+}
+
+int mln_http2_window_update_generate(mln_http2_t *h2, mln_http2_stream_t *stream, mln_u32_t increment)
+{
+    mln_chain_t *c;
+    mln_u8ptr_t p;
+    mln_s64_t *window = stream == NULL? &h2->recv_window: &stream->recv_window;
+
+    if (!increment || increment > M_HTTP2_MAX_WINDOW_SIZE || *window + increment > M_HTTP2_MAX_WINDOW_SIZE)
+        return M_HTTP2_RET_ERROR;
+    c = mln_http2_frame_new(h2, 4, M_HTTP2_FRAME_WINDOW_UPDATE, 0, stream == NULL? 0: stream->id, &p);
+    if (c == NULL) return M_HTTP2_RET_ERROR;
+    mln_http2_set_u32(p, increment);
+    mln_tcp_conn_append(h2->connection, c, M_C_SEND);
+    *window += increment;
+    return M_HTTP2_RET_OK;
+}
+
+static int mln_http2_rst_send(mln_http2_t *h2, mln_u32_t id, mln_u32_t error)
+{
+    mln_chain_t *c;
+    mln_u8ptr_t p;
+
+    if ((c = mln_http2_frame_new(h2, 4, M_HTTP2_FRAME_RST_STREAM, 0, id, &p)) == NULL)
+        return M_HTTP2_RET_ERROR;
+    mln_http2_set_u32(p, error);
+    mln_tcp_conn_append(h2->connection, c, M_C_SEND);
+    return M_HTTP2_RET_OK;
+}
+
+int mln_http2_rst_stream_generate(mln_http2_t *h2, mln_http2_stream_t *stream, mln_u32_t error)
+{
+    if (mln_http2_rst_send(h2, stream->id, error) != M_HTTP2_RET_OK)
+        return M_HTTP2_RET_ERROR;
+    mln_http2_stream_close(h2, stream, error);
+    return M_HTTP2_RET_OK;
+}
+
+int mln_http2_headers_generate(mln_http2_t *h2, \
+                               mln_http2_stream_t *stream, \
+                               mln_http2_field_t *fields, \
+                               mln_size_t n, \
+                               int end_stream)
+{
+    mln_size_t size = 6, len, flen, i;
+    mln_u8ptr_t buf, p, pos;
+    mln_chain_t *c;
+    mln_u8_t type = M_HTTP2_FRAME_HEADERS, flags;
+
+    if (stream->state != M_HTTP2_STATE_IDLE && \
+        stream->state != M_HTTP2_STATE_OPEN && \
+        stream->state != M_HTTP2_STATE_HALF_CLOSED_REMOTE)
+    {
+        return M_HTTP2_RET_ERROR;
+    }
+
+    for (i = 0; i < n; ++i)
+        size += fields[i].name->len + fields[i].value->len + 18;
+    if ((buf = (mln_u8ptr_t)mln_alloc_m(h2->pool, size)) == NULL) return M_HTTP2_RET_ERROR;
+    if ((len = mln_http2_hpack_encode(&h2->encoder, fields, n, buf, size)) == 0 && n) {
+        mln_alloc_free(buf);
+        return M_HTTP2_RET_ERROR;
+    }
+
+    pos = buf;
+    do {
+        flen = len > h2->remote.max_frame_size? h2->remote.max_frame_size: len;
+        flags = flen == len? M_HTTP2_FLAG_END_HEADERS: 0;
+        if (end_stream && type == M_HTTP2_FRAME_HEADERS) flags |= M_HTTP2_FLAG_END_STREAM;
+        if ((c = mln_http2_frame_new(h2, flen, type, flags, stream->id, &p)) == NULL) {
+            /*the encoder state has been changed, so this connection can not be used any more*/
+            mln_alloc_free(buf);
+            h2->error = M_HTTP2_INTERNAL_ERROR;
+            return M_HTTP2_RET_ERROR;
+        }
+        memcpy(p, pos, flen);
+        mln_tcp_conn_append(h2->connection, c, M_C_SEND);
+        pos += flen;
+        len -= flen;
+        type = M_HTTP2_FRAME_CONTINUATION;
+    } while (len);
+    mln_alloc_free(buf);
+
+    if (stream->state == M_HTTP2_STATE_IDLE) stream->state = M_HTTP2_STATE_OPEN;
+    if (end_stream) mln_http2_stream_end_local(h2, stream);
+    return M_HTTP2_RET_OK;
+}
+
+int mln_http2_data_generate(mln_http2_t *h2, \
+                            mln_http2_stream_t *stream, \
+                            mln_u8ptr_t buf, \
+                            mln_size_t len, \
+                            int end_stream, \
+                            mln_size_t *sent)
+{
+    mln_s64_t avail;
+    mln_size_t n, flen, total;
+    mln_chain_t *c;
+    mln_u8ptr_t p;
+    mln_u8_t flags;
+
+    if (sent != NULL) *sent = 0;
+    if (stream->state != M_HTTP2_STATE_OPEN && stream->state != M_HTTP2_STATE_HALF_CLOSED_REMOTE)
+        return M_HTTP2_RET_ERROR;
+    if (buf == NULL && len) return M_HTTP2_RET_ERROR;
+
+    avail = stream->send_window < h2->send_window? stream->send_window: h2->send_window;
+    if (avail < 0) avail = 0;
+    total = n = len > avail? avail: len;
+    if (n == 0 && (n < len || !end_stream)) return M_HTTP2_RET_OK;
+
+    do {
+        flen = n > h2->remote.max_frame_size? h2->remote.max_frame_size: n;
+        flags = (flen == n && total == len && end_stream)? M_HTTP2_FLAG_END_STREAM: 0;
+        if ((c = mln_http2_frame_new(h2, flen, M_HTTP2_FRAME_DATA, flags, stream->id, &p)) == NULL)
+            return M_HTTP2_RET_ERROR;
+        if (flen) memcpy(p, buf, flen);
+        mln_tcp_conn_append(h2->connection, c, M_C_SEND);
+        buf += flen;
+        n -= flen;
+        stream->send_window -= flen;
+        h2->send_window -= flen;
+        if (sent != NULL) *sent += flen;
+    } while (n);
+
+    if (total == len && end_stream) mln_http2_stream_end_local(h2, stream);
+    return M_HTTP2_RET_OK;
+}
+
+
+/*
+ * parser
+ */
+static mln_size_t mln_http2_chain_size(mln_chain_t *c)
+{
+    mln_size_t size = 0;
+    for (; c != NULL; c = c->next) {
+        if (c->buf == NULL || c->buf->in_file) continue;
+        size += mln_buf_left_size(c->buf);
+    }
+    return size;
+}
+
+static void mln_http2_chain_copy(mln_chain_t *c, mln_u8ptr_t out, mln_size_t n)
+{
+    mln_size_t len;
+
+    for (; n && c != NULL; c = c->next) {
+        if (c->buf == NULL || c->buf->in_file || !(len = mln_buf_left_size(c->buf))) continue;
+        if (len > n) len = n;
+        memcpy(out, c->buf->left_pos, len);
+        out += len;
+        n -= len;
+    }
+}
+
+static void mln_http2_chain_skip(mln_chain_t *c, mln_size_t n)
+{
+    mln_size_t len;
+
+    for (; n && c != NULL; c = c->next) {
+        if (c->buf == NULL || c->buf->in_file || !(len = mln_buf_left_size(c->buf))) continue;
+        if (len > n) len = n;
+        c->buf->left_pos += len;
+        n -= len;
+    }
+}
+
+static mln_u8ptr_t mln_http2_chain_contiguous(mln_chain_t *c, mln_size_t n)
+{
+    for (; c != NULL; c = c->next) {
+        if (c->buf == NULL || c->buf->in_file || !mln_buf_left_size(c->buf)) continue;
+        return mln_buf_left_size(c->buf) >= n? c->buf->left_pos: NULL;
+    }
+    return NULL;
+}
+
+int mln_http2_parse(mln_http2_t *h2, mln_chain_t **in)
+{
+    mln_chain_t *c;
+    mln_u8_t hdr[M_HTTP2_FRAME_HEADER_LEN];
+    mln_u8ptr_t payload, tmp;
+    mln_size_t size = mln_http2_chain_size(*in), len;
+    int ret = M_HTTP2_RET_OK;
+
+    if (!h2->preface) {
+        mln_u8_t preface[M_HTTP2_PREFACE_LEN];
+
+        if (size < M_HTTP2_PREFACE_LEN) return M_HTTP2_RET_OK;
+        mln_http2_chain_copy(*in, preface, M_HTTP2_PREFACE_LEN);
+        if (memcmp(preface, mln_http2_preface, M_HTTP2_PREFACE_LEN)) {
+            ret = mln_http2_error_set(h2, M_HTTP2_PROTOCOL_ERROR);
+            goto out;
+        }
+        mln_http2_chain_skip(*in, M_HTTP2_PREFACE_LEN);
+        size -= M_HTTP2_PREFACE_LEN;
+        h2->preface = 1;
+    }
+
+    while (size >= M_HTTP2_FRAME_HEADER_LEN) {
+        mln_http2_chain_copy(*in, hdr, M_HTTP2_FRAME_HEADER_LEN);
+        len = ((mln_size_t)hdr[0] << 16) | ((mln_size_t)hdr[1] << 8) | hdr[2];
+        if (len > h2->local.max_frame_size) {
+            ret = mln_http2_error_set(h2, M_HTTP2_FRAME_SIZE_ERROR);
+            break;
+        }
+        if (size < M_HTTP2_FRAME_HEADER_LEN + len) break;
+
+        mln_http2_chain_skip(*in, M_HTTP2_FRAME_HEADER_LEN);
+        tmp = payload = NULL;
+        if (len && (payload = mln_http2_chain_contiguous(*in, len)) == NULL) {
+            if ((payload = tmp = (mln_u8ptr_t)mln_alloc_m(h2->pool, len)) == NULL) {
+                ret = mln_http2_error_set(h2, M_HTTP2_INTERNAL_ERROR);
+                break;
+            }
+            mln_http2_chain_copy(*in, payload, len);
+        }
+        mln_http2_chain_skip(*in, len);
+        size -= M_HTTP2_FRAME_HEADER_LEN + len;
+
+        ret = mln_http2_frame_process(h2, hdr[3], hdr[4], mln_http2_get_u32(hdr + 5) & 0x7fffffff, payload, len);
+        if (tmp != NULL) mln_alloc_free(tmp);
+        if (ret != M_HTTP2_RET_OK) break;
+    }
+
+out:
+    for (c = *in; c != NULL; c = c->next) {
+        if (c->buf == NULL || c->buf->in_file || mln_buf_left_size(c->buf) == 0) continue;
+        break;
+    }
+    if (c == NULL) {
+        mln_chain_pool_release_all(*in);
+        *in = NULL;
+    } else if (c != *in) {
+        mln_chain_t *tmpc = *in;
+        *in = c;
+        for (c = tmpc; c->next != *in; c = c->next)
+            ;
+        c->next = NULL;
+        mln_chain_pool_release_all(tmpc);
+    }
+
+    if (ret == M_HTTP2_RET_ERROR && !h2->goaway_sent)
+        mln_http2_goaway_generate(h2, h2->error);
+    return ret;
+}
+
+static int mln_http2_frame_process(mln_http2_t *h2, mln_u8_t type, mln_u8_t flags, mln_u32_t id, mln_u8ptr_t payload, mln_size_t len)
+{
+    /*a header block must not be interleaved with any other frame*/
+    if (h2->hblock_stream && (type != M_HTTP2_FRAME_CONTINUATION || id != h2->hblock_stream))
+        return mln_http2_error_set(h2, M_HTTP2_PROTOCOL_ERROR);
+
+    switch (type) {
+        case M_HTTP2_FRAME_DATA:
+            return mln_http2_frame_data(h2, flags, id, payload, len);
+        case M_HTTP2_FRAME_HEADERS:
+            return mln_http2_frame_headers(h2, flags, id, payload, len);
+        case M_HTTP2_FRAME_PRIORITY:
+            if (!id) return mln_http2_error_set(h2, M_HTTP2_PROTOCOL_ERROR);
+            if (len != 5) return mln_http2_error_set(h2, M_HTTP2_FRAME_SIZE_ERROR);
+            return M_HTTP2_RET_OK;
+        case M_HTTP2_FRAME_RST_STREAM:
+            return mln_http2_frame_rst_stream(h2, id, payload, len);
+        case M_HTTP2_FRAME_SETTINGS:
+            return mln_http2_frame_settings(h2, flags, id, payload, len);
+        case M_HTTP2_FRAME_PUSH_PROMISE:
+            /*push is disabled by local settings*/
+            return mln_http2_error_set(h2, M_HTTP2_PROTOCOL_ERROR);
+        case M_HTTP2_FRAME_PING:
+            return mln_http2_frame_ping(h2, flags, id, payload, len);
+        case M_HTTP2_FRAME_GOAWAY:
+            return mln_http2_frame_goaway(h2, id, payload, len);
+        case M_HTTP2_FRAME_WINDOW_UPDATE:
+            return mln_http2_frame_window_update(h2, id, payload, len);
+        case M_HTTP2_FRAME_CONTINUATION:
+            return mln_http2_frame_continuation(h2, flags, id, payload, len);
+        default:
+            /*unknown frame types must be ignored*/
+            return M_HTTP2_RET_OK;
+    }
+}
+
+static int mln_http2_frame_data(mln_http2_t *h2, mln_u8_t flags, mln_u32_t id, mln_u8ptr_t payload, mln_size_t len)
+{
+    mln_http2_stream_t *stream;
+    mln_size_t pad = 0;
+    int end_stream = flags & M_HTTP2_FLAG_END_STREAM;
+
+    if (!id) return mln_http2_error_set(h2, M_HTTP2_PROTOCOL_ERROR);
+    if (flags & M_HTTP2_FLAG_PADDED) {
+        if (!len || (pad = payload[0]) >= len) return mln_http2_error_set(h2, M_HTTP2_PROTOCOL_ERROR);
+    }
+
+    /*the whole frame is counted in flow control, padding included*/
+    h2->recv_window -= len;
+    if (h2->recv_window < 0) return mln_http2_error_set(h2, M_HTTP2_FLOW_CONTROL_ERROR);
+    if (h2->recv_window <= M_HTTP2_DEFAULT_WINDOW_SIZE / 2) {
+        if (mln_http2_window_update_generate(h2, NULL, M_HTTP2_DEFAULT_WINDOW_SIZE - h2->recv_window) != M_HTTP2_RET_OK)
+            return mln_http2_error_set(h2, M_HTTP2_INTERNAL_ERROR);
+    }
+
+    if ((stream = mln_http2_stream_search(h2, id)) == NULL) {
+        if (mln_http2_peer_stream(h2, id)? id > h2->last_peer_id: id >= h2->next_id)
+            return mln_http2_error_set(h2, M_HTTP2_PROTOCOL_ERROR);
+        if (mln_http2_rst_send(h2, id, M_HTTP2_STREAM_CLOSED) != M_HTTP2_RET_OK)
+            return mln_http2_error_set(h2, M_HTTP2_INTERNAL_ERROR);
+        return M_HTTP2_RET_OK;
+    }
+    if (stream->state != M_HTTP2_STATE_OPEN && stream->state != M_HTTP2_STATE_HALF_CLOSED_LOCAL) {
+        if (mln_http2_rst_stream_generate(h2, stream, M_HTTP2_STREAM_CLOSED) != M_HTTP2_RET_OK)
+            return mln_http2_error_set(h2, M_HTTP2_INTERNAL_ERROR);
+        return M_HTTP2_RET_OK;
+    }
+
+    stream->recv_window -= len;
+    if (stream->recv_window < 0) {
+        if (mln_http2_rst_stream_generate(h2, stream, M_HTTP2_FLOW_CONTROL_ERROR) != M_HTTP2_RET_OK)
+            return mln_http2_error_set(h2, M_HTTP2_INTERNAL_ERROR);
+        return M_HTTP2_RET_OK;
+    }
+
+    if (h2->data_handler != NULL) {
+        if (flags & M_HTTP2_FLAG_PADDED) {
+            ++payload;
+            len -= pad + 1;
+        }
+        if (h2->data_handler(h2, stream, payload, len, end_stream) != M_HTTP2_RET_OK) {
+            if (mln_http2_rst_stream_generate(h2, stream, M_HTTP2_CANCEL) != M_HTTP2_RET_OK)
+                return mln_http2_error_set(h2, M_HTTP2_INTERNAL_ERROR);
+            return M_HTTP2_RET_OK;
+        }
+    }
+
+    if (end_stream) {
+        mln_http2_stream_end_remote(h2, stream);
+    } else if (stream->recv_window <= h2->local.initial_window_size / 2) {
+        if (mln_http2_window_update_generate(h2, stream, h2->local.initial_window_size - stream->recv_window) != M_HTTP2_RET_OK)
+            return mln_http2_error_set(h2, M_HTTP2_INTERNAL_ERROR);
+    }
+    return M_HTTP2_RET_OK;
+}
+
+static int mln_http2_frame_headers(mln_http2_t *h2, mln_u8_t flags, mln_u32_t id, mln_u8ptr_t payload, mln_size_t len)
+{
+    mln_size_t pad = 0;
+
+    if (!id) return mln_http2_error_set(h2, M_HTTP2_PROTOCOL_ERROR);
+    if (flags & M_HTTP2_FLAG_PADDED) {
+        if (!len) return mln_http2_error_set(h2, M_HTTP2_PROTOCOL_ERROR);
+        pad = payload[0];
+        ++payload;
+        --len;
+    }
+    if (flags & M_HTTP2_FLAG_PRIORITY) {
+        if (len < 5) return mln_http2_error_set(h2, M_HTTP2_FRAME_SIZE_ERROR);
+        payload += 5;
+        len -= 5;
+    }
+    if (pad > len) return mln_http2_error_set(h2, M_HTTP2_PROTOCOL_ERROR);
+    len -= pad;
+
+    if (flags & M_HTTP2_FLAG_END_HEADERS)
+        return mln_http2_hblock_process(h2, id, payload, len, flags & M_HTTP2_FLAG_END_STREAM);
+
+    h2->hblock_len = 0;
+    if (mln_http2_hblock_append(h2, payload, len) != M_HTTP2_RET_OK) return M_HTTP2_RET_ERROR;
+    h2->hblock_stream = id;
+    h2->hblock_end_stream = (flags & M_HTTP2_FLAG_END_STREAM)? 1: 0;
+    return M_HTTP2_RET_OK;
+}
+
+static int mln_http2_frame_continuation(mln_http2_t *h2, mln_u8_t flags, mln_u32_t id, mln_u8ptr_t payload, mln_size_t len)
+{
+    if (!h2->hblock_stream) return mln_http2_error_set(h2, M_HTTP2_PROTOCOL_ERROR);
+    if (mln_http2_hblock_append(h2, payload, len) != M_HTTP2_RET_OK) return M_HTTP2_RET_ERROR;
+    if (!(flags & M_HTTP2_FLAG_END_HEADERS)) return M_HTTP2_RET_OK;
+
+    h2->hblock_stream = 0;
+    return mln_http2_hblock_process(h2, id, h2->hblock, h2->hblock_len, h2->hblock_end_stream);
+}
+
+static int mln_http2_hblock_append(mln_http2_t *h2, mln_u8ptr_t buf, mln_size_t len)
+{
+    mln_u8ptr_t p;
+    mln_size_t size;
+
+    if (h2->hblock_len + len > h2->local.max_header_list_size)
+        return mln_http2_error_set(h2, M_HTTP2_ENHANCE_YOUR_CALM);
+    if (h2->hblock_len + len > h2->hblock_size) {
+        size = h2->hblock_size? h2->hblock_size: 1024;
+        while (size < h2->hblock_len + len) size <<= 1;
+        if ((p = (mln_u8ptr_t)mln_alloc_m(h2->pool, size)) == NULL)
+            return mln_http2_error_set(h2, M_HTTP2_INTERNAL_ERROR);
+        if (h2->hblock != NULL) {
+            memcpy(p, h2->hblock, h2->hblock_len);
+            mln_alloc_free(h2->hblock);
+        }
+        h2->hblock = p;
+        h2->hblock_size = size;
+    }
+    memcpy(h2->hblock + h2->hblock_len, buf, len);
+    h2->hblock_len += len;
+    return M_HTTP2_RET_OK;
+}
+
+static int mln_http2_hblock_process(mln_http2_t *h2, mln_u32_t id, mln_u8ptr_t buf, mln_size_t len, int end_stream)
+{
+    mln_http2_stream_t *stream = mln_http2_stream_search(h2, id);
+    mln_u32_t rst = M_HTTP2_NO_ERROR;
+    mln_array_t *fields = NULL;
+    struct mln_array_attr attr;
+    int ret;
+
+    if (stream == NULL) {
+        if (!mln_http2_peer_stream(h2, id)) {
+            if (id >= h2->next_id) return mln_http2_error_set(h2, M_HTTP2_PROTOCOL_ERROR);
+            rst = M_HTTP2_STREAM_CLOSED;
+        } else if (h2->type == M_HTTP2_CLIENT) {
+            /*server push is not supported*/
+            return mln_http2_error_set(h2, M_HTTP2_PROTOCOL_ERROR);
+        } else if (id <= h2->last_peer_id) {
+            rst = M_HTTP2_STREAM_CLOSED;
+        } else {
+            h2->last_peer_id = id;
+            if (h2->goaway_sent || h2->nr_streams >= h2->local.max_concurrent_streams)
+                rst = M_HTTP2_REFUSED_STREAM;
+            else if ((stream = mln_http2_stream_create(h2, id)) == NULL)
+                return mln_http2_error_set(h2, M_HTTP2_INTERNAL_ERROR);
+        }
+    } else if (stream->state != M_HTTP2_STATE_OPEN && stream->state != M_HTTP2_STATE_HALF_CLOSED_LOCAL) {
+        rst = M_HTTP2_STREAM_CLOSED;
+    }
+
+    /*the header block is always decoded to keep the HPACK context in sync*/
+    if (rst != M_HTTP2_NO_ERROR) {
+        attr.pool = h2->pool;
+        attr.pool_alloc = (array_pool_alloc_handler)mln_alloc_m;
+        attr.pool_free = (array_pool_free_handler)mln_alloc_free;
+        attr.free = mln_http2_field_free;
+        attr.size = sizeof(mln_http2_field_t);
+        attr.nalloc = 8;
+        if ((fields = mln_array_new(&attr)) == NULL)
+            return mln_http2_error_set(h2, M_HTTP2_INTERNAL_ERROR);
+    }
+    ret = mln_http2_hpack_decode(&h2->decoder, buf, len, fields != NULL? fields: stream->fields);
+    if (fields != NULL) mln_array_free(fields);
+    if (ret != M_HTTP2_RET_OK) return mln_http2_error_set(h2, M_HTTP2_COMPRESSION_ERROR);
+
+    if (rst != M_HTTP2_NO_ERROR) {
+        if (stream != NULL) ret = mln_http2_rst_stream_generate(h2, stream, rst);
+        else ret = mln_http2_rst_send(h2, id, rst);
+        if (ret != M_HTTP2_RET_OK) return mln_http2_error_set(h2, M_HTTP2_INTERNAL_ERROR);
+        return M_HTTP2_RET_OK;
+    }
+
+    if (stream->state == M_HTTP2_STATE_IDLE) stream->state = M_HTTP2_STATE_OPEN;
+    if (h2->headers_handler != NULL && h2->headers_handler(h2, stream, end_stream) != M_HTTP2_RET_OK) {
+        if (mln_http2_rst_stream_generate(h2, stream, M_HTTP2_CANCEL) != M_HTTP2_RET_OK)
+            return mln_http2_error_set(h2, M_HTTP2_INTERNAL_ERROR);
+        return M_HTTP2_RET_OK;
+    }
+    if (end_stream) mln_http2_stream_end_remote(h2, stream);
+    return M_HTTP2_RET_OK;
+}
+
+static int mln_http2_frame_rst_stream(mln_http2_t *h2, mln_u32_t id, mln_u8ptr_t payload, mln_size_t len)
+{
+    mln_http2_stream_t *stream;
+
+    if (!id) return mln_http2_error_set(h2, M_HTTP2_PROTOCOL_ERROR);
+    if (len != 4) return mln_http2_error_set(h2, M_HTTP2_FRAME_SIZE_ERROR);
+    if ((stream = mln_http2_stream_search(h2, id)) == NULL) {
+        if (mln_http2_peer_stream(h2, id)? id > h2->last_peer_id: id >= h2->next_id)
+            return mln_http2_error_set(h2, M_HTTP2_PROTOCOL_ERROR);
+        return M_HTTP2_RET_OK;
+    }
+    if (stream->state == M_HTTP2_STATE_IDLE)
+        return mln_http2_error_set(h2, M_HTTP2_PROTOCOL_ERROR);
+    mln_http2_stream_close(h2, stream, mln_http2_get_u32(payload));
+    return M_HTTP2_RET_OK;
+}
+
+static int mln_http2_frame_settings(mln_http2_t *h2, mln_u8_t flags, mln_u32_t id, mln_u8ptr_t payload, mln_size_t len)
+{
+    mln_u8ptr_t p, end = payload + len;
+    mln_u32_t key, val;
+    mln_s64_t delta = 0;
+    mln_rbtree_node_t *rn, *next;
+    mln_chain_t *c;
+
+    if (id) return mln_http2_error_set(h2, M_HTTP2_PROTOCOL_ERROR);
+    if (flags & M_HTTP2_FLAG_ACK) {
+        if (len) return mln_http2_error_set(h2, M_HTTP2_FRAME_SIZE_ERROR);
+        mln_http2_hpack_size_set(&h2->decoder, h2->local.header_table_size);
+        return M_HTTP2_RET_OK;
+    }
+    if (len % 6) return mln_http2_error_set(h2, M_HTTP2_FRAME_SIZE_ERROR);
+
+    for (p = payload; p < end; p += 6) {
+        key = ((mln_u32_t)p[0] << 8) | p[1];
+        val = mln_http2_get_u32(p + 2);
+        switch (key) {
+            case M_HTTP2_SETTINGS_HEADER_TABLE_SIZE:
+                h2->remote.header_table_size = val;
+                /*the encoder does not need a table larger than the default one*/
+                mln_http2_hpack_size_set(&h2->encoder, val > M_HTTP2_DEFAULT_TABLE_SIZE? M_HTTP2_DEFAULT_TABLE_SIZE: val);
+                break;
+            case M_HTTP2_SETTINGS_ENABLE_PUSH:
+                if (val > 1 || (val && h2->type == M_HTTP2_CLIENT))
+                    return mln_http2_error_set(h2, M_HTTP2_PROTOCOL_ERROR);
+                h2->remote.enable_push = val;
+                break;
+            case M_HTTP2_SETTINGS_MAX_CONCURRENT:
+                h2->remote.max_concurrent_streams = val;
+                break;
+            case M_HTTP2_SETTINGS_INITIAL_WINDOW_SIZE:
+                if (val > M_HTTP2_MAX_WINDOW_SIZE)
+                    return mln_http2_error_set(h2, M_HTTP2_FLOW_CONTROL_ERROR);
+                delta = (mln_s64_t)val - h2->remote.initial_window_size;
+                h2->remote.initial_window_size = val;
+                for (rn = h2->streams->head; rn != NULL; rn = rn->next) {
+                    mln_http2_stream_t *s = (mln_http2_stream_t *)mln_rbtree_node_data_get(rn);
+                    s->send_window += delta;
+                    if (s->send_window > M_HTTP2_MAX_WINDOW_SIZE)
+                        return mln_http2_error_set(h2, M_HTTP2_FLOW_CONTROL_ERROR);
+                }
+                break;
+            case M_HTTP2_SETTINGS_MAX_FRAME_SIZE:
+                if (val < M_HTTP2_DEFAULT_FRAME_SIZE || val > M_HTTP2_MAX_FRAME_SIZE)
+                    return mln_http2_error_set(h2, M_HTTP2_PROTOCOL_ERROR);
+                h2->remote.max_frame_size = val;
+                break;
+            case M_HTTP2_SETTINGS_MAX_HEADER_LIST_SIZE:
+                h2->remote.max_header_list_size = val;
+                break;
+            default:
+                /*unknown settings must be ignored*/
+                break;
+        }
+    }
+
+    if ((c = mln_http2_frame_new(h2, 0, M_HTTP2_FRAME_SETTINGS, M_HTTP2_FLAG_ACK, 0, NULL)) == NULL)
+        return mln_http2_error_set(h2, M_HTTP2_INTERNAL_ERROR);
+    mln_tcp_conn_append(h2->connection, c, M_C_SEND);
+
+    if (delta > 0 && h2->window_handler != NULL) {
+        for (rn = h2->streams->head; rn != NULL; rn = next) {
+            mln_http2_stream_t *s = (mln_http2_stream_t *)mln_rbtree_node_data_get(rn);
+            next = rn->next;
+            if (s->send_window > 0) h2->window_handler(h2, s);
+        }
+    }
+    return M_HTTP2_RET_OK;
+}
+
+static int mln_http2_frame_ping(mln_http2_t *h2, mln_u8_t flags, mln_u32_t id, mln_u8ptr_t payload, mln_size_t len)
+{
+    if (id) return mln_http2_error_set(h2, M_HTTP2_PROTOCOL_ERROR);
+    if (len != 8) return mln_http2_error_set(h2, M_HTTP2_FRAME_SIZE_ERROR);
+    if (flags & M_HTTP2_FLAG_ACK) return M_HTTP2_RET_OK;
+    if (mln_http2_ping_generate(h2, payload, 1) != M_HTTP2_RET_OK)
+        return mln_http2_error_set(h2, M_HTTP2_INTERNAL_ERROR);
+    return M_HTTP2_RET_OK;
+}
+
+static int mln_http2_frame_goaway(mln_http2_t *h2, mln_u32_t id, mln_u8ptr_t payload, mln_size_t len)
+{
+    if (id) return mln_http2_error_set(h2, M_HTTP2_PROTOCOL_ERROR);
+    if (len < 8) return mln_http2_error_set(h2, M_HTTP2_FRAME_SIZE_ERROR);
+    h2->goaway_recv = 1;
+    h2->error = mln_http2_get_u32(payload + 4);
+    return M_HTTP2_RET_DONE;
+}
+
+static int mln_http2_frame_window_update(mln_http2_t *h2, mln_u32_t id, mln_u8ptr_t payload, mln_size_t len)
+{
+    mln_http2_stream_t *stream;
+    mln_u32_t increment;
+
+    if (len != 4) return mln_http2_error_set(h2, M_HTTP2_FRAME_SIZE_ERROR);
+    increment = mln_http2_get_u32(payload) & 0x7fffffff;
+
+    if (!id) {
+        if (!increment) return mln_http2_error_set(h2, M_HTTP2_PROTOCOL_ERROR);
+        h2->send_window += increment;
+        if (h2->send_window > M_HTTP2_MAX_WINDOW_SIZE)
+            return mln_http2_error_set(h2, M_HTTP2_FLOW_CONTROL_ERROR);
+        if (h2->window_handler != NULL) h2->window_handler(h2, NULL);
+        return M_HTTP2_RET_OK;
+    }
+
+    if ((stream = mln_http2_stream_search(h2, id)) == NULL) {
+        if (mln_http2_peer_stream(h2, id)? id > h2->last_peer_id: id >= h2->next_id)
+            return mln_http2_error_set(h2, M_HTTP2_PROTOCOL_ERROR);
+        return M_HTTP2_RET_OK;
+    }
+    if (!increment) {
+        if (mln_http2_rst_stream_generate(h2, stream, M_HTTP2_PROTOCOL_ERROR) != M_HTTP2_RET_OK)
+            return mln_http2_error_set(h2, M_HTTP2_INTERNAL_ERROR);
+        return M_HTTP2_RET_OK;
+    }
+    stream->send_window += increment;
+    if (stream->send_window > M_HTTP2_MAX_WINDOW_SIZE) {
+        if (mln_http2_rst_stream_generate(h2, stream, M_HTTP2_FLOW_CONTROL_ERROR) != M_HTTP2_RET_OK)
+            return mln_http2_error_set(h2, M_HTTP2_INTERNAL_ERROR);
+        return M_HTTP2_RET_OK;
+    }
+    if (h2->window_handler != NULL) h2->window_handler(h2, stream);
+    return M_HTTP2_RET_OK;
+}
+
@@ -18,6 +18,10 @@
 static inline void mln_iothread_fd_nonblock_set(int fd);
 static inline mln_iothread_msg_t *mln_iothread_msg_new(mln_u32_t type, void *data, int feedback);
 static inline void mln_iothread_msg_free(mln_iothread_msg_t *msg);
+static inline void
+mln_iothread_msg_process(mln_iothread_t *t, mln_iothread_ep_type_t from, mln_iothread_msg_t *msg);
+static inline int
+mln_iothread_ring_process(mln_iothread_t *t, mln_iothread_ep_type_t from, mln_ring_t *ring);
 MLN_CHAIN_FUNC_DECLARE(mln_iothread_msg, mln_iothread_msg_t, static inline void,);
 MLN_CHAIN_FUNC_DEFINE(mln_iothread_msg, mln_iothread_msg_t, static inline void, prev, next);
 
@@ -44,9 +48,28 @@ int mln_iothread_init(mln_iothread_t *t, struct mln_iothread_attr *attr)
     pthread_mutex_init(&(t->user_lock), NULL);
     t->io_head = t->io_tail = NULL;
     t->user_head = t->user_tail = NULL;
+    t->io_pending = t->user_pending = 0;
+    t->io_overflow = t->user_overflow = 0;
     t->nthread = attr->nthread;
+    t->tids = NULL;
+
+    /*
+     * The handlers of each side are serialized by its lock,
+     * so there is only one consumer at a time.
+     */
+    t->io_ring = mln_ring_new(M_RING_MPSC, M_IOTHREAD_RING_LEN);
+    t->user_ring = mln_ring_new(M_RING_MPSC, M_IOTHREAD_RING_LEN);
+    if (t->io_ring == NULL || t->user_ring == NULL) {
+        mln_ring_free(t->io_ring);
+        mln_ring_free(t->user_ring);
+        mln_socket_close(fds[0]);
+        mln_socket_close(fds[1]);
+        return -1;
+    }
 
     if ((t->tids = (pthread_t *)calloc(t->nthread, sizeof(pthread_t))) == NULL) {
+        mln_ring_free(t->io_ring);
+        mln_ring_free(t->user_ring);
         mln_socket_close(fds[0]);
         mln_socket_close(fds[1]);
         return -1;
@@ -76,27 +99,37 @@ void mln_iothread_destroy(mln_iothread_t *t)
         }
         free(t->tids);
     }
+    mln_ring_free(t->io_ring);
+    mln_ring_free(t->user_ring);
     mln_socket_close(t->io_fd);
     mln_socket_close(t->user_fd);
 }
 
 int mln_iothread_send(mln_iothread_t *t, mln_u32_t type, void *data, mln_iothread_ep_type_t to, mln_u32_t feedback)
 {
-    int fd;
+    int fd, wakeup = 1;
     pthread_mutex_t *plock;
     mln_iothread_msg_t *msg;
     mln_iothread_msg_t **head, **tail;
+    mln_ring_t *ring;
+    mln_u32_t *pending, *overflow;
 
     if (to == io_thread) {
         fd = t->user_fd;
         plock = &(t->io_lock);
         head = &(t->io_head);
         tail = &(t->io_tail);
+        ring = t->io_ring;
+        pending = &(t->io_pending);
+        overflow = &(t->io_overflow);
     } else {
         fd = t->io_fd;
         plock = &(t->user_lock);
         head = &(t->user_head);
         tail = &(t->user_tail);
+        ring = t->user_ring;
+        pending = &(t->user_pending);
+        overflow = &(t->user_overflow);
     }
 
     if ((msg = mln_iothread_msg_new(type, data, feedback)) == NULL)
@@ -105,19 +138,30 @@ int mln_iothread_send(mln_iothread_t *t, mln_u32_t type, void *data, mln_iothrea
     if (feedback)
         pthread_mutex_lock(&(msg->mutex));
 
-    pthread_mutex_lock(plock);
-
-    mln_iothread_msg_chain_add(head, tail, msg);
-
-    if (*head == *tail && *head == msg && send(fd, " ", 1, 0) != 1) {
-        mln_iothread_msg_chain_del(head, tail, msg);
-        if (feedback) pthread_mutex_unlock(&(msg->mutex));
+    /*
+     * Once a message went to the list, the following ones go there too
+     * until the receiver empties it, so the messages of a sender keep their order.
+     */
+    if (__atomic_load_n(overflow, __ATOMIC_ACQUIRE) || mln_ring_push(ring, msg) < 0) {
+        pthread_mutex_lock(plock);
+        mln_iothread_msg_chain_add(head, tail, msg);
+        wakeup = *head == msg;
+        __atomic_store_n(overflow, 1, __ATOMIC_RELEASE);
         pthread_mutex_unlock(plock);
-        mln_iothread_msg_free(msg);
-        return 1;
     }
 
-    pthread_mutex_unlock(plock);
+    /*
+     * Only the first sender after the receiver cleared pending writes a byte.
+     * If the socket buffer is full, the receiver has bytes to read anyway.
+     * A message appended to a non-empty list is taken with the messages before it.
+     * The message is queued already, so if writing fails it is not an error,
+     * pending is cleared to let the next sender write the byte instead.
+     */
+    if (wakeup && !__atomic_exchange_n(pending, 1, __ATOMIC_SEQ_CST) \
+        && send(fd, " ", 1, 0) != 1 && errno != EAGAIN && errno != EWOULDBLOCK)
+    {
+        __atomic_store_n(pending, 0, __ATOMIC_RELEASE);
+    }
 
     if (feedback) {
         pthread_mutex_lock(&(msg->mutex));
@@ -128,51 +172,93 @@ int mln_iothread_send(mln_iothread_t *t, mln_u32_t type, void *data, mln_iothrea
     return 0;
 }
 
+static inline void
+mln_iothread_msg_process(mln_iothread_t *t, mln_iothread_ep_type_t from, mln_iothread_msg_t *msg)
+{
+    if (t->handler != NULL)
+        t->handler(t, from, msg);
+    if (msg->feedback) {
+        if (!msg->hold)
+            pthread_mutex_unlock(&(msg->mutex));
+    } else {
+        mln_iothread_msg_free(msg);
+    }
+}
+
+static inline int
+mln_iothread_ring_process(mln_iothread_t *t, mln_iothread_ep_type_t from, mln_ring_t *ring)
+{
+    int n = 0;
+    void *data;
+
+    while (mln_ring_pop(ring, &data) == 0) {
+        mln_iothread_msg_process(t, from, (mln_iothread_msg_t *)data);
+        ++n;
+    }
+    return n;
+}
+
 int mln_iothread_recv(mln_iothread_t *t, mln_iothread_ep_type_t from)
 {
     int fd, n = 0;
-    mln_s8_t c;
+    mln_s8_t buf[64];
     pthread_mutex_t *plock;
-    mln_iothread_msg_t *msg, *pos;
+    mln_iothread_msg_t *msg;
     mln_iothread_msg_t **head, **tail;
+    mln_ring_t *ring;
+    mln_u32_t *pending, *overflow;
 
     if (from == io_thread) {
         fd = t->user_fd;
         plock = &(t->user_lock);
         head = &(t->user_head);
         tail = &(t->user_tail);
+        ring = t->user_ring;
+        pending = &(t->user_pending);
+        overflow = &(t->user_overflow);
     } else {
         fd = t->io_fd;
         plock = &(t->io_lock);
         head = &(t->io_head);
         tail = &(t->io_tail);
+        ring = t->io_ring;
+        pending = &(t->io_pending);
+        overflow = &(t->io_overflow);
     }
 
     pthread_mutex_lock(plock);
 
-    pos = *head;
-    while ((msg = *head) != NULL) {
-        mln_iothread_msg_chain_del(head, tail, msg);
-        if (t->handler != NULL)
-            t->handler(t, from, msg);
-        if (msg->feedback) {
-            if (!msg->hold)
-                pthread_mutex_unlock(&(msg->mutex));
-        } else {
-            mln_iothread_msg_free(msg);
+    /*
+     * pending is cleared before the messages are taken, so a message sent
+     * after this point is either taken below or followed by a new byte.
+     */
+    while (recv(fd, buf, sizeof(buf), 0) == sizeof(buf))
+        ;
+    (void)__atomic_exchange_n(pending, 0, __ATOMIC_SEQ_CST);
+
+    n += mln_iothread_ring_process(t, from, ring);
+    /*
+     * The messages a sender pushed into the ring before it switched to the list
+     * must be handled before the list. Popping stops at a cell claimed by a sender
+     * but not filled yet, and the cells behind it may hold messages sent before
+     * the list ones. So the list is taken only if the ring is empty, otherwise
+     * that sender writes a byte after filling its cell and the list is taken
+     * by a later call.
+     */
+    if (__atomic_load_n(overflow, __ATOMIC_ACQUIRE) && !mln_ring_count(ring)) {
+        while ((msg = *head) != NULL) {
+            mln_iothread_msg_chain_del(head, tail, msg);
+            mln_iothread_msg_process(t, from, msg);
+            ++n;
         }
-        ++n;
+        __atomic_store_n(overflow, 0, __ATOMIC_RELEASE);
     }
 
-    if (pos != *head)
-        (void)recv(fd, &c, 1, 0);
-
     pthread_mutex_unlock(plock);
 
     return n;
 }
 
-
 static inline mln_iothread_msg_t *mln_iothread_msg_new(mln_u32_t type, void *data, int feedback)
 {
     mln_iothread_msg_t *msg = (mln_iothread_msg_t *)malloc(sizeof(mln_iothread_msg_t));
@@ -6,25 +6,869 @@
 #include <ctype.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <float.h>
+#include <math.h>
 #include "mln_json.h"
+#include "mln_hash.h"
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define MLN_JSON_AVX2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define MLN_JSON_NEON
+#endif
 
-static int mln_json_dump_obj_iterate_handler(mln_rbtree_node_t *node, void *data);
-static inline int
-mln_json_parse_json(mln_json_t *j, char *jstr, int len, mln_uauto_t index);
-static inline int
-mln_json_parse_obj(mln_json_t *val, char *jstr, int len, mln_uauto_t index);
-static inline int
-mln_json_parse_array(mln_json_t *val, char *jstr, int len, mln_uauto_t index);
-static inline int
-mln_json_parse_string(mln_json_t *j, char *jstr, int len, mln_uauto_t index);
-static mln_u8ptr_t
-mln_json_parse_string_fetch(mln_u8ptr_t jstr, int *len);
+#define M_JSON_INDEX_LEN        1024
+#define M_JSON_LAZY_INDEX_LEN   32
+#define M_JSON_ODD_BITS         0xaaaaaaaaaaaaaaaaULL
+#define M_JSON_CHAIN_BUF_LEN    4096
+#define M_JSON_INDEFINITE       (~0ULL)/*CBOR containers ended by a break byte*/
+#define M_JSON_DECODE_MAX_DEPTH 1024
+#define M_JSON_PATH_MAX_DEPTH   1024/*nesting levels walked by a path*/
+#define M_JSON_IS_DIGIT(c)      ((mln_u8_t)((c) - '0') < 10)
+#define M_JSON_PATH_IS_NAME(c)  (isalnum(c) || (c) == '_' || (c) >= 0x80)
+
+/*stream states*/
+#define M_JSON_STREAM_S_VALUE   0
+#define M_JSON_STREAM_S_KEY     1
+#define M_JSON_STREAM_S_COLON   2
+#define M_JSON_STREAM_S_NEXT    3
+#define M_JSON_STREAM_S_STRING  4
+#define M_JSON_STREAM_S_SCALAR  5
+#define M_JSON_STREAM_S_DONE    6
+#define M_JSON_STREAM_S_ERROR   7
+
+typedef struct {
+    mln_u64_t                    quote;
+    mln_u64_t                    bs;
+    mln_u64_t                    op;
+    mln_u64_t                    ws;
+} mln_json_masks_t;
+
+typedef struct {
+    mln_u8ptr_t                  data;
+    mln_u64_t                    len;
+    mln_u64_t                    off;/*offset of the next block to be classified*/
+    mln_u64_t                    prev_in_string;
+    mln_u64_t                    prev_escaped;
+    mln_u64_t                    prev_scalar;
+    mln_u32_t                    n;
+    mln_u32_t                    cur;
+    mln_u32_t                    ref;/*strings without escapes refer to the input*/
+    mln_u32_t                    want;/*positions a fill stops at*/
+    mln_u64_t                    pos[M_JSON_INDEX_LEN + 64];
+} mln_json_index_t;
+
+typedef void (*mln_json_classify_handler_t)(mln_u8ptr_t, mln_json_masks_t *);
+
+typedef struct {
+    mln_u64_t                    f;
+    int                          e;
+} mln_json_diyfp_t;
+
+typedef struct mln_json_writer_s mln_json_writer_t;
+typedef int (*mln_json_writer_refill_t)(mln_json_writer_t *, mln_size_t);
+
+struct mln_json_writer_s {
+    mln_u8ptr_t                  start;
+    mln_u8ptr_t                  pos;
+    mln_u8ptr_t                  end;
+    mln_size_t                   len;/*length of the whole output, including the truncated part*/
+    mln_json_writer_refill_t     refill;
+    void                        *data;
+    mln_alloc_t                 *pool;
+    mln_u32_t                    pretty:1;
+    mln_u32_t                    failed:1;
+    mln_u32_t                    depth:30;
+};
+
+typedef struct mln_json_reader_s mln_json_reader_t;
+typedef int (*mln_json_read_handler_t)(mln_json_reader_t *, mln_json_t *);
+
+struct mln_json_reader_s {
+    mln_u8ptr_t                  pos;
+    mln_u8ptr_t                  end;
+    mln_alloc_t                 *pool;
+    mln_json_read_handler_t      read;
+    mln_u32_t                    ref:1;/*strings refer to the input*/
+    mln_u32_t                    depth:31;
+};
+
+/*a member or an element being matched against the selectors of a step*/
+typedef struct {
+    mln_string_t                *key;/*NULL when evaluated on the input*/
+    mln_u8ptr_t                  raw;/*the key still escaped in the input*/
+    mln_u64_t                    rawlen;
+    mln_s64_t                    index;/*-1 for a member*/
+    mln_s64_t                    n;/*the array length*/
+    mln_json_t                  *val;/*NULL when evaluated on the input*/
+    mln_json_lazy_t              lazy;
+} mln_json_path_child_t;
+
+typedef struct {
+    mln_json_path_t             *path;
+    mln_alloc_t                 *pool;
+    mln_json_iterator_t          iterator;
+    void                        *data;
+    int                          count;
+    mln_u32_t                    depth;
+} mln_json_path_ctx_t;
+
+/*
+ * Cached powers 10^k (k = -348, -340, ..., 340) for Grisu, the significands
+ * and the binary exponents.
+ */
+static const mln_u64_t mln_json_cached_powers_f[] = {
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+    0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+    0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+    0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+    0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+    0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+    0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+    0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+    0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+    0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+    0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+    0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+    0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+    0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+    0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+    0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+    0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+    0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+    0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+    0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+    0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+    0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL
+};
+
+static const mln_s16_t mln_json_cached_powers_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+    -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+    -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+    -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+    -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+    109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+    641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066
+};
+
+/*
+ * 5^q (q = -342, ..., 308) for Eisel-Lemire, each normalized to 128 bits and
+ * stored as the high and low halves, the negative powers are rounded up.
+ */
+static const mln_u64_t mln_json_pow5_128[] = {
+    0xeef453d6923bd65aULL, 0x113faa2906a13b3fULL,
+    0x9558b4661b6565f8ULL, 0x4ac7ca59a424c507ULL,
+    0xbaaee17fa23ebf76ULL, 0x5d79bcf00d2df649ULL,
+    0xe95a99df8ace6f53ULL, 0xf4d82c2c107973dcULL,
+    0x91d8a02bb6c10594ULL, 0x79071b9b8a4be869ULL,
+    0xb64ec836a47146f9ULL, 0x9748e2826cdee284ULL,
+    0xe3e27a444d8d98b7ULL, 0xfd1b1b2308169b25ULL,
+    0x8e6d8c6ab0787f72ULL, 0xfe30f0f5e50e20f7ULL,
+    0xb208ef855c969f4fULL, 0xbdbd2d335e51a935ULL,
+    0xde8b2b66b3bc4723ULL, 0xad2c788035e61382ULL,
+    0x8b16fb203055ac76ULL, 0x4c3bcb5021afcc31ULL,
+    0xaddcb9e83c6b1793ULL, 0xdf4abe242a1bbf3dULL,
+    0xd953e8624b85dd78ULL, 0xd71d6dad34a2af0dULL,
+    0x87d4713d6f33aa6bULL, 0x8672648c40e5ad68ULL,
+    0xa9c98d8ccb009506ULL, 0x680efdaf511f18c2ULL,
+    0xd43bf0effdc0ba48ULL, 0x0212bd1b2566def2ULL,
+    0x84a57695fe98746dULL, 0x014bb630f7604b57ULL,
+    0xa5ced43b7e3e9188ULL, 0x419ea3bd35385e2dULL,
+    0xcf42894a5dce35eaULL, 0x52064cac828675b9ULL,
+    0x818995ce7aa0e1b2ULL, 0x7343efebd1940993ULL,
+    0xa1ebfb4219491a1fULL, 0x1014ebe6c5f90bf8ULL,
+    0xca66fa129f9b60a6ULL, 0xd41a26e077774ef6ULL,
+    0xfd00b897478238d0ULL, 0x8920b098955522b4ULL,
+    0x9e20735e8cb16382ULL, 0x55b46e5f5d5535b0ULL,
+    0xc5a890362fddbc62ULL, 0xeb2189f734aa831dULL,
+    0xf712b443bbd52b7bULL, 0xa5e9ec7501d523e4ULL,
+    0x9a6bb0aa55653b2dULL, 0x47b233c92125366eULL,
+    0xc1069cd4eabe89f8ULL, 0x999ec0bb696e840aULL,
+    0xf148440a256e2c76ULL, 0xc00670ea43ca250dULL,
+    0x96cd2a865764dbcaULL, 0x380406926a5e5728ULL,
+    0xbc807527ed3e12bcULL, 0xc605083704f5ecf2ULL,
+    0xeba09271e88d976bULL, 0xf7864a44c633682eULL,
+    0x93445b8731587ea3ULL, 0x7ab3ee6afbe0211dULL,
+    0xb8157268fdae9e4cULL, 0x5960ea05bad82964ULL,
+    0xe61acf033d1a45dfULL, 0x6fb92487298e33bdULL,
+    0x8fd0c16206306babULL, 0xa5d3b6d479f8e056ULL,
+    0xb3c4f1ba87bc8696ULL, 0x8f48a4899877186cULL,
+    0xe0b62e2929aba83cULL, 0x331acdabfe94de87ULL,
+    0x8c71dcd9ba0b4925ULL, 0x9ff0c08b7f1d0b14ULL,
+    0xaf8e5410288e1b6fULL, 0x07ecf0ae5ee44dd9ULL,
+    0xdb71e91432b1a24aULL, 0xc9e82cd9f69d6150ULL,
+    0x892731ac9faf056eULL, 0xbe311c083a225cd2ULL,
+    0xab70fe17c79ac6caULL, 0x6dbd630a48aaf406ULL,
+    0xd64d3d9db981787dULL, 0x092cbbccdad5b108ULL,
+    0x85f0468293f0eb4eULL, 0x25bbf56008c58ea5ULL,
+    0xa76c582338ed2621ULL, 0xaf2af2b80af6f24eULL,
+    0xd1476e2c07286faaULL, 0x1af5af660db4aee1ULL,
+    0x82cca4db847945caULL, 0x50d98d9fc890ed4dULL,
+    0xa37fce126597973cULL, 0xe50ff107bab528a0ULL,
+    0xcc5fc196fefd7d0cULL, 0x1e53ed49a96272c8ULL,
+    0xff77b1fcbebcdc4fULL, 0x25e8e89c13bb0f7aULL,
+    0x9faacf3df73609b1ULL, 0x77b191618c54e9acULL,
+    0xc795830d75038c1dULL, 0xd59df5b9ef6a2417ULL,
+    0xf97ae3d0d2446f25ULL, 0x4b0573286b44ad1dULL,
+    0x9becce62836ac577ULL, 0x4ee367f9430aec32ULL,
+    0xc2e801fb244576d5ULL, 0x229c41f793cda73fULL,
+    0xf3a20279ed56d48aULL, 0x6b43527578c1110fULL,
+    0x9845418c345644d6ULL, 0x830a13896b78aaa9ULL,
+    0xbe5691ef416bd60cULL, 0x23cc986bc656d553ULL,
+    0xedec366b11c6cb8fULL, 0x2cbfbe86b7ec8aa8ULL,
+    0x94b3a202eb1c3f39ULL, 0x7bf7d71432f3d6a9ULL,
+    0xb9e08a83a5e34f07ULL, 0xdaf5ccd93fb0cc53ULL,
+    0xe858ad248f5c22c9ULL, 0xd1b3400f8f9cff68ULL,
+    0x91376c36d99995beULL, 0x23100809b9c21fa1ULL,
+    0xb58547448ffffb2dULL, 0xabd40a0c2832a78aULL,
+    0xe2e69915b3fff9f9ULL, 0x16c90c8f323f516cULL,
+    0x8dd01fad907ffc3bULL, 0xae3da7d97f6792e3ULL,
+    0xb1442798f49ffb4aULL, 0x99cd11cfdf41779cULL,
+    0xdd95317f31c7fa1dULL, 0x40405643d711d583ULL,
+    0x8a7d3eef7f1cfc52ULL, 0x482835ea666b2572ULL,
+    0xad1c8eab5ee43b66ULL, 0xda3243650005eecfULL,
+    0xd863b256369d4a40ULL, 0x90bed43e40076a82ULL,
+    0x873e4f75e2224e68ULL, 0x5a7744a6e804a291ULL,
+    0xa90de3535aaae202ULL, 0x711515d0a205cb36ULL,
+    0xd3515c2831559a83ULL, 0x0d5a5b44ca873e03ULL,
+    0x8412d9991ed58091ULL, 0xe858790afe9486c2ULL,
+    0xa5178fff668ae0b6ULL, 0x626e974dbe39a872ULL,
+    0xce5d73ff402d98e3ULL, 0xfb0a3d212dc8128fULL,
+    0x80fa687f881c7f8eULL, 0x7ce66634bc9d0b99ULL,
+    0xa139029f6a239f72ULL, 0x1c1fffc1ebc44e80ULL,
+    0xc987434744ac874eULL, 0xa327ffb266b56220ULL,
+    0xfbe9141915d7a922ULL, 0x4bf1ff9f0062baa8ULL,
+    0x9d71ac8fada6c9b5ULL, 0x6f773fc3603db4a9ULL,
+    0xc4ce17b399107c22ULL, 0xcb550fb4384d21d3ULL,
+    0xf6019da07f549b2bULL, 0x7e2a53a146606a48ULL,
+    0x99c102844f94e0fbULL, 0x2eda7444cbfc426dULL,
+    0xc0314325637a1939ULL, 0xfa911155fefb5308ULL,
+    0xf03d93eebc589f88ULL, 0x793555ab7eba27caULL,
+    0x96267c7535b763b5ULL, 0x4bc1558b2f3458deULL,
+    0xbbb01b9283253ca2ULL, 0x9eb1aaedfb016f16ULL,
+    0xea9c227723ee8bcbULL, 0x465e15a979c1cadcULL,
+    0x92a1958a7675175fULL, 0x0bfacd89ec191ec9ULL,
+    0xb749faed14125d36ULL, 0xcef980ec671f667bULL,
+    0xe51c79a85916f484ULL, 0x82b7e12780e7401aULL,
+    0x8f31cc0937ae58d2ULL, 0xd1b2ecb8b0908810ULL,
+    0xb2fe3f0b8599ef07ULL, 0x861fa7e6dcb4aa15ULL,
+    0xdfbdcece67006ac9ULL, 0x67a791e093e1d49aULL,
+    0x8bd6a141006042bdULL, 0xe0c8bb2c5c6d24e0ULL,
+    0xaecc49914078536dULL, 0x58fae9f773886e18ULL,
+    0xda7f5bf590966848ULL, 0xaf39a475506a899eULL,
+    0x888f99797a5e012dULL, 0x6d8406c952429603ULL,
+    0xaab37fd7d8f58178ULL, 0xc8e5087ba6d33b83ULL,
+    0xd5605fcdcf32e1d6ULL, 0xfb1e4a9a90880a64ULL,
+    0x855c3be0a17fcd26ULL, 0x5cf2eea09a55067fULL,
+    0xa6b34ad8c9dfc06fULL, 0xf42faa48c0ea481eULL,
+    0xd0601d8efc57b08bULL, 0xf13b94daf124da26ULL,
+    0x823c12795db6ce57ULL, 0x76c53d08d6b70858ULL,
+    0xa2cb1717b52481edULL, 0x54768c4b0c64ca6eULL,
+    0xcb7ddcdda26da268ULL, 0xa9942f5dcf7dfd09ULL,
+    0xfe5d54150b090b02ULL, 0xd3f93b35435d7c4cULL,
+    0x9efa548d26e5a6e1ULL, 0xc47bc5014a1a6dafULL,
+    0xc6b8e9b0709f109aULL, 0x359ab6419ca1091bULL,
+    0xf867241c8cc6d4c0ULL, 0xc30163d203c94b62ULL,
+    0x9b407691d7fc44f8ULL, 0x79e0de63425dcf1dULL,
+    0xc21094364dfb5636ULL, 0x985915fc12f542e4ULL,
+    0xf294b943e17a2bc4ULL, 0x3e6f5b7b17b2939dULL,
+    0x979cf3ca6cec5b5aULL, 0xa705992ceecf9c42ULL,
+    0xbd8430bd08277231ULL, 0x50c6ff782a838353ULL,
+    0xece53cec4a314ebdULL, 0xa4f8bf5635246428ULL,
+    0x940f4613ae5ed136ULL, 0x871b7795e136be99ULL,
+    0xb913179899f68584ULL, 0x28e2557b59846e3fULL,
+    0xe757dd7ec07426e5ULL, 0x331aeada2fe589cfULL,
+    0x9096ea6f3848984fULL, 0x3ff0d2c85def7621ULL,
+    0xb4bca50b065abe63ULL, 0x0fed077a756b53a9ULL,
+    0xe1ebce4dc7f16dfbULL, 0xd3e8495912c62894ULL,
+    0x8d3360f09cf6e4bdULL, 0x64712dd7abbbd95cULL,
+    0xb080392cc4349decULL, 0xbd8d794d96aacfb3ULL,
+    0xdca04777f541c567ULL, 0xecf0d7a0fc5583a0ULL,
+    0x89e42caaf9491b60ULL, 0xf41686c49db57244ULL,
+    0xac5d37d5b79b6239ULL, 0x311c2875c522ced5ULL,
+    0xd77485cb25823ac7ULL, 0x7d633293366b828bULL,
+    0x86a8d39ef77164bcULL, 0xae5dff9c02033197ULL,
+    0xa8530886b54dbdebULL, 0xd9f57f830283fdfcULL,
+    0xd267caa862a12d66ULL, 0xd072df63c324fd7bULL,
+    0x8380dea93da4bc60ULL, 0x4247cb9e59f71e6dULL,
+    0xa46116538d0deb78ULL, 0x52d9be85f074e608ULL,
+    0xcd795be870516656ULL, 0x67902e276c921f8bULL,
+    0x806bd9714632dff6ULL, 0x00ba1cd8a3db53b6ULL,
+    0xa086cfcd97bf97f3ULL, 0x80e8a40eccd228a4ULL,
+    0xc8a883c0fdaf7df0ULL, 0x6122cd128006b2cdULL,
+    0xfad2a4b13d1b5d6cULL, 0x796b805720085f81ULL,
+    0x9cc3a6eec6311a63ULL, 0xcbe3303674053bb0ULL,
+    0xc3f490aa77bd60fcULL, 0xbedbfc4411068a9cULL,
+    0xf4f1b4d515acb93bULL, 0xee92fb5515482d44ULL,
+    0x991711052d8bf3c5ULL, 0x751bdd152d4d1c4aULL,
+    0xbf5cd54678eef0b6ULL, 0xd262d45a78a0635dULL,
+    0xef340a98172aace4ULL, 0x86fb897116c87c34ULL,
+    0x9580869f0e7aac0eULL, 0xd45d35e6ae3d4da0ULL,
+    0xbae0a846d2195712ULL, 0x8974836059cca109ULL,
+    0xe998d258869facd7ULL, 0x2bd1a438703fc94bULL,
+    0x91ff83775423cc06ULL, 0x7b6306a34627ddcfULL,
+    0xb67f6455292cbf08ULL, 0x1a3bc84c17b1d542ULL,
+    0xe41f3d6a7377eecaULL, 0x20caba5f1d9e4a93ULL,
+    0x8e938662882af53eULL, 0x547eb47b7282ee9cULL,
+    0xb23867fb2a35b28dULL, 0xe99e619a4f23aa43ULL,
+    0xdec681f9f4c31f31ULL, 0x6405fa00e2ec94d4ULL,
+    0x8b3c113c38f9f37eULL, 0xde83bc408dd3dd04ULL,
+    0xae0b158b4738705eULL, 0x9624ab50b148d445ULL,
+    0xd98ddaee19068c76ULL, 0x3badd624dd9b0957ULL,
+    0x87f8a8d4cfa417c9ULL, 0xe54ca5d70a80e5d6ULL,
+    0xa9f6d30a038d1dbcULL, 0x5e9fcf4ccd211f4cULL,
+    0xd47487cc8470652bULL, 0x7647c3200069671fULL,
+    0x84c8d4dfd2c63f3bULL, 0x29ecd9f40041e073ULL,
+    0xa5fb0a17c777cf09ULL, 0xf468107100525890ULL,
+    0xcf79cc9db955c2ccULL, 0x7182148d4066eeb4ULL,
+    0x81ac1fe293d599bfULL, 0xc6f14cd848405530ULL,
+    0xa21727db38cb002fULL, 0xb8ada00e5a506a7cULL,
+    0xca9cf1d206fdc03bULL, 0xa6d90811f0e4851cULL,
+    0xfd442e4688bd304aULL, 0x908f4a166d1da663ULL,
+    0x9e4a9cec15763e2eULL, 0x9a598e4e043287feULL,
+    0xc5dd44271ad3cdbaULL, 0x40eff1e1853f29fdULL,
+    0xf7549530e188c128ULL, 0xd12bee59e68ef47cULL,
+    0x9a94dd3e8cf578b9ULL, 0x82bb74f8301958ceULL,
+    0xc13a148e3032d6e7ULL, 0xe36a52363c1faf01ULL,
+    0xf18899b1bc3f8ca1ULL, 0xdc44e6c3cb279ac1ULL,
+    0x96f5600f15a7b7e5ULL, 0x29ab103a5ef8c0b9ULL,
+    0xbcb2b812db11a5deULL, 0x7415d448f6b6f0e7ULL,
+    0xebdf661791d60f56ULL, 0x111b495b3464ad21ULL,
+    0x936b9fcebb25c995ULL, 0xcab10dd900beec34ULL,
+    0xb84687c269ef3bfbULL, 0x3d5d514f40eea742ULL,
+    0xe65829b3046b0afaULL, 0x0cb4a5a3112a5112ULL,
+    0x8ff71a0fe2c2e6dcULL, 0x47f0e785eaba72abULL,
+    0xb3f4e093db73a093ULL, 0x59ed216765690f56ULL,
+    0xe0f218b8d25088b8ULL, 0x306869c13ec3532cULL,
+    0x8c974f7383725573ULL, 0x1e414218c73a13fbULL,
+    0xafbd2350644eeacfULL, 0xe5d1929ef90898faULL,
+    0xdbac6c247d62a583ULL, 0xdf45f746b74abf39ULL,
+    0x894bc396ce5da772ULL, 0x6b8bba8c328eb783ULL,
+    0xab9eb47c81f5114fULL, 0x066ea92f3f326564ULL,
+    0xd686619ba27255a2ULL, 0xc80a537b0efefebdULL,
+    0x8613fd0145877585ULL, 0xbd06742ce95f5f36ULL,
+    0xa798fc4196e952e7ULL, 0x2c48113823b73704ULL,
+    0xd17f3b51fca3a7a0ULL, 0xf75a15862ca504c5ULL,
+    0x82ef85133de648c4ULL, 0x9a984d73dbe722fbULL,
+    0xa3ab66580d5fdaf5ULL, 0xc13e60d0d2e0ebbaULL,
+    0xcc963fee10b7d1b3ULL, 0x318df905079926a8ULL,
+    0xffbbcfe994e5c61fULL, 0xfdf17746497f7052ULL,
+    0x9fd561f1fd0f9bd3ULL, 0xfeb6ea8bedefa633ULL,
+    0xc7caba6e7c5382c8ULL, 0xfe64a52ee96b8fc0ULL,
+    0xf9bd690a1b68637bULL, 0x3dfdce7aa3c673b0ULL,
+    0x9c1661a651213e2dULL, 0x06bea10ca65c084eULL,
+    0xc31bfa0fe5698db8ULL, 0x486e494fcff30a62ULL,
+    0xf3e2f893dec3f126ULL, 0x5a89dba3c3efccfaULL,
+    0x986ddb5c6b3a76b7ULL, 0xf89629465a75e01cULL,
+    0xbe89523386091465ULL, 0xf6bbb397f1135823ULL,
+    0xee2ba6c0678b597fULL, 0x746aa07ded582e2cULL,
+    0x94db483840b717efULL, 0xa8c2a44eb4571cdcULL,
+    0xba121a4650e4ddebULL, 0x92f34d62616ce413ULL,
+    0xe896a0d7e51e1566ULL, 0x77b020baf9c81d17ULL,
+    0x915e2486ef32cd60ULL, 0x0ace1474dc1d122eULL,
+    0xb5b5ada8aaff80b8ULL, 0x0d819992132456baULL,
+    0xe3231912d5bf60e6ULL, 0x10e1fff697ed6c69ULL,
+    0x8df5efabc5979c8fULL, 0xca8d3ffa1ef463c1ULL,
+    0xb1736b96b6fd83b3ULL, 0xbd308ff8a6b17cb2ULL,
+    0xddd0467c64bce4a0ULL, 0xac7cb3f6d05ddbdeULL,
+    0x8aa22c0dbef60ee4ULL, 0x6bcdf07a423aa96bULL,
+    0xad4ab7112eb3929dULL, 0x86c16c98d2c953c6ULL,
+    0xd89d64d57a607744ULL, 0xe871c7bf077ba8b7ULL,
+    0x87625f056c7c4a8bULL, 0x11471cd764ad4972ULL,
+    0xa93af6c6c79b5d2dULL, 0xd598e40d3dd89bcfULL,
+    0xd389b47879823479ULL, 0x4aff1d108d4ec2c3ULL,
+    0x843610cb4bf160cbULL, 0xcedf722a585139baULL,
+    0xa54394fe1eedb8feULL, 0xc2974eb4ee658828ULL,
+    0xce947a3da6a9273eULL, 0x733d226229feea32ULL,
+    0x811ccc668829b887ULL, 0x0806357d5a3f525fULL,
+    0xa163ff802a3426a8ULL, 0xca07c2dcb0cf26f7ULL,
+    0xc9bcff6034c13052ULL, 0xfc89b393dd02f0b5ULL,
+    0xfc2c3f3841f17c67ULL, 0xbbac2078d443ace2ULL,
+    0x9d9ba7832936edc0ULL, 0xd54b944b84aa4c0dULL,
+    0xc5029163f384a931ULL, 0x0a9e795e65d4df11ULL,
+    0xf64335bcf065d37dULL, 0x4d4617b5ff4a16d5ULL,
+    0x99ea0196163fa42eULL, 0x504bced1bf8e4e45ULL,
+    0xc06481fb9bcf8d39ULL, 0xe45ec2862f71e1d6ULL,
+    0xf07da27a82c37088ULL, 0x5d767327bb4e5a4cULL,
+    0x964e858c91ba2655ULL, 0x3a6a07f8d510f86fULL,
+    0xbbe226efb628afeaULL, 0x890489f70a55368bULL,
+    0xeadab0aba3b2dbe5ULL, 0x2b45ac74ccea842eULL,
+    0x92c8ae6b464fc96fULL, 0x3b0b8bc90012929dULL,
+    0xb77ada0617e3bbcbULL, 0x09ce6ebb40173744ULL,
+    0xe55990879ddcaabdULL, 0xcc420a6a101d0515ULL,
+    0x8f57fa54c2a9eab6ULL, 0x9fa946824a12232dULL,
+    0xb32df8e9f3546564ULL, 0x47939822dc96abf9ULL,
+    0xdff9772470297ebdULL, 0x59787e2b93bc56f7ULL,
+    0x8bfbea76c619ef36ULL, 0x57eb4edb3c55b65aULL,
+    0xaefae51477a06b03ULL, 0xede622920b6b23f1ULL,
+    0xdab99e59958885c4ULL, 0xe95fab368e45ecedULL,
+    0x88b402f7fd75539bULL, 0x11dbcb0218ebb414ULL,
+    0xaae103b5fcd2a881ULL, 0xd652bdc29f26a119ULL,
+    0xd59944a37c0752a2ULL, 0x4be76d3346f0495fULL,
+    0x857fcae62d8493a5ULL, 0x6f70a4400c562ddbULL,
+    0xa6dfbd9fb8e5b88eULL, 0xcb4ccd500f6bb952ULL,
+    0xd097ad07a71f26b2ULL, 0x7e2000a41346a7a7ULL,
+    0x825ecc24c873782fULL, 0x8ed400668c0c28c8ULL,
+    0xa2f67f2dfa90563bULL, 0x728900802f0f32faULL,
+    0xcbb41ef979346bcaULL, 0x4f2b40a03ad2ffb9ULL,
+    0xfea126b7d78186bcULL, 0xe2f610c84987bfa8ULL,
+    0x9f24b832e6b0f436ULL, 0x0dd9ca7d2df4d7c9ULL,
+    0xc6ede63fa05d3143ULL, 0x91503d1c79720dbbULL,
+    0xf8a95fcf88747d94ULL, 0x75a44c6397ce912aULL,
+    0x9b69dbe1b548ce7cULL, 0xc986afbe3ee11abaULL,
+    0xc24452da229b021bULL, 0xfbe85badce996168ULL,
+    0xf2d56790ab41c2a2ULL, 0xfae27299423fb9c3ULL,
+    0x97c560ba6b0919a5ULL, 0xdccd879fc967d41aULL,
+    0xbdb6b8e905cb600fULL, 0x5400e987bbc1c920ULL,
+    0xed246723473e3813ULL, 0x290123e9aab23b68ULL,
+    0x9436c0760c86e30bULL, 0xf9a0b6720aaf6521ULL,
+    0xb94470938fa89bceULL, 0xf808e40e8d5b3e69ULL,
+    0xe7958cb87392c2c2ULL, 0xb60b1d1230b20e04ULL,
+    0x90bd77f3483bb9b9ULL, 0xb1c6f22b5e6f48c2ULL,
+    0xb4ecd5f01a4aa828ULL, 0x1e38aeb6360b1af3ULL,
+    0xe2280b6c20dd5232ULL, 0x25c6da63c38de1b0ULL,
+    0x8d590723948a535fULL, 0x579c487e5a38ad0eULL,
+    0xb0af48ec79ace837ULL, 0x2d835a9df0c6d851ULL,
+    0xdcdb1b2798182244ULL, 0xf8e431456cf88e65ULL,
+    0x8a08f0f8bf0f156bULL, 0x1b8e9ecb641b58ffULL,
+    0xac8b2d36eed2dac5ULL, 0xe272467e3d222f3fULL,
+    0xd7adf884aa879177ULL, 0x5b0ed81dcc6abb0fULL,
+    0x86ccbb52ea94baeaULL, 0x98e947129fc2b4e9ULL,
+    0xa87fea27a539e9a5ULL, 0x3f2398d747b36224ULL,
+    0xd29fe4b18e88640eULL, 0x8eec7f0d19a03aadULL,
+    0x83a3eeeef9153e89ULL, 0x1953cf68300424acULL,
+    0xa48ceaaab75a8e2bULL, 0x5fa8c3423c052dd7ULL,
+    0xcdb02555653131b6ULL, 0x3792f412cb06794dULL,
+    0x808e17555f3ebf11ULL, 0xe2bbd88bbee40bd0ULL,
+    0xa0b19d2ab70e6ed6ULL, 0x5b6aceaeae9d0ec4ULL,
+    0xc8de047564d20a8bULL, 0xf245825a5a445275ULL,
+    0xfb158592be068d2eULL, 0xeed6e2f0f0d56712ULL,
+    0x9ced737bb6c4183dULL, 0x55464dd69685606bULL,
+    0xc428d05aa4751e4cULL, 0xaa97e14c3c26b886ULL,
+    0xf53304714d9265dfULL, 0xd53dd99f4b3066a8ULL,
+    0x993fe2c6d07b7fabULL, 0xe546a8038efe4029ULL,
+    0xbf8fdb78849a5f96ULL, 0xde98520472bdd033ULL,
+    0xef73d256a5c0f77cULL, 0x963e66858f6d4440ULL,
+    0x95a8637627989aadULL, 0xdde7001379a44aa8ULL,
+    0xbb127c53b17ec159ULL, 0x5560c018580d5d52ULL,
+    0xe9d71b689dde71afULL, 0xaab8f01e6e10b4a6ULL,
+    0x9226712162ab070dULL, 0xcab3961304ca70e8ULL,
+    0xb6b00d69bb55c8d1ULL, 0x3d607b97c5fd0d22ULL,
+    0xe45c10c42a2b3b05ULL, 0x8cb89a7db77c506aULL,
+    0x8eb98a7a9a5b04e3ULL, 0x77f3608e92adb242ULL,
+    0xb267ed1940f1c61cULL, 0x55f038b237591ed3ULL,
+    0xdf01e85f912e37a3ULL, 0x6b6c46dec52f6688ULL,
+    0x8b61313bbabce2c6ULL, 0x2323ac4b3b3da015ULL,
+    0xae397d8aa96c1b77ULL, 0xabec975e0a0d081aULL,
+    0xd9c7dced53c72255ULL, 0x96e7bd358c904a21ULL,
+    0x881cea14545c7575ULL, 0x7e50d64177da2e54ULL,
+    0xaa242499697392d2ULL, 0xdde50bd1d5d0b9e9ULL,
+    0xd4ad2dbfc3d07787ULL, 0x955e4ec64b44e864ULL,
+    0x84ec3c97da624ab4ULL, 0xbd5af13bef0b113eULL,
+    0xa6274bbdd0fadd61ULL, 0xecb1ad8aeacdd58eULL,
+    0xcfb11ead453994baULL, 0x67de18eda5814af2ULL,
+    0x81ceb32c4b43fcf4ULL, 0x80eacf948770ced7ULL,
+    0xa2425ff75e14fc31ULL, 0xa1258379a94d028dULL,
+    0xcad2f7f5359a3b3eULL, 0x096ee45813a04330ULL,
+    0xfd87b5f28300ca0dULL, 0x8bca9d6e188853fcULL,
+    0x9e74d1b791e07e48ULL, 0x775ea264cf55347eULL,
+    0xc612062576589ddaULL, 0x95364afe032a819eULL,
+    0xf79687aed3eec551ULL, 0x3a83ddbd83f52205ULL,
+    0x9abe14cd44753b52ULL, 0xc4926a9672793543ULL,
+    0xc16d9a0095928a27ULL, 0x75b7053c0f178294ULL,
+    0xf1c90080baf72cb1ULL, 0x5324c68b12dd6339ULL,
+    0x971da05074da7beeULL, 0xd3f6fc16ebca5e04ULL,
+    0xbce5086492111aeaULL, 0x88f4bb1ca6bcf585ULL,
+    0xec1e4a7db69561a5ULL, 0x2b31e9e3d06c32e6ULL,
+    0x9392ee8e921d5d07ULL, 0x3aff322e62439fd0ULL,
+    0xb877aa3236a4b449ULL, 0x09befeb9fad487c3ULL,
+    0xe69594bec44de15bULL, 0x4c2ebe687989a9b4ULL,
+    0x901d7cf73ab0acd9ULL, 0x0f9d37014bf60a11ULL,
+    0xb424dc35095cd80fULL, 0x538484c19ef38c95ULL,
+    0xe12e13424bb40e13ULL, 0x2865a5f206b06fbaULL,
+    0x8cbccc096f5088cbULL, 0xf93f87b7442e45d4ULL,
+    0xafebff0bcb24aafeULL, 0xf78f69a51539d749ULL,
+    0xdbe6fecebdedd5beULL, 0xb573440e5a884d1cULL,
+    0x89705f4136b4a597ULL, 0x31680a88f8953031ULL,
+    0xabcc77118461cefcULL, 0xfdc20d2b36ba7c3eULL,
+    0xd6bf94d5e57a42bcULL, 0x3d32907604691b4dULL,
+    0x8637bd05af6c69b5ULL, 0xa63f9a49c2c1b110ULL,
+    0xa7c5ac471b478423ULL, 0x0fcf80dc33721d54ULL,
+    0xd1b71758e219652bULL, 0xd3c36113404ea4a9ULL,
+    0x83126e978d4fdf3bULL, 0x645a1cac083126eaULL,
+    0xa3d70a3d70a3d70aULL, 0x3d70a3d70a3d70a4ULL,
+    0xccccccccccccccccULL, 0xcccccccccccccccdULL,
+    0x8000000000000000ULL, 0x0000000000000000ULL,
+    0xa000000000000000ULL, 0x0000000000000000ULL,
+    0xc800000000000000ULL, 0x0000000000000000ULL,
+    0xfa00000000000000ULL, 0x0000000000000000ULL,
+    0x9c40000000000000ULL, 0x0000000000000000ULL,
+    0xc350000000000000ULL, 0x0000000000000000ULL,
+    0xf424000000000000ULL, 0x0000000000000000ULL,
+    0x9896800000000000ULL, 0x0000000000000000ULL,
+    0xbebc200000000000ULL, 0x0000000000000000ULL,
+    0xee6b280000000000ULL, 0x0000000000000000ULL,
+    0x9502f90000000000ULL, 0x0000000000000000ULL,
+    0xba43b74000000000ULL, 0x0000000000000000ULL,
+    0xe8d4a51000000000ULL, 0x0000000000000000ULL,
+    0x9184e72a00000000ULL, 0x0000000000000000ULL,
+    0xb5e620f480000000ULL, 0x0000000000000000ULL,
+    0xe35fa931a0000000ULL, 0x0000000000000000ULL,
+    0x8e1bc9bf04000000ULL, 0x0000000000000000ULL,
+    0xb1a2bc2ec5000000ULL, 0x0000000000000000ULL,
+    0xde0b6b3a76400000ULL, 0x0000000000000000ULL,
+    0x8ac7230489e80000ULL, 0x0000000000000000ULL,
+    0xad78ebc5ac620000ULL, 0x0000000000000000ULL,
+    0xd8d726b7177a8000ULL, 0x0000000000000000ULL,
+    0x878678326eac9000ULL, 0x0000000000000000ULL,
+    0xa968163f0a57b400ULL, 0x0000000000000000ULL,
+    0xd3c21bcecceda100ULL, 0x0000000000000000ULL,
+    0x84595161401484a0ULL, 0x0000000000000000ULL,
+    0xa56fa5b99019a5c8ULL, 0x0000000000000000ULL,
+    0xcecb8f27f4200f3aULL, 0x0000000000000000ULL,
+    0x813f3978f8940984ULL, 0x4000000000000000ULL,
+    0xa18f07d736b90be5ULL, 0x5000000000000000ULL,
+    0xc9f2c9cd04674edeULL, 0xa400000000000000ULL,
+    0xfc6f7c4045812296ULL, 0x4d00000000000000ULL,
+    0x9dc5ada82b70b59dULL, 0xf020000000000000ULL,
+    0xc5371912364ce305ULL, 0x6c28000000000000ULL,
+    0xf684df56c3e01bc6ULL, 0xc732000000000000ULL,
+    0x9a130b963a6c115cULL, 0x3c7f400000000000ULL,
+    0xc097ce7bc90715b3ULL, 0x4b9f100000000000ULL,
+    0xf0bdc21abb48db20ULL, 0x1e86d40000000000ULL,
+    0x96769950b50d88f4ULL, 0x1314448000000000ULL,
+    0xbc143fa4e250eb31ULL, 0x17d955a000000000ULL,
+    0xeb194f8e1ae525fdULL, 0x5dcfab0800000000ULL,
+    0x92efd1b8d0cf37beULL, 0x5aa1cae500000000ULL,
+    0xb7abc627050305adULL, 0xf14a3d9e40000000ULL,
+    0xe596b7b0c643c719ULL, 0x6d9ccd05d0000000ULL,
+    0x8f7e32ce7bea5c6fULL, 0xe4820023a2000000ULL,
+    0xb35dbf821ae4f38bULL, 0xdda2802c8a800000ULL,
+    0xe0352f62a19e306eULL, 0xd50b2037ad200000ULL,
+    0x8c213d9da502de45ULL, 0x4526f422cc340000ULL,
+    0xaf298d050e4395d6ULL, 0x9670b12b7f410000ULL,
+    0xdaf3f04651d47b4cULL, 0x3c0cdd765f114000ULL,
+    0x88d8762bf324cd0fULL, 0xa5880a69fb6ac800ULL,
+    0xab0e93b6efee0053ULL, 0x8eea0d047a457a00ULL,
+    0xd5d238a4abe98068ULL, 0x72a4904598d6d880ULL,
+    0x85a36366eb71f041ULL, 0x47a6da2b7f864750ULL,
+    0xa70c3c40a64e6c51ULL, 0x999090b65f67d924ULL,
+    0xd0cf4b50cfe20765ULL, 0xfff4b4e3f741cf6dULL,
+    0x82818f1281ed449fULL, 0xbff8f10e7a8921a4ULL,
+    0xa321f2d7226895c7ULL, 0xaff72d52192b6a0dULL,
+    0xcbea6f8ceb02bb39ULL, 0x9bf4f8a69f764490ULL,
+    0xfee50b7025c36a08ULL, 0x02f236d04753d5b4ULL,
+    0x9f4f2726179a2245ULL, 0x01d762422c946590ULL,
+    0xc722f0ef9d80aad6ULL, 0x424d3ad2b7b97ef5ULL,
+    0xf8ebad2b84e0d58bULL, 0xd2e0898765a7deb2ULL,
+    0x9b934c3b330c8577ULL, 0x63cc55f49f88eb2fULL,
+    0xc2781f49ffcfa6d5ULL, 0x3cbf6b71c76b25fbULL,
+    0xf316271c7fc3908aULL, 0x8bef464e3945ef7aULL,
+    0x97edd871cfda3a56ULL, 0x97758bf0e3cbb5acULL,
+    0xbde94e8e43d0c8ecULL, 0x3d52eeed1cbea317ULL,
+    0xed63a231d4c4fb27ULL, 0x4ca7aaa863ee4bddULL,
+    0x945e455f24fb1cf8ULL, 0x8fe8caa93e74ef6aULL,
+    0xb975d6b6ee39e436ULL, 0xb3e2fd538e122b44ULL,
+    0xe7d34c64a9c85d44ULL, 0x60dbbca87196b616ULL,
+    0x90e40fbeea1d3a4aULL, 0xbc8955e946fe31cdULL,
+    0xb51d13aea4a488ddULL, 0x6babab6398bdbe41ULL,
+    0xe264589a4dcdab14ULL, 0xc696963c7eed2dd1ULL,
+    0x8d7eb76070a08aecULL, 0xfc1e1de5cf543ca2ULL,
+    0xb0de65388cc8ada8ULL, 0x3b25a55f43294bcbULL,
+    0xdd15fe86affad912ULL, 0x49ef0eb713f39ebeULL,
+    0x8a2dbf142dfcc7abULL, 0x6e3569326c784337ULL,
+    0xacb92ed9397bf996ULL, 0x49c2c37f07965404ULL,
+    0xd7e77a8f87daf7fbULL, 0xdc33745ec97be906ULL,
+    0x86f0ac99b4e8dafdULL, 0x69a028bb3ded71a3ULL,
+    0xa8acd7c0222311bcULL, 0xc40832ea0d68ce0cULL,
+    0xd2d80db02aabd62bULL, 0xf50a3fa490c30190ULL,
+    0x83c7088e1aab65dbULL, 0x792667c6da79e0faULL,
+    0xa4b8cab1a1563f52ULL, 0x577001b891185938ULL,
+    0xcde6fd5e09abcf26ULL, 0xed4c0226b55e6f86ULL,
+    0x80b05e5ac60b6178ULL, 0x544f8158315b05b4ULL,
+    0xa0dc75f1778e39d6ULL, 0x696361ae3db1c721ULL,
+    0xc913936dd571c84cULL, 0x03bc3a19cd1e38e9ULL,
+    0xfb5878494ace3a5fULL, 0x04ab48a04065c723ULL,
+    0x9d174b2dcec0e47bULL, 0x62eb0d64283f9c76ULL,
+    0xc45d1df942711d9aULL, 0x3ba5d0bd324f8394ULL,
+    0xf5746577930d6500ULL, 0xca8f44ec7ee36479ULL,
+    0x9968bf6abbe85f20ULL, 0x7e998b13cf4e1ecbULL,
+    0xbfc2ef456ae276e8ULL, 0x9e3fedd8c321a67eULL,
+    0xefb3ab16c59b14a2ULL, 0xc5cfe94ef3ea101eULL,
+    0x95d04aee3b80ece5ULL, 0xbba1f1d158724a12ULL,
+    0xbb445da9ca61281fULL, 0x2a8a6e45ae8edc97ULL,
+    0xea1575143cf97226ULL, 0xf52d09d71a3293bdULL,
+    0x924d692ca61be758ULL, 0x593c2626705f9c56ULL,
+    0xb6e0c377cfa2e12eULL, 0x6f8b2fb00c77836cULL,
+    0xe498f455c38b997aULL, 0x0b6dfb9c0f956447ULL,
+    0x8edf98b59a373fecULL, 0x4724bd4189bd5eacULL,
+    0xb2977ee300c50fe7ULL, 0x58edec91ec2cb657ULL,
+    0xdf3d5e9bc0f653e1ULL, 0x2f2967b66737e3edULL,
+    0x8b865b215899f46cULL, 0xbd79e0d20082ee74ULL,
+    0xae67f1e9aec07187ULL, 0xecd8590680a3aa11ULL,
+    0xda01ee641a708de9ULL, 0xe80e6f4820cc9495ULL,
+    0x884134fe908658b2ULL, 0x3109058d147fdcddULL,
+    0xaa51823e34a7eedeULL, 0xbd4b46f0599fd415ULL,
+    0xd4e5e2cdc1d1ea96ULL, 0x6c9e18ac7007c91aULL,
+    0x850fadc09923329eULL, 0x03e2cf6bc604ddb0ULL,
+    0xa6539930bf6bff45ULL, 0x84db8346b786151cULL,
+    0xcfe87f7cef46ff16ULL, 0xe612641865679a63ULL,
+    0x81f14fae158c5f6eULL, 0x4fcb7e8f3f60c07eULL,
+    0xa26da3999aef7749ULL, 0xe3be5e330f38f09dULL,
+    0xcb090c8001ab551cULL, 0x5cadf5bfd3072cc5ULL,
+    0xfdcb4fa002162a63ULL, 0x73d9732fc7c8f7f6ULL,
+    0x9e9f11c4014dda7eULL, 0x2867e7fddcdd9afaULL,
+    0xc646d63501a1511dULL, 0xb281e1fd541501b8ULL,
+    0xf7d88bc24209a565ULL, 0x1f225a7ca91a4226ULL,
+    0x9ae757596946075fULL, 0x3375788de9b06958ULL,
+    0xc1a12d2fc3978937ULL, 0x0052d6b1641c83aeULL,
+    0xf209787bb47d6b84ULL, 0xc0678c5dbd23a49aULL,
+    0x9745eb4d50ce6332ULL, 0xf840b7ba963646e0ULL,
+    0xbd176620a501fbffULL, 0xb650e5a93bc3d898ULL,
+    0xec5d3fa8ce427affULL, 0xa3e51f138ab4cebeULL,
+    0x93ba47c980e98cdfULL, 0xc66f336c36b10137ULL,
+    0xb8a8d9bbe123f017ULL, 0xb80b0047445d4184ULL,
+    0xe6d3102ad96cec1dULL, 0xa60dc059157491e5ULL,
+    0x9043ea1ac7e41392ULL, 0x87c89837ad68db2fULL,
+    0xb454e4a179dd1877ULL, 0x29babe4598c311fbULL,
+    0xe16a1dc9d8545e94ULL, 0xf4296dd6fef3d67aULL,
+    0x8ce2529e2734bb1dULL, 0x1899e4a65f58660cULL,
+    0xb01ae745b101e9e4ULL, 0x5ec05dcff72e7f8fULL,
+    0xdc21a1171d42645dULL, 0x76707543f4fa1f73ULL,
+    0x899504ae72497ebaULL, 0x6a06494a791c53a8ULL,
+    0xabfa45da0edbde69ULL, 0x0487db9d17636892ULL,
+    0xd6f8d7509292d603ULL, 0x45a9d2845d3c42b6ULL,
+    0x865b86925b9bc5c2ULL, 0x0b8a2392ba45a9b2ULL,
+    0xa7f26836f282b732ULL, 0x8e6cac7768d7141eULL,
+    0xd1ef0244af2364ffULL, 0x3207d795430cd926ULL,
+    0x8335616aed761f1fULL, 0x7f44e6bd49e807b8ULL,
+    0xa402b9c5a8d3a6e7ULL, 0x5f16206c9c6209a6ULL,
+    0xcd036837130890a1ULL, 0x36dba887c37a8c0fULL,
+    0x802221226be55a64ULL, 0xc2494954da2c9789ULL,
+    0xa02aa96b06deb0fdULL, 0xf2db9baa10b7bd6cULL,
+    0xc83553c5c8965d3dULL, 0x6f92829494e5acc7ULL,
+    0xfa42a8b73abbf48cULL, 0xcb772339ba1f17f9ULL,
+    0x9c69a97284b578d7ULL, 0xff2a760414536efbULL,
+    0xc38413cf25e2d70dULL, 0xfef5138519684abaULL,
+    0xf46518c2ef5b8cd1ULL, 0x7eb258665fc25d69ULL,
+    0x98bf2f79d5993802ULL, 0xef2f773ffbd97a61ULL,
+    0xbeeefb584aff8603ULL, 0xaafb550ffacfd8faULL,
+    0xeeaaba2e5dbf6784ULL, 0x95ba2a53f983cf38ULL,
+    0x952ab45cfa97a0b2ULL, 0xdd945a747bf26183ULL,
+    0xba756174393d88dfULL, 0x94f971119aeef9e4ULL,
+    0xe912b9d1478ceb17ULL, 0x7a37cd5601aab85dULL,
+    0x91abb422ccb812eeULL, 0xac62e055c10ab33aULL,
+    0xb616a12b7fe617aaULL, 0x577b986b314d6009ULL,
+    0xe39c49765fdf9d94ULL, 0xed5a7e85fda0b80bULL,
+    0x8e41ade9fbebc27dULL, 0x14588f13be847307ULL,
+    0xb1d219647ae6b31cULL, 0x596eb2d8ae258fc8ULL,
+    0xde469fbd99a05fe3ULL, 0x6fca5f8ed9aef3bbULL,
+    0x8aec23d680043beeULL, 0x25de7bb9480d5854ULL,
+    0xada72ccc20054ae9ULL, 0xaf561aa79a10ae6aULL,
+    0xd910f7ff28069da4ULL, 0x1b2ba1518094da04ULL,
+    0x87aa9aff79042286ULL, 0x90fb44d2f05d0842ULL,
+    0xa99541bf57452b28ULL, 0x353a1607ac744a53ULL,
+    0xd3fa922f2d1675f2ULL, 0x42889b8997915ce8ULL,
+    0x847c9b5d7c2e09b7ULL, 0x69956135febada11ULL,
+    0xa59bc234db398c25ULL, 0x43fab9837e699095ULL,
+    0xcf02b2c21207ef2eULL, 0x94f967e45e03f4bbULL,
+    0x8161afb94b44f57dULL, 0x1d1be0eebac278f5ULL,
+    0xa1ba1ba79e1632dcULL, 0x6462d92a69731732ULL,
+    0xca28a291859bbf93ULL, 0x7d7b8f7503cfdcfeULL,
+    0xfcb2cb35e702af78ULL, 0x5cda735244c3d43eULL,
+    0x9defbf01b061adabULL, 0x3a0888136afa64a7ULL,
+    0xc56baec21c7a1916ULL, 0x088aaa1845b8fdd0ULL,
+    0xf6c69a72a3989f5bULL, 0x8aad549e57273d45ULL,
+    0x9a3c2087a63f6399ULL, 0x36ac54e2f678864bULL,
+    0xc0cb28a98fcf3c7fULL, 0x84576a1bb416a7ddULL,
+    0xf0fdf2d3f3c30b9fULL, 0x656d44a2a11c51d5ULL,
+    0x969eb7c47859e743ULL, 0x9f644ae5a4b1b325ULL,
+    0xbc4665b596706114ULL, 0x873d5d9f0dde1feeULL,
+    0xeb57ff22fc0c7959ULL, 0xa90cb506d155a7eaULL,
+    0x9316ff75dd87cbd8ULL, 0x09a7f12442d588f2ULL,
+    0xb7dcbf5354e9beceULL, 0x0c11ed6d538aeb2fULL,
+    0xe5d3ef282a242e81ULL, 0x8f1668c8a86da5faULL,
+    0x8fa475791a569d10ULL, 0xf96e017d694487bcULL,
+    0xb38d92d760ec4455ULL, 0x37c981dcc395a9acULL,
+    0xe070f78d3927556aULL, 0x85bbe253f47b1417ULL,
+    0x8c469ab843b89562ULL, 0x93956d7478ccec8eULL,
+    0xaf58416654a6babbULL, 0x387ac8d1970027b2ULL,
+    0xdb2e51bfe9d0696aULL, 0x06997b05fcc0319eULL,
+    0x88fcf317f22241e2ULL, 0x441fece3bdf81f03ULL,
+    0xab3c2fddeeaad25aULL, 0xd527e81cad7626c3ULL,
+    0xd60b3bd56a5586f1ULL, 0x8a71e223d8d3b074ULL,
+    0x85c7056562757456ULL, 0xf6872d5667844e49ULL,
+    0xa738c6bebb12d16cULL, 0xb428f8ac016561dbULL,
+    0xd106f86e69d785c7ULL, 0xe13336d701beba52ULL,
+    0x82a45b450226b39cULL, 0xecc0024661173473ULL,
+    0xa34d721642b06084ULL, 0x27f002d7f95d0190ULL,
+    0xcc20ce9bd35c78a5ULL, 0x31ec038df7b441f4ULL,
+    0xff290242c83396ceULL, 0x7e67047175a15271ULL,
+    0x9f79a169bd203e41ULL, 0x0f0062c6e984d386ULL,
+    0xc75809c42c684dd1ULL, 0x52c07b78a3e60868ULL,
+    0xf92e0c3537826145ULL, 0xa7709a56ccdf8a82ULL,
+    0x9bbcc7a142b17ccbULL, 0x88a66076400bb691ULL,
+    0xc2abf989935ddbfeULL, 0x6acff893d00ea435ULL,
+    0xf356f7ebf83552feULL, 0x0583f6b8c4124d43ULL,
+    0x98165af37b2153deULL, 0xc3727a337a8b704aULL,
+    0xbe1bf1b059e9a8d6ULL, 0x744f18c0592e4c5cULL,
+    0xeda2ee1c7064130cULL, 0x1162def06f79df73ULL,
+    0x9485d4d1c63e8be7ULL, 0x8addcb5645ac2ba8ULL,
+    0xb9a74a0637ce2ee1ULL, 0x6d953e2bd7173692ULL,
+    0xe8111c87c5c1ba99ULL, 0xc8fa8db6ccdd0437ULL,
+    0x910ab1d4db9914a0ULL, 0x1d9c9892400a22a2ULL,
+    0xb54d5e4a127f59c8ULL, 0x2503beb6d00cab4bULL,
+    0xe2a0b5dc971f303aULL, 0x2e44ae64840fd61dULL,
+    0x8da471a9de737e24ULL, 0x5ceaecfed289e5d2ULL,
+    0xb10d8e1456105dadULL, 0x7425a83e872c5f47ULL,
+    0xdd50f1996b947518ULL, 0xd12f124e28f77719ULL,
+    0x8a5296ffe33cc92fULL, 0x82bd6b70d99aaa6fULL,
+    0xace73cbfdc0bfb7bULL, 0x636cc64d1001550bULL,
+    0xd8210befd30efa5aULL, 0x3c47f7e05401aa4eULL,
+    0x8714a775e3e95c78ULL, 0x65acfaec34810a71ULL,
+    0xa8d9d1535ce3b396ULL, 0x7f1839a741a14d0dULL,
+    0xd31045a8341ca07cULL, 0x1ede48111209a050ULL,
+    0x83ea2b892091e44dULL, 0x934aed0aab460432ULL,
+    0xa4e4b66b68b65d60ULL, 0xf81da84d5617853fULL,
+    0xce1de40642e3f4b9ULL, 0x36251260ab9d668eULL,
+    0x80d2ae83e9ce78f3ULL, 0xc1d72b7c6b426019ULL,
+    0xa1075a24e4421730ULL, 0xb24cf65b8612f81fULL,
+    0xc94930ae1d529cfcULL, 0xdee033f26797b627ULL,
+    0xfb9b7cd9a4a7443cULL, 0x169840ef017da3b1ULL,
+    0x9d412e0806e88aa5ULL, 0x8e1f289560ee864eULL,
+    0xc491798a08a2ad4eULL, 0xf1a6f2bab92a27e2ULL,
+    0xf5b5d7ec8acb58a2ULL, 0xae10af696774b1dbULL,
+    0x9991a6f3d6bf1765ULL, 0xacca6da1e0a8ef29ULL,
+    0xbff610b0cc6edd3fULL, 0x17fd090a58d32af3ULL,
+    0xeff394dcff8a948eULL, 0xddfc4b4cef07f5b0ULL,
+    0x95f83d0a1fb69cd9ULL, 0x4abdaf101564f98eULL,
+    0xbb764c4ca7a4440fULL, 0x9d6d1ad41abe37f1ULL,
+    0xea53df5fd18d5513ULL, 0x84c86189216dc5edULL,
+    0x92746b9be2f8552cULL, 0x32fd3cf5b4e49bb4ULL,
+    0xb7118682dbb66a77ULL, 0x3fbc8c33221dc2a1ULL,
+    0xe4d5e82392a40515ULL, 0x0fabaf3feaa5334aULL,
+    0x8f05b1163ba6832dULL, 0x29cb4d87f2a7400eULL,
+    0xb2c71d5bca9023f8ULL, 0x743e20e9ef511012ULL,
+    0xdf78e4b2bd342cf6ULL, 0x914da9246b255416ULL,
+    0x8bab8eefb6409c1aULL, 0x1ad089b6c2f7548eULL,
+    0xae9672aba3d0c320ULL, 0xa184ac2473b529b1ULL,
+    0xda3c0f568cc4f3e8ULL, 0xc9e5d72d90a2741eULL,
+    0x8865899617fb1871ULL, 0x7e2fa67c7a658892ULL,
+    0xaa7eebfb9df9de8dULL, 0xddbb901b98feeab7ULL,
+    0xd51ea6fa85785631ULL, 0x552a74227f3ea565ULL,
+    0x8533285c936b35deULL, 0xd53a88958f87275fULL,
+    0xa67ff273b8460356ULL, 0x8a892abaf368f137ULL,
+    0xd01fef10a657842cULL, 0x2d2b7569b0432d85ULL,
+    0x8213f56a67f6b29bULL, 0x9c3b29620e29fc73ULL,
+    0xa298f2c501f45f42ULL, 0x8349f3ba91b47b8fULL,
+    0xcb3f2f7642717713ULL, 0x241c70a936219a73ULL,
+    0xfe0efb53d30dd4d7ULL, 0xed238cd383aa0110ULL,
+    0x9ec95d1463e8a506ULL, 0xf4363804324a40aaULL,
+    0xc67bb4597ce2ce48ULL, 0xb143c6053edcd0d5ULL,
+    0xf81aa16fdc1b81daULL, 0xdd94b7868e94050aULL,
+    0x9b10a4e5e9913128ULL, 0xca7cf2b4191c8326ULL,
+    0xc1d4ce1f63f57d72ULL, 0xfd1c2f611f63a3f0ULL,
+    0xf24a01a73cf2dccfULL, 0xbc633b39673c8cecULL,
+    0x976e41088617ca01ULL, 0xd5be0503e085d813ULL,
+    0xbd49d14aa79dbc82ULL, 0x4b2d8644d8a74e18ULL,
+    0xec9c459d51852ba2ULL, 0xddf8e7d60ed1219eULL,
+    0x93e1ab8252f33b45ULL, 0xcabb90e5c942b503ULL,
+    0xb8da1662e7b00a17ULL, 0x3d6a751f3b936243ULL,
+    0xe7109bfba19c0c9dULL, 0x0cc512670a783ad4ULL,
+    0x906a617d450187e2ULL, 0x27fb2b80668b24c5ULL,
+    0xb484f9dc9641e9daULL, 0xb1f9f660802dedf6ULL,
+    0xe1a63853bbd26451ULL, 0x5e7873f8a0396973ULL,
+    0x8d07e33455637eb2ULL, 0xdb0b487b6423e1e8ULL,
+    0xb049dc016abc5e5fULL, 0x91ce1a9a3d2cda62ULL,
+    0xdc5c5301c56b75f7ULL, 0x7641a140cc7810fbULL,
+    0x89b9b3e11b6329baULL, 0xa9e904c87fcb0a9dULL,
+    0xac2820d9623bf429ULL, 0x546345fa9fbdcd44ULL,
+    0xd732290fbacaf133ULL, 0xa97c177947ad4095ULL,
+    0x867f59a9d4bed6c0ULL, 0x49ed8eabcccc485dULL,
+    0xa81f301449ee8c70ULL, 0x5c68f256bfff5a74ULL,
+    0xd226fc195c6a2f8cULL, 0x73832eec6fff3111ULL,
+    0x83585d8fd9c25db7ULL, 0xc831fd53c5ff7eabULL,
+    0xa42e74f3d032f525ULL, 0xba3e7ca8b77f5e55ULL,
+    0xcd3a1230c43fb26fULL, 0x28ce1bd2e55f35ebULL,
+    0x80444b5e7aa7cf85ULL, 0x7980d163cf5b81b3ULL,
+    0xa0555e361951c366ULL, 0xd7e105bcc332621fULL,
+    0xc86ab5c39fa63440ULL, 0x8dd9472bf3fefaa7ULL,
+    0xfa856334878fc150ULL, 0xb14f98f6f0feb951ULL,
+    0x9c935e00d4b9d8d2ULL, 0x6ed1bf9a569f33d3ULL,
+    0xc3b8358109e84f07ULL, 0x0a862f80ec4700c8ULL,
+    0xf4a642e14c6262c8ULL, 0xcd27bb612758c0faULL,
+    0x98e7e9cccfbd7dbdULL, 0x8038d51cb897789cULL,
+    0xbf21e44003acdd2cULL, 0xe0470a63e6bd56c3ULL,
+    0xeeea5d5004981478ULL, 0x1858ccfce06cac74ULL,
+    0x95527a5202df0ccbULL, 0x0f37801e0c43ebc8ULL,
+    0xbaa718e68396cffdULL, 0xd30560258f54e6baULL,
+    0xe950df20247c83fdULL, 0x47c6b82ef32a2069ULL,
+    0x91d28b7416cdd27eULL, 0x4cdc331d57fa5441ULL,
+    0xb6472e511c81471dULL, 0xe0133fe4adf8e952ULL,
+    0xe3d8f9e563a198e5ULL, 0x58180fddd97723a6ULL,
+    0x8e679c2f5e44ff8fULL, 0x570f09eaa7ea7648ULL
+};
+
+#if !defined(__SSE2__) && !defined(MLN_JSON_NEON)
+#define M_JSON_C_QUOTE          1
+#define M_JSON_C_BS             2
+#define M_JSON_C_OP             3
+#define M_JSON_C_WS             4
+static const mln_u8_t mln_json_class[256] = {
+    ['\"'] = M_JSON_C_QUOTE, ['\\'] = M_JSON_C_BS,
+    ['{'] = M_JSON_C_OP, ['}'] = M_JSON_C_OP, ['['] = M_JSON_C_OP, [']'] = M_JSON_C_OP,
+    [':'] = M_JSON_C_OP, [','] = M_JSON_C_OP,
+    [' '] = M_JSON_C_WS, ['\t'] = M_JSON_C_WS, ['\n'] = M_JSON_C_WS, ['\r'] = M_JSON_C_WS
+};
+#endif
+static mln_json_classify_handler_t mln_json_classify_handler = NULL;
+
+static mln_json_classify_handler_t mln_json_classify_select(void);
+static inline void mln_json_index_init(mln_json_index_t *ix, mln_u8ptr_t data, mln_u64_t len);
+static int mln_json_index_fill(mln_json_index_t *ix);
+static inline int mln_json_index_next(mln_json_index_t *ix, mln_u64_t *pos);
+static inline mln_u64_t mln_json_index_peek(mln_json_index_t *ix);
+static int mln_json_index_value(mln_json_index_t *ix, mln_alloc_t *pool, mln_json_t *j, mln_u64_t pos);
+static int mln_json_index_obj(mln_json_index_t *ix, mln_alloc_t *pool, mln_json_t *val);
+static int mln_json_index_array(mln_json_index_t *ix, mln_alloc_t *pool, mln_json_t *val);
+static int mln_json_index_string(mln_json_index_t *ix, mln_alloc_t *pool, mln_json_t *j, mln_u64_t pos);
+static int mln_json_index_scalar(mln_json_index_t *ix, mln_json_t *j, mln_u64_t pos);
+static inline void mln_json_lazy_index_init(mln_json_index_t *ix, mln_json_lazy_t *l);
+static int mln_json_lazy_skip(mln_json_index_t *ix, mln_u64_t pos);
+static int mln_json_lazy_key_cmp(mln_u8ptr_t raw, mln_u64_t len, mln_string_t *key);
+static mln_string_t *mln_json_string_build(mln_alloc_t *pool, mln_u8ptr_t raw, int count);
+static int mln_json_scalar_build(mln_json_t *j, char *s, int len);
+static void mln_json_stream_frame_free(mln_json_stream_frame_t *f);
+static int mln_json_stream_process(mln_json_stream_t *s, mln_u8ptr_t *pp, mln_u8ptr_t end);
+static int mln_json_stream_open(mln_json_stream_t *s, int is_obj);
+static int mln_json_stream_close(mln_json_stream_t *s, int is_obj);
+static int mln_json_stream_value(mln_json_stream_t *s, mln_json_t *v);
+static int mln_json_stream_string(mln_json_stream_t *s);
+static int mln_json_stream_scalar(mln_json_stream_t *s);
+MLN_ARRAY_FUNC_DECLARE(mln_json_stream_stack, mln_json_stream_frame_t, static inline)
+MLN_ARRAY_FUNC_DEFINE(mln_json_stream_stack, mln_json_stream_frame_t, static inline)
+MLN_ARRAY_FUNC_DECLARE(mln_json_stream_token, mln_u8_t, static inline)
+MLN_ARRAY_FUNC_DEFINE(mln_json_stream_token, mln_u8_t, static inline)
+static int
+mln_json_parse_string_fetch(mln_u8ptr_t jstr, int len, mln_u8ptr_t buf);
 static void mln_json_encode_utf8(unsigned int u, mln_u8ptr_t *b, int *count);
 static inline int mln_json_get_char(mln_u8ptr_t *s, int *len, unsigned int *hex);
 static int
 mln_json_parse_digit(mln_json_t *j, char *jstr, int len, mln_uauto_t index);
-static inline int
-mln_json_digit_process(double *val, char *s, int len);
+static int mln_json_number_compute(mln_u64_t w, mln_s64_t q, int truncated, double *out);
+static mln_u64_t mln_json_eisel_lemire(mln_u64_t w, mln_s64_t q);
+static inline void mln_json_mul128(mln_u64_t a, mln_u64_t b, mln_u64_t *hi, mln_u64_t *lo);
 static inline int
 mln_json_parse_true(mln_json_t *j, char *jstr, int len, mln_uauto_t index);
 static inline int
@@ -32,44 +876,237 @@ mln_json_parse_false(mln_json_t *j, char *jstr, int len, mln_uauto_t index);
 static inline int
 mln_json_parse_null(mln_json_t *j, char *jstr, int len, mln_uauto_t index);
 static inline void mln_json_jumpoff_blank(char **jstr, int *len);
-static inline mln_size_t mln_json_get_length(mln_json_t *j);
-static int
-mln_json_get_length_obj_iterate_handler(mln_rbtree_node_t *node, void *data);
-static inline mln_size_t
-mln_json_write_content(mln_json_t *j, mln_s8ptr_t buf);
-static int
-mln_json_write_content_obj_iterate_handler(mln_rbtree_node_t *node, void *data);
+static int mln_json_writer_string_refill(mln_json_writer_t *w, mln_size_t n);
+static int mln_json_writer_chain_refill(mln_json_writer_t *w, mln_size_t n);
+static void mln_json_write(mln_json_writer_t *w, const void *data, mln_size_t n);
+static inline void mln_json_write_char(mln_json_writer_t *w, mln_u8_t c);
+static inline void mln_json_write_indent(mln_json_writer_t *w);
+static void mln_json_write_value(mln_json_writer_t *w, mln_json_t *j);
+static mln_string_t *mln_json_encode_string(mln_json_t *j, mln_u32_t flags);
+static void mln_json_write_root(mln_json_writer_t *w, mln_json_t *j, mln_u32_t flags);
+static int mln_json_binary_decode(mln_alloc_t *pool, mln_string_t *in, mln_json_t *out, mln_u32_t flags, mln_json_read_handler_t read);
+static void mln_json_cbor_write(mln_json_writer_t *w, mln_json_t *j);
+static void mln_json_cbor_write_float(mln_json_writer_t *w, double d);
+static int mln_json_half_from_float(mln_u32_t f, mln_u16_t *h);
+static double mln_json_half_to_double(mln_u16_t h);
+static void mln_json_msgpack_write(mln_json_writer_t *w, mln_json_t *j);
+static void mln_json_msgpack_write_float(mln_json_writer_t *w, double d);
+static int mln_json_reader_string(mln_json_reader_t *r, mln_json_t *j, mln_u64_t n);
+static mln_string_t *mln_json_binary_string_new(mln_alloc_t *pool, mln_u64_t n);
+static int mln_json_reader_array(mln_json_reader_t *r, mln_json_t *j, mln_u64_t n);
+static int mln_json_reader_map(mln_json_reader_t *r, mln_json_t *j, mln_u64_t n);
+static int mln_json_cbor_read(mln_json_reader_t *r, mln_json_t *j);
+static int mln_json_cbor_chunks(mln_json_reader_t *r, mln_json_t *j, mln_u8_t major);
+static int mln_json_msgpack_read(mln_json_reader_t *r, mln_json_t *j);
+static void mln_json_write_string(mln_json_writer_t *w, mln_string_t *s);
+static int mln_json_number_format(double d, char *buf);
+static int mln_json_integer_format(mln_u64_t u, int neg, char *buf);
+static void mln_json_grisu2(double d, char *buf, int *len, int *k);
+static inline void
+mln_json_grisu_round(char *buf, int len, mln_u64_t delta, mln_u64_t rest, mln_u64_t ten_kappa, mln_u64_t wp_w);
+static inline mln_json_diyfp_t mln_json_diyfp_mul(mln_json_diyfp_t x, mln_json_diyfp_t y);
 static inline int mln_json_parse_is_index(mln_string_t *s, mln_size_t *idx);
+static inline mln_u8ptr_t mln_json_path_blank(mln_u8ptr_t p, mln_u8ptr_t end);
+static mln_u8ptr_t mln_json_path_segments(mln_json_path_t *path, mln_u8ptr_t p, mln_u8ptr_t end, int singular);
+static mln_u8ptr_t mln_json_path_bracket(mln_json_path_step_t *st, mln_u8ptr_t p, mln_u8ptr_t end, int singular);
+static mln_u8ptr_t mln_json_path_slice(mln_json_path_sel_t *sel, mln_u8ptr_t p, mln_u8ptr_t end, int singular);
+static mln_u8ptr_t mln_json_path_int(mln_u8ptr_t p, mln_u8ptr_t end, mln_s64_t *out);
+static mln_u8ptr_t mln_json_path_string(mln_u8ptr_t p, mln_u8ptr_t end, mln_string_t **out);
+static mln_u8ptr_t mln_json_path_or(mln_json_path_expr_t **out, mln_u8ptr_t p, mln_u8ptr_t end);
+static mln_u8ptr_t mln_json_path_and(mln_json_path_expr_t **out, mln_u8ptr_t p, mln_u8ptr_t end);
+static mln_u8ptr_t mln_json_path_unary(mln_json_path_expr_t **out, mln_u8ptr_t p, mln_u8ptr_t end);
+static mln_u8ptr_t mln_json_path_operand(mln_json_path_operand_t *o, mln_u8ptr_t p, mln_u8ptr_t end);
+static mln_json_path_step_t *mln_json_path_step_new(mln_json_path_t *path);
+static mln_json_path_sel_t *mln_json_path_sel_new(mln_json_path_step_t *st);
+static mln_json_path_expr_t *mln_json_path_expr_new(enum json_path_op op);
+static void mln_json_path_expr_free(mln_json_path_expr_t *e);
+static int mln_json_path_tree_walk(mln_json_path_ctx_t *ctx, mln_json_t *j, mln_u64_t states);
+static int mln_json_path_text_walk(mln_json_path_ctx_t *ctx, mln_json_index_t *ix, mln_u64_t pos, mln_u64_t states);
+static int mln_json_path_emit(mln_json_path_ctx_t *ctx, mln_json_index_t *ix, mln_u64_t pos, int consume);
+static mln_u64_t mln_json_path_child_states(mln_json_path_t *path, mln_u64_t states, mln_json_path_child_t *c);
+static int mln_json_path_sel_match(mln_json_path_sel_t *sel, mln_json_path_child_t *c);
+static int mln_json_path_slice_match(mln_json_path_sel_t *sel, mln_s64_t i, mln_s64_t n);
+static mln_json_t *mln_json_path_select(mln_json_t *j, mln_json_path_sel_t *sel);
+static int mln_json_path_lazy_select(mln_json_lazy_t *l, mln_json_path_sel_t *sel);
+static mln_s64_t mln_json_path_lazy_count(mln_json_lazy_t *l);
+static int mln_json_path_filter(mln_json_path_expr_t *e, mln_json_path_child_t *c);
+static mln_json_t *mln_json_path_value(mln_json_path_operand_t *o, mln_json_path_child_t *c, mln_json_t *tmp, int build);
+static int mln_json_path_compare(enum json_path_op op, mln_json_t *a, mln_json_t *b);
+static int mln_json_path_num_cmp(mln_json_t *a, mln_json_t *b);
 static inline int mln_json_obj_generate(mln_json_t *j, char **fmt, va_list *arg);
 static inline int mln_json_array_generate(mln_json_t *j, char **fmt, va_list *arg);
 static inline int __mln_json_obj_update(mln_json_t *j, mln_json_t *key, mln_json_t *val);
 static inline int __mln_json_array_append(mln_json_t *j, mln_json_t *value);
-static inline int mln_json_object_iterator(mln_rbtree_node_t *node, void *data);
-
 
-static inline int mln_json_kv_cmp(const mln_json_kv_t *kv1, const mln_json_kv_t *kv2)
-{
-    ASSERT(mln_json_is_string(&(kv1->key)) && mln_json_is_string(&(kv2->key)));
-    return mln_string_strcmp(mln_json_string_data_get(&(kv1->key)), mln_json_string_data_get(&(kv2->key)));
-}
 
-static inline void mln_json_kv_free(mln_json_kv_t *kv)
+static inline void mln_json_kv_destroy(mln_json_kv_t *kv)
 {
     if (kv == NULL) return;
 
     mln_json_destroy(&(kv->key));
     mln_json_destroy(&(kv->val));
-    free(kv);
 }
 
+/*
+ * Seeded per process, so keys colliding in the index of an object can not be
+ * chosen from outside.
+ */
+static inline mln_u32_t mln_json_key_hash(mln_string_t *key)
+{
+    return (mln_u32_t)mln_hash_bytes(key->data, key->len, mln_hash_seed());
+}
+
+static inline int mln_json_key_equal(mln_string_t *s1, mln_string_t *s2)
+{
+    return s1->len == s2->len && !memcmp(s1->data, s2->data, s1->len);
+}
 
-int mln_json_obj_init(mln_json_t *j)
+static inline void *mln_json_obj_mem_alloc(mln_json_obj_t *o, mln_size_t size)
+{
+    if (o->kvs.pool != NULL) return o->kvs.pool_alloc(o->kvs.pool, size);
+    return malloc(size);
+}
+
+static inline void mln_json_obj_mem_free(mln_json_obj_t *o, void *ptr)
+{
+    if (ptr == NULL) return;
+    if (o->kvs.pool != NULL) o->kvs.pool_free(ptr);
+    else free(ptr);
+}
+
+static int mln_json_obj_new(mln_json_t *j, mln_alloc_t *pool)
 {
+    struct mln_array_attr attr;
+    mln_json_obj_t *o;
+
+    if (pool != NULL) o = (mln_json_obj_t *)mln_alloc_m(pool, sizeof(mln_json_obj_t));
+    else o = (mln_json_obj_t *)malloc(sizeof(mln_json_obj_t));
+    if (o == NULL) return -1;
+
+    attr.pool = pool;
+    attr.pool_alloc = pool == NULL? NULL: (array_pool_alloc_handler)mln_alloc_m;
+    attr.pool_free = pool == NULL? NULL: (array_pool_free_handler)mln_alloc_free;
+    attr.free = (array_free)mln_json_kv_destroy;
+    attr.size = sizeof(mln_json_kv_t);
+    attr.nalloc = M_JSON_OBJ_SMALL;
+    if (mln_array_init(&(o->kvs), &attr) < 0) {
+        if (pool != NULL) mln_alloc_free(o);
+        else free(o);
+        return -1;
+    }
+    o->index = NULL;
+    o->mask = 0;
+
     j->type = M_JSON_OBJECT;
-    if ((j->data.m_j_obj = mln_rbtree_new(NULL)) == NULL) return -1;
+    j->data.m_j_obj = o;
+    return 0;
+}
+
+static void mln_json_obj_free(mln_json_obj_t *o)
+{
+    if (o == NULL) return;
+
+    mln_json_obj_mem_free(o, o->index);
+    mln_array_destroy(&(o->kvs));
+    if (o->kvs.pool != NULL) o->kvs.pool_free(o);
+    else free(o);
+}
+
+static void mln_json_obj_index_fill(mln_json_obj_t *o)
+{
+    mln_json_kv_t *kv = (mln_json_kv_t *)mln_array_elts(&(o->kvs));
+    mln_u32_t n = mln_array_nelts(&(o->kvs)), i, slot;
+
+    memset(o->index, 0, (o->mask + 1) * sizeof(mln_u32_t));
+    for (i = 0; i < n; ++i) {
+        for (slot = kv[i].hash & o->mask; o->index[slot]; slot = (slot + 1) & o->mask)
+            ;
+        o->index[slot] = i + 1;
+    }
+}
+
+/*
+ * Remove the slot of kv by shifting the following entries of its cluster back,
+ * so no tombstone is left. The members behind kv are about to be shifted
+ * forward, so their positions in the index are decreased.
+ */
+static void mln_json_obj_index_remove(mln_json_obj_t *o, mln_json_kv_t *kv)
+{
+    mln_json_kv_t *kvs = (mln_json_kv_t *)mln_array_elts(&(o->kvs));
+    mln_u32_t pos = kv - kvs + 1, i, j, home;
+
+    for (i = kv->hash & o->mask; o->index[i] != pos; i = (i + 1) & o->mask)
+        ;
+    for (j = (i + 1) & o->mask; o->index[j]; j = (j + 1) & o->mask) {
+        home = kvs[o->index[j] - 1].hash & o->mask;
+        /*the entry at j may fill the hole at i only if i is not before its home slot*/
+        if (((j - home) & o->mask) < ((j - i) & o->mask)) continue;
+        o->index[i] = o->index[j];
+        i = j;
+    }
+    o->index[i] = 0;
+
+    if (pos == mln_array_nelts(&(o->kvs))) return;
+    for (i = 0; i <= o->mask; ++i) {
+        if (o->index[i] > pos) --(o->index[i]);
+    }
+}
+
+/*
+ * size must be a power of 2 and larger than the number of members.
+ * Key hashes are computed only when the object was not indexed yet.
+ */
+static int mln_json_obj_index_build(mln_json_obj_t *o, mln_u32_t size)
+{
+    mln_json_kv_t *kv, *end;
+    mln_u32_t *index;
+
+    if ((index = (mln_u32_t *)mln_json_obj_mem_alloc(o, size * sizeof(mln_u32_t))) == NULL)
+        return -1;
+
+    if (o->index == NULL) {
+        kv = (mln_json_kv_t *)mln_array_elts(&(o->kvs));
+        for (end = kv + mln_array_nelts(&(o->kvs)); kv < end; ++kv)
+            kv->hash = mln_json_key_hash(mln_json_string_data_get(&(kv->key)));
+    }
+    mln_json_obj_mem_free(o, o->index);
+    o->index = index;
+    o->mask = size - 1;
+    mln_json_obj_index_fill(o);
     return 0;
 }
 
+static mln_json_kv_t *mln_json_obj_lookup(mln_json_obj_t *o, mln_string_t *key, mln_u32_t hash)
+{
+    mln_json_kv_t *kv = (mln_json_kv_t *)mln_array_elts(&(o->kvs)), *end, *p;
+    mln_u32_t slot;
+
+    if (o->index == NULL) {
+        for (end = kv + mln_array_nelts(&(o->kvs)); kv < end; ++kv) {
+            if (mln_json_key_equal(mln_json_string_data_get(&(kv->key)), key))
+                return kv;
+        }
+        return NULL;
+    }
+
+    for (slot = hash & o->mask; o->index[slot]; slot = (slot + 1) & o->mask) {
+        p = &kv[o->index[slot] - 1];
+        if (p->hash == hash && mln_json_key_equal(mln_json_string_data_get(&(p->key)), key))
+            return p;
+    }
+    return NULL;
+}
+
+int mln_json_obj_init(mln_json_t *j)
+{
+    return mln_json_obj_new(j, NULL);
+}
+
+int mln_json_obj_pool_init(mln_json_t *j, mln_alloc_t *pool)
+{
+    return mln_json_obj_new(j, pool);
+}
+
 int mln_json_obj_update(mln_json_t *j, mln_json_t *key, mln_json_t *val)
 {
     return __mln_json_obj_update(j, key, val);
@@ -77,27 +1114,40 @@ int mln_json_obj_update(mln_json_t *j, mln_json_t *key, mln_json_t *val)
 
 static inline int __mln_json_obj_update(mln_json_t *j, mln_json_t *key, mln_json_t *val)
 {
-    mln_rbtree_node_t *rn;
-    mln_json_kv_t kv, *pkv;
+    mln_json_obj_t *o;
+    mln_json_kv_t *kv;
+    mln_u32_t n, size, hash = 0, slot;
 
     if (!mln_json_is_string(key) || !mln_json_is_object(j)) return -1;
 
-    kv.key = *key;
-    rn = mln_rbtree_inline_search(mln_json_object_data_get(j), &kv, mln_json_kv_cmp);
-    if (mln_rbtree_null(rn, mln_json_object_data_get(j))) {
-        pkv = (mln_json_kv_t *)malloc(sizeof(mln_json_kv_t));
-        if (pkv == NULL) return -1;
+    o = mln_json_object_data_get(j);
+    if (o->index != NULL) hash = mln_json_key_hash(mln_json_string_data_get(key));
 
-        pkv->key = *key;
-        pkv->val = *val;
-        rn = mln_rbtree_node_init(&pkv->node, pkv);
-        mln_rbtree_inline_insert(mln_json_object_data_get(j), rn, mln_json_kv_cmp);
-    } else {
-        pkv = (mln_json_kv_t *)mln_rbtree_node_data_get(rn);
-        mln_json_destroy(&(pkv->key));
-        mln_json_destroy(&(pkv->val));
-        pkv->key = *key;
-        pkv->val = *val;
+    if ((kv = mln_json_obj_lookup(o, mln_json_string_data_get(key), hash)) != NULL) {
+        /*the member keeps its position*/
+        mln_json_destroy(&(kv->key));
+        mln_json_destroy(&(kv->val));
+        kv->key = *key;
+        kv->val = *val;
+        return 0;
+    }
+
+    n = mln_array_nelts(&(o->kvs)) + 1;
+    if (n > M_JSON_OBJ_SMALL && (o->index == NULL || (n << 1) > o->mask + 1)) {
+        for (size = o->index == NULL? (M_JSON_OBJ_SMALL << 2): ((o->mask + 1) << 1); size < (n << 1); size <<= 1)
+            ;
+        if (o->index == NULL) hash = mln_json_key_hash(mln_json_string_data_get(key));
+        if (mln_json_obj_index_build(o, size) < 0) return -1;
+    }
+
+    if ((kv = (mln_json_kv_t *)mln_array_push(&(o->kvs))) == NULL) return -1;
+    kv->key = *key;
+    kv->val = *val;
+    kv->hash = hash;
+    if (o->index != NULL) {
+        for (slot = hash & o->mask; o->index[slot]; slot = (slot + 1) & o->mask)
+            ;
+        o->index[slot] = n;
     }
 
     return 0;
@@ -107,31 +1157,29 @@ mln_json_t *mln_json_obj_search(mln_json_t *j, mln_string_t *key)
 {
     if (!mln_json_is_object(j)) return NULL;
 
-    mln_rbtree_node_t *rn;
-    mln_json_kv_t kv;
+    mln_json_obj_t *o = mln_json_object_data_get(j);
+    mln_json_kv_t *kv;
 
-    mln_json_string_init(&(kv.key), key);
-    rn = mln_rbtree_inline_search(mln_json_object_data_get(j), &kv, mln_json_kv_cmp);
-    if (mln_rbtree_null(rn, mln_json_object_data_get(j))) {
-        return NULL;
-    }
-    return &(((mln_json_kv_t *)mln_rbtree_node_data_get(rn))->val);
+    kv = mln_json_obj_lookup(o, key, o->index == NULL? 0: mln_json_key_hash(key));
+    return kv == NULL? NULL: &(kv->val);
 }
 
 void mln_json_obj_remove(mln_json_t *j, mln_string_t *key)
 {
     if (!mln_json_is_object(j)) return;
 
-    mln_json_kv_t kv;
-    mln_rbtree_node_t *rn;
+    mln_json_obj_t *o = mln_json_object_data_get(j);
+    mln_json_kv_t *kv, *end;
 
-    mln_json_string_init(&(kv.key), key);
-    rn = mln_rbtree_inline_search(mln_json_object_data_get(j), &kv, mln_json_kv_cmp);
-    if (mln_rbtree_null(rn, mln_json_object_data_get(j))) {
-        return;
-    }
-    mln_rbtree_delete(mln_json_object_data_get(j), rn);
-    mln_rbtree_inline_node_free(mln_json_object_data_get(j), rn, mln_json_kv_free);
+    kv = mln_json_obj_lookup(o, key, o->index == NULL? 0: mln_json_key_hash(key));
+    if (kv == NULL) return;
+
+    if (o->index != NULL) mln_json_obj_index_remove(o, kv);
+
+    end = (mln_json_kv_t *)mln_array_elts(&(o->kvs)) + mln_array_nelts(&(o->kvs));
+    mln_json_kv_destroy(kv);
+    memmove(kv, kv + 1, (end - kv - 1) * sizeof(mln_json_kv_t));
+    --mln_array_nelts(&(o->kvs));
 }
 
 
@@ -151,6 +1199,22 @@ int mln_json_array_init(mln_json_t *j)
     return 0;
 }
 
+int mln_json_array_pool_init(mln_json_t *j, mln_alloc_t *pool)
+{
+    struct mln_array_attr attr;
+
+    attr.pool = pool;
+    attr.pool_alloc = (array_pool_alloc_handler)mln_alloc_m;
+    attr.pool_free = (array_pool_free_handler)mln_alloc_free;
+    attr.free = (array_free)mln_json_destroy;
+    attr.size = sizeof(mln_json_t);
+    attr.nalloc = M_JSON_LEN;
+    if ((j->data.m_j_array = mln_array_new(&attr)) == NULL)
+        return -1;
+    mln_json_array_type_set(j);
+    return 0;
+}
+
 mln_json_t *mln_json_array_search(mln_json_t *j, mln_uauto_t index)
 {
     if (!mln_json_is_array(j)) return NULL;
@@ -210,7 +1274,7 @@ void mln_json_destroy(mln_json_t *j)
 
     switch (j->type) {
         case M_JSON_OBJECT:
-            mln_rbtree_inline_free(mln_json_object_data_get(j), mln_json_kv_free);
+            mln_json_obj_free(mln_json_object_data_get(j));
             break;
         case M_JSON_ARRAY:
             mln_array_free(mln_json_array_data_get(j));
@@ -247,9 +1311,16 @@ void mln_json_dump(mln_json_t *j, int n_space, char *prefix)
     }
     switch (j->type) {
         case M_JSON_OBJECT:
+        {
             printf("type:object\n");
-            mln_rbtree_iterate(mln_json_object_data_get(j), mln_json_dump_obj_iterate_handler, &space);
+            mln_json_kv_t *kv = mln_array_elts(&(mln_json_object_data_get(j)->kvs));
+            mln_json_kv_t *kvend = kv + mln_array_nelts(&(mln_json_object_data_get(j)->kvs));
+            for (; kv < kvend; ++kv) {
+                mln_json_dump(&(kv->key), space, "Object key:");
+                mln_json_dump(&(kv->val), space, "Object value:");
+            }
             break;
+        }
         case M_JSON_ARRAY:
         {
             printf("type:array\n");
@@ -265,7 +1336,12 @@ void mln_json_dump(mln_json_t *j, int n_space, char *prefix)
                 printf("type:string val:[%s]\n", (char *)(j->data.m_j_string->data));
             break;
         case M_JSON_NUM:
-            printf("type:number val:[%f]\n", j->data.m_j_number);
+            if (j->num_type == M_JSON_NUM_INT)
+                printf("type:number val:[%lld]\n", (long long)j->data.m_j_int);
+            else if (j->num_type == M_JSON_NUM_UINT)
+                printf("type:number val:[%llu]\n", (unsigned long long)j->data.m_j_uint);
+            else
+                printf("type:number val:[%f]\n", j->data.m_j_number);
             break;
         case M_JSON_TRUE:
             printf("type:true val:[true]\n");
@@ -282,34 +1358,42 @@ void mln_json_dump(mln_json_t *j, int n_space, char *prefix)
     }
 }
 
-static int mln_json_dump_obj_iterate_handler(mln_rbtree_node_t *node, void *data)
-{
-    int *space = (int *)data;
-    mln_json_kv_t *kv = (mln_json_kv_t *)mln_rbtree_node_data_get(node);
-
-    mln_json_dump(&(kv->key), *space, "Object key:");
-    mln_json_dump(&(kv->val), *space, "Object value:");
-
-    return 0;
-}
 
 
 /*
  * decode
+ *
+ * Decoding is done in two stages. Stage 1 classifies the input 64 bytes at a time
+ * into bitmasks (quotes, backslashes, whitespaces and structural characters) and
+ * turns them into the positions of structural characters, string quotes and the
+ * first characters of scalars. Stage 2 walks these positions to build the tree.
+ * Positions are produced in a bounded window, so the memory used by stage 1 does
+ * not grow with the input.
  */
 int mln_json_decode(mln_string_t *jstr, mln_json_t *out)
 {
+    return mln_json_pool_decode(NULL, jstr, out);
+}
+
+int mln_json_pool_decode(mln_alloc_t *pool, mln_string_t *jstr, mln_json_t *out)
+{
+    mln_json_index_t ix;
+    mln_u64_t pos;
+
     if (jstr == NULL || out == NULL) {
         return -1;
     }
 
     mln_json_init(out);
 
-    if (mln_json_parse_json(out, (char *)(jstr->data), jstr->len, 0) != 0) {
-        mln_json_destroy(out);
+    mln_json_index_init(&ix, jstr->data, jstr->len);
+    if (mln_json_index_next(&ix, &pos) < 0) {
+        return -1;
+    }
+    if (jstr->data[pos] != (mln_u8_t)'{' && jstr->data[pos] != (mln_u8_t)'[') {
         return -1;
     }
-    if (!mln_json_is_object(out) && !mln_json_is_array(out)) {
+    if (mln_json_index_value(&ix, pool, out, pos) < 0 || mln_json_index_next(&ix, &pos) == 0) {
         mln_json_destroy(out);
         return -1;
     }
@@ -317,767 +1401,3407 @@ int mln_json_decode(mln_string_t *jstr, mln_json_t *out)
     return 0;
 }
 
-static inline int
-mln_json_parse_json(mln_json_t *j, char *jstr, int len, mln_uauto_t index)
+
+/*
+ * lazy
+ *
+ * A lazy value is just a position in the input. Searching an object or an array
+ * indexes the input from the container on, and the values which are not asked for
+ * are skipped without being built, so only the touched path is validated.
+ * The input must be kept unchanged while lazy values are in use.
+ */
+int mln_json_lazy_init(mln_json_lazy_t *l, mln_string_t *jstr)
 {
-    if (jstr == NULL) {
-        return -1;
-    }
+    mln_u8ptr_t p = jstr->data, end = jstr->data + jstr->len;
 
-    int left;
+    for (; p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'); ++p)
+        ;
+    if (p >= end || (*p != (mln_u8_t)'{' && *p != (mln_u8_t)'[')) return -1;
 
-    mln_json_jumpoff_blank(&jstr, &len);
-    if (len <= 0) {
-        return len;
-    }
+    l->data = jstr->data;
+    l->len = jstr->len;
+    l->pos = p - jstr->data;
+    return 0;
+}
 
-    switch (jstr[0]) {
-        case '{':
-            return mln_json_parse_obj(j, jstr, len, index);
-        case '[':
-            return mln_json_parse_array(j, jstr, len, index);
-        case '\"':
-            return mln_json_parse_string(j, jstr, len, index);
+enum json_type mln_json_lazy_type(mln_json_lazy_t *l)
+{
+    switch (l->data[l->pos]) {
+        case (mln_u8_t)'{':
+            return M_JSON_OBJECT;
+        case (mln_u8_t)'[':
+            return M_JSON_ARRAY;
+        case (mln_u8_t)'\"':
+            return M_JSON_STRING;
+        case (mln_u8_t)'t':
+        case (mln_u8_t)'T':
+            return M_JSON_TRUE;
+        case (mln_u8_t)'f':
+        case (mln_u8_t)'F':
+            return M_JSON_FALSE;
+        case (mln_u8_t)'n':
+        case (mln_u8_t)'N':
+            return M_JSON_NULL;
+        case (mln_u8_t)'-':
+            return M_JSON_NUM;
         default:
-            if (isdigit(jstr[0]) || jstr[0] == '-') {
-                return mln_json_parse_digit(j, jstr, len, index);
-            }
-            left = mln_json_parse_true(j, jstr, len, index);
-            if (left >= 0) return left;
-            left = mln_json_parse_false(j, jstr, len, index);
-            if (left >= 0) return left;
             break;
     }
-    return mln_json_parse_null(j, jstr, len, index);
+    return isdigit(l->data[l->pos])? M_JSON_NUM: M_JSON_NONE;
 }
 
-static inline int
-mln_json_parse_obj(mln_json_t *val, char *jstr, int len, mln_uauto_t index)
+int mln_json_lazy_obj_search(mln_json_lazy_t *l, mln_string_t *key, mln_json_lazy_t *out)
 {
-    int left;
-    mln_json_t key, v;
-
-    /*jump off '{'*/
-    ++jstr;
-    if (--len <= 0) {
-        return -1;
-    }
-
-    if (mln_json_obj_init(val) < 0) return -1;
-
-again:
-    mln_json_init(&key);
-    mln_json_init(&v);
-    mln_json_jumpoff_blank(&jstr, &len);
-    if (jstr[0] != '}') {
-        left = mln_json_parse_json(&key, jstr, len, 0);
-        if (left <= 0) {
-            mln_json_destroy(&key);
-            mln_json_destroy(&v);
-            return -1;
-        }
-        if (!mln_json_is_string(&key)) {
-            mln_json_destroy(&key);
-            mln_json_destroy(&v);
-            return -1;
-        }
-        jstr += (len - left);
-        len = left;
-        if (len <= 0) {
-            mln_json_destroy(&key);
-            mln_json_destroy(&v);
-            return -1;
-        }
-
-        mln_json_jumpoff_blank(&jstr, &len);
-        if (len <= 0) {
-            mln_json_destroy(&key);
-            mln_json_destroy(&v);
-            return -1;
-        }
-
-        /*jump off ':'*/
-        if (jstr[0] != ':') {
-            mln_json_destroy(&key);
-            mln_json_destroy(&v);
-            return -1;
-        }
-        ++jstr;
-        if (--len <= 0) {
-            mln_json_destroy(&key);
-            mln_json_destroy(&v);
-            return -1;
+    mln_json_index_t ix;
+    mln_u8ptr_t data = l->data;
+    mln_u64_t pos, end;
+    int found;
+
+    if (data[l->pos] != (mln_u8_t)'{') return -1;
+
+    mln_json_lazy_index_init(&ix, l);
+    if (mln_json_index_next(&ix, &pos) < 0 || mln_json_index_next(&ix, &pos) < 0) return -1;
+
+    while (data[pos] != (mln_u8_t)'}') {
+        if (data[pos] != (mln_u8_t)'\"') return -1;
+        if (mln_json_index_next(&ix, &end) < 0 || data[end] != (mln_u8_t)'\"') return -1;
+        found = !mln_json_lazy_key_cmp(data + pos + 1, end - pos - 1, key);
+        if (mln_json_index_next(&ix, &pos) < 0 || data[pos] != (mln_u8_t)':') return -1;
+        if (mln_json_index_next(&ix, &pos) < 0) return -1;
+
+        if (found) {
+            out->data = data;
+            out->len = l->len;
+            out->pos = pos;
+            return 0;
         }
 
-        left = mln_json_parse_json(&v, jstr, len, 0);
-        if (left <= 0) {
-            mln_json_destroy(&key);
-            mln_json_destroy(&v);
-            return -1;
-        }
-        jstr += (len - left);
-        len = left;
+        if (mln_json_lazy_skip(&ix, pos) < 0 || mln_json_index_next(&ix, &pos) < 0) return -1;
+        if (data[pos] == (mln_u8_t)'}') break;
+        if (data[pos] != (mln_u8_t)',' || mln_json_index_next(&ix, &pos) < 0) return -1;
+    }
 
-        mln_json_jumpoff_blank(&jstr, &len);
-        if (len <= 0) {
-            mln_json_destroy(&key);
-            mln_json_destroy(&v);
-            return -1;
-        }
+    return -1;
+}
 
-        if (__mln_json_obj_update(val, &key, &v) < 0) {
-            mln_json_destroy(&key);
-            mln_json_destroy(&v);
-            return -1;
+int mln_json_lazy_array_search(mln_json_lazy_t *l, mln_uauto_t index, mln_json_lazy_t *out)
+{
+    mln_json_index_t ix;
+    mln_u8ptr_t data = l->data;
+    mln_u64_t pos;
+    mln_uauto_t i = 0;
+
+    if (data[l->pos] != (mln_u8_t)'[') return -1;
+
+    mln_json_lazy_index_init(&ix, l);
+    if (mln_json_index_next(&ix, &pos) < 0 || mln_json_index_next(&ix, &pos) < 0) return -1;
+
+    while (data[pos] != (mln_u8_t)']') {
+        if (i++ == index) {
+            out->data = data;
+            out->len = l->len;
+            out->pos = pos;
+            return 0;
         }
-    }
 
-    if (jstr[0] == ',') {
-        ++jstr;
-        if (--len <= 0) {
-            return -1;
-        }
-        goto again;
-    } else if (jstr[0] == '}') {
-        ++jstr;
-        --len;
-        mln_json_jumpoff_blank(&jstr, &len);
-        return len;
+        if (mln_json_lazy_skip(&ix, pos) < 0 || mln_json_index_next(&ix, &pos) < 0) return -1;
+        if (data[pos] == (mln_u8_t)']') break;
+        if (data[pos] != (mln_u8_t)',' || mln_json_index_next(&ix, &pos) < 0) return -1;
     }
 
     return -1;
 }
 
-static inline int
-mln_json_parse_array(mln_json_t *val, char *jstr, int len, mln_uauto_t index)
+int mln_json_lazy_decode(mln_json_lazy_t *l, mln_alloc_t *pool, mln_json_t *out)
 {
-    int left;
-    mln_json_t j;
-    mln_uauto_t cnt = 0;
+    mln_json_index_t ix;
+    mln_u64_t pos;
 
-    if (mln_json_array_init(val) < 0) return -1;
+    mln_json_init(out);
 
-    ++jstr;
-    if (--len <= 0) {
+    mln_json_lazy_index_init(&ix, l);
+    ix.ref = 1;
+    if (mln_json_index_next(&ix, &pos) < 0) return -1;
+    if (mln_json_index_value(&ix, pool, out, pos) < 0) {
+        mln_json_destroy(out);
         return -1;
     }
 
-again:
-    mln_json_init(&j);
-    if (jstr[0] != ']') {
-        left = mln_json_parse_json(&j, jstr, len, ++cnt);
-        if (left <= 0) {
-            mln_json_destroy(&j);
-            return -1;
-        }
-        jstr += (len - left);
-        len = left;
-        if (len <= 0) {
-            mln_json_destroy(&j);
-            return -1;
-        }
-    }
+    return 0;
+}
 
-    if (__mln_json_array_append(val, &j) < 0) {
-        mln_json_destroy(&j);
-        return -1;
-    }
+static inline void mln_json_lazy_index_init(mln_json_index_t *ix, mln_json_lazy_t *l)
+{
+    mln_json_index_init(ix, l->data, l->len);
+    /*a value never starts inside a string, so classifying can start right there*/
+    ix->off = l->pos;
+    /*lookups often stop early, the window grows from a few blocks*/
+    ix->want = M_JSON_LAZY_INDEX_LEN;
+}
 
-    mln_json_jumpoff_blank(&jstr, &len);
-    if (len <= 0) {
-        return -1;
-    }
+/*
+ * Skip the value whose first token is at pos.
+ */
+static int mln_json_lazy_skip(mln_json_index_t *ix, mln_u64_t pos)
+{
+    mln_u8ptr_t data = ix->data;
+    mln_u64_t depth = 0;
 
-    if (jstr[0] == ',') {
-        ++jstr;
-        if (--len <= 0) {
-            return -1;
+    while (1) {
+        switch (data[pos]) {
+            case (mln_u8_t)'\"':
+                /*the closing quote*/
+                if (mln_json_index_next(ix, &pos) < 0) return -1;
+                break;
+            case (mln_u8_t)'{':
+            case (mln_u8_t)'[':
+                ++depth;
+                break;
+            case (mln_u8_t)'}':
+            case (mln_u8_t)']':
+                if (depth-- == 0) return -1;
+                break;
+            case (mln_u8_t)':':
+            case (mln_u8_t)',':
+                if (depth == 0) return -1;
+                break;
+            default:
+                break;
         }
-        goto again;
-    }
-    if (jstr[0] == ']') {
-        ++jstr;
-        --len;
-        mln_json_jumpoff_blank(&jstr, &len);
-        return len;
+        if (depth == 0) break;
+        if (mln_json_index_next(ix, &pos) < 0) return -1;
     }
 
-    return -1;
+    return 0;
 }
 
-static inline int
-mln_json_parse_string(mln_json_t *j, char *jstr, int len, mln_uauto_t index)
+/*
+ * Compare the raw (still escaped) key in the input with key, returns 0 if they are equal.
+ */
+static int mln_json_lazy_key_cmp(mln_u8ptr_t raw, mln_u64_t len, mln_string_t *key)
 {
-    mln_u8_t *p, flag = 0;
-    int plen, count = 0;
-    mln_string_t *str;
     mln_u8ptr_t buf;
+    int n, rc;
 
-    ++jstr;
-    if (--len <= 0) {
-        return -1;
-    }
-
-    for (p = (mln_u8ptr_t)jstr, plen = len; plen > 0; ++p, ++count, --plen) {
-        if (!flag && *p == (mln_u8_t)'\\') {
-            flag = 1;
-        } else {
-            if (*p == (mln_u8_t)'\"' && (p == (mln_u8ptr_t)jstr || !flag))
-                break;
-            if (flag) flag = 0;
-        }
-    }
-    if (plen <= 0) {
-        return -1;
-    }
-
-    buf = mln_json_parse_string_fetch((mln_u8ptr_t)jstr, &count);
-    if (buf == NULL) {
-        return -1;
-    }
+    if (memchr(raw, '\\', len) == NULL)
+        return len != key->len || memcmp(raw, key->data, len);
 
-    str = mln_string_const_ndup((char *)buf, count);
+    /*unescaping never makes a string longer*/
+    if (key->len > len || len > 0x7fffffff) return 1;
+    if ((buf = (mln_u8ptr_t)malloc(len)) == NULL) return 1;
+    n = mln_json_parse_string_fetch(raw, (int)len, buf);
+    rc = n < 0 || (mln_u64_t)n != key->len || memcmp(buf, key->data, n);
     free(buf);
-    if (str == NULL) {
-        return -1;
-    }
+
+    return rc;
+}
+
+/*
+ * stream
+ *
+ * A push parser which takes the input chunk by chunk. Strings and scalars are
+ * collected in s->token until they are complete, containers are kept in s->stack
+ * until they are closed and then put into their parents.
+ */
+int mln_json_stream_init(mln_json_stream_t *s, mln_alloc_t *pool)
+{
+    struct mln_array_type_attr attr;
+
+    attr.pool = pool;
+    attr.pool_alloc = (array_pool_alloc_handler)mln_alloc_m;
+    attr.pool_free = (array_pool_free_handler)mln_alloc_free;
+    attr.pool_realloc = (array_pool_realloc_handler)mln_alloc_re;
+    attr.free = (array_free)mln_json_stream_frame_free;
+    mln_json_stream_stack_init(&s->stack, &attr);
+
+    attr.free = NULL;
+    mln_json_stream_token_init(&s->token, &attr);
+
+    s->pool = pool;
+    mln_json_init(&s->root);
+    s->state = M_JSON_STREAM_S_VALUE;
+    s->is_key = 0;
+    s->escaped = 0;
+
+    return 0;
+}
+
+void mln_json_stream_destroy(mln_json_stream_t *s)
+{
+    if (s == NULL) return;
+
+    mln_json_stream_stack_destroy(&s->stack);
+    mln_json_stream_token_destroy(&s->token);
+    mln_json_destroy(&s->root);
+}
+
+int mln_json_stream_parse(mln_json_stream_t *s, mln_chain_t **in, mln_json_t *out)
+{
+    mln_chain_t *c;
+    mln_buf_t *b;
+    int rc = M_JSON_STREAM_NOTYET;
+
+    if (s->state == M_JSON_STREAM_S_ERROR) return M_JSON_STREAM_ERROR;
+
+    while ((c = *in) != NULL) {
+        b = c->buf;
+        if (b != NULL && !b->in_file && mln_buf_left_size(b) > 0) {
+            if ((rc = mln_json_stream_process(s, &b->left_pos, b->last)) == M_JSON_STREAM_ERROR) {
+                s->state = M_JSON_STREAM_S_ERROR;
+                return M_JSON_STREAM_ERROR;
+            }
+            /*the rest belongs to the next document*/
+            if (rc == M_JSON_STREAM_DONE && mln_buf_left_size(b) > 0) break;
+        }
+        *in = c->next;
+        mln_chain_pool_release(c);
+        if (rc == M_JSON_STREAM_DONE) break;
+    }
+
+    if (rc == M_JSON_STREAM_DONE) {
+        *out = s->root;
+        mln_json_init(&s->root);
+        s->state = M_JSON_STREAM_S_VALUE;
+    }
+
+    return rc;
+}
+
+static void mln_json_stream_frame_free(mln_json_stream_frame_t *f)
+{
+    mln_json_destroy(&f->val);
+    mln_json_destroy(&f->key);
+}
+
+static int mln_json_stream_process(mln_json_stream_t *s, mln_u8ptr_t *pp, mln_u8ptr_t end)
+{
+    mln_u8ptr_t p = *pp, q, t;
+    mln_u8_t c;
+    int rc = M_JSON_STREAM_NOTYET;
+
+    while (p < end) {
+        if (s->state == M_JSON_STREAM_S_STRING) {
+            for (q = p; q < end; ++q) {
+                if (s->escaped) s->escaped = 0;
+                else if (*q == (mln_u8_t)'\\') s->escaped = 1;
+                else if (*q == (mln_u8_t)'\"') break;
+            }
+            if (q > p) {
+                if ((t = mln_json_stream_token_pushn(&s->token, q - p)) == NULL) goto err;
+                memcpy(t, p, q - p);
+            }
+            if ((p = q) < end) {
+                ++p;
+                if (mln_json_stream_string(s) < 0) goto err;
+            }
+            continue;
+        }
+        if (s->state == M_JSON_STREAM_S_SCALAR) {
+            for (q = p; q < end; ++q) {
+                c = *q;
+                if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ',' || c == ':' || \
+                    c == '{' || c == '}' || c == '[' || c == ']' || c == '\"')
+                {
+                    break;
+                }
+            }
+            if (q > p) {
+                if ((t = mln_json_stream_token_pushn(&s->token, q - p)) == NULL) goto err;
+                memcpy(t, p, q - p);
+            }
+            if ((p = q) < end && mln_json_stream_scalar(s) < 0) goto err;
+            continue;
+        }
+
+        c = *p;
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            ++p;
+            continue;
+        }
+
+        switch (s->state) {
+            case M_JSON_STREAM_S_VALUE:
+                if (c == '{' || c == '[') {
+                    if (mln_json_stream_open(s, c == '{') < 0) goto err;
+                } else if (!mln_array_nelts(&s->stack)) {
+                    /*the root must be an object or an array*/
+                    goto err;
+                } else if (c == '\"') {
+                    s->state = M_JSON_STREAM_S_STRING;
+                    s->is_key = 0;
+                } else if (c == ']') {
+                    /*an empty array or a trailing comma*/
+                    if (mln_json_stream_close(s, 0) < 0) goto err;
+                } else if (c == '}' || c == ':' || c == ',') {
+                    goto err;
+                } else {
+                    /*the first character is collected in the scalar state*/
+                    s->state = M_JSON_STREAM_S_SCALAR;
+                    continue;
+                }
+                break;
+            case M_JSON_STREAM_S_KEY:
+                if (c == '\"') {
+                    s->state = M_JSON_STREAM_S_STRING;
+                    s->is_key = 1;
+                } else if (c == '}') {
+                    if (mln_json_stream_close(s, 1) < 0) goto err;
+                } else {
+                    goto err;
+                }
+                break;
+            case M_JSON_STREAM_S_COLON:
+                if (c != ':') goto err;
+                s->state = M_JSON_STREAM_S_VALUE;
+                break;
+            default: /*M_JSON_STREAM_S_NEXT*/
+                if (c == ',') {
+                    s->state = mln_json_is_object(&(((mln_json_stream_frame_t *)mln_array_elts(&s->stack)) + \
+                                                   mln_array_nelts(&s->stack) - 1)->val)? \
+                                   M_JSON_STREAM_S_KEY: M_JSON_STREAM_S_VALUE;
+                } else if (c == '}' || c == ']') {
+                    if (mln_json_stream_close(s, c == '}') < 0) goto err;
+                } else {
+                    goto err;
+                }
+                break;
+        }
+        ++p;
+
+        if (s->state == M_JSON_STREAM_S_DONE) {
+            rc = M_JSON_STREAM_DONE;
+            break;
+        }
+    }
+
+    *pp = p;
+    return rc;
+
+err:
+    *pp = p;
+    return M_JSON_STREAM_ERROR;
+}
+
+static int mln_json_stream_open(mln_json_stream_t *s, int is_obj)
+{
+    mln_json_stream_frame_t *f;
+    int rc;
+
+    if ((f = mln_json_stream_stack_push(&s->stack)) == NULL) return -1;
+    mln_json_init(&f->key);
+
+    if (is_obj)
+        rc = s->pool != NULL? mln_json_obj_pool_init(&f->val, s->pool): mln_json_obj_init(&f->val);
+    else
+        rc = s->pool != NULL? mln_json_array_pool_init(&f->val, s->pool): mln_json_array_init(&f->val);
+    if (rc < 0) {
+        mln_json_init(&f->val);
+        mln_json_stream_stack_pop(&s->stack);
+        return -1;
+    }
+
+    s->state = is_obj? M_JSON_STREAM_S_KEY: M_JSON_STREAM_S_VALUE;
+    return 0;
+}
+
+static int mln_json_stream_close(mln_json_stream_t *s, int is_obj)
+{
+    mln_json_stream_frame_t *f;
+    mln_json_t v;
+
+    if (!mln_array_nelts(&s->stack)) return -1;
+
+    f = (mln_json_stream_frame_t *)mln_array_elts(&s->stack) + mln_array_nelts(&s->stack) - 1;
+    if (mln_json_is_object(&f->val) != is_obj) return -1;
+    v = f->val;
+    mln_json_init(&f->val);
+    mln_json_stream_stack_pop(&s->stack);
+
+    if (mln_json_stream_value(s, &v) < 0) {
+        mln_json_destroy(&v);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Put a complete value into the innermost container, or make it the result.
+ */
+static int mln_json_stream_value(mln_json_stream_t *s, mln_json_t *v)
+{
+    mln_json_stream_frame_t *f;
+
+    if (!mln_array_nelts(&s->stack)) {
+        s->root = *v;
+        s->state = M_JSON_STREAM_S_DONE;
+        return 0;
+    }
+
+    f = (mln_json_stream_frame_t *)mln_array_elts(&s->stack) + mln_array_nelts(&s->stack) - 1;
+    if (mln_json_is_object(&f->val)) {
+        if (__mln_json_obj_update(&f->val, &f->key, v) < 0) return -1;
+        mln_json_init(&f->key);
+    } else {
+        if (__mln_json_array_append(&f->val, v) < 0) return -1;
+    }
+
+    s->state = M_JSON_STREAM_S_NEXT;
+    return 0;
+}
+
+static int mln_json_stream_string(mln_json_stream_t *s)
+{
+    mln_json_stream_frame_t *f;
+    mln_string_t *str;
+    mln_json_t j;
+
+    if (mln_array_nelts(&s->token) > 0x7fffffff) return -1;
+    str = mln_json_string_build(s->pool, (mln_u8ptr_t)mln_array_elts(&s->token), (int)mln_array_nelts(&s->token));
+    mln_json_stream_token_reset(&s->token);
+    if (str == NULL) return -1;
+    mln_json_string_init(&j, str);
+
+    if (s->is_key) {
+        f = (mln_json_stream_frame_t *)mln_array_elts(&s->stack) + mln_array_nelts(&s->stack) - 1;
+        f->key = j;
+        s->state = M_JSON_STREAM_S_COLON;
+        return 0;
+    }
+
+    if (mln_json_stream_value(s, &j) < 0) {
+        mln_json_destroy(&j);
+        return -1;
+    }
+    return 0;
+}
+
+static int mln_json_stream_scalar(mln_json_stream_t *s)
+{
+    mln_json_t j;
+    mln_u8ptr_t t;
+    int n = mln_array_nelts(&s->token), left;
+
+    /*
+     * The terminator stands for the delimiter following the scalar in the input,
+     * so the token is parsed exactly as mln_json_decode does, e.g. "1." is accepted.
+     */
+    if (n > 0xffff || (t = mln_json_stream_token_push(&s->token)) == NULL) return -1;
+    *t = 0;
+
+    mln_json_init(&j);
+    left = mln_json_scalar_build(&j, (char *)mln_array_elts(&s->token), n + 1);
+    mln_json_stream_token_reset(&s->token);
+    if (left != 1) return -1;
+
+    return mln_json_stream_value(s, &j);
+}
+
+static inline void mln_json_index_init(mln_json_index_t *ix, mln_u8ptr_t data, mln_u64_t len)
+{
+    ix->data = data;
+    ix->len = len;
+    ix->off = 0;
+    ix->prev_in_string = 0;
+    ix->prev_escaped = 0;
+    ix->prev_scalar = 0;
+    ix->n = ix->cur = 0;
+    ix->ref = 0;
+    ix->want = M_JSON_INDEX_LEN;
+}
+
+static inline mln_u64_t mln_json_prefix_xor(mln_u64_t x)
+{
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+/*
+ * Scan the next blocks until the window is filled or the input is exhausted.
+ * Returns -1 if there is no position left.
+ */
+static int mln_json_index_fill(mln_json_index_t *ix)
+{
+    mln_json_masks_t m;
+    mln_u8_t tail[64];
+    mln_u8ptr_t p;
+    mln_u64_t potential, code, escaped, quote, in_string, scalar, nonquote, start;
+
+    if (mln_json_classify_handler == NULL)
+        mln_json_classify_handler = mln_json_classify_select();
+
+    ix->n = ix->cur = 0;
+    while (ix->off < ix->len && ix->n < ix->want) {
+        if (ix->len - ix->off >= 64) {
+            p = ix->data + ix->off;
+        } else {
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, ix->data + ix->off, ix->len - ix->off);
+            p = tail;
+        }
+        mln_json_classify_handler(p, &m);
+
+        /*characters escaped by an odd number of backslashes*/
+        if (m.bs == 0) {
+            escaped = ix->prev_escaped;
+            ix->prev_escaped = 0;
+        } else {
+            potential = m.bs & ~ix->prev_escaped;
+            code = (((potential << 1) | M_JSON_ODD_BITS) - potential) ^ M_JSON_ODD_BITS;
+            escaped = code ^ (m.bs | ix->prev_escaped);
+            ix->prev_escaped = (code & m.bs) >> 63;
+        }
+
+        quote = m.quote & ~escaped;
+        /*opening quotes and string contents, closing quotes are excluded*/
+        in_string = mln_json_prefix_xor(quote) ^ ix->prev_in_string;
+        ix->prev_in_string = (mln_u64_t)((mln_s64_t)in_string >> 63);
+
+        scalar = ~(m.op | m.ws);
+        nonquote = scalar & ~quote;
+        start = m.op | (scalar & ~((nonquote << 1) | ix->prev_scalar));
+        ix->prev_scalar = nonquote >> 63;
+        start = (start & ~(in_string ^ quote)) | (quote & ~in_string);
+
+        for (; start; start &= start - 1)
+            ix->pos[ix->n++] = ix->off + __builtin_ctzll(start);
+        ix->off += 64;
+    }
+    if (ix->want < M_JSON_INDEX_LEN) ix->want <<= 1;
+
+    return ix->n? 0: -1;
+}
+
+static inline int mln_json_index_next(mln_json_index_t *ix, mln_u64_t *pos)
+{
+    if (ix->cur >= ix->n && mln_json_index_fill(ix) < 0) return -1;
+    *pos = ix->pos[ix->cur++];
+    return 0;
+}
+
+/*
+ * The position of the next token, or the input length if there is no more token.
+ */
+static inline mln_u64_t mln_json_index_peek(mln_json_index_t *ix)
+{
+    if (ix->cur >= ix->n && mln_json_index_fill(ix) < 0) return ix->len;
+    return ix->pos[ix->cur];
+}
+
+static int mln_json_index_value(mln_json_index_t *ix, mln_alloc_t *pool, mln_json_t *j, mln_u64_t pos)
+{
+    switch (ix->data[pos]) {
+        case (mln_u8_t)'{':
+            return mln_json_index_obj(ix, pool, j);
+        case (mln_u8_t)'[':
+            return mln_json_index_array(ix, pool, j);
+        case (mln_u8_t)'\"':
+            return mln_json_index_string(ix, pool, j, pos);
+        case (mln_u8_t)'}':
+        case (mln_u8_t)']':
+        case (mln_u8_t)':':
+        case (mln_u8_t)',':
+            return -1;
+        default:
+            break;
+    }
+    return mln_json_index_scalar(ix, j, pos);
+}
+
+static int mln_json_index_obj(mln_json_index_t *ix, mln_alloc_t *pool, mln_json_t *val)
+{
+    mln_json_t key, v;
+    mln_u8ptr_t data = ix->data;
+    mln_u64_t pos;
+
+    if (pool != NULL) {
+        if (mln_json_obj_pool_init(val, pool) < 0) return -1;
+    } else {
+        if (mln_json_obj_init(val) < 0) return -1;
+    }
+
+    if (mln_json_index_next(ix, &pos) < 0) return -1;
+    if (data[pos] == (mln_u8_t)'}') return 0;
+
+    while (1) {
+        if (data[pos] != (mln_u8_t)'\"') return -1;
+
+        mln_json_init(&key);
+        mln_json_init(&v);
+        if (mln_json_index_string(ix, pool, &key, pos) < 0) {
+            return -1;
+        }
+        if (mln_json_index_next(ix, &pos) < 0 || data[pos] != (mln_u8_t)':') {
+            mln_json_destroy(&key);
+            return -1;
+        }
+        if (mln_json_index_next(ix, &pos) < 0 || mln_json_index_value(ix, pool, &v, pos) < 0) {
+            mln_json_destroy(&key);
+            mln_json_destroy(&v);
+            return -1;
+        }
+        if (__mln_json_obj_update(val, &key, &v) < 0) {
+            mln_json_destroy(&key);
+            mln_json_destroy(&v);
+            return -1;
+        }
+
+        if (mln_json_index_next(ix, &pos) < 0) return -1;
+        if (data[pos] == (mln_u8_t)'}') break;
+        if (data[pos] != (mln_u8_t)',' || mln_json_index_next(ix, &pos) < 0) return -1;
+        /*a trailing comma is tolerated as the previous parser did*/
+        if (data[pos] == (mln_u8_t)'}') break;
+    }
+
+    return 0;
+}
+
+static int mln_json_index_array(mln_json_index_t *ix, mln_alloc_t *pool, mln_json_t *val)
+{
+    mln_json_t j;
+    mln_u8ptr_t data = ix->data;
+    mln_u64_t pos;
+
+    if (pool != NULL) {
+        if (mln_json_array_pool_init(val, pool) < 0) return -1;
+    } else {
+        if (mln_json_array_init(val) < 0) return -1;
+    }
+
+    if (mln_json_index_next(ix, &pos) < 0) return -1;
+    if (data[pos] == (mln_u8_t)']') return 0;
+
+    while (1) {
+        mln_json_init(&j);
+        if (mln_json_index_value(ix, pool, &j, pos) < 0 || __mln_json_array_append(val, &j) < 0) {
+            mln_json_destroy(&j);
+            return -1;
+        }
+
+        if (mln_json_index_next(ix, &pos) < 0) return -1;
+        if (data[pos] == (mln_u8_t)']') break;
+        if (data[pos] != (mln_u8_t)',' || mln_json_index_next(ix, &pos) < 0) return -1;
+        /*a trailing comma is tolerated as the previous parser did*/
+        if (data[pos] == (mln_u8_t)']') break;
+    }
+
+    return 0;
+}
+
+static int mln_json_index_string(mln_json_index_t *ix, mln_alloc_t *pool, mln_json_t *j, mln_u64_t pos)
+{
+    mln_u64_t end;
+    mln_string_t *str;
+    int count;
+
+    /*the next position of an opening quote is always its closing quote*/
+    if (mln_json_index_next(ix, &end) < 0 || ix->data[end] != (mln_u8_t)'\"') return -1;
+    if (end - pos - 1 > 0x7fffffff) return -1;
+    count = end - pos - 1;
+
+    if (ix->ref && memchr(ix->data + pos + 1, '\\', count) == NULL) {
+        if (pool != NULL)
+            str = (mln_string_t *)mln_alloc_m(pool, sizeof(mln_string_t));
+        else
+            str = (mln_string_t *)malloc(sizeof(mln_string_t));
+        if (str == NULL) {
+            return -1;
+        }
+        mln_string_nset(str, ix->data + pos + 1, count);
+        str->pool = pool != NULL;
+        mln_json_string_init(j, str);
+        return 0;
+    }
+
+    if ((str = mln_json_string_build(pool, ix->data + pos + 1, count)) == NULL) {
+        return -1;
+    }
+    mln_json_string_init(j, str);
+
+    return 0;
+}
+
+/*
+ * The unescaped string is never longer than the escaped one,
+ * so the structure and its data are allocated in one block.
+ */
+static mln_string_t *mln_json_string_build(mln_alloc_t *pool, mln_u8ptr_t raw, int count)
+{
+    mln_string_t *str;
+
+    if (pool != NULL)
+        str = (mln_string_t *)mln_alloc_m(pool, sizeof(mln_string_t) + count + 1);
+    else
+        str = (mln_string_t *)malloc(sizeof(mln_string_t) + count + 1);
+    if (str == NULL) {
+        return NULL;
+    }
+    str->data = (mln_u8ptr_t)(str + 1);
+    str->data_ref = 1;
+    str->pool = pool != NULL;
+    str->ref = 1;
+
+    if ((count = mln_json_parse_string_fetch(raw, count, str->data)) < 0) {
+        mln_string_free(str);
+        return NULL;
+    }
+    str->data[count] = 0;
+    str->len = count;
+
+    return str;
+}
+
+/*
+ * A scalar must be followed by blanks and then the next token (or the end of input),
+ * otherwise there is garbage which is not indexed, e.g. '1' in "true1".
+ */
+static int mln_json_index_scalar(mln_json_index_t *ix, mln_json_t *j, mln_u64_t pos)
+{
+    char *s = (char *)(ix->data + pos);
+    int len, left;
+
+    len = ix->len - pos > 0x7fffffff? 0x7fffffff: (int)(ix->len - pos);
+    if ((left = mln_json_scalar_build(j, s, len)) < 0) return -1;
+
+    s += len - left;
+    mln_json_jumpoff_blank(&s, &left);
+    if ((mln_u8ptr_t)s != ix->data + mln_json_index_peek(ix)) return -1;
+
+    return 0;
+}
+
+/*
+ * Returns the length of the rest of s, or -1 if s does not start with a number, true, false or null.
+ */
+static int mln_json_scalar_build(mln_json_t *j, char *s, int len)
+{
+    int left;
+
+    if (isdigit(s[0]) || s[0] == '-')
+        return mln_json_parse_digit(j, s, len, 0);
+    if ((left = mln_json_parse_true(j, s, len, 0)) >= 0)
+        return left;
+    if ((left = mln_json_parse_false(j, s, len, 0)) >= 0)
+        return left;
+    return mln_json_parse_null(j, s, len, 0);
+}
+
+/*
+ * stage 1 classifiers, each of them classifies 64 bytes into bitmasks.
+ */
+#if !defined(__SSE2__) && !defined(MLN_JSON_NEON)
+static void mln_json_classify_scalar(mln_u8ptr_t p, mln_json_masks_t *m)
+{
+    mln_u64_t bit;
+    mln_u8_t c;
+    int i;
+
+    m->quote = m->bs = m->op = m->ws = 0;
+    for (i = 0; i < 64; ++i) {
+        if ((c = mln_json_class[p[i]]) == 0) continue;
+        bit = (mln_u64_t)1 << i;
+        if (c == M_JSON_C_QUOTE) m->quote |= bit;
+        else if (c == M_JSON_C_BS) m->bs |= bit;
+        else if (c == M_JSON_C_OP) m->op |= bit;
+        else m->ws |= bit;
+    }
+}
+#endif
+
+#if defined(__SSE2__)
+static void mln_json_classify_sse2(mln_u8ptr_t p, mln_json_masks_t *m)
+{
+    const __m128i quote = _mm_set1_epi8('\"'), bs = _mm_set1_epi8('\\');
+    const __m128i lower = _mm_set1_epi8(0x20), lbrace = _mm_set1_epi8('{'), rbrace = _mm_set1_epi8('}');
+    const __m128i colon = _mm_set1_epi8(':'), comma = _mm_set1_epi8(',');
+    const __m128i sp = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t'), lf = _mm_set1_epi8('\n'), cr = _mm_set1_epi8('\r');
+    __m128i v, l;
+    int i;
+
+    m->quote = m->bs = m->op = m->ws = 0;
+    for (i = 0; i < 64; i += 16) {
+        v = _mm_loadu_si128((const __m128i *)(p + i));
+        /*'[' and ']' become '{' and '}'*/
+        l = _mm_or_si128(v, lower);
+        m->quote |= (mln_u64_t)(mln_u16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)) << i;
+        m->bs |= (mln_u64_t)(mln_u16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, bs)) << i;
+        m->op |= (mln_u64_t)(mln_u16_t)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(l, lbrace), \
+                                                                                   _mm_cmpeq_epi8(l, rbrace)), \
+                                                                      _mm_or_si128(_mm_cmpeq_epi8(v, colon), \
+                                                                                   _mm_cmpeq_epi8(v, comma)))) << i;
+        m->ws |= (mln_u64_t)(mln_u16_t)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, sp), \
+                                                                                   _mm_cmpeq_epi8(v, tab)), \
+                                                                      _mm_or_si128(_mm_cmpeq_epi8(v, lf), \
+                                                                                   _mm_cmpeq_epi8(v, cr)))) << i;
+    }
+}
+#endif
+
+#if defined(MLN_JSON_AVX2)
+__attribute__((target("avx2")))
+static void mln_json_classify_avx2(mln_u8ptr_t p, mln_json_masks_t *m)
+{
+    const __m256i quote = _mm256_set1_epi8('\"'), bs = _mm256_set1_epi8('\\');
+    const __m256i lower = _mm256_set1_epi8(0x20), lbrace = _mm256_set1_epi8('{'), rbrace = _mm256_set1_epi8('}');
+    const __m256i colon = _mm256_set1_epi8(':'), comma = _mm256_set1_epi8(',');
+    const __m256i sp = _mm256_set1_epi8(' '), tab = _mm256_set1_epi8('\t'), lf = _mm256_set1_epi8('\n'), cr = _mm256_set1_epi8('\r');
+    __m256i v, l;
+    int i;
+
+    m->quote = m->bs = m->op = m->ws = 0;
+    for (i = 0; i < 64; i += 32) {
+        v = _mm256_loadu_si256((const __m256i *)(p + i));
+        l = _mm256_or_si256(v, lower);
+        m->quote |= (mln_u64_t)(mln_u32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quote)) << i;
+        m->bs |= (mln_u64_t)(mln_u32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, bs)) << i;
+        m->op |= (mln_u64_t)(mln_u32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(l, lbrace), \
+                                                                                            _mm256_cmpeq_epi8(l, rbrace)), \
+                                                                            _mm256_or_si256(_mm256_cmpeq_epi8(v, colon), \
+                                                                                            _mm256_cmpeq_epi8(v, comma)))) << i;
+        m->ws |= (mln_u64_t)(mln_u32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, sp), \
+                                                                                            _mm256_cmpeq_epi8(v, tab)), \
+                                                                            _mm256_or_si256(_mm256_cmpeq_epi8(v, lf), \
+                                                                                            _mm256_cmpeq_epi8(v, cr)))) << i;
+    }
+}
+#endif
+
+#if defined(MLN_JSON_NEON)
+static inline mln_u64_t mln_json_movemask_neon(uint8x16_t a, uint8x16_t b, uint8x16_t c, uint8x16_t d)
+{
+    const uint8x16_t bit = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, \
+                            0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
+    uint8x16_t s0 = vpaddq_u8(vandq_u8(a, bit), vandq_u8(b, bit));
+    uint8x16_t s1 = vpaddq_u8(vandq_u8(c, bit), vandq_u8(d, bit));
+
+    s0 = vpaddq_u8(s0, s1);
+    s0 = vpaddq_u8(s0, s0);
+    return vgetq_lane_u64(vreinterpretq_u64_u8(s0), 0);
+}
+
+static void mln_json_classify_neon(mln_u8ptr_t p, mln_json_masks_t *m)
+{
+    uint8x16_t v[4], q[4], b[4], o[4], w[4], l;
+    int i;
+
+    for (i = 0; i < 4; ++i) {
+        v[i] = vld1q_u8(p + (i << 4));
+        l = vorrq_u8(v[i], vdupq_n_u8(0x20));
+        q[i] = vceqq_u8(v[i], vdupq_n_u8('\"'));
+        b[i] = vceqq_u8(v[i], vdupq_n_u8('\\'));
+        o[i] = vorrq_u8(vorrq_u8(vceqq_u8(l, vdupq_n_u8('{')), vceqq_u8(l, vdupq_n_u8('}'))), \
+                        vorrq_u8(vceqq_u8(v[i], vdupq_n_u8(':')), vceqq_u8(v[i], vdupq_n_u8(','))));
+        w[i] = vorrq_u8(vorrq_u8(vceqq_u8(v[i], vdupq_n_u8(' ')), vceqq_u8(v[i], vdupq_n_u8('\t'))), \
+                        vorrq_u8(vceqq_u8(v[i], vdupq_n_u8('\n')), vceqq_u8(v[i], vdupq_n_u8('\r'))));
+    }
+    m->quote = mln_json_movemask_neon(q[0], q[1], q[2], q[3]);
+    m->bs = mln_json_movemask_neon(b[0], b[1], b[2], b[3]);
+    m->op = mln_json_movemask_neon(o[0], o[1], o[2], o[3]);
+    m->ws = mln_json_movemask_neon(w[0], w[1], w[2], w[3]);
+}
+#endif
+
+static mln_json_classify_handler_t mln_json_classify_select(void)
+{
+#if defined(MLN_JSON_AVX2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return mln_json_classify_avx2;
+#endif
+#if defined(__SSE2__)
+    return mln_json_classify_sse2;
+#elif defined(MLN_JSON_NEON)
+    return mln_json_classify_neon;
+#else
+    return mln_json_classify_scalar;
+#endif
+}
+
+static int mln_json_parse_string_fetch(mln_u8ptr_t jstr, int len, mln_u8ptr_t buf)
+{
+    int c, n, count = 0;
+    unsigned int hex = 0;
+    mln_u8ptr_t p = jstr, q = buf, e;
+
+    while (len > 0) {
+        /*copy the bytes before the next backslash at once*/
+        if ((e = (mln_u8ptr_t)memchr(p, '\\', len)) == NULL) e = p + len;
+        if ((n = e - p) > 0) {
+            memcpy(q, p, n);
+            p += n;
+            q += n;
+            len -= n;
+            count += n;
+            continue;
+        }
+        c = mln_json_get_char(&p, &len, &hex);
+        if (c < 0) {
+            return -1;
+        } else if (c == 0) {
+            mln_json_encode_utf8(hex, &q, &count);
+        } else {
+            *q++ = (mln_u8_t)c;
+            ++count;
+        }
+    }
+    return count;
+}
+
+static void mln_json_encode_utf8(unsigned int u, mln_u8ptr_t *b, int *count)
+{
+    mln_u8ptr_t buf = *b;
+    if (u <= 0x7f) {
+        *buf++ = u & 0xFF;
+        ++(*count);
+    } else if (u <= 0x7FF) {
+        *buf++ = 0xC0 | ((u >> 6) & 0xFF);
+        *buf++ = 0x80 | ((u) & 0x3F);
+        (*count) += 2;
+    } else if (u <= 0xFFFF) {
+        *buf++ = 0xE0 | ((u >> 12) & 0xFF);
+        *buf++ = 0x80 | ((u >> 6) & 0x3F);
+        *buf++ = 0x80 | ((u) & 0x3F);
+        (*count) += 3;
+    } else {
+        *buf++ = 0xF0 | ((u >> 18) & 0xFF);
+        *buf++ = 0x80 | ((u >> 12) & 0x3F);
+        *buf++ = 0x80 | ((u >> 6) & 0x3F);
+        *buf++ = 0x80 | (u & 0x3F);
+        (*count) += 4;
+    }
+    *b = buf;
+}
+
+static inline int mln_json_char2int(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return c;
+}
+
+static inline int mln_json_get_char(mln_u8ptr_t *s, int *len, unsigned int *hex)
+{
+    if (*len <= 0) return 0;
+
+    if ((*s)[0] == (mln_u8_t)'\\' && *len > 1) {
+        switch ((*s)[1]) {
+            case (mln_u8_t)'\"':
+                (*s) += 2;
+                (*len) -= 2;
+                return '\"';
+            case (mln_u8_t)'\\':
+                (*s) += 2;
+                (*len) -= 2;
+                return '\\';
+            case (mln_u8_t)'/':
+                (*s) += 2;
+                (*len) -= 2;
+                return '/';
+            case (mln_u8_t)'b':
+                (*s) += 2;
+                (*len) -= 2;
+                return '\b';
+            case (mln_u8_t)'f':
+                (*s) += 2;
+                (*len) -= 2;
+                return '\f';
+            case (mln_u8_t)'n':
+                (*s) += 2;
+                (*len) -= 2;
+                return '\n';
+            case (mln_u8_t)'r':
+                (*s) += 2;
+                (*len) -= 2;
+                return '\r';
+            case (mln_u8_t)'t':
+                (*s) += 2;
+                (*len) -= 2;
+                return '\t';
+            case (mln_u8_t)'u': {
+                (*s) += 2;
+                (*len) -= 2;
+                if (*len < 4) return -1;
+                unsigned int h = 0;
+                h = mln_json_char2int(*(*s)++);
+                h <<= 4;
+                h |= mln_json_char2int(*(*s)++);
+                h <<= 4;
+                h |= mln_json_char2int(*(*s)++);
+                h <<= 4;
+                h |= mln_json_char2int(*(*s)++);
+                (*len) -= 4;
+                *hex = h;
+                return 0;
+            } default:
+                return -1;
+        }
+    }
+
+    switch ((*s)[0]) {
+        case (mln_u8_t)'\\':
+            return -1;
+        default:
+            break;
+    }
+    (*len) -= 1;
+    return *((*s)++);
+}
+
+/*
+ * Integral literals are kept as 64-bit integers (unsigned only if they do not fit
+ * in mln_s64_t), the others are converted to the nearest double by the Clinger fast
+ * path or Eisel-Lemire. A literal with more than 19 significant digits falls back to
+ * strtod in the rare case that its first 19 digits are not enough to decide.
+ */
+static int
+mln_json_parse_digit(mln_json_t *j, char *jstr, int len, mln_uauto_t index)
+{
+    mln_u8ptr_t p = (mln_u8ptr_t)jstr, end = p + len, istart, iend, fstart = NULL, fend = NULL;
+    mln_u64_t w = 0;
+    mln_s64_t e = 0, exp10 = 0;
+    int neg = 0, ndigits;
+    double d;
+
+    if (*p == '-') {
+        neg = 1;
+        ++p;
+    }
+
+    /*all digits are accumulated into w, it is exact if there are at most 19 of them*/
+    for (istart = p; p < end && M_JSON_IS_DIGIT(*p); ++p)
+        w = w * 10 + (*p - '0');
+    iend = p;
+    if (iend == istart || (*istart == '0' && iend - istart > 1)) return -1;
+    ndigits = iend - istart;
+
+    if (p < end && *p == '.') {
+        for (fstart = ++p; p < end && M_JSON_IS_DIGIT(*p); ++p)
+            w = w * 10 + (*p - '0');
+        if (p == fstart) return -1;
+        fend = p;
+        ndigits += fend - fstart;
+        e = -(fend - fstart);
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        int esign = 1;
+        if (++p < end && (*p == '+' || *p == '-')) {
+            if (*p++ == '-') esign = -1;
+        }
+        if (p >= end || !M_JSON_IS_DIGIT(*p)) return -1;
+        for (; p < end && M_JSON_IS_DIGIT(*p); ++p) {
+            /*large enough to be zero or infinity*/
+            if (exp10 < 0x10000) exp10 = exp10 * 10 + (*p - '0');
+        }
+        e += esign * exp10;
+    } else if (fstart == NULL && (ndigits < 20 || (ndigits == 20 && *istart == '1' && w > 0x7fffffffffffffffULL))) {
+        /*
+         * An integer. A 20-digit one starting with 1 fits in 64 bits only if w is at least
+         * 10^19, otherwise w wrapped around and is less than 2^63.
+         */
+        if (!neg) {
+            if (w <= 0x7fffffffffffffffULL) mln_json_int_init(j, w);
+            else mln_json_uint_init(j, w);
+            return end - p;
+        }
+        /*-0 is left to the double path to keep its sign*/
+        if (w && w <= 0x8000000000000000ULL) {
+            mln_json_int_init(j, (mln_s64_t)(0 - w));
+            return end - p;
+        }
+    }
+
+    if (ndigits > 19) {
+        /*keep only the first 19 significant digits, the exponent is counted again*/
+        if (fstart != NULL) e += fend - fstart;
+        ndigits = 0;
+        w = 0;
+        for (; istart < iend && *istart == '0'; ++istart)
+            ;
+        if (istart == iend && fstart != NULL) {
+            for (; fstart < fend && *fstart == '0'; ++fstart, --e)
+                ;
+        }
+        for (; istart < iend; ++istart, ++ndigits) {
+            if (ndigits < 19) w = w * 10 + (*istart - '0');
+            else ++e;
+        }
+        for (; fstart != NULL && fstart < fend; ++fstart, ++ndigits) {
+            if (ndigits >= 19) continue;
+            w = w * 10 + (*fstart - '0');
+            --e;
+        }
+    }
+
+    if (mln_json_number_compute(w, e, ndigits > 19, &d) < 0) {
+        char buf[64], *s = buf;
+        if (p - (mln_u8ptr_t)jstr >= (int)sizeof(buf) && (s = (char *)malloc(p - (mln_u8ptr_t)jstr + 1)) == NULL)
+            return -1;
+        memcpy(s, jstr, p - (mln_u8ptr_t)jstr);
+        s[p - (mln_u8ptr_t)jstr] = 0;
+        d = strtod(s, NULL);
+        if (s != buf) free(s);
+        mln_json_number_init(j, d);
+        return end - p;
+    }
+    mln_json_number_init(j, neg? -d: d);
+
+    return end - p;
+}
+
+/*
+ * w * 10^q as a correctly rounded positive double. truncated means that w holds only
+ * the leading digits, then the result is accepted only if w + 1 rounds to the same.
+ * Returns -1 if the result can not be decided here.
+ */
+static int mln_json_number_compute(mln_u64_t w, mln_s64_t q, int truncated, double *out)
+{
+    static const double pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    mln_u64_t bits;
+
+    if (w == 0) {
+        *out = 0;
+        return 0;
+    }
+
+#if !defined(FLT_EVAL_METHOD) || FLT_EVAL_METHOD == 0
+    /*both w and 10^|q| are exact doubles, so is the result after one rounding*/
+    if (!truncated && q >= -22 && q <= 22 && w <= 0x20000000000000ULL) {
+        *out = q < 0? (double)w / pow10[-q]: (double)w * pow10[q];
+        return 0;
+    }
+#endif
+
+    bits = mln_json_eisel_lemire(w, q);
+    if (truncated && mln_json_eisel_lemire(w + 1, q) != bits) return -1;
+
+    memcpy(out, &bits, sizeof(double));
+    return 0;
+}
+
+/*
+ * Eisel-Lemire (Daniel Lemire, "Number Parsing at a Gigabyte per Second"),
+ * returns the bits of the double nearest to w * 10^q, w must not be 0.
+ */
+static mln_u64_t mln_json_eisel_lemire(mln_u64_t w, mln_s64_t q)
+{
+    mln_u64_t hi, lo, hi2, lo2, mantissa;
+    int lz, upperbit, shift;
+    mln_s64_t power2;
+    const mln_u64_t *pow5;
+
+    if (q < -342) return 0;
+    if (q > 308) return 0x7ff0000000000000ULL;
+
+    lz = __builtin_clzll(w);
+    w <<= lz;
+
+    /*the product of w and 5^q, the second half of 5^q is needed only near a boundary*/
+    pow5 = &mln_json_pow5_128[(q + 342) << 1];
+    mln_json_mul128(w, pow5[0], &hi, &lo);
+    if ((hi & 0x1ff) == 0x1ff) {
+        mln_json_mul128(w, pow5[1], &hi2, &lo2);
+        lo += hi2;
+        if (hi2 > lo) ++hi;
+    }
+
+    upperbit = (int)(hi >> 63);
+    shift = upperbit + 64 - 52 - 3;
+    mantissa = hi >> shift;
+    power2 = (((152170 + 65536) * q) >> 16) + 63 + upperbit - lz + 1023;
+
+    if (power2 <= 0) {
+        /*subnormal*/
+        if (-power2 + 1 >= 64) return 0;
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        power2 = mantissa < (1ULL << 52)? 0: 1;
+        return ((mln_u64_t)power2 << 52) | (mantissa & ((1ULL << 52) - 1));
+    }
+
+    /*exactly halfway between two doubles, round to even*/
+    if (lo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 && (mantissa << shift) == hi)
+        mantissa &= ~1ULL;
+
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= (2ULL << 52)) {
+        mantissa = 1ULL << 52;
+        ++power2;
+    }
+    if (power2 >= 0x7ff) return 0x7ff0000000000000ULL;
+
+    return ((mln_u64_t)power2 << 52) | (mantissa & ((1ULL << 52) - 1));
+}
+
+static inline void mln_json_mul128(mln_u64_t a, mln_u64_t b, mln_u64_t *hi, mln_u64_t *lo)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 r = (unsigned __int128)a * b;
+    *hi = (mln_u64_t)(r >> 64);
+    *lo = (mln_u64_t)r;
+#else
+    mln_u64_t ah = a >> 32, al = a & 0xffffffffULL, bh = b >> 32, bl = b & 0xffffffffULL;
+    mln_u64_t ll = al * bl, lh = al * bh, hl = ah * bl, hh = ah * bh;
+    mln_u64_t mid = (ll >> 32) + (lh & 0xffffffffULL) + (hl & 0xffffffffULL);
+
+    *lo = (mid << 32) | (ll & 0xffffffffULL);
+    *hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+}
+
+static inline int
+mln_json_parse_true(mln_json_t *j, char *jstr, int len, mln_uauto_t index)
+{
+    if (len < 4) {
+        return -1;
+    }
+
+    if (strncasecmp(jstr, "true", 4)) {
+        return -1;
+    }
+    mln_json_true_init(j);
+
+    return len - 4;
+}
+
+static inline int
+mln_json_parse_false(mln_json_t *j, char *jstr, int len, mln_uauto_t index)
+{
+    if (len < 5) {
+        return -1;
+    }
+
+    if (strncasecmp(jstr, "false", 5)) {
+        return -1;
+    }
+    mln_json_false_init(j);
+
+    return len - 5;
+}
+
+static inline int
+mln_json_parse_null(mln_json_t *j, char *jstr, int len, mln_uauto_t index)
+{
+    if (len < 4) {
+        return -1;
+    }
+
+    if (strncasecmp(jstr, "null", 4)) {
+        return -1;
+    }
+    mln_json_null_init(j);
+
+    return len - 4;
+}
+
+static inline void mln_json_jumpoff_blank(char **jstr, int *len)
+{
+    for (; \
+         *len > 0 && (*jstr[0] == ' ' || *jstr[0] == '\t' || *jstr[0] == '\r' || *jstr[0] == '\n'); \
+         ++(*jstr), --(*len))
+        ;
+}
+
+
+struct mln_json_tmp_s {
+    void *ptr1;
+    void *ptr2;
+};
+
+/*
+ * encode
+ *
+ * The tree is walked once, and the output is written through a window
+ * [pos, end) which is refilled by the sink (a growing buffer, chain buffers
+ * or nothing but counting for a caller-supplied buffer).
+ */
+mln_string_t *mln_json_encode(mln_json_t *j)
+{
+    return mln_json_encode_string(j, 0);
+}
+
+mln_string_t *mln_json_cbor_encode(mln_json_t *j)
+{
+    return mln_json_encode_string(j, M_JSON_ENCODE_CBOR);
+}
+
+mln_string_t *mln_json_msgpack_encode(mln_json_t *j)
+{
+    return mln_json_encode_string(j, M_JSON_ENCODE_MSGPACK);
+}
+
+static mln_string_t *mln_json_encode_string(mln_json_t *j, mln_u32_t flags)
+{
+    mln_json_writer_t w;
+    mln_string_t *s;
+
+    w.start = w.pos = w.end = NULL;
+    w.len = 0;
+    w.refill = mln_json_writer_string_refill;
+    w.data = NULL;
+    w.pretty = 0;
+    w.failed = 0;
+    w.depth = 0;
+
+    mln_json_write_root(&w, j, flags);
+    /*keep the result null-terminated*/
+    mln_json_write_char(&w, 0);
+    if (w.failed || (s = mln_string_buf_new(w.start, w.len - 1)) == NULL) {
+        free(w.start);
+        return NULL;
+    }
+
+    return s;
+}
+
+mln_size_t mln_json_encode_buf(mln_json_t *j, mln_u8ptr_t buf, mln_size_t size, mln_u32_t flags)
+{
+    mln_json_writer_t w;
+
+    w.start = w.pos = buf;
+    w.end = buf == NULL? buf: buf + size;
+    w.len = 0;
+    w.refill = NULL;
+    w.data = NULL;
+    w.pretty = !!(flags & M_JSON_ENCODE_PRETTY);
+    w.failed = 0;
+    w.depth = 0;
+
+    mln_json_write_root(&w, j, flags);
+
+    return w.len;
+}
+
+int mln_json_encode_chain(mln_json_t *j, mln_alloc_t *pool, mln_chain_t **out_head, mln_chain_t **out_tail, mln_u32_t flags)
+{
+    mln_json_writer_t w;
+    mln_chain_t *head = NULL, *tail = NULL;
+    struct mln_json_tmp_s tmp;
+
+    tmp.ptr1 = &head;
+    tmp.ptr2 = &tail;
+
+    w.start = w.pos = w.end = NULL;
+    w.len = 0;
+    w.refill = mln_json_writer_chain_refill;
+    w.data = &tmp;
+    w.pool = pool;
+    w.pretty = !!(flags & M_JSON_ENCODE_PRETTY);
+    w.failed = 0;
+    w.depth = 0;
+
+    mln_json_write_root(&w, j, flags);
+    if (w.failed) {
+        mln_chain_pool_release_all(head);
+        return -1;
+    }
+    if (tail != NULL) {
+        tail->buf->last = w.pos;
+        tail->buf->last_buf = 1;
+        mln_chain_add(out_head, out_tail, head);
+        *out_tail = tail;
+    }
+
+    return 0;
+}
+
+static int mln_json_writer_string_refill(mln_json_writer_t *w, mln_size_t n)
+{
+    mln_size_t used = w->pos - w->start, size = (w->end - w->start) << 1;
+    mln_u8ptr_t buf;
+
+    if (size < used + n) size = used + n;
+    if (size < 256) size = 256;
+    if ((buf = (mln_u8ptr_t)realloc(w->start, size)) == NULL) return -1;
+
+    w->start = buf;
+    w->pos = buf + used;
+    w->end = buf + size;
+    return 0;
+}
+
+static int mln_json_writer_chain_refill(mln_json_writer_t *w, mln_size_t n)
+{
+    struct mln_json_tmp_s *tmp = (struct mln_json_tmp_s *)(w->data);
+    mln_chain_t **head = (mln_chain_t **)(tmp->ptr1), **tail = (mln_chain_t **)(tmp->ptr2), *c;
+    mln_size_t size = n > M_JSON_CHAIN_BUF_LEN? n: M_JSON_CHAIN_BUF_LEN;
+    mln_buf_t *b;
+    mln_u8ptr_t buf;
+
+    if (*tail != NULL) (*tail)->buf->last = w->pos;
+
+    if ((c = mln_chain_new(w->pool)) == NULL) return -1;
+    if ((b = mln_buf_new(w->pool)) == NULL) {
+        mln_chain_pool_release(c);
+        return -1;
+    }
+    c->buf = b;
+    if ((buf = (mln_u8ptr_t)mln_alloc_m(w->pool, size)) == NULL) {
+        mln_chain_pool_release(c);
+        return -1;
+    }
+    b->left_pos = b->pos = b->start = b->last = buf;
+    b->end = buf + size;
+    b->in_memory = 1;
+    mln_chain_add(head, tail, c);
+
+    w->pos = buf;
+    w->end = buf + size;
+    return 0;
+}
+
+static void mln_json_write(mln_json_writer_t *w, const void *data, mln_size_t n)
+{
+    mln_u8ptr_t p = (mln_u8ptr_t)data;
+    mln_size_t k;
+
+    w->len += n;
+    while (n > 0 && !w->failed) {
+        if (w->pos >= w->end) {
+            /*a caller-supplied buffer is never refilled, the rest is only counted*/
+            if (w->refill == NULL) return;
+            if (w->refill(w, n) < 0) {
+                w->failed = 1;
+                return;
+            }
+        }
+        k = w->end - w->pos;
+        if (k > n) k = n;
+        memcpy(w->pos, p, k);
+        w->pos += k;
+        p += k;
+        n -= k;
+    }
+}
+
+static inline void mln_json_write_char(mln_json_writer_t *w, mln_u8_t c)
+{
+    if (w->pos < w->end) {
+        *(w->pos)++ = c;
+        ++(w->len);
+        return;
+    }
+    mln_json_write(w, &c, 1);
+}
+
+static void mln_json_write_root(mln_json_writer_t *w, mln_json_t *j, mln_u32_t flags)
+{
+    if (j == NULL) return;
+
+    if (flags & M_JSON_ENCODE_CBOR)
+        mln_json_cbor_write(w, j);
+    else if (flags & M_JSON_ENCODE_MSGPACK)
+        mln_json_msgpack_write(w, j);
+    else
+        mln_json_write_value(w, j);
+}
+
+static inline void mln_json_write_indent(mln_json_writer_t *w)
+{
+    mln_u32_t n = w->depth << 1;
+
+    mln_json_write_char(w, '\n');
+    for (; n > 0; --n) mln_json_write_char(w, ' ');
+}
+
+static void mln_json_write_value(mln_json_writer_t *w, mln_json_t *j)
+{
+    char num[32];
+    mln_json_t *el, *elend;
+    mln_json_kv_t *kv, *kvend;
+    int first, n;
+
+    if (j == NULL) return;
+
+    switch (j->type) {
+        case M_JSON_OBJECT:
+            kv = (mln_json_kv_t *)mln_array_elts(&(mln_json_object_data_get(j)->kvs));
+            kvend = kv + mln_array_nelts(&(mln_json_object_data_get(j)->kvs));
+            mln_json_write_char(w, '{');
+            ++(w->depth);
+            for (first = 1; kv < kvend; ++kv, first = 0) {
+                if (!first) mln_json_write_char(w, ',');
+                if (w->pretty) mln_json_write_indent(w);
+                mln_json_write_value(w, &(kv->key));
+                mln_json_write_char(w, ':');
+                if (w->pretty) mln_json_write_char(w, ' ');
+                mln_json_write_value(w, &(kv->val));
+            }
+            --(w->depth);
+            if (w->pretty && !first) mln_json_write_indent(w);
+            mln_json_write_char(w, '}');
+            break;
+        case M_JSON_ARRAY:
+            el = (mln_json_t *)mln_array_elts(mln_json_array_data_get(j));
+            elend = el + mln_array_nelts(mln_json_array_data_get(j));
+            mln_json_write_char(w, '[');
+            ++(w->depth);
+            for (first = 1; el < elend; ++el, first = 0) {
+                if (!first) mln_json_write_char(w, ',');
+                if (w->pretty) mln_json_write_indent(w);
+                mln_json_write_value(w, el);
+            }
+            --(w->depth);
+            if (w->pretty && !first) mln_json_write_indent(w);
+            mln_json_write_char(w, ']');
+            break;
+        case M_JSON_STRING:
+            mln_json_write_string(w, j->data.m_j_string);
+            break;
+        case M_JSON_NUM:
+            if (j->num_type == M_JSON_NUM_INT)
+                n = mln_json_integer_format(j->data.m_j_int < 0? -(mln_u64_t)j->data.m_j_int: (mln_u64_t)j->data.m_j_int, j->data.m_j_int < 0, num);
+            else if (j->num_type == M_JSON_NUM_UINT)
+                n = mln_json_integer_format(j->data.m_j_uint, 0, num);
+            else
+                n = mln_json_number_format(j->data.m_j_number, num);
+            mln_json_write(w, num, n);
+            break;
+        case M_JSON_TRUE:
+            mln_json_write(w, "true", 4);
+            break;
+        case M_JSON_FALSE:
+            mln_json_write(w, "false", 5);
+            break;
+        case M_JSON_NULL:
+            mln_json_write(w, "null", 4);
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ * Only '"' and '\\' are escaped, the runs between them are copied at once.
+ */
+static void mln_json_write_string(mln_json_writer_t *w, mln_string_t *s)
+{
+    mln_u8ptr_t p, q, end;
+
+    mln_json_write_char(w, '\"');
+    if (s != NULL) {
+        for (p = q = s->data, end = s->data + s->len; q < end; ++q) {
+            if (*q != (mln_u8_t)'\"' && *q != (mln_u8_t)'\\') continue;
+            mln_json_write(w, p, q - p);
+            mln_json_write_char(w, '\\');
+            p = q;
+        }
+        mln_json_write(w, p, end - p);
+    }
+    mln_json_write_char(w, '\"');
+}
+
+/*
+ * Integral values are written as integers, the others in a short form which
+ * reads back to the same double (Grisu2). It is not always the shortest one,
+ * e.g. 1e23 is written as 9.999999999999999e22. -0 keeps its sign. JSON has
+ * no NaN or infinity, so they are written as null.
+ */
+static int mln_json_number_format(double d, char *buf)
+{
+    char *p = buf, digits[24];
+    int len, k, kk, i;
+
+    if (d != d || d - d != 0) {
+        memcpy(buf, "null", 4);
+        return 4;
+    }
+
+    if (d == 0 && signbit(d)) {
+        memcpy(buf, "-0", 2);
+        return 2;
+    }
+
+    if (d >= -9223372036854775808.0 && d < 9223372036854775808.0 && (double)(mln_s64_t)d == d)
+        return mln_json_integer_format(d < 0? -(mln_u64_t)(mln_s64_t)d: (mln_u64_t)(mln_s64_t)d, d < 0, buf);
+
+    if (d < 0) {
+        *p++ = '-';
+        d = -d;
+    }
+    mln_json_grisu2(d, digits, &len, &k);
+
+    /*digits * 10^k, and 10^(kk-1) <= d < 10^kk*/
+    kk = len + k;
+    if (k >= 0 && kk <= 21) {
+        /*1234e7 -> 12340000000*/
+        memcpy(p, digits, len);
+        memset(p + len, '0', k);
+        p += kk;
+    } else if (kk > 0 && kk <= 21) {
+        /*1234e-2 -> 12.34*/
+        memcpy(p, digits, kk);
+        p[kk] = '.';
+        memcpy(p + kk + 1, digits + kk, len - kk);
+        p += len + 1;
+    } else if (kk > -6 && kk <= 0) {
+        /*1234e-6 -> 0.001234*/
+        *p++ = '0';
+        *p++ = '.';
+        for (i = kk; i < 0; ++i) *p++ = '0';
+        memcpy(p, digits, len);
+        p += len;
+    } else {
+        /*1234e30 -> 1.234e33*/
+        *p++ = digits[0];
+        if (len > 1) {
+            *p++ = '.';
+            memcpy(p, digits + 1, len - 1);
+            p += len - 1;
+        }
+        *p++ = 'e';
+        if (--kk < 0) {
+            *p++ = '-';
+            kk = -kk;
+        }
+        if (kk >= 100) {
+            *p++ = '0' + kk / 100;
+            kk %= 100;
+            *p++ = '0' + kk / 10;
+        } else if (kk >= 10) {
+            *p++ = '0' + kk / 10;
+        }
+        *p++ = '0' + kk % 10;
+    }
+
+    return p - buf;
+}
+
+static int mln_json_integer_format(mln_u64_t u, int neg, char *buf)
+{
+    char *p = buf, digits[24];
+    int len = 0;
+
+    if (neg) *p++ = '-';
+    do {
+        digits[len++] = '0' + u % 10;
+        u /= 10;
+    } while (u);
+    while (len > 0) *p++ = digits[--len];
+
+    return p - buf;
+}
+
+/*
+ * Grisu2 (Florian Loitsch, "Printing Floating-Point Numbers Quickly and Accurately
+ * with Integers"). d must be positive and finite. The digits are put into buf,
+ * and d is about digits * 10^k.
+ */
+static void mln_json_grisu2(double d, char *buf, int *len, int *k)
+{
+    mln_json_diyfp_t v, w, mi, pl, c, wp, wm, one;
+    mln_u64_t bits, delta, p2, wp_w, tmp, ten_kappa;
+    mln_u32_t p1, pow10;
+    int idx, dk_int, index, kappa;
+    double dk;
+    char digit;
+
+    memcpy(&bits, &d, sizeof(bits));
+    if ((bits & 0x7ff0000000000000ULL) != 0) {
+        v.f = (bits & 0x000fffffffffffffULL) + 0x0010000000000000ULL;
+        v.e = (int)((bits & 0x7ff0000000000000ULL) >> 52) - 1075;
+    } else {
+        v.f = bits & 0x000fffffffffffffULL;
+        v.e = -1074;
+    }
+
+    /*the boundaries m- and m+, m+ normalized and m- scaled to the same exponent*/
+    pl.f = (v.f << 1) + 1;
+    pl.e = v.e - 1;
+    while (!(pl.f & (0x0010000000000000ULL << 1))) {
+        pl.f <<= 1;
+        --pl.e;
+    }
+    pl.f <<= 10;
+    pl.e -= 10;
+    if (v.f == 0x0010000000000000ULL) {
+        mi.f = (v.f << 2) - 1;
+        mi.e = v.e - 2;
+    } else {
+        mi.f = (v.f << 1) - 1;
+        mi.e = v.e - 1;
+    }
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+
+    /*normalized v*/
+    idx = __builtin_clzll(v.f);
+    w.f = v.f << idx;
+    w.e = v.e - idx;
+
+    /*the cached power c = 10^-k which brings the exponent of m+ into [-60, -32]*/
+    dk = (-61 - pl.e) * 0.30102999566398114 + 347;
+    dk_int = (int)dk;
+    if (dk - dk_int > 0.0) ++dk_int;
+    index = (dk_int >> 3) + 1;
+    *k = -(-348 + index * 8);
+    c.f = mln_json_cached_powers_f[index];
+    c.e = mln_json_cached_powers_e[index];
+
+    w = mln_json_diyfp_mul(w, c);
+    wp = mln_json_diyfp_mul(pl, c);
+    wm = mln_json_diyfp_mul(mi, c);
+    ++wm.f;
+    --wp.f;
+
+    /*digit generation*/
+    delta = wp.f - wm.f;
+    one.f = (mln_u64_t)1 << -wp.e;
+    one.e = wp.e;
+    wp_w = wp.f - w.f;
+    p1 = (mln_u32_t)(wp.f >> -one.e);
+    p2 = wp.f & (one.f - 1);
+    for (kappa = 1, pow10 = 10; kappa < 10 && p1 >= pow10; ++kappa, pow10 *= 10)
+        ;
+    pow10 = kappa < 10? pow10 / 10: 1000000000;
+    *len = 0;
+
+    while (kappa > 0) {
+        digit = (char)(p1 / pow10);
+        p1 %= pow10;
+        if (digit || *len) buf[(*len)++] = '0' + digit;
+        --kappa;
+        tmp = ((mln_u64_t)p1 << -one.e) + p2;
+        if (tmp <= delta) {
+            *k += kappa;
+            mln_json_grisu_round(buf, *len, delta, tmp, (mln_u64_t)pow10 << -one.e, wp_w);
+            return;
+        }
+        pow10 /= 10;
+    }
+
+    while (1) {
+        p2 *= 10;
+        delta *= 10;
+        digit = (char)(p2 >> -one.e);
+        if (digit || *len) buf[(*len)++] = '0' + digit;
+        p2 &= one.f - 1;
+        --kappa;
+        if (p2 < delta) {
+            *k += kappa;
+            for (ten_kappa = 1, index = -kappa; index > 0 && index < 20; --index) ten_kappa *= 10;
+            mln_json_grisu_round(buf, *len, delta, p2, one.f, -kappa < 20? wp_w * ten_kappa: 0);
+            return;
+        }
+    }
+}
+
+static inline void
+mln_json_grisu_round(char *buf, int len, mln_u64_t delta, mln_u64_t rest, mln_u64_t ten_kappa, mln_u64_t wp_w)
+{
+    while (rest < wp_w && delta - rest >= ten_kappa && \
+           (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w))
+    {
+        buf[len - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+static inline mln_json_diyfp_t mln_json_diyfp_mul(mln_json_diyfp_t x, mln_json_diyfp_t y)
+{
+    mln_json_diyfp_t r;
+    mln_u64_t a = x.f >> 32, b = x.f & 0xffffffffULL;
+    mln_u64_t c = y.f >> 32, d = y.f & 0xffffffffULL;
+    mln_u64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    /*round the lower 64 bits*/
+    mln_u64_t tmp = (bd >> 32) + (ad & 0xffffffffULL) + (bc & 0xffffffffULL) + (1ULL << 31);
+
+    r.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+    r.e = x.e + y.e + 64;
+    return r;
+}
+
+
+/*
+ * binary
+ *
+ * CBOR (RFC 8949) and MessagePack share the tree with the text format. Both are
+ * written with definite lengths and the shortest heads, and doubles in the
+ * shortest float which keeps the value. Map keys must be strings, byte strings
+ * (and MessagePack bin) are read as strings, CBOR tags are skipped.
+ */
+int mln_json_cbor_decode(mln_alloc_t *pool, mln_string_t *in, mln_json_t *out, mln_u32_t flags)
+{
+    return mln_json_binary_decode(pool, in, out, flags, mln_json_cbor_read);
+}
+
+int mln_json_msgpack_decode(mln_alloc_t *pool, mln_string_t *in, mln_json_t *out, mln_u32_t flags)
+{
+    return mln_json_binary_decode(pool, in, out, flags, mln_json_msgpack_read);
+}
+
+static int mln_json_binary_decode(mln_alloc_t *pool, mln_string_t *in, mln_json_t *out, mln_u32_t flags, mln_json_read_handler_t read)
+{
+    mln_json_reader_t r;
+
+    r.pos = in->data;
+    r.end = in->data + in->len;
+    r.pool = pool;
+    r.read = read;
+    r.ref = !!(flags & M_JSON_DECODE_REF);
+    r.depth = 0;
+
+    mln_json_init(out);
+    if (read(&r, out) < 0 || r.pos != r.end) {
+        mln_json_destroy(out);
+        mln_json_init(out);
+        return -1;
+    }
+
+    return 0;
+}
+
+static inline void mln_json_be_put(mln_u8ptr_t p, mln_u64_t v, int n)
+{
+    while (n-- > 0) {
+        p[n] = (mln_u8_t)v;
+        v >>= 8;
+    }
+}
+
+static inline mln_u64_t mln_json_be_get(mln_u8ptr_t p, int n)
+{
+    mln_u64_t v = 0;
+
+    while (n-- > 0) v = (v << 8) | *p++;
+    return v;
+}
+
+/*
+ * Write the byte c followed by v in n big-endian bytes.
+ */
+static inline void mln_json_write_be(mln_json_writer_t *w, mln_u8_t c, mln_u64_t v, int n)
+{
+    mln_u8_t buf[9];
+
+    buf[0] = c;
+    mln_json_be_put(buf + 1, v, n);
+    mln_json_write(w, buf, n + 1);
+}
+
+static void mln_json_cbor_write_head(mln_json_writer_t *w, mln_u8_t major, mln_u64_t n)
+{
+    major <<= 5;
+    if (n < 24)
+        mln_json_write_char(w, major | (mln_u8_t)n);
+    else if (n <= 0xff)
+        mln_json_write_be(w, major | 24, n, 1);
+    else if (n <= 0xffff)
+        mln_json_write_be(w, major | 25, n, 2);
+    else if (n <= 0xffffffffULL)
+        mln_json_write_be(w, major | 26, n, 4);
+    else
+        mln_json_write_be(w, major | 27, n, 8);
+}
+
+static void mln_json_cbor_write(mln_json_writer_t *w, mln_json_t *j)
+{
+    mln_json_t *el, *elend;
+    mln_json_kv_t *kv, *kvend;
+    mln_string_t *s;
+    mln_array_t *a;
+
+    switch (j->type) {
+        case M_JSON_OBJECT:
+            a = &(mln_json_object_data_get(j)->kvs);
+            mln_json_cbor_write_head(w, 5, mln_array_nelts(a));
+            kv = (mln_json_kv_t *)mln_array_elts(a);
+            for (kvend = kv + mln_array_nelts(a); kv < kvend; ++kv) {
+                mln_json_cbor_write(w, &(kv->key));
+                mln_json_cbor_write(w, &(kv->val));
+            }
+            break;
+        case M_JSON_ARRAY:
+            a = mln_json_array_data_get(j);
+            mln_json_cbor_write_head(w, 4, mln_array_nelts(a));
+            el = (mln_json_t *)mln_array_elts(a);
+            for (elend = el + mln_array_nelts(a); el < elend; ++el)
+                mln_json_cbor_write(w, el);
+            break;
+        case M_JSON_STRING:
+            s = mln_json_string_data_get(j);
+            mln_json_cbor_write_head(w, 3, s == NULL? 0: s->len);
+            if (s != NULL) mln_json_write(w, s->data, s->len);
+            break;
+        case M_JSON_NUM:
+            if (j->num_type == M_JSON_NUM_INT) {
+                if (j->data.m_j_int < 0)
+                    mln_json_cbor_write_head(w, 1, (mln_u64_t)(-(j->data.m_j_int + 1)));
+                else
+                    mln_json_cbor_write_head(w, 0, (mln_u64_t)j->data.m_j_int);
+            } else if (j->num_type == M_JSON_NUM_UINT) {
+                mln_json_cbor_write_head(w, 0, j->data.m_j_uint);
+            } else {
+                mln_json_cbor_write_float(w, j->data.m_j_number);
+            }
+            break;
+        case M_JSON_TRUE:
+            mln_json_write_char(w, 0xf5);
+            break;
+        case M_JSON_FALSE:
+            mln_json_write_char(w, 0xf4);
+            break;
+        default:
+            mln_json_write_char(w, 0xf6);
+            break;
+    }
+}
+
+static void mln_json_cbor_write_float(mln_json_writer_t *w, double d)
+{
+    float f = (float)d;
+    mln_u64_t bits;
+    mln_u32_t fbits;
+    mln_u16_t h;
+
+    if (d != d) {
+        mln_json_write_be(w, 0xf9, 0x7e00, 2);
+        return;
+    }
+    if ((double)f != d) {
+        memcpy(&bits, &d, sizeof(bits));
+        mln_json_write_be(w, 0xfb, bits, 8);
+        return;
+    }
+
+    memcpy(&fbits, &f, sizeof(fbits));
+    if (mln_json_half_from_float(fbits, &h))
+        mln_json_write_be(w, 0xf9, h, 2);
+    else
+        mln_json_write_be(w, 0xfa, fbits, 4);
+}
+
+/*
+ * Convert a float to a half if that is exact, returns 0 otherwise.
+ */
+static int mln_json_half_from_float(mln_u32_t f, mln_u16_t *h)
+{
+    mln_u32_t sign = (f >> 16) & 0x8000, m = f & 0x7fffff, shift;
+    int e = (int)((f >> 23) & 0xff);
+
+    if (e == 0xff) {
+        if (m & 0x1fff) return 0;
+        *h = sign | 0x7c00 | (m >> 13);
+        return 1;
+    }
+    if (e == 0) {
+        if (m) return 0;
+        *h = sign;
+        return 1;
+    }
+
+    e -= 127;
+    if (e >= -14 && e <= 15) {
+        if (m & 0x1fff) return 0;
+        *h = sign | ((e + 15) << 10) | (m >> 13);
+        return 1;
+    }
+    if (e >= -24 && e < -14) {
+        /*a subnormal half, whose unit is 2^-24*/
+        m |= 0x800000;
+        shift = -e - 1;
+        if (m & ((1U << shift) - 1)) return 0;
+        *h = sign | (m >> shift);
+        return 1;
+    }
+
+    return 0;
+}
+
+static double mln_json_half_to_double(mln_u16_t h)
+{
+    mln_u32_t sign = (mln_u32_t)(h & 0x8000) << 16, e = (h >> 10) & 0x1f, m = h & 0x3ff, bits;
+    float f;
+
+    if (e == 0) {
+        /*zero and subnormals, m * 2^-24 is exact*/
+        f = (float)m * (1.0f / 16777216.0f);
+        return sign? -(double)f: (double)f;
+    }
+    if (e == 0x1f) bits = sign | 0x7f800000 | (m << 13);
+    else bits = sign | ((e + 112) << 23) | (m << 13);
+    memcpy(&f, &bits, sizeof(f));
+
+    return f;
+}
+
+static void mln_json_msgpack_write(mln_json_writer_t *w, mln_json_t *j)
+{
+    mln_json_t *el, *elend;
+    mln_json_kv_t *kv, *kvend;
+    mln_string_t *s;
+    mln_array_t *a;
+    mln_u64_t n;
+    mln_s64_t i;
+
+    switch (j->type) {
+        case M_JSON_OBJECT:
+            a = &(mln_json_object_data_get(j)->kvs);
+            n = mln_array_nelts(a);
+            if (n < 16) mln_json_write_char(w, 0x80 | (mln_u8_t)n);
+            else if (n <= 0xffff) mln_json_write_be(w, 0xde, n, 2);
+            else mln_json_write_be(w, 0xdf, n, 4);
+            kv = (mln_json_kv_t *)mln_array_elts(a);
+            for (kvend = kv + n; kv < kvend; ++kv) {
+                mln_json_msgpack_write(w, &(kv->key));
+                mln_json_msgpack_write(w, &(kv->val));
+            }
+            break;
+        case M_JSON_ARRAY:
+            a = mln_json_array_data_get(j);
+            n = mln_array_nelts(a);
+            if (n < 16) mln_json_write_char(w, 0x90 | (mln_u8_t)n);
+            else if (n <= 0xffff) mln_json_write_be(w, 0xdc, n, 2);
+            else mln_json_write_be(w, 0xdd, n, 4);
+            el = (mln_json_t *)mln_array_elts(a);
+            for (elend = el + n; el < elend; ++el)
+                mln_json_msgpack_write(w, el);
+            break;
+        case M_JSON_STRING:
+            s = mln_json_string_data_get(j);
+            n = s == NULL? 0: s->len;
+            if (n < 32) mln_json_write_char(w, 0xa0 | (mln_u8_t)n);
+            else if (n <= 0xff) mln_json_write_be(w, 0xd9, n, 1);
+            else if (n <= 0xffff) mln_json_write_be(w, 0xda, n, 2);
+            else if (n <= 0xffffffffULL) mln_json_write_be(w, 0xdb, n, 4);
+            else {
+                w->failed = 1;
+                break;
+            }
+            if (n) mln_json_write(w, s->data, n);
+            break;
+        case M_JSON_NUM:
+            if (j->num_type == M_JSON_NUM_UINT || (j->num_type == M_JSON_NUM_INT && j->data.m_j_int >= 0)) {
+                n = j->num_type == M_JSON_NUM_UINT? j->data.m_j_uint: (mln_u64_t)j->data.m_j_int;
+                if (n < 128) mln_json_write_char(w, (mln_u8_t)n);
+                else if (n <= 0xff) mln_json_write_be(w, 0xcc, n, 1);
+                else if (n <= 0xffff) mln_json_write_be(w, 0xcd, n, 2);
+                else if (n <= 0xffffffffULL) mln_json_write_be(w, 0xce, n, 4);
+                else mln_json_write_be(w, 0xcf, n, 8);
+            } else if (j->num_type == M_JSON_NUM_INT) {
+                i = j->data.m_j_int;
+                if (i >= -32) mln_json_write_char(w, (mln_u8_t)i);
+                else if (i >= -128) mln_json_write_be(w, 0xd0, (mln_u64_t)i, 1);
+                else if (i >= -32768) mln_json_write_be(w, 0xd1, (mln_u64_t)i, 2);
+                else if (i >= -2147483647LL - 1) mln_json_write_be(w, 0xd2, (mln_u64_t)i, 4);
+                else mln_json_write_be(w, 0xd3, (mln_u64_t)i, 8);
+            } else {
+                mln_json_msgpack_write_float(w, j->data.m_j_number);
+            }
+            break;
+        case M_JSON_TRUE:
+            mln_json_write_char(w, 0xc3);
+            break;
+        case M_JSON_FALSE:
+            mln_json_write_char(w, 0xc2);
+            break;
+        default:
+            mln_json_write_char(w, 0xc0);
+            break;
+    }
+}
+
+static void mln_json_msgpack_write_float(mln_json_writer_t *w, double d)
+{
+    float f = (float)d;
+    mln_u64_t bits;
+    mln_u32_t fbits;
+
+    if ((double)f == d) {
+        memcpy(&fbits, &f, sizeof(fbits));
+        mln_json_write_be(w, 0xca, fbits, 4);
+    } else {
+        memcpy(&bits, &d, sizeof(bits));
+        mln_json_write_be(w, 0xcb, bits, 8);
+    }
+}
+
+static inline int mln_json_reader_uint(mln_json_reader_t *r, int n, mln_u64_t *v)
+{
+    if (r->end - r->pos < n) return -1;
+    *v = mln_json_be_get(r->pos, n);
+    r->pos += n;
+    return 0;
+}
+
+/*
+ * A string of n bytes at the current position, referred to if r->ref is set.
+ */
+static int mln_json_reader_string(mln_json_reader_t *r, mln_json_t *j, mln_u64_t n)
+{
+    mln_string_t *str;
+
+    if (n > (mln_u64_t)(r->end - r->pos)) return -1;
+
+    if (r->ref) {
+        if (r->pool != NULL)
+            str = (mln_string_t *)mln_alloc_m(r->pool, sizeof(mln_string_t));
+        else
+            str = (mln_string_t *)malloc(sizeof(mln_string_t));
+        if (str == NULL) return -1;
+        mln_string_nset(str, r->pos, n);
+        str->pool = r->pool != NULL;
+    } else {
+        if ((str = mln_json_binary_string_new(r->pool, n)) == NULL) return -1;
+        memcpy(str->data, r->pos, n);
+    }
+    r->pos += n;
+    mln_json_string_init(j, str);
+
+    return 0;
+}
+
+/*
+ * The structure and its data are allocated in one block, as the text decoder does.
+ */
+static mln_string_t *mln_json_binary_string_new(mln_alloc_t *pool, mln_u64_t n)
+{
+    mln_string_t *str;
+
+    if (pool != NULL)
+        str = (mln_string_t *)mln_alloc_m(pool, sizeof(mln_string_t) + n + 1);
+    else
+        str = (mln_string_t *)malloc(sizeof(mln_string_t) + n + 1);
+    if (str == NULL) return NULL;
+
+    str->data = (mln_u8ptr_t)(str + 1);
+    str->len = n;
+    str->data_ref = 1;
+    str->pool = pool != NULL;
+    str->ref = 1;
+    str->data[n] = 0;
+
+    return str;
+}
+
+/*
+ * Read n values into an array, or up to a break byte (0xff) if n is M_JSON_INDEFINITE.
+ */
+static int mln_json_reader_array(mln_json_reader_t *r, mln_json_t *j, mln_u64_t n)
+{
+    mln_json_t v;
+
+    if (++(r->depth) > M_JSON_DECODE_MAX_DEPTH) return -1;
+    /*every value takes at least one byte*/
+    if (n != M_JSON_INDEFINITE && n > (mln_u64_t)(r->end - r->pos)) return -1;
+
+    if (r->pool != NULL) {
+        if (mln_json_array_pool_init(j, r->pool) < 0) return -1;
+    } else {
+        if (mln_json_array_init(j) < 0) return -1;
+    }
+
+    while (1) {
+        if (n == M_JSON_INDEFINITE) {
+            if (r->pos >= r->end) return -1;
+            if (*(r->pos) == 0xff) {
+                ++(r->pos);
+                break;
+            }
+        } else if (n-- == 0) {
+            break;
+        }
+
+        mln_json_init(&v);
+        if (r->read(r, &v) < 0 || __mln_json_array_append(j, &v) < 0) {
+            mln_json_destroy(&v);
+            return -1;
+        }
+    }
+
+    --(r->depth);
+    return 0;
+}
+
+static int mln_json_reader_map(mln_json_reader_t *r, mln_json_t *j, mln_u64_t n)
+{
+    mln_json_t key, v;
+
+    if (++(r->depth) > M_JSON_DECODE_MAX_DEPTH) return -1;
+    /*every member takes at least two bytes*/
+    if (n != M_JSON_INDEFINITE && n > (mln_u64_t)(r->end - r->pos) / 2) return -1;
+
+    if (r->pool != NULL) {
+        if (mln_json_obj_pool_init(j, r->pool) < 0) return -1;
+    } else {
+        if (mln_json_obj_init(j) < 0) return -1;
+    }
+
+    while (1) {
+        if (n == M_JSON_INDEFINITE) {
+            if (r->pos >= r->end) return -1;
+            if (*(r->pos) == 0xff) {
+                ++(r->pos);
+                break;
+            }
+        } else if (n-- == 0) {
+            break;
+        }
+
+        mln_json_init(&key);
+        mln_json_init(&v);
+        if (r->read(r, &key) < 0 || !mln_json_is_string(&key)) {
+            mln_json_destroy(&key);
+            return -1;
+        }
+        if (r->read(r, &v) < 0 || __mln_json_obj_update(j, &key, &v) < 0) {
+            mln_json_destroy(&key);
+            mln_json_destroy(&v);
+            return -1;
+        }
+    }
+
+    --(r->depth);
+    return 0;
+}
+
+static int mln_json_cbor_read(mln_json_reader_t *r, mln_json_t *j)
+{
+    mln_u8_t major, info;
+    mln_u64_t arg;
+    mln_u32_t fbits;
+    float f;
+    double d;
+
+    do {
+        if (r->pos >= r->end) return -1;
+        major = *(r->pos) >> 5;
+        info = *(r->pos)++ & 0x1f;
+        if (info < 24) arg = info;
+        else if (info <= 27) {
+            if (mln_json_reader_uint(r, 1 << (info - 24), &arg) < 0) return -1;
+        } else if (info == 31 && (major == 2 || major == 3 || major == 4 || major == 5)) {
+            arg = M_JSON_INDEFINITE;
+        } else {
+            return -1;
+        }
+    } while (major == 6);/*tags are skipped*/
+
+    switch (major) {
+        case 0:
+            if (arg > 0x7fffffffffffffffULL) mln_json_uint_init(j, arg);
+            else mln_json_int_init(j, arg);
+            return 0;
+        case 1:
+            if (arg > 0x7fffffffffffffffULL) mln_json_number_init(j, -1.0 - (double)arg);
+            else mln_json_int_init(j, -1 - (mln_s64_t)arg);
+            return 0;
+        case 2:
+        case 3:
+            if (arg == M_JSON_INDEFINITE) return mln_json_cbor_chunks(r, j, major);
+            return mln_json_reader_string(r, j, arg);
+        case 4:
+            return mln_json_reader_array(r, j, arg);
+        case 5:
+            return mln_json_reader_map(r, j, arg);
+        default:
+            break;
+    }
+
+    switch (info) {
+        case 20:
+            mln_json_false_init(j);
+            return 0;
+        case 21:
+            mln_json_true_init(j);
+            return 0;
+        case 22:
+        case 23:/*undefined*/
+            mln_json_null_init(j);
+            return 0;
+        case 25:
+            mln_json_number_init(j, mln_json_half_to_double((mln_u16_t)arg));
+            return 0;
+        case 26:
+            fbits = (mln_u32_t)arg;
+            memcpy(&f, &fbits, sizeof(f));
+            mln_json_number_init(j, f);
+            return 0;
+        case 27:
+            memcpy(&d, &arg, sizeof(d));
+            mln_json_number_init(j, d);
+            return 0;
+        default:
+            break;
+    }
+    return -1;
+}
+
+/*
+ * An indefinite-length string is a sequence of definite-length chunks of the
+ * same major type, they are measured first and then copied into one string.
+ */
+static int mln_json_cbor_chunks(mln_json_reader_t *r, mln_json_t *j, mln_u8_t major)
+{
+    mln_u8ptr_t start = r->pos, p;
+    mln_u64_t total = 0, n;
+    mln_string_t *str = NULL;
+    int pass;
+
+    for (pass = 0; pass < 2; ++pass) {
+        r->pos = start;
+        p = NULL;
+        if (pass) {
+            if ((str = mln_json_binary_string_new(r->pool, total)) == NULL) return -1;
+            p = str->data;
+        }
+        while (1) {
+            if (r->pos >= r->end) goto err;
+            if (*(r->pos) == 0xff) {
+                ++(r->pos);
+                break;
+            }
+            if ((*(r->pos) >> 5) != major || (*(r->pos) & 0x1f) > 27) goto err;
+            n = *(r->pos)++ & 0x1f;
+            if (n >= 24 && mln_json_reader_uint(r, 1 << (n - 24), &n) < 0) goto err;
+            if (n > (mln_u64_t)(r->end - r->pos)) goto err;
+            if (pass) {
+                memcpy(p, r->pos, n);
+                p += n;
+            } else {
+                total += n;
+            }
+            r->pos += n;
+        }
+    }
 
     mln_json_string_init(j, str);
+    return 0;
 
-    return --plen; /* jump off " */
+err:
+    if (str != NULL) mln_string_free(str);
+    return -1;
 }
 
-static mln_u8ptr_t mln_json_parse_string_fetch(mln_u8ptr_t jstr, int *len)
+static int mln_json_msgpack_read(mln_json_reader_t *r, mln_json_t *j)
 {
-    int l = *len, c, count = 0;
-    unsigned int hex = 0;
-    mln_u8ptr_t p = jstr, buf, q;
-    if ((buf = (mln_u8ptr_t)malloc(l)) == NULL) {
+    mln_u8_t c;
+    mln_u64_t n;
+    mln_u32_t fbits;
+    int shift;
+    float f;
+    double d;
+
+    if (r->pos >= r->end) return -1;
+    c = *(r->pos)++;
+
+    if (c <= 0x7f) {
+        mln_json_int_init(j, c);
+        return 0;
+    }
+    if (c >= 0xe0) {
+        mln_json_int_init(j, (mln_s64_t)c - 256);
+        return 0;
+    }
+    if (c <= 0x8f) return mln_json_reader_map(r, j, c & 0xf);
+    if (c <= 0x9f) return mln_json_reader_array(r, j, c & 0xf);
+    if (c <= 0xbf) return mln_json_reader_string(r, j, c & 0x1f);
+
+    switch (c) {
+        case 0xc0:
+            mln_json_null_init(j);
+            return 0;
+        case 0xc2:
+            mln_json_false_init(j);
+            return 0;
+        case 0xc3:
+            mln_json_true_init(j);
+            return 0;
+        case 0xc4:
+        case 0xc5:
+        case 0xc6:/*bin*/
+            if (mln_json_reader_uint(r, 1 << (c - 0xc4), &n) < 0) return -1;
+            return mln_json_reader_string(r, j, n);
+        case 0xca:
+            if (mln_json_reader_uint(r, 4, &n) < 0) return -1;
+            fbits = (mln_u32_t)n;
+            memcpy(&f, &fbits, sizeof(f));
+            mln_json_number_init(j, f);
+            return 0;
+        case 0xcb:
+            if (mln_json_reader_uint(r, 8, &n) < 0) return -1;
+            memcpy(&d, &n, sizeof(d));
+            mln_json_number_init(j, d);
+            return 0;
+        case 0xcc:
+        case 0xcd:
+        case 0xce:
+        case 0xcf:
+            if (mln_json_reader_uint(r, 1 << (c - 0xcc), &n) < 0) return -1;
+            if (n > 0x7fffffffffffffffULL) mln_json_uint_init(j, n);
+            else mln_json_int_init(j, n);
+            return 0;
+        case 0xd0:
+        case 0xd1:
+        case 0xd2:
+        case 0xd3:
+            if (mln_json_reader_uint(r, 1 << (c - 0xd0), &n) < 0) return -1;
+            /*sign extension*/
+            shift = 64 - (8 << (c - 0xd0));
+            mln_json_int_init(j, (mln_s64_t)(n << shift) >> shift);
+            return 0;
+        case 0xd9:
+        case 0xda:
+        case 0xdb:
+            if (mln_json_reader_uint(r, 1 << (c - 0xd9), &n) < 0) return -1;
+            return mln_json_reader_string(r, j, n);
+        case 0xdc:
+        case 0xdd:
+            if (mln_json_reader_uint(r, 2 << (c - 0xdc), &n) < 0) return -1;
+            return mln_json_reader_array(r, j, n);
+        case 0xde:
+        case 0xdf:
+            if (mln_json_reader_uint(r, 2 << (c - 0xde), &n) < 0) return -1;
+            return mln_json_reader_map(r, j, n);
+        default:
+            break;
+    }
+    /*0xc1 is never used, extension types are not supported*/
+    return -1;
+}
+
+
+int mln_json_parse(mln_json_t *j, mln_string_t *exp, mln_json_iterator_t iterator, void *data)
+{
+    mln_size_t idx = 0;
+    mln_string_t *p, *arr = mln_string_slice(exp, ".");
+    if (arr == NULL) return -1;
+
+    for (p = arr; p->len != 0; ++p) {
+        if (mln_json_is_object(j)) {
+            j = mln_json_obj_search(j, p);
+            if (j == NULL) goto err;
+        } else if (mln_json_is_array(j)) {
+            if (!mln_json_parse_is_index(p, &idx)) goto err;
+            j = mln_json_array_search(j, idx);
+            if (j == NULL) goto err;
+        } else {
+err:
+            mln_string_slice_free(arr);
+            return -1;
+        }
+    }
+    mln_string_slice_free(arr);
+    if (iterator != NULL)
+        return iterator(j, data);
+    return 0;
+}
+
+static inline int mln_json_parse_is_index(mln_string_t *s, mln_size_t *idx)
+{
+    mln_u8ptr_t p = s->data, pend = s->data + s->len;
+    mln_size_t sum = 0;
+
+    for (; p < pend; ++p) {
+        if (*p < (mln_u8_t)'0' || *p > (mln_u8_t)'9')
+           return 0;
+        sum = sum * 10 + (*p - (mln_u8_t)'0');
+    }
+    *idx = sum;
+    return 1;
+}
+
+
+/*
+ * path
+ *
+ * A compiled subset of JSONPath (RFC 9535): $, .name, ['name'], [index], [start:end:step],
+ * .* and [*], descendants (..), unions ([a,b]) and filters ([?expr]) which test and
+ * compare values relative to @ with ==, !=, <, <=, >, >=, !, && and ||.
+ * Evaluation keeps a bit set of the steps active for every value, so each value is
+ * visited once and reported at most once, in document order.
+ */
+mln_json_path_t *mln_json_path_compile(mln_string_t *exp)
+{
+    mln_u8ptr_t p = exp->data, end = exp->data + exp->len;
+    mln_json_path_t *path;
+
+    p = mln_json_path_blank(p, end);
+    if (p >= end || *p != (mln_u8_t)'$') return NULL;
+
+    if ((path = (mln_json_path_t *)calloc(1, sizeof(mln_json_path_t))) == NULL) return NULL;
+    if ((p = mln_json_path_segments(path, p + 1, end, 0)) == NULL || mln_json_path_blank(p, end) != end) {
+        mln_json_path_free(path);
         return NULL;
     }
-    q = buf;
-    while (l > 0) {
-        c = mln_json_get_char(&p, &l, &hex);
-        if (c < 0) {
-            free(buf);
-            return NULL;
-        } else if (c == 0) {
-            mln_json_encode_utf8(hex, &q, &count);
+
+    return path;
+}
+
+void mln_json_path_free(mln_json_path_t *path)
+{
+    mln_json_path_step_t *st, *stend;
+    mln_json_path_sel_t *sel, *selend;
+
+    if (path == NULL) return;
+
+    for (st = path->steps, stend = st + path->nsteps; st < stend; ++st) {
+        for (sel = st->sels, selend = sel + st->nsels; sel < selend; ++sel) {
+            if (sel->name != NULL) mln_string_free(sel->name);
+            mln_json_path_expr_free(sel->filter);
+        }
+        free(st->sels);
+    }
+    free(path->steps);
+    free(path);
+}
+
+int mln_json_path_search(mln_json_path_t *path, mln_json_t *j, mln_json_iterator_t iterator, void *data)
+{
+    mln_json_path_ctx_t ctx;
+
+    ctx.path = path;
+    ctx.pool = NULL;
+    ctx.iterator = iterator;
+    ctx.data = data;
+    ctx.count = 0;
+    ctx.depth = 0;
+
+    if (mln_json_path_tree_walk(&ctx, j, 1) < 0) return -1;
+    return ctx.count;
+}
+
+int mln_json_path_decode(mln_json_path_t *path, mln_alloc_t *pool, mln_string_t *jstr, mln_json_iterator_t iterator, void *data)
+{
+    mln_json_path_ctx_t ctx;
+    mln_json_index_t ix;
+    mln_u64_t pos;
+
+    ctx.path = path;
+    ctx.pool = pool;
+    ctx.iterator = iterator;
+    ctx.data = data;
+    ctx.count = 0;
+    ctx.depth = 0;
+
+    mln_json_index_init(&ix, jstr->data, jstr->len);
+    if (mln_json_index_next(&ix, &pos) < 0) return -1;
+    if (jstr->data[pos] != (mln_u8_t)'{' && jstr->data[pos] != (mln_u8_t)'[') return -1;
+    if (mln_json_path_text_walk(&ctx, &ix, pos, 1) < 0 || mln_json_index_next(&ix, &pos) == 0) return -1;
+
+    return ctx.count;
+}
+
+static inline mln_u8ptr_t mln_json_path_blank(mln_u8ptr_t p, mln_u8ptr_t end)
+{
+    for (; p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'); ++p)
+        ;
+    return p;
+}
+
+/*
+ * Parse the segments following $ or @. Paths relative to @ are singular,
+ * each of their segments is a single name or index.
+ */
+static mln_u8ptr_t mln_json_path_segments(mln_json_path_t *path, mln_u8ptr_t p, mln_u8ptr_t end, int singular)
+{
+    mln_json_path_step_t *st;
+    mln_json_path_sel_t *sel;
+    mln_u8ptr_t q;
+
+    while (p < end && (*p == (mln_u8_t)'.' || *p == (mln_u8_t)'[')) {
+        if ((st = mln_json_path_step_new(path)) == NULL) return NULL;
+
+        if (*p == (mln_u8_t)'[') {
+            if ((p = mln_json_path_bracket(st, p + 1, end, singular)) == NULL) return NULL;
+            continue;
+        }
+
+        if (++p < end && *p == (mln_u8_t)'.') {
+            if (singular) return NULL;
+            st->descendant = 1;
+            if (++p < end && *p == (mln_u8_t)'[') {
+                if ((p = mln_json_path_bracket(st, p + 1, end, singular)) == NULL) return NULL;
+                continue;
+            }
+        }
+
+        if ((sel = mln_json_path_sel_new(st)) == NULL) return NULL;
+        if (p < end && *p == (mln_u8_t)'*') {
+            if (singular) return NULL;
+            sel->type = M_JSON_PATH_WILDCARD;
+            ++p;
+            continue;
+        }
+        for (q = p; q < end && M_JSON_PATH_IS_NAME(*q); ++q)
+            ;
+        if (q == p || q - p > 0x7fffffff) return NULL;
+        sel->type = M_JSON_PATH_NAME;
+        if ((sel->name = mln_string_const_ndup((char *)p, q - p)) == NULL) return NULL;
+        p = q;
+    }
+
+    return p;
+}
+
+/*
+ * Parse the comma-separated selectors following '['.
+ */
+static mln_u8ptr_t mln_json_path_bracket(mln_json_path_step_t *st, mln_u8ptr_t p, mln_u8ptr_t end, int singular)
+{
+    mln_json_path_sel_t *sel;
+
+    while (1) {
+        p = mln_json_path_blank(p, end);
+        if (p >= end || (sel = mln_json_path_sel_new(st)) == NULL) return NULL;
+
+        if (*p == (mln_u8_t)'\'' || *p == (mln_u8_t)'\"') {
+            sel->type = M_JSON_PATH_NAME;
+            if ((p = mln_json_path_string(p, end, &(sel->name))) == NULL) return NULL;
+        } else if (*p == (mln_u8_t)'*' && !singular) {
+            sel->type = M_JSON_PATH_WILDCARD;
+            ++p;
+        } else if (*p == (mln_u8_t)'?' && !singular) {
+            sel->type = M_JSON_PATH_FILTER;
+            if ((p = mln_json_path_or(&(sel->filter), p + 1, end)) == NULL) return NULL;
         } else {
-            *q++ = (mln_u8_t)c;
-            ++count;
+            if ((p = mln_json_path_slice(sel, p, end, singular)) == NULL) return NULL;
+            if (sel->type == M_JSON_PATH_INDEX) {
+                if (sel->start < 0) st->need_len = 1;
+            } else if (sel->step < 0 || (sel->has_start && sel->start < 0) || (sel->has_end && sel->end < 0)) {
+                st->need_len = 1;
+            }
         }
+
+        p = mln_json_path_blank(p, end);
+        if (p >= end) return NULL;
+        if (*p == (mln_u8_t)']') return p + 1;
+        if (*p != (mln_u8_t)',' || singular) return NULL;
+        ++p;
     }
-    *len = count;
-    return buf;
 }
 
-static void mln_json_encode_utf8(unsigned int u, mln_u8ptr_t *b, int *count)
+/*
+ * Parse an index or a slice start:end:step, each part of a slice is optional.
+ */
+static mln_u8ptr_t mln_json_path_slice(mln_json_path_sel_t *sel, mln_u8ptr_t p, mln_u8ptr_t end, int singular)
 {
-    mln_u8ptr_t buf = *b;
-    if (u <= 0x7f) {
-        *buf++ = u & 0xFF;
-        ++(*count);
-    } else if (u <= 0x7FF) {
-        *buf++ = 0xC0 | ((u >> 6) & 0xFF);
-        *buf++ = 0x80 | ((u) & 0x3F);
-        (*count) += 2;
-    } else if (u <= 0xFFFF) {
-        *buf++ = 0xE0 | ((u >> 12) & 0xFF);
-        *buf++ = 0x80 | ((u >> 6) & 0x3F);
-        *buf++ = 0x80 | ((u) & 0x3F);
-        (*count) += 3;
+    mln_s64_t *part[3] = {&(sel->start), &(sel->end), &(sel->step)};
+    int i = 0;
+
+    sel->step = 1;
+    while (1) {
+        p = mln_json_path_blank(p, end);
+        if (p < end && (*p == (mln_u8_t)'-' || M_JSON_IS_DIGIT(*p))) {
+            if ((p = mln_json_path_int(p, end, part[i])) == NULL) return NULL;
+            if (i == 0) sel->has_start = 1;
+            else if (i == 1) sel->has_end = 1;
+            p = mln_json_path_blank(p, end);
+        }
+        if (i == 2 || p >= end || *p != (mln_u8_t)':') break;
+        ++p;
+        ++i;
+    }
+
+    if (i == 0) {
+        if (!sel->has_start) return NULL;
+        sel->type = M_JSON_PATH_INDEX;
     } else {
-        *buf++ = 0xF0 | ((u >> 18) & 0xFF);
-        *buf++ = 0x80 | ((u >> 12) & 0x3F);
-        *buf++ = 0x80 | ((u >> 6) & 0x3F);
-        *buf++ = 0x80 | (u & 0x3F);
-        (*count) += 4;
+        if (singular) return NULL;
+        sel->type = M_JSON_PATH_SLICE;
     }
-    *b = buf;
+
+    return p;
 }
 
-static inline int mln_json_char2int(char c)
+static mln_u8ptr_t mln_json_path_int(mln_u8ptr_t p, mln_u8ptr_t end, mln_s64_t *out)
 {
-    if (c >= '0' && c <= '9') return c - '0';
-    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
-    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
-    return c;
+    mln_s64_t v = 0;
+    int neg = 0, n = 0;
+
+    if (*p == (mln_u8_t)'-') {
+        neg = 1;
+        ++p;
+    }
+    /*RFC 9535 limits integers to the exact range of double*/
+    for (; p < end && M_JSON_IS_DIGIT(*p); ++p) {
+        if (++n > 16) return NULL;
+        v = v * 10 + (*p - '0');
+    }
+    if (n == 0) return NULL;
+
+    *out = neg? -v: v;
+    return p;
 }
 
-static inline int mln_json_get_char(mln_u8ptr_t *s, int *len, unsigned int *hex)
+/*
+ * Parse a quoted string, which is escaped as in JSON, plus \' in single quotes.
+ */
+static mln_u8ptr_t mln_json_path_string(mln_u8ptr_t p, mln_u8ptr_t end, mln_string_t **out)
 {
-    if (*len <= 0) return 0;
+    mln_u8_t quote = *p++;
+    mln_u8ptr_t q, buf, b;
+    unsigned int hex;
+    int len, c, n = 0;
 
-    if ((*s)[0] == (mln_u8_t)'\\' && *len > 1) {
-        switch ((*s)[1]) {
-            case (mln_u8_t)'\"':
-                (*s) += 2;
-                (*len) -= 2;
-                return '\"';
-            case (mln_u8_t)'\\':
-                (*s) += 2;
-                (*len) -= 2;
-                return '\\';
-            case (mln_u8_t)'/':
-                (*s) += 2;
-                (*len) -= 2;
-                return '/';
-            case (mln_u8_t)'b':
-                (*s) += 2;
-                (*len) -= 2;
-                return '\b';
-            case (mln_u8_t)'f':
-                (*s) += 2;
-                (*len) -= 2;
-                return '\f';
-            case (mln_u8_t)'n':
-                (*s) += 2;
-                (*len) -= 2;
-                return '\n';
-            case (mln_u8_t)'r':
-                (*s) += 2;
-                (*len) -= 2;
-                return '\r';
-            case (mln_u8_t)'t':
-                (*s) += 2;
-                (*len) -= 2;
-                return '\t';
-            case (mln_u8_t)'u': {
-                (*s) += 2;
-                (*len) -= 2;
-                if (*len < 4) return -1;
-                unsigned int h = 0;
-                h = mln_json_char2int(*(*s)++);
-                h <<= 4;
-                h |= mln_json_char2int(*(*s)++);
-                h <<= 4;
-                h |= mln_json_char2int(*(*s)++);
-                h <<= 4;
-                h |= mln_json_char2int(*(*s)++);
-                (*len) -= 4;
-                *hex = h;
-                return 0;
-            } default:
-                return -1;
+    for (q = p; q < end && *q != quote; ++q) {
+        if (*q == (mln_u8_t)'\\' && ++q >= end) return NULL;
+    }
+    if (q >= end || q - p > 0x7fffffff) return NULL;
+
+    /*unescaping never makes a string longer*/
+    if ((buf = (mln_u8ptr_t)malloc(q - p + 1)) == NULL) return NULL;
+    for (b = buf, len = q - p; len > 0; ) {
+        if (len > 1 && p[0] == (mln_u8_t)'\\' && p[1] == (mln_u8_t)'\'') {
+            *b++ = '\'';
+            p += 2;
+            len -= 2;
+            continue;
+        }
+        hex = 0;
+        if ((c = mln_json_get_char(&p, &len, &hex)) < 0) {
+            free(buf);
+            return NULL;
         }
+        if (c == 0) mln_json_encode_utf8(hex, &b, &n);
+        else *b++ = (mln_u8_t)c;
+    }
+    *b = 0;
+
+    if ((*out = mln_string_buf_new(buf, b - buf)) == NULL) {
+        free(buf);
+        return NULL;
+    }
+
+    return q + 1;
+}
+
+/*
+ * The filter expression parsers below leave *out NULL and free what they
+ * built if they fail.
+ */
+static mln_u8ptr_t mln_json_path_or(mln_json_path_expr_t **out, mln_u8ptr_t p, mln_u8ptr_t end)
+{
+    mln_json_path_expr_t *e;
+
+    if ((p = mln_json_path_and(out, p, end)) == NULL) return NULL;
+
+    while (1) {
+        p = mln_json_path_blank(p, end);
+        if (end - p < 2 || p[0] != (mln_u8_t)'|' || p[1] != (mln_u8_t)'|') return p;
+        if ((e = mln_json_path_expr_new(M_JSON_PATH_OR)) == NULL) goto err;
+        e->left = *out;
+        *out = e;
+        if ((p = mln_json_path_and(&(e->right), p + 2, end)) == NULL) goto err;
     }
 
-    switch ((*s)[0]) {
-        case (mln_u8_t)'\\':
-            return -1;
-        default:
-            break;
+err:
+    mln_json_path_expr_free(*out);
+    *out = NULL;
+    return NULL;
+}
+
+static mln_u8ptr_t mln_json_path_and(mln_json_path_expr_t **out, mln_u8ptr_t p, mln_u8ptr_t end)
+{
+    mln_json_path_expr_t *e;
+
+    if ((p = mln_json_path_unary(out, p, end)) == NULL) return NULL;
+
+    while (1) {
+        p = mln_json_path_blank(p, end);
+        if (end - p < 2 || p[0] != (mln_u8_t)'&' || p[1] != (mln_u8_t)'&') return p;
+        if ((e = mln_json_path_expr_new(M_JSON_PATH_AND)) == NULL) goto err;
+        e->left = *out;
+        *out = e;
+        if ((p = mln_json_path_unary(&(e->right), p + 2, end)) == NULL) goto err;
     }
-    (*len) -= 1;
-    return *((*s)++);
+
+err:
+    mln_json_path_expr_free(*out);
+    *out = NULL;
+    return NULL;
 }
 
-static int
-mln_json_parse_digit(mln_json_t *j, char *jstr, int len, mln_uauto_t index)
+static mln_u8ptr_t mln_json_path_unary(mln_json_path_expr_t **out, mln_u8ptr_t p, mln_u8ptr_t end)
 {
-    int sub_flag = 0, left;
-    double val = 0;
+    mln_json_path_expr_t *e;
+    enum json_path_op op = M_JSON_PATH_EXIST;
 
-    if (jstr[0] == '-') {
-        sub_flag = 1;
-        ++jstr;
-        if (--len <= 0) {
-            return -1;
+    *out = NULL;
+    p = mln_json_path_blank(p, end);
+    if (p >= end) return NULL;
+
+    if (*p == (mln_u8_t)'!') {
+        if ((*out = mln_json_path_expr_new(M_JSON_PATH_NOT)) == NULL) return NULL;
+        if ((p = mln_json_path_unary(&((*out)->left), p + 1, end)) == NULL) goto err;
+        return p;
+    }
+
+    if (*p == (mln_u8_t)'(') {
+        if ((p = mln_json_path_or(out, p + 1, end)) == NULL) return NULL;
+        p = mln_json_path_blank(p, end);
+        if (p >= end || *p != (mln_u8_t)')') goto err;
+        return p + 1;
+    }
+
+    if ((e = *out = mln_json_path_expr_new(M_JSON_PATH_EXIST)) == NULL) return NULL;
+    if ((p = mln_json_path_operand(&(e->lhs), p, end)) == NULL) goto err;
+
+    p = mln_json_path_blank(p, end);
+    if (end - p >= 2 && p[1] == (mln_u8_t)'=') {
+        switch (*p) {
+            case (mln_u8_t)'=': op = M_JSON_PATH_EQ; break;
+            case (mln_u8_t)'!': op = M_JSON_PATH_NE; break;
+            case (mln_u8_t)'<': op = M_JSON_PATH_LE; break;
+            case (mln_u8_t)'>': op = M_JSON_PATH_GE; break;
+            default: break;
         }
+        if (op != M_JSON_PATH_EXIST) p += 2;
+    } else if (p < end && *p == (mln_u8_t)'<') {
+        op = M_JSON_PATH_LT;
+        ++p;
+    } else if (p < end && *p == (mln_u8_t)'>') {
+        op = M_JSON_PATH_GT;
+        ++p;
     }
 
-    left = mln_json_digit_process(&val, jstr, len);
-    if (left < 0) {
-        return -1;
+    if (op == M_JSON_PATH_EXIST) {
+        /*a literal alone is not a test*/
+        if (e->lhs.rel == NULL) goto err;
+        return p;
     }
 
-    mln_json_number_init(j, sub_flag? -val: val);
+    e->op = op;
+    if ((p = mln_json_path_operand(&(e->rhs), p, end)) == NULL) goto err;
+    return p;
 
-    return left;
+err:
+    mln_json_path_expr_free(*out);
+    *out = NULL;
+    return NULL;
 }
 
-static inline int
-mln_json_digit_process(double *val, char *s, int len)
+static mln_u8ptr_t mln_json_path_operand(mln_json_path_operand_t *o, mln_u8ptr_t p, mln_u8ptr_t end)
+{
+    mln_string_t *s;
+    int len, left;
+
+    p = mln_json_path_blank(p, end);
+    if (p >= end) return NULL;
+
+    switch (*p) {
+        case (mln_u8_t)'@':
+            if ((o->rel = (mln_json_path_t *)calloc(1, sizeof(mln_json_path_t))) == NULL) return NULL;
+            return mln_json_path_segments(o->rel, p + 1, end, 1);
+        case (mln_u8_t)'\'':
+        case (mln_u8_t)'\"':
+            if ((p = mln_json_path_string(p, end, &s)) == NULL) return NULL;
+            mln_json_string_init(&(o->literal), s);
+            return p;
+        case (mln_u8_t)'t':
+            if (end - p < 4 || memcmp(p, "true", 4)) return NULL;
+            mln_json_true_init(&(o->literal));
+            return p + 4;
+        case (mln_u8_t)'f':
+            if (end - p < 5 || memcmp(p, "false", 5)) return NULL;
+            mln_json_false_init(&(o->literal));
+            return p + 5;
+        case (mln_u8_t)'n':
+            if (end - p < 4 || memcmp(p, "null", 4)) return NULL;
+            mln_json_null_init(&(o->literal));
+            return p + 4;
+        default:
+            break;
+    }
+
+    if (*p != (mln_u8_t)'-' && !M_JSON_IS_DIGIT(*p)) return NULL;
+    len = end - p > 0x7fffffff? 0x7fffffff: (int)(end - p);
+    if ((left = mln_json_parse_digit(&(o->literal), (char *)p, len, 0)) < 0) return NULL;
+
+    return p + (len - left);
+}
+
+static mln_json_path_step_t *mln_json_path_step_new(mln_json_path_t *path)
 {
-    double f = 0;
-    int i, j, dir = 1;
+    mln_json_path_step_t *steps;
 
-    if (!isdigit(*s)) return -1;
+    if (path->nsteps >= M_JSON_PATH_MAX_STEPS) return NULL;
+    steps = (mln_json_path_step_t *)realloc(path->steps, (path->nsteps + 1) * sizeof(mln_json_path_step_t));
+    if (steps == NULL) return NULL;
+    path->steps = steps;
 
-    if (s[0] == '0') {
-        ++s;
-        if (--len <= 0) return 0;
-        if (isdigit(*s)) return -1;
-    } else {
-        for (; len > 0; --len, ++s) {
-            if (!isdigit(*s)) break;
-            (*val) *= 10;
-            (*val) += (*s - '0');
-        }
-        if (len <= 0) return 0;
-    }
-
-    if (*s == '.') {
-        ++s;
-        if (--len <= 0) return -1;
-        for (i = 1; len > 0; --len, ++s, ++i) {
-            if (!isdigit(*s)) break;
-            f = *s - '0';
-            for (j = 0; j < i; ++j) {
-                f /= 10;
-            }
-            *val += f;
-        }
-        if (len <= 0) return 0;
-    }
+    memset(&steps[path->nsteps], 0, sizeof(mln_json_path_step_t));
+    return &steps[path->nsteps++];
+}
 
-    if (*s == 'e' || *s == 'E') {
-        ++s;
-        if (--len <= 0) return -1;
+static mln_json_path_sel_t *mln_json_path_sel_new(mln_json_path_step_t *st)
+{
+    mln_json_path_sel_t *sels;
 
-        if (*s == '+') {
-            ++s;
-            if (--len <= 0) return 0;
-        } else if (*s == '-') {
-            dir = 0;
-            ++s;
-            if (--len <= 0) return 0;
-        }
+    sels = (mln_json_path_sel_t *)realloc(st->sels, (st->nsels + 1) * sizeof(mln_json_path_sel_t));
+    if (sels == NULL) return NULL;
+    st->sels = sels;
 
-        for (i = 0; len > 0; --len, ++s) {
-            if (!isdigit(*s)) break;
-            i *= 10;
-            i += (*s - '0');
-        }
-        if (i == 0) return len;
+    memset(&sels[st->nsels], 0, sizeof(mln_json_path_sel_t));
+    return &sels[st->nsels++];
+}
 
-        for (f = 1, j = 0; j < i; ++j) {
-            if (dir) f *= 10;
-            else f /= 10;
-        }
-        (*val) *= f;
-    }
+static mln_json_path_expr_t *mln_json_path_expr_new(enum json_path_op op)
+{
+    mln_json_path_expr_t *e;
+
+    if ((e = (mln_json_path_expr_t *)calloc(1, sizeof(mln_json_path_expr_t))) == NULL) return NULL;
+    e->op = op;
+    mln_json_init(&(e->lhs.literal));
+    mln_json_init(&(e->rhs.literal));
 
-    return len;
+    return e;
 }
 
-static inline int
-mln_json_parse_true(mln_json_t *j, char *jstr, int len, mln_uauto_t index)
+static void mln_json_path_expr_free(mln_json_path_expr_t *e)
 {
-    if (len < 4) {
-        return -1;
+    if (e == NULL) return;
+
+    mln_json_path_expr_free(e->left);
+    mln_json_path_expr_free(e->right);
+    mln_json_path_free(e->lhs.rel);
+    mln_json_path_free(e->rhs.rel);
+    mln_json_destroy(&(e->lhs.literal));
+    mln_json_destroy(&(e->rhs.literal));
+    free(e);
+}
+
+static int mln_json_path_tree_walk(mln_json_path_ctx_t *ctx, mln_json_t *j, mln_u64_t states)
+{
+    mln_u64_t match = (mln_u64_t)1 << ctx->path->nsteps, cs;
+    mln_json_path_child_t c;
+    mln_json_path_step_t *st;
+    mln_json_kv_t *kv, *kvend;
+    mln_json_t *el;
+    mln_array_t *a;
+
+    if (states & match) {
+        if (ctx->iterator != NULL && ctx->iterator(j, ctx->data) < 0) return -1;
+        ++(ctx->count);
+        if (!(states &= ~match)) return 0;
     }
 
-    if (strncasecmp(jstr, "true", 4)) {
-        return -1;
+    if (!(states & (states - 1))) {
+        /*only one step is active, a single name or index is just looked up*/
+        st = &(ctx->path->steps[__builtin_ctzll(states)]);
+        if (!st->descendant && st->nsels == 1 && st->sels->type <= M_JSON_PATH_INDEX) {
+            if ((j = mln_json_path_select(j, st->sels)) == NULL) return 0;
+            return mln_json_path_tree_walk(ctx, j, states << 1);
+        }
     }
-    mln_json_true_init(j);
 
-    return len - 4;
+    /*each level takes a stack frame*/
+    if (++(ctx->depth) > M_JSON_PATH_MAX_DEPTH) return -1;
+
+    c.val = NULL;
+    if (mln_json_is_object(j)) {
+        a = &(mln_json_object_data_get(j)->kvs);
+        c.index = -1;
+        c.n = 0;
+        kv = (mln_json_kv_t *)mln_array_elts(a);
+        for (kvend = kv + mln_array_nelts(a); kv < kvend; ++kv) {
+            c.key = mln_json_string_data_get(&(kv->key));
+            c.val = &(kv->val);
+            if ((cs = mln_json_path_child_states(ctx->path, states, &c)) == 0) continue;
+            if (mln_json_path_tree_walk(ctx, &(kv->val), cs) < 0) return -1;
+        }
+    } else if (mln_json_is_array(j)) {
+        a = mln_json_array_data_get(j);
+        c.key = NULL;
+        c.n = mln_array_nelts(a);
+        el = (mln_json_t *)mln_array_elts(a);
+        for (c.index = 0; c.index < c.n; ++(c.index)) {
+            c.val = &el[c.index];
+            if ((cs = mln_json_path_child_states(ctx->path, states, &c)) == 0) continue;
+            if (mln_json_path_tree_walk(ctx, &el[c.index], cs) < 0) return -1;
+        }
+    }
+
+    --(ctx->depth);
+    return 0;
 }
 
-static inline int
-mln_json_parse_false(mln_json_t *j, char *jstr, int len, mln_uauto_t index)
+/*
+ * Walk the value whose first token is at pos, leaving ix at its last token like
+ * mln_json_index_value does. Children without active steps are skipped.
+ */
+static int mln_json_path_text_walk(mln_json_path_ctx_t *ctx, mln_json_index_t *ix, mln_u64_t pos, mln_u64_t states)
 {
-    if (len < 5) {
-        return -1;
+    mln_u64_t match = (mln_u64_t)1 << ctx->path->nsteps, end, cs, s;
+    mln_u8ptr_t data = ix->data;
+    mln_json_path_child_t c;
+    int need_len = 0;
+
+    if (states & match) {
+        states &= ~match;
+        if (!states || (data[pos] != (mln_u8_t)'{' && data[pos] != (mln_u8_t)'['))
+            return mln_json_path_emit(ctx, ix, pos, 1);
+        /*the steps going on need the input, so the match is built separately*/
+        if (mln_json_path_emit(ctx, ix, pos, 0) < 0) return -1;
+    } else if (data[pos] != (mln_u8_t)'{' && data[pos] != (mln_u8_t)'[') {
+        return mln_json_lazy_skip(ix, pos);
     }
 
-    if (strncasecmp(jstr, "false", 5)) {
-        return -1;
+    /*each level takes a stack frame*/
+    if (++(ctx->depth) > M_JSON_PATH_MAX_DEPTH) return -1;
+
+    c.key = NULL;
+    c.val = NULL;
+    c.lazy.data = data;
+    c.lazy.len = ix->len;
+
+    if (data[pos] == (mln_u8_t)'{') {
+        c.index = -1;
+        c.n = 0;
+        if (mln_json_index_next(ix, &pos) < 0) return -1;
+        while (data[pos] != (mln_u8_t)'}') {
+            if (data[pos] != (mln_u8_t)'\"') return -1;
+            if (mln_json_index_next(ix, &end) < 0 || data[end] != (mln_u8_t)'\"') return -1;
+            c.raw = data + pos + 1;
+            c.rawlen = end - pos - 1;
+            if (mln_json_index_next(ix, &pos) < 0 || data[pos] != (mln_u8_t)':') return -1;
+            if (mln_json_index_next(ix, &pos) < 0) return -1;
+
+            c.lazy.pos = pos;
+            if ((cs = mln_json_path_child_states(ctx->path, states, &c)) != 0) {
+                if (mln_json_path_text_walk(ctx, ix, pos, cs) < 0) return -1;
+            } else if (mln_json_lazy_skip(ix, pos) < 0) {
+                return -1;
+            }
+
+            if (mln_json_index_next(ix, &pos) < 0) return -1;
+            if (data[pos] == (mln_u8_t)'}') break;
+            if (data[pos] != (mln_u8_t)',' || mln_json_index_next(ix, &pos) < 0) return -1;
+        }
+        --(ctx->depth);
+        return 0;
     }
-    mln_json_false_init(j);
 
-    return len - 5;
+    /*the length is counted only if a negative index or slice bound needs it*/
+    for (s = states; s; s &= s - 1) {
+        if (ctx->path->steps[__builtin_ctzll(s)].need_len) need_len = 1;
+    }
+    c.lazy.pos = pos;
+    if (!need_len) c.n = (mln_s64_t)(~0ULL >> 1);
+    else if ((c.n = mln_json_path_lazy_count(&(c.lazy))) < 0) return -1;
+
+    c.index = 0;
+    if (mln_json_index_next(ix, &pos) < 0) return -1;
+    while (data[pos] != (mln_u8_t)']') {
+        c.lazy.pos = pos;
+        if ((cs = mln_json_path_child_states(ctx->path, states, &c)) != 0) {
+            if (mln_json_path_text_walk(ctx, ix, pos, cs) < 0) return -1;
+        } else if (mln_json_lazy_skip(ix, pos) < 0) {
+            return -1;
+        }
+        ++(c.index);
+
+        if (mln_json_index_next(ix, &pos) < 0) return -1;
+        if (data[pos] == (mln_u8_t)']') break;
+        if (data[pos] != (mln_u8_t)',' || mln_json_index_next(ix, &pos) < 0) return -1;
+    }
+
+    --(ctx->depth);
+    return 0;
 }
 
-static inline int
-mln_json_parse_null(mln_json_t *j, char *jstr, int len, mln_uauto_t index)
+/*
+ * Build the matched value at pos and report it. If consume is not set, the value
+ * is built through another index and ix is left at pos.
+ */
+static int mln_json_path_emit(mln_json_path_ctx_t *ctx, mln_json_index_t *ix, mln_u64_t pos, int consume)
 {
-    if (len < 4) {
-        return -1;
+    mln_json_index_t own;
+    mln_json_lazy_t l;
+    mln_json_t v;
+    int rc = 0;
+
+    if (!consume) {
+        l.data = ix->data;
+        l.len = ix->len;
+        l.pos = pos;
+        mln_json_lazy_index_init(&own, &l);
+        ix = &own;
+        if (mln_json_index_next(ix, &pos) < 0) return -1;
     }
 
-    if (strncasecmp(jstr, "null", 4)) {
+    mln_json_init(&v);
+    if (mln_json_index_value(ix, ctx->pool, &v, pos) < 0) {
+        mln_json_destroy(&v);
         return -1;
     }
-    mln_json_null_init(j);
+    if (ctx->iterator != NULL) rc = ctx->iterator(&v, ctx->data);
+    mln_json_destroy(&v);
+    if (rc < 0) return -1;
 
-    return len - 4;
+    ++(ctx->count);
+    return 0;
 }
 
-static inline void mln_json_jumpoff_blank(char **jstr, int *len)
+/*
+ * A descendant step stays active on the children, and a step whose selectors
+ * take the child activates the next one.
+ */
+static mln_u64_t mln_json_path_child_states(mln_json_path_t *path, mln_u64_t states, mln_json_path_child_t *c)
 {
-    for (; \
-         *len > 0 && (*jstr[0] == ' ' || *jstr[0] == '\t' || *jstr[0] == '\r' || *jstr[0] == '\n'); \
-         ++(*jstr), --(*len))
-        ;
+    mln_json_path_step_t *st;
+    mln_json_path_sel_t *sel, *selend;
+    mln_u64_t cs = 0;
+    int s;
+
+    for (; states; states &= states - 1) {
+        s = __builtin_ctzll(states);
+        st = &(path->steps[s]);
+        if (st->descendant) cs |= (mln_u64_t)1 << s;
+        for (sel = st->sels, selend = sel + st->nsels; sel < selend; ++sel) {
+            if (mln_json_path_sel_match(sel, c)) {
+                cs |= (mln_u64_t)1 << (s + 1);
+                break;
+            }
+        }
+    }
+
+    return cs;
 }
 
+static int mln_json_path_sel_match(mln_json_path_sel_t *sel, mln_json_path_child_t *c)
+{
+    switch (sel->type) {
+        case M_JSON_PATH_NAME:
+            if (c->index >= 0) return 0;
+            if (c->key != NULL) return mln_json_key_equal(c->key, sel->name);
+            return !mln_json_lazy_key_cmp(c->raw, c->rawlen, sel->name);
+        case M_JSON_PATH_INDEX:
+            if (c->index < 0) return 0;
+            return c->index == (sel->start < 0? sel->start + c->n: sel->start);
+        case M_JSON_PATH_SLICE:
+            return c->index >= 0 && mln_json_path_slice_match(sel, c->index, c->n);
+        case M_JSON_PATH_WILDCARD:
+            return 1;
+        default:
+            break;
+    }
+    return mln_json_path_filter(sel->filter, c);
+}
 
-mln_string_t *mln_json_encode(mln_json_t *j)
+/*
+ * The bounds are normalized and clamped as RFC 9535 does, then i is tested
+ * against them, so the selected elements stay in document order.
+ */
+static int mln_json_path_slice_match(mln_json_path_sel_t *sel, mln_s64_t i, mln_s64_t n)
 {
-    mln_u32_t size = mln_json_get_length(j), n;
-    mln_s8ptr_t buf;
-    mln_string_t *s;
+    mln_s64_t step = sel->step, start, end, lower, upper;
 
-    buf = (mln_s8ptr_t)malloc(size);
-    if (buf == NULL) return NULL;
+    if (step == 0) return 0;
 
-    n = mln_json_write_content(j, buf);
-    buf[n] = 0;
+    start = sel->start < 0? sel->start + n: sel->start;
+    end = sel->end < 0? sel->end + n: sel->end;
 
-    s = mln_string_const_ndup(buf, n);
-    free(buf);
-    if (s == NULL) return NULL;
+    if (step > 0) {
+        lower = !sel->has_start? 0: (start < 0? 0: (start > n? n: start));
+        upper = !sel->has_end? n: (end < 0? 0: (end > n? n: end));
+        return i >= lower && i < upper && (i - lower) % step == 0;
+    }
 
-    return s;
+    upper = !sel->has_start? n - 1: (start < -1? -1: (start >= n? n - 1: start));
+    lower = !sel->has_end? -1: (end < -1? -1: (end >= n? n - 1: end));
+    return i > lower && i <= upper && (upper - i) % -step == 0;
 }
 
-static inline mln_size_t mln_json_get_length(mln_json_t *j)
+static mln_json_t *mln_json_path_select(mln_json_t *j, mln_json_path_sel_t *sel)
 {
-    if (j == NULL) return 0;
+    mln_s64_t i = sel->start;
 
-    char num_str[512] = {0};
-    mln_size_t length = 1;
-    mln_u8ptr_t p, end;
+    if (sel->type == M_JSON_PATH_NAME)
+        return mln_json_is_object(j)? mln_json_obj_search(j, sel->name): NULL;
 
-    switch (j->type) {
-        case M_JSON_OBJECT:
-            length += 2;
-            mln_rbtree_iterate(mln_json_object_data_get(j), mln_json_get_length_obj_iterate_handler, &length);
-            break;
-        case M_JSON_ARRAY:
-        {
-            mln_json_t *el = (mln_json_t *)mln_array_elts(mln_json_array_data_get(j));
-            mln_json_t *elend = el + mln_array_nelts(mln_json_array_data_get(j));
-            length += 2;
-            for (; el < elend; ++el) {
-                length += (mln_json_get_length(el) + 1);
-            }
-            break;
-        }
-        case M_JSON_STRING:
-            length += 2;
-            if (j->data.m_j_string != NULL) {
-                p = j->data.m_j_string->data;
-                end = p + j->data.m_j_string->len;
-                for (; p < end; ++p) {
-                    if (*p == '\"' || *p == '\\')
-                        ++length;
-                }
-                length += j->data.m_j_string->len;
-            }
-            break;
-        case M_JSON_NUM:
-            length += snprintf(num_str, sizeof(num_str), "%f", j->data.m_j_number);
-            break;
-        case M_JSON_TRUE:
-            length += 4;
-            break;
-        case M_JSON_FALSE:
-            length += 5;
-            break;
-        case M_JSON_NULL:
-            length += 4;
-            break;
-        default:
-            break;
-    }
-
-    return length;
+    if (!mln_json_is_array(j)) return NULL;
+    if (i < 0 && (i += (mln_s64_t)mln_json_array_length(j)) < 0) return NULL;
+    return mln_json_array_search(j, (mln_uauto_t)i);
 }
 
-static int
-mln_json_get_length_obj_iterate_handler(mln_rbtree_node_t *node, void *data)
+static int mln_json_path_lazy_select(mln_json_lazy_t *l, mln_json_path_sel_t *sel)
 {
-    mln_json_kv_t *kv = (mln_json_kv_t *)mln_rbtree_node_data_get(node);
-    mln_size_t *length = (mln_size_t *)data;
+    mln_json_lazy_t next;
+    mln_s64_t i = sel->start, n;
+
+    if (sel->type == M_JSON_PATH_NAME) {
+        if (mln_json_lazy_obj_search(l, sel->name, &next) < 0) return -1;
+    } else {
+        if (i < 0 && ((n = mln_json_path_lazy_count(l)) < 0 || (i += n) < 0)) return -1;
+        if (mln_json_lazy_array_search(l, (mln_uauto_t)i, &next) < 0) return -1;
+    }
 
-    (*length) += (mln_json_get_length(&(kv->key)) + mln_json_get_length(&(kv->val)) + 2);
+    *l = next;
     return 0;
 }
 
-struct mln_json_tmp_s {
-    void *ptr1;
-    void *ptr2;
-};
-
-static inline mln_size_t
-mln_json_write_content(mln_json_t *j, mln_s8ptr_t buf)
+static mln_s64_t mln_json_path_lazy_count(mln_json_lazy_t *l)
 {
-    if (j == NULL) return 0;
+    mln_json_index_t ix;
+    mln_u8ptr_t data = l->data;
+    mln_u64_t pos;
+    mln_s64_t n = 0;
 
-    int n;
-    mln_size_t length = 0, save;
-    mln_string_t *s;
-    struct mln_json_tmp_s tmp;
-    mln_u8ptr_t p, end;
+    if (data[l->pos] != (mln_u8_t)'[') return -1;
 
-    switch (j->type) {
-        case M_JSON_OBJECT:
-            *buf++ = '{';
-            ++length;
-            tmp.ptr1 = &length;
-            tmp.ptr2 = &buf;
-            save = length;
-            mln_rbtree_iterate(mln_json_object_data_get(j), mln_json_write_content_obj_iterate_handler, &tmp);
-            if (save < length) {
-                --buf;
-                --length;
-                *buf = 0;
-            }
-            *buf++ = '}';
-            ++length;
-            break;
-        case M_JSON_ARRAY:
-        {
-            mln_json_t *el = (mln_json_t *)mln_array_elts(mln_json_array_data_get(j));
-            mln_json_t *elend = el + mln_array_nelts(mln_json_array_data_get(j));
-
-            *buf++ = '[';
-            ++length;
-            save = length;
-            for (; el < elend; ++el) {
-                n = mln_json_write_content(el, buf);
-                buf += n;
-                length += n;
-
-                *buf++ = ',';
-                length += 1;
-            }
-            if (save < length) {
-                --buf;
-                --length;
-                *buf = 0;
-            }
-            *buf++ = ']';
-            ++length;
-            break;
-        }
-        case M_JSON_STRING:
-            *buf++ = '\"';
-            ++length;
-            if ((s = j->data.m_j_string) != NULL) {
-                p = j->data.m_j_string->data;
-                end = p + j->data.m_j_string->len;
-                for (; p < end; ) {
-                    if (*p == '\"' || *p == '\\') {
-                        *buf++ = '\\';
-                        ++length;
-                    }
-                    *buf++ = *p++;
-                    ++length;
-                }
-            }
-            *buf++ = '\"';
-            ++length;
-            break;
-        case M_JSON_NUM:
-        {
-            mln_s64_t i = (mln_s64_t)(j->data.m_j_number);
-            if (i == j->data.m_j_number)
-#if defined(WIN32)
-                n = snprintf(buf, 512, "%I64d", i);
-#elif defined(i386) || defined(__arm__) || defined(__wasm__)
-                n = snprintf(buf, 512, "%lld", i);
-#else
-                n = snprintf(buf, 512, "%ld", i);
-#endif
-            else
-                n = snprintf(buf, 512, "%f", j->data.m_j_number);
-            buf += n;
-            length += n;
-            break;
-        }
-        case M_JSON_TRUE:
-            memcpy(buf, "true", 4);
-            buf += 4;
-            length += 4;
-            break;
-        case M_JSON_FALSE:
-            memcpy(buf, "false", 5);
-            buf += 5;
-            length += 5;
-            break;
-        case M_JSON_NULL:
-            memcpy(buf, "null", 4);
-            buf += 4;
-            length += 4;
-            break;
-        default:
-            break;
+    mln_json_lazy_index_init(&ix, l);
+    if (mln_json_index_next(&ix, &pos) < 0 || mln_json_index_next(&ix, &pos) < 0) return -1;
+
+    while (data[pos] != (mln_u8_t)']') {
+        ++n;
+        if (mln_json_lazy_skip(&ix, pos) < 0 || mln_json_index_next(&ix, &pos) < 0) return -1;
+        if (data[pos] == (mln_u8_t)']') break;
+        if (data[pos] != (mln_u8_t)',' || mln_json_index_next(&ix, &pos) < 0) return -1;
     }
 
-    return length;
+    return n;
 }
 
-static int
-mln_json_write_content_obj_iterate_handler(mln_rbtree_node_t *node, void *data)
+static int mln_json_path_filter(mln_json_path_expr_t *e, mln_json_path_child_t *c)
 {
-    mln_json_kv_t *kv = (mln_json_kv_t *)mln_rbtree_node_data_get(node);
-    struct mln_json_tmp_s *tmp = (struct mln_json_tmp_s *)data;
-    mln_size_t *length = (mln_size_t *)(tmp->ptr1);
-    mln_s8ptr_t *buf = (mln_s8ptr_t *)(tmp->ptr2);
-    mln_size_t n;
-
-    if (kv == NULL) return 0;
-
-    n = mln_json_write_content(&(kv->key), *buf);
-    (*buf) += n;
-    (*length) += n;
-    *(*buf)++ = ':';
-    ++(*length);
-    n = mln_json_write_content(&(kv->val), *buf);
-    (*buf) += n;
-    (*length) += n;
+    mln_json_t ta, tb, *a, *b;
+    int rc;
+
+    switch (e->op) {
+        case M_JSON_PATH_OR:
+            return mln_json_path_filter(e->left, c) || mln_json_path_filter(e->right, c);
+        case M_JSON_PATH_AND:
+            return mln_json_path_filter(e->left, c) && mln_json_path_filter(e->right, c);
+        case M_JSON_PATH_NOT:
+            return !mln_json_path_filter(e->left, c);
+        case M_JSON_PATH_EXIST:
+            return mln_json_path_value(&(e->lhs), c, &ta, 0) != NULL;
+        default:
+            break;
+    }
 
-    *(*buf)++ = ',';
-    (*length) += 1;
+    a = mln_json_path_value(&(e->lhs), c, &ta, 1);
+    b = mln_json_path_value(&(e->rhs), c, &tb, 1);
+    rc = mln_json_path_compare(e->op, a, b);
+    mln_json_destroy(&ta);
+    mln_json_destroy(&tb);
 
-    return 0;
+    return rc;
 }
 
+/*
+ * Values in the input are not built unless build is set and they are scalars,
+ * containers are never comparable, so they are only marked as existing.
+ */
+static mln_json_t mln_json_path_unbuilt = {.type = M_JSON_OBJECT};
 
-int mln_json_parse(mln_json_t *j, mln_string_t *exp, mln_json_iterator_t iterator, void *data)
+static mln_json_t *mln_json_path_value(mln_json_path_operand_t *o, mln_json_path_child_t *c, mln_json_t *tmp, int build)
 {
-    mln_size_t idx = 0;
-    mln_string_t *p, *arr = mln_string_slice(exp, ".");
-    if (arr == NULL) return -1;
+    mln_json_path_step_t *st, *stend;
+    mln_json_lazy_t l;
+    mln_json_t *j;
+    enum json_type type;
+
+    mln_json_init(tmp);
+    if (o->rel == NULL) return &(o->literal);
+
+    st = o->rel->steps;
+    stend = st + o->rel->nsteps;
+    if (c->val != NULL) {
+        for (j = c->val; j != NULL && st < stend; ++st)
+            j = mln_json_path_select(j, st->sels);
+        return j;
+    }
 
-    for (p = arr; p->len != 0; ++p) {
-        if (mln_json_is_object(j)) {
-            j = mln_json_obj_search(j, p);
-            if (j == NULL) goto err;
-        } else if (mln_json_is_array(j)) {
-            if (!mln_json_parse_is_index(p, &idx)) goto err;
-            j = mln_json_array_search(j, idx);
-            if (j == NULL) goto err;
-        } else {
-err:
-            mln_string_slice_free(arr);
-            return -1;
+    for (l = c->lazy; st < stend; ++st) {
+        if (mln_json_path_lazy_select(&l, st->sels) < 0) return NULL;
+    }
+    type = mln_json_lazy_type(&l);
+    if (!build || type == M_JSON_OBJECT || type == M_JSON_ARRAY) return &mln_json_path_unbuilt;
+    if (mln_json_lazy_decode(&l, NULL, tmp) < 0) return NULL;
+
+    return tmp;
+}
+
+/*
+ * Numbers and strings are ordered, true, false and null are only equal to
+ * themselves. Nothing (a missing value) is only equal to nothing.
+ */
+static int mln_json_path_compare(enum json_path_op op, mln_json_t *a, mln_json_t *b)
+{
+    mln_string_t *sa, *sb;
+    int eq = 0, ordered = 0, cmp = 0;
+    mln_u64_t n;
+
+    if (a == NULL || b == NULL) {
+        eq = a == b;
+    } else if (a->type == b->type) {
+        switch (a->type) {
+            case M_JSON_NUM:
+                cmp = mln_json_path_num_cmp(a, b);
+                eq = !cmp;
+                ordered = 1;
+                break;
+            case M_JSON_STRING:
+                sa = mln_json_string_data_get(a);
+                sb = mln_json_string_data_get(b);
+                n = sa->len < sb->len? sa->len: sb->len;
+                if (!n || !(cmp = memcmp(sa->data, sb->data, n)))
+                    cmp = (sa->len > sb->len) - (sa->len < sb->len);
+                eq = !cmp;
+                ordered = 1;
+                break;
+            case M_JSON_TRUE:
+            case M_JSON_FALSE:
+            case M_JSON_NULL:
+                eq = 1;
+                break;
+            default:
+                break;
         }
     }
-    mln_string_slice_free(arr);
-    if (iterator != NULL)
-        return iterator(j, data);
-    return 0;
+
+    switch (op) {
+        case M_JSON_PATH_EQ:
+            return eq;
+        case M_JSON_PATH_NE:
+            return !eq;
+        case M_JSON_PATH_LT:
+            return ordered && cmp < 0;
+        case M_JSON_PATH_LE:
+            return eq || (ordered && cmp < 0);
+        case M_JSON_PATH_GT:
+            return ordered && cmp > 0;
+        default:
+            break;
+    }
+    return eq || (ordered && cmp > 0);
 }
 
-static inline int mln_json_parse_is_index(mln_string_t *s, mln_size_t *idx)
+/*
+ * Integers are compared exactly, a double with anything else as doubles.
+ */
+static int mln_json_path_num_cmp(mln_json_t *a, mln_json_t *b)
 {
-    mln_u8ptr_t p = s->data, pend = s->data + s->len - 1;
-    mln_size_t sum = 0;
+    mln_u64_t x, y;
+    double dx, dy;
 
-    for (; pend >= p; --pend) {
-        if (*pend < (mln_u8_t)'0' || *pend > (mln_u8_t)'9')
-           return 0;
-        sum = sum * 10 + (*pend - (mln_u8_t)'0');
+    if ((!mln_json_is_int(a) && !mln_json_is_uint(a)) || (!mln_json_is_int(b) && !mln_json_is_uint(b))) {
+        dx = mln_json_number_data_get(a);
+        dy = mln_json_number_data_get(b);
+        return (dx > dy) - (dx < dy);
     }
-    *idx = sum;
-    return 1;
+
+    if (a->num_type == M_JSON_NUM_INT && a->data.m_j_int < 0) {
+        if (b->num_type != M_JSON_NUM_INT || b->data.m_j_int >= 0) return -1;
+        return (a->data.m_j_int > b->data.m_j_int) - (a->data.m_j_int < b->data.m_j_int);
+    }
+    if (b->num_type == M_JSON_NUM_INT && b->data.m_j_int < 0) return 1;
+
+    /*both are non-negative now*/
+    x = a->num_type == M_JSON_NUM_INT? (mln_u64_t)a->data.m_j_int: a->data.m_j_uint;
+    y = b->num_type == M_JSON_NUM_INT? (mln_u64_t)b->data.m_j_int: b->data.m_j_uint;
+    return (x > y) - (x < y);
 }
 
 
@@ -1164,25 +4888,26 @@ again:
         case 'd':
         {
             s32 = va_arg(*arg, mln_s32_t);
-            mln_json_number_init(&v, s32);
+            mln_json_int_init(&v, s32);
             break;
         }
         case 'D':
         {
             s64 = va_arg(*arg, mln_s64_t);
-            mln_json_number_init(&v, s64);
+            mln_json_int_init(&v, s64);
             break;
         }
         case 'u':
         {
             u32 = va_arg(*arg, mln_u32_t);
-            mln_json_number_init(&v, u32);
+            mln_json_int_init(&v, u32);
             break;
         }
         case 'U':
         {
             u64 = va_arg(*arg, mln_u64_t);
-            mln_json_number_init(&v, u64);
+            if (u64 > 0x7fffffffffffffffULL) mln_json_uint_init(&v, u64);
+            else mln_json_int_init(&v, u64);
             break;
         }
         case 'F':
@@ -1296,25 +5021,26 @@ again:
         case 'd':
         {
             s32 = va_arg(*arg, mln_s32_t);
-            mln_json_number_init(&v, s32);
+            mln_json_int_init(&v, s32);
             break;
         }
         case 'D':
         {
             s64 = va_arg(*arg, mln_s64_t);
-            mln_json_number_init(&v, s64);
+            mln_json_int_init(&v, s64);
             break;
         }
         case 'u':
         {
             u32 = va_arg(*arg, mln_u32_t);
-            mln_json_number_init(&v, u32);
+            mln_json_int_init(&v, u32);
             break;
         }
         case 'U':
         {
             u64 = va_arg(*arg, mln_u64_t);
-            mln_json_number_init(&v, u64);
+            if (u64 > 0x7fffffffffffffffULL) mln_json_uint_init(&v, u64);
+            else mln_json_int_init(&v, u64);
             break;
         }
         case 'F':
@@ -1406,17 +5132,12 @@ int mln_json_object_iterate(mln_json_t *j, mln_json_object_iterator_t it, void *
 {
     if (!mln_json_is_object(j)) return -1;
 
-    struct mln_json_tmp_s tmp;
-    tmp.ptr1 = it;
-    tmp.ptr2 = data;
-    return mln_rbtree_iterate(mln_json_object_data_get(j), mln_json_object_iterator, &tmp);
-}
+    mln_json_kv_t *kv = (mln_json_kv_t *)mln_array_elts(&(mln_json_object_data_get(j)->kvs));
+    mln_json_kv_t *end = kv + mln_array_nelts(&(mln_json_object_data_get(j)->kvs));
 
-static inline int mln_json_object_iterator(mln_rbtree_node_t *node, void *data)
-{
-    struct mln_json_tmp_s *tmp = (struct mln_json_tmp_s *)data;
-    mln_json_kv_t *kv = (mln_json_kv_t *)mln_rbtree_node_data_get(node);
-    mln_json_object_iterator_t it = (mln_json_object_iterator_t)(tmp->ptr1);
-    return it(&(kv->key), &(kv->val), tmp->ptr2);
+    for (; kv < end; ++kv) {
+        if (it(&(kv->key), &(kv->val), data) < 0) return -1;
+    }
+    return 0;
 }
 
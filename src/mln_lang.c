@@ -78,6 +78,8 @@ MLN_CHAIN_FUNC_DEFINE(mln_lang_ctx, \
                       static inline void, \
                       prev, \
                       next);
+MLN_ARRAY_FUNC_DECLARE(mln_lang_var_array, mln_lang_var_t *, static inline)
+MLN_ARRAY_FUNC_DEFINE(mln_lang_var_array, mln_lang_var_t *, static inline)
 static int mln_lang_ctx_alias_cmp(mln_lang_ctx_t *ctx1, mln_lang_ctx_t *ctx2);
 static inline mln_lang_ctx_t *
 __mln_lang_job_new(mln_lang_t *lang, \
@@ -151,7 +153,7 @@ static inline void __mln_lang_var_assign(mln_lang_var_t *var, mln_lang_val_t *va
 static inline int
 __mln_lang_var_value_set(mln_lang_ctx_t *ctx, mln_lang_var_t *dest, mln_lang_var_t *src);
 static inline int
-mln_lang_funcdef_args_get(mln_lang_ctx_t *ctx, mln_lang_exp_t *exp, mln_array_t *arr, int is_closure);
+mln_lang_funcdef_args_get(mln_lang_ctx_t *ctx, mln_lang_exp_t *exp, mln_lang_var_array_t *arr, int is_closure);
 static inline mln_lang_func_detail_t *
 __mln_lang_func_detail_new(mln_lang_ctx_t *ctx, \
                            mln_lang_func_type_t type, \
@@ -1991,7 +1993,7 @@ void mln_lang_var_set_string(mln_lang_var_t *var, mln_string_t *s)
 
 
 static inline int
-mln_lang_funcdef_args_get(mln_lang_ctx_t *ctx, mln_lang_exp_t *exp, mln_array_t *arr, int is_closure)
+mln_lang_funcdef_args_get(mln_lang_ctx_t *ctx, mln_lang_exp_t *exp, mln_lang_var_array_t *arr, int is_closure)
 {
     mln_lang_exp_t *scan;
     mln_lang_var_t *var, **v;
@@ -2023,7 +2025,7 @@ mln_lang_funcdef_args_get(mln_lang_ctx_t *ctx, mln_lang_exp_t *exp, mln_array_t
             return -1;
         }
 
-        if ((v = (mln_lang_var_t **)mln_array_push(arr)) == NULL) {
+        if ((v = mln_lang_var_array_push(arr)) == NULL) {
             return -1;
         }
         if ((*v = __mln_lang_var_new(ctx, factor->data.s_id, type, NULL, NULL)) == NULL) {
@@ -2064,7 +2066,7 @@ __mln_lang_func_detail_new(mln_lang_ctx_t *ctx, \
                            mln_lang_exp_t *exp, \
                            mln_lang_exp_t *closure)
 {
-    struct mln_array_attr attr;
+    struct mln_array_type_attr attr;
     mln_lang_func_detail_t *lfd;
     if ((lfd = (mln_lang_func_detail_t *)mln_alloc_m(ctx->pool, sizeof(mln_lang_func_detail_t))) == NULL) {
         return NULL;
@@ -2074,18 +2076,10 @@ __mln_lang_func_detail_new(mln_lang_ctx_t *ctx, \
     attr.pool = ctx->pool;
     attr.pool_alloc = (array_pool_alloc_handler)mln_alloc_m;
     attr.pool_free = (array_pool_free_handler)mln_alloc_free;
+    attr.pool_realloc = (array_pool_realloc_handler)mln_alloc_re;
     attr.free = (array_free)mln_lang_var_pfree;
-    attr.size = sizeof(mln_lang_var_t *);
-    attr.nalloc = M_LANG_ARRAY_PREALLOC;
-    if (mln_array_init(&(lfd->args), &attr) < 0) {
-        mln_alloc_free(lfd);
-        return NULL;
-    }
-    if (mln_array_init(&(lfd->closure), &attr) < 0) {
-        mln_array_destroy(&(lfd->args));
-        mln_alloc_free(lfd);
-        return NULL;
-    }
+    mln_lang_var_array_init(&(lfd->args), &attr);
+    mln_lang_var_array_init(&(lfd->closure), &attr);
     lfd->type = type;
     switch (type) {
         case M_FUNC_INTERNAL:
@@ -2118,8 +2112,8 @@ void mln_lang_func_detail_free(mln_lang_func_detail_t *lfd)
 static inline void __mln_lang_func_detail_free(mln_lang_func_detail_t *lfd)
 {
     if (lfd == NULL) return;
-    mln_array_destroy(&lfd->args);
-    mln_array_destroy(&lfd->closure);
+    mln_lang_var_array_destroy(&lfd->args);
+    mln_lang_var_array_destroy(&lfd->closure);
     mln_alloc_free(lfd);
 }
 
@@ -2142,7 +2136,7 @@ mln_lang_func_detail_dup(mln_lang_ctx_t *ctx, mln_lang_func_detail_t *func)
     if (ret == NULL) return NULL;
 
     for (i = 0; i < mln_array_nelts(&(func->args)); ++i) {
-        if ((var = (mln_lang_var_t **)mln_array_push(&(ret->args))) == NULL) {
+        if ((var = mln_lang_var_array_push(&(ret->args))) == NULL) {
             __mln_lang_func_detail_free(ret);
             return NULL;
         }
@@ -2153,7 +2147,7 @@ mln_lang_func_detail_dup(mln_lang_ctx_t *ctx, mln_lang_func_detail_t *func)
         }
     }
     for (i = 0; i < mln_array_nelts(&(func->closure)); ++i) {
-        if ((var = (mln_lang_var_t **)mln_array_push(&(ret->closure))) == NULL) {
+        if ((var = mln_lang_var_array_push(&(ret->closure))) == NULL) {
             __mln_lang_func_detail_free(ret);
             return NULL;
         }
@@ -2170,7 +2164,7 @@ int mln_lang_func_detail_arg_append(mln_lang_func_detail_t *func, mln_lang_var_t
 {
     mln_lang_var_t **v;
 
-    if ((v = (mln_lang_var_t **)mln_array_push(&(func->args))) == NULL) {
+    if ((v = mln_lang_var_array_push(&(func->args))) == NULL) {
         return -1;
     }
     *v = var;
@@ -2765,7 +2759,7 @@ int mln_lang_array_elem_exist(mln_lang_array_t *array, mln_lang_var_t *key)
 
 static inline mln_lang_funccall_val_t *__mln_lang_funccall_val_new(mln_alloc_t *pool, mln_string_t *name)
 {
-    struct mln_array_attr attr;
+    struct mln_array_type_attr attr;
     mln_lang_funccall_val_t *func;
 
     if ((func = (mln_lang_funccall_val_t *)mln_alloc_m(pool, sizeof(mln_lang_funccall_val_t))) == NULL) {
@@ -2782,13 +2776,9 @@ static inline mln_lang_funccall_val_t *__mln_lang_funccall_val_new(mln_alloc_t *
     attr.pool = pool;
     attr.pool_alloc = (array_pool_alloc_handler)mln_alloc_m;
     attr.pool_free = (array_pool_free_handler)mln_alloc_free;
+    attr.pool_realloc = (array_pool_realloc_handler)mln_alloc_re;
     attr.free = (array_free)mln_lang_var_pfree;
-    attr.size = sizeof(mln_lang_var_t *);
-    attr.nalloc = M_LANG_ARRAY_PREALLOC;
-    if (mln_array_init(&func->args, &attr) < 0) {
-        mln_alloc_free(func);
-        return NULL;
-    }
+    mln_lang_var_array_init(&func->args, &attr);
     return func;
 }
 
@@ -2808,7 +2798,7 @@ static inline void __mln_lang_funccall_val_free(mln_lang_funccall_val_t *func)
     if (func->name != NULL) {
         mln_string_free(func->name);
     }
-    mln_array_destroy(&func->args);
+    mln_lang_var_array_destroy(&func->args);
     if (func->object != NULL) __mln_lang_val_free(func->object);
     mln_alloc_free(func);
 }
@@ -2817,7 +2807,7 @@ inline int mln_lang_funccall_val_add_arg(mln_lang_funccall_val_t *func, mln_lang
 {
     mln_lang_var_t **v;
 
-    if ((v = (mln_lang_var_t **)mln_array_push(&func->args)) == NULL)
+    if ((v = mln_lang_var_array_push(&func->args)) == NULL)
         return -1;
     *v = var;
     return 0;
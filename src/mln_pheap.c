@@ -0,0 +1,88 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "mln_pheap.h"
+
+
+mln_pheap_t *mln_pheap_new(struct mln_pheap_attr *attr)
+{
+    mln_pheap_t *ph;
+    if (attr != NULL && attr->pool != NULL)
+        ph = (mln_pheap_t *)attr->pool_alloc(attr->pool, sizeof(mln_pheap_t));
+    else
+        ph = (mln_pheap_t *)malloc(sizeof(mln_pheap_t));
+    if (ph == NULL) return NULL;
+
+    if (attr != NULL) {
+        ph->pool = attr->pool;
+        ph->pool_alloc = attr->pool_alloc;
+        ph->pool_free = attr->pool_free;
+        ph->cmp = attr->cmp;
+        ph->copy = attr->copy;
+        ph->key_free = attr->key_free;
+    } else {
+        ph->pool = NULL;
+        ph->pool_alloc = NULL;
+        ph->pool_free = NULL;
+        ph->cmp = NULL;
+        ph->copy = NULL;
+        ph->key_free = NULL;
+    }
+    ph->root = NULL;
+    ph->num = 0;
+    return ph;
+}
+
+void mln_pheap_insert(mln_pheap_t *ph, mln_pheap_node_t *pn)
+{
+    mln_pheap_inline_insert(ph, pn, NULL);
+}
+
+mln_pheap_node_t *mln_pheap_extract_min(mln_pheap_t *ph)
+{
+    return mln_pheap_inline_extract_min(ph, NULL);
+}
+
+int mln_pheap_decrease_key(mln_pheap_t *ph, mln_pheap_node_t *node, void *key)
+{
+    return mln_pheap_inline_decrease_key(ph, node, key, NULL, NULL);
+}
+
+void mln_pheap_delete(mln_pheap_t *ph, mln_pheap_node_t *node)
+{
+    mln_pheap_inline_delete(ph, node, NULL);
+}
+
+void mln_pheap_free(mln_pheap_t *ph)
+{
+    mln_pheap_inline_free(ph, NULL);
+}
+
+/*mln_pheap_node_t*/
+mln_pheap_node_t *mln_pheap_node_new(mln_pheap_t *ph, void *key)
+{
+    mln_pheap_node_t *pn;
+
+    if (ph->pool != NULL)
+        pn = (mln_pheap_node_t *)ph->pool_alloc(ph->pool, sizeof(mln_pheap_node_t));
+    else
+        pn = (mln_pheap_node_t *)malloc(sizeof(mln_pheap_node_t));
+    if (pn == NULL) return NULL;
+
+    pn->key = key;
+    pn->prev = NULL;
+    pn->next = NULL;
+    pn->child = NULL;
+    pn->nofree = 0;
+    return pn;
+}
+
+void mln_pheap_node_free(mln_pheap_t *ph, mln_pheap_node_t *pn)
+{
+    mln_pheap_inline_node_free(ph, pn, NULL);
+}
+
@@ -305,3 +305,230 @@ int mln_rbtree_iterate(mln_rbtree_t *t, rbtree_iterate_handler handler, void *ud
     return 0;
 }
 
+
+/*
+ * intrusive usage
+ */
+#define mln_rbtree_link_color(l)  ((l)->parent_color & 1)
+#define mln_rbtree_link_red(l)    ((l) != NULL && mln_rbtree_link_color(l) == M_RB_RED)
+#define mln_rbtree_link_black(l)  ((l) == NULL || mln_rbtree_link_color(l) == M_RB_BLACK)
+#define mln_rbtree_link_set_red(l)   ((l)->parent_color &= ~(mln_uauto_t)1)
+#define mln_rbtree_link_set_black(l) ((l)->parent_color |= M_RB_BLACK)
+
+static inline void mln_rbtree_link_set_parent(mln_rbtree_link_t *l, mln_rbtree_link_t *p)
+{
+    l->parent_color = (mln_uauto_t)p | mln_rbtree_link_color(l);
+}
+
+static inline void
+mln_rbtree_link_replace(mln_rbtree_head_t *h, mln_rbtree_link_t *p, mln_rbtree_link_t *old, mln_rbtree_link_t *new)
+{
+    if (p == NULL) h->root = new;
+    else if (p->left == old) p->left = new;
+    else p->right = new;
+}
+
+static inline void mln_rbtree_link_left_rotate(mln_rbtree_head_t *h, mln_rbtree_link_t *x)
+{
+    mln_rbtree_link_t *y = x->right, *p = mln_rbtree_link_parent(x);
+    x->right = y->left;
+    if (y->left != NULL) mln_rbtree_link_set_parent(y->left, x);
+    mln_rbtree_link_set_parent(y, p);
+    mln_rbtree_link_replace(h, p, x, y);
+    y->left = x;
+    mln_rbtree_link_set_parent(x, y);
+}
+
+static inline void mln_rbtree_link_right_rotate(mln_rbtree_head_t *h, mln_rbtree_link_t *x)
+{
+    mln_rbtree_link_t *y = x->left, *p = mln_rbtree_link_parent(x);
+    x->left = y->right;
+    if (y->right != NULL) mln_rbtree_link_set_parent(y->right, x);
+    mln_rbtree_link_set_parent(y, p);
+    mln_rbtree_link_replace(h, p, x, y);
+    y->right = x;
+    mln_rbtree_link_set_parent(x, y);
+}
+
+void mln_rbtree_link_insert_fixup(mln_rbtree_head_t *h, mln_rbtree_link_t *n)
+{
+    mln_rbtree_link_t *p, *g, *u;
+
+    while ((p = mln_rbtree_link_parent(n)) != NULL && mln_rbtree_link_red(p)) {
+        g = mln_rbtree_link_parent(p);/*a red node is never the root*/
+        if (p == g->left) {
+            u = g->right;
+            if (mln_rbtree_link_red(u)) {
+                mln_rbtree_link_set_black(p);
+                mln_rbtree_link_set_black(u);
+                mln_rbtree_link_set_red(g);
+                n = g;
+                continue;
+            }
+            if (n == p->right) {
+                mln_rbtree_link_left_rotate(h, p);
+                n = p;
+                p = mln_rbtree_link_parent(n);
+            }
+            mln_rbtree_link_set_black(p);
+            mln_rbtree_link_set_red(g);
+            mln_rbtree_link_right_rotate(h, g);
+        } else {
+            u = g->left;
+            if (mln_rbtree_link_red(u)) {
+                mln_rbtree_link_set_black(p);
+                mln_rbtree_link_set_black(u);
+                mln_rbtree_link_set_red(g);
+                n = g;
+                continue;
+            }
+            if (n == p->left) {
+                mln_rbtree_link_right_rotate(h, p);
+                n = p;
+                p = mln_rbtree_link_parent(n);
+            }
+            mln_rbtree_link_set_black(p);
+            mln_rbtree_link_set_red(g);
+            mln_rbtree_link_left_rotate(h, g);
+        }
+    }
+    mln_rbtree_link_set_black(h->root);
+}
+
+static inline void mln_rbtree_link_transplant(mln_rbtree_head_t *h, mln_rbtree_link_t *u, mln_rbtree_link_t *v)
+{
+    mln_rbtree_link_t *p = mln_rbtree_link_parent(u);
+    mln_rbtree_link_replace(h, p, u, v);
+    if (v != NULL) mln_rbtree_link_set_parent(v, p);
+}
+
+/*
+ * x may be NULL, so its parent is given by xp.
+ */
+static inline void mln_rbtree_link_erase_fixup(mln_rbtree_head_t *h, mln_rbtree_link_t *x, mln_rbtree_link_t *xp)
+{
+    mln_rbtree_link_t *w;
+
+    while (x != h->root && mln_rbtree_link_black(x)) {
+        if (x == xp->left) {
+            w = xp->right;
+            if (mln_rbtree_link_red(w)) {
+                mln_rbtree_link_set_black(w);
+                mln_rbtree_link_set_red(xp);
+                mln_rbtree_link_left_rotate(h, xp);
+                w = xp->right;
+            }
+            if (mln_rbtree_link_black(w->left) && mln_rbtree_link_black(w->right)) {
+                mln_rbtree_link_set_red(w);
+                x = xp;
+                xp = mln_rbtree_link_parent(x);
+                continue;
+            }
+            if (mln_rbtree_link_black(w->right)) {
+                mln_rbtree_link_set_black(w->left);
+                mln_rbtree_link_set_red(w);
+                mln_rbtree_link_right_rotate(h, w);
+                w = xp->right;
+            }
+            if (mln_rbtree_link_color(xp) == M_RB_BLACK) mln_rbtree_link_set_black(w);
+            else mln_rbtree_link_set_red(w);
+            mln_rbtree_link_set_black(xp);
+            mln_rbtree_link_set_black(w->right);
+            mln_rbtree_link_left_rotate(h, xp);
+        } else {
+            w = xp->left;
+            if (mln_rbtree_link_red(w)) {
+                mln_rbtree_link_set_black(w);
+                mln_rbtree_link_set_red(xp);
+                mln_rbtree_link_right_rotate(h, xp);
+                w = xp->left;
+            }
+            if (mln_rbtree_link_black(w->left) && mln_rbtree_link_black(w->right)) {
+                mln_rbtree_link_set_red(w);
+                x = xp;
+                xp = mln_rbtree_link_parent(x);
+                continue;
+            }
+            if (mln_rbtree_link_black(w->left)) {
+                mln_rbtree_link_set_black(w->right);
+                mln_rbtree_link_set_red(w);
+                mln_rbtree_link_left_rotate(h, w);
+                w = xp->left;
+            }
+            if (mln_rbtree_link_color(xp) == M_RB_BLACK) mln_rbtree_link_set_black(w);
+            else mln_rbtree_link_set_red(w);
+            mln_rbtree_link_set_black(xp);
+            mln_rbtree_link_set_black(w->left);
+            mln_rbtree_link_right_rotate(h, xp);
+        }
+        x = h->root;
+        break;
+    }
+    if (x != NULL) mln_rbtree_link_set_black(x);
+}
+
+void mln_rbtree_link_erase(mln_rbtree_head_t *h, mln_rbtree_link_t *z)
+{
+    mln_rbtree_link_t *x, *xp, *y = z;
+    mln_uauto_t color = mln_rbtree_link_color(z);
+
+    if (h->min == z) h->min = mln_rbtree_link_next(z);
+    --(h->nr_node);
+
+    if (z->left == NULL) {
+        x = z->right;
+        xp = mln_rbtree_link_parent(z);
+        mln_rbtree_link_transplant(h, z, x);
+    } else if (z->right == NULL) {
+        x = z->left;
+        xp = mln_rbtree_link_parent(z);
+        mln_rbtree_link_transplant(h, z, x);
+    } else {
+        for (y = z->right; y->left != NULL; y = y->left)
+            ;
+        color = mln_rbtree_link_color(y);
+        x = y->right;
+        if (mln_rbtree_link_parent(y) == z) {
+            xp = y;
+        } else {
+            xp = mln_rbtree_link_parent(y);
+            mln_rbtree_link_transplant(h, y, x);
+            y->right = z->right;
+            mln_rbtree_link_set_parent(y->right, y);
+        }
+        mln_rbtree_link_transplant(h, z, y);
+        y->left = z->left;
+        mln_rbtree_link_set_parent(y->left, y);
+        y->parent_color = (y->parent_color & ~(mln_uauto_t)1) | mln_rbtree_link_color(z);
+    }
+    if (color == M_RB_BLACK) mln_rbtree_link_erase_fixup(h, x, xp);
+}
+
+mln_rbtree_link_t *mln_rbtree_link_next(mln_rbtree_link_t *l)
+{
+    mln_rbtree_link_t *p;
+
+    if (l->right != NULL) {
+        for (l = l->right; l->left != NULL; l = l->left)
+            ;
+        return l;
+    }
+    while ((p = mln_rbtree_link_parent(l)) != NULL && l == p->right)
+        l = p;
+    return p;
+}
+
+mln_rbtree_link_t *mln_rbtree_link_prev(mln_rbtree_link_t *l)
+{
+    mln_rbtree_link_t *p;
+
+    if (l->left != NULL) {
+        for (l = l->left; l->right != NULL; l = l->right)
+            ;
+        return l;
+    }
+    while ((p = mln_rbtree_link_parent(l)) != NULL && l == p->left)
+        l = p;
+    return p;
+}
+
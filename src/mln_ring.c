@@ -0,0 +1,306 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+#include <stdlib.h>
+#include "mln_ring.h"
+
+#define mln_ring_load(p)         __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define mln_ring_load_relaxed(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define mln_ring_store(p,v)      __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define mln_ring_cas(p,o,n)      __atomic_compare_exchange_n((p), (o), (n), 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+
+static inline int mln_ring_spsc_push(mln_ring_t *r, void *data) __NONNULL1(1);
+static inline int mln_ring_spsc_pop(mln_ring_t *r, void **data) __NONNULL2(1,2);
+static inline mln_uauto_t
+mln_ring_spsc_push_batch(mln_ring_t *r, void **data, mln_uauto_t n) __NONNULL2(1,2);
+static inline mln_uauto_t
+mln_ring_spsc_pop_batch(mln_ring_t *r, void **data, mln_uauto_t n) __NONNULL2(1,2);
+static inline int mln_ring_mp_push(mln_ring_t *r, void *data) __NONNULL1(1);
+static inline int mln_ring_mc_pop(mln_ring_t *r, void **data) __NONNULL2(1,2);
+static inline int mln_ring_sc_pop(mln_ring_t *r, void **data) __NONNULL2(1,2);
+static inline mln_uauto_t
+mln_ring_mp_push_batch(mln_ring_t *r, void **data, mln_uauto_t n) __NONNULL2(1,2);
+static inline mln_uauto_t
+mln_ring_mc_pop_batch(mln_ring_t *r, void **data, mln_uauto_t n) __NONNULL2(1,2);
+static inline mln_uauto_t
+mln_ring_sc_pop_batch(mln_ring_t *r, void **data, mln_uauto_t n) __NONNULL2(1,2);
+
+mln_ring_t *mln_ring_new(mln_u32_t type, mln_uauto_t size)
+{
+    mln_ring_t *r;
+    mln_uauto_t n = 2, i;
+
+    if (type > M_RING_MPMC) return NULL;
+    while (n < size) {
+        if (n << 1 < n) return NULL;
+        n <<= 1;
+    }
+    if ((r = (mln_ring_t *)malloc(sizeof(mln_ring_t))) == NULL) return NULL;
+    r->type = type;
+    r->mask = n - 1;
+    r->head.s.pos = r->head.s.cache = 0;
+    r->tail.s.pos = r->tail.s.cache = 0;
+    if (type == M_RING_SPSC) {
+        r->u.slots = (void **)malloc(n * sizeof(void *));
+    } else {
+        r->u.cells = (mln_ring_cell_t *)malloc(n * sizeof(mln_ring_cell_t));
+        if (r->u.cells != NULL) {
+            for (i = 0; i < n; ++i) r->u.cells[i].seq = i;
+        }
+    }
+    if (r->u.slots == NULL) {
+        free(r);
+        return NULL;
+    }
+    return r;
+}
+
+void mln_ring_free(mln_ring_t *r)
+{
+    if (r == NULL) return;
+    if (r->type == M_RING_SPSC) free(r->u.slots);
+    else free(r->u.cells);
+    free(r);
+}
+
+int mln_ring_push(mln_ring_t *r, void *data)
+{
+    if (r->type == M_RING_SPSC) return mln_ring_spsc_push(r, data);
+    return mln_ring_mp_push(r, data);
+}
+
+int mln_ring_pop(mln_ring_t *r, void **data)
+{
+    switch (r->type) {
+        case M_RING_SPSC:
+            return mln_ring_spsc_pop(r, data);
+        case M_RING_MPSC:
+            return mln_ring_sc_pop(r, data);
+        default:
+            return mln_ring_mc_pop(r, data);
+    }
+}
+
+mln_uauto_t mln_ring_push_batch(mln_ring_t *r, void **data, mln_uauto_t n)
+{
+    if (r->type == M_RING_SPSC) return mln_ring_spsc_push_batch(r, data, n);
+    return mln_ring_mp_push_batch(r, data, n);
+}
+
+mln_uauto_t mln_ring_pop_batch(mln_ring_t *r, void **data, mln_uauto_t n)
+{
+    switch (r->type) {
+        case M_RING_SPSC:
+            return mln_ring_spsc_pop_batch(r, data, n);
+        case M_RING_MPSC:
+            return mln_ring_sc_pop_batch(r, data, n);
+        default:
+            return mln_ring_mc_pop_batch(r, data, n);
+    }
+}
+
+mln_uauto_t mln_ring_count(mln_ring_t *r)
+{
+    mln_uauto_t head = mln_ring_load(&(r->head.s.pos));
+    mln_uauto_t tail = mln_ring_load(&(r->tail.s.pos));
+    return tail - head > r->mask + 1? 0: tail - head;
+}
+
+/*
+ * SPSC
+ */
+static inline int mln_ring_spsc_push(mln_ring_t *r, void *data)
+{
+    mln_uauto_t tail = r->tail.s.pos;
+
+    if (tail - r->tail.s.cache > r->mask) {
+        r->tail.s.cache = mln_ring_load(&(r->head.s.pos));
+        if (tail - r->tail.s.cache > r->mask) return -1;
+    }
+    r->u.slots[tail & r->mask] = data;
+    mln_ring_store(&(r->tail.s.pos), tail + 1);
+    return 0;
+}
+
+static inline int mln_ring_spsc_pop(mln_ring_t *r, void **data)
+{
+    mln_uauto_t head = r->head.s.pos;
+
+    if (head == r->head.s.cache) {
+        r->head.s.cache = mln_ring_load(&(r->tail.s.pos));
+        if (head == r->head.s.cache) return -1;
+    }
+    *data = r->u.slots[head & r->mask];
+    mln_ring_store(&(r->head.s.pos), head + 1);
+    return 0;
+}
+
+static inline mln_uauto_t
+mln_ring_spsc_push_batch(mln_ring_t *r, void **data, mln_uauto_t n)
+{
+    mln_uauto_t tail = r->tail.s.pos, room, i;
+
+    room = r->mask + 1 - (tail - r->tail.s.cache);
+    if (room < n) {
+        r->tail.s.cache = mln_ring_load(&(r->head.s.pos));
+        room = r->mask + 1 - (tail - r->tail.s.cache);
+        if (room < n) n = room;
+    }
+    for (i = 0; i < n; ++i)
+        r->u.slots[(tail + i) & r->mask] = data[i];
+    if (n) mln_ring_store(&(r->tail.s.pos), tail + n);
+    return n;
+}
+
+static inline mln_uauto_t
+mln_ring_spsc_pop_batch(mln_ring_t *r, void **data, mln_uauto_t n)
+{
+    mln_uauto_t head = r->head.s.pos, avail, i;
+
+    avail = r->head.s.cache - head;
+    if (avail < n) {
+        r->head.s.cache = mln_ring_load(&(r->tail.s.pos));
+        avail = r->head.s.cache - head;
+        if (avail < n) n = avail;
+    }
+    for (i = 0; i < n; ++i)
+        data[i] = r->u.slots[(head + i) & r->mask];
+    if (n) mln_ring_store(&(r->head.s.pos), head + n);
+    return n;
+}
+
+/*
+ * MPSC and MPMC
+ */
+static inline int mln_ring_mp_push(mln_ring_t *r, void *data)
+{
+    mln_ring_cell_t *cell;
+    mln_uauto_t pos = mln_ring_load_relaxed(&(r->tail.s.pos)), seq;
+
+    while (1) {
+        cell = &(r->u.cells[pos & r->mask]);
+        seq = mln_ring_load(&(cell->seq));
+        if (seq == pos) {
+            if (mln_ring_cas(&(r->tail.s.pos), &pos, pos + 1)) break;
+        } else if ((mln_sauto_t)(seq - pos) < 0) {
+            return -1;
+        } else {
+            pos = mln_ring_load_relaxed(&(r->tail.s.pos));
+        }
+    }
+    cell->data = data;
+    mln_ring_store(&(cell->seq), pos + 1);
+    return 0;
+}
+
+static inline int mln_ring_mc_pop(mln_ring_t *r, void **data)
+{
+    mln_ring_cell_t *cell;
+    mln_uauto_t pos = mln_ring_load_relaxed(&(r->head.s.pos)), seq;
+
+    while (1) {
+        cell = &(r->u.cells[pos & r->mask]);
+        seq = mln_ring_load(&(cell->seq));
+        if (seq == pos + 1) {
+            if (mln_ring_cas(&(r->head.s.pos), &pos, pos + 1)) break;
+        } else if ((mln_sauto_t)(seq - (pos + 1)) < 0) {
+            return -1;
+        } else {
+            pos = mln_ring_load_relaxed(&(r->head.s.pos));
+        }
+    }
+    *data = cell->data;
+    mln_ring_store(&(cell->seq), pos + r->mask + 1);
+    return 0;
+}
+
+static inline int mln_ring_sc_pop(mln_ring_t *r, void **data)
+{
+    mln_uauto_t pos = r->head.s.pos;
+    mln_ring_cell_t *cell = &(r->u.cells[pos & r->mask]);
+
+    if (mln_ring_load(&(cell->seq)) != pos + 1) return -1;
+    *data = cell->data;
+    mln_ring_store(&(cell->seq), pos + r->mask + 1);
+    mln_ring_store(&(r->head.s.pos), pos + 1);
+    return 0;
+}
+
+/*
+ * A batch claims the run of consecutive cells that are ready at once,
+ * then fills or drains them one by one.
+ */
+static inline mln_uauto_t
+mln_ring_mp_push_batch(mln_ring_t *r, void **data, mln_uauto_t n)
+{
+    mln_ring_cell_t *cell;
+    mln_uauto_t pos = mln_ring_load_relaxed(&(r->tail.s.pos)), seq, k, i;
+
+    if (!n) return 0;
+    while (1) {
+        for (k = 0; k < n; ++k) {
+            seq = mln_ring_load(&(r->u.cells[(pos + k) & r->mask].seq));
+            if (seq != pos + k) break;
+        }
+        if (k) {
+            if (mln_ring_cas(&(r->tail.s.pos), &pos, pos + k)) break;
+        } else if ((mln_sauto_t)(seq - pos) < 0) {
+            return 0;
+        } else {
+            pos = mln_ring_load_relaxed(&(r->tail.s.pos));
+        }
+    }
+    for (i = 0; i < k; ++i) {
+        cell = &(r->u.cells[(pos + i) & r->mask]);
+        cell->data = data[i];
+        mln_ring_store(&(cell->seq), pos + i + 1);
+    }
+    return k;
+}
+
+static inline mln_uauto_t
+mln_ring_mc_pop_batch(mln_ring_t *r, void **data, mln_uauto_t n)
+{
+    mln_ring_cell_t *cell;
+    mln_uauto_t pos = mln_ring_load_relaxed(&(r->head.s.pos)), seq, k, i;
+
+    if (!n) return 0;
+    while (1) {
+        for (k = 0; k < n; ++k) {
+            seq = mln_ring_load(&(r->u.cells[(pos + k) & r->mask].seq));
+            if (seq != pos + k + 1) break;
+        }
+        if (k) {
+            if (mln_ring_cas(&(r->head.s.pos), &pos, pos + k)) break;
+        } else if ((mln_sauto_t)(seq - (pos + 1)) < 0) {
+            return 0;
+        } else {
+            pos = mln_ring_load_relaxed(&(r->head.s.pos));
+        }
+    }
+    for (i = 0; i < k; ++i) {
+        cell = &(r->u.cells[(pos + i) & r->mask]);
+        data[i] = cell->data;
+        mln_ring_store(&(cell->seq), pos + i + r->mask + 1);
+    }
+    return k;
+}
+
+static inline mln_uauto_t
+mln_ring_sc_pop_batch(mln_ring_t *r, void **data, mln_uauto_t n)
+{
+    mln_ring_cell_t *cell;
+    mln_uauto_t pos = r->head.s.pos, k;
+
+    for (k = 0; k < n; ++k) {
+        cell = &(r->u.cells[(pos + k) & r->mask]);
+        if (mln_ring_load(&(cell->seq)) != pos + k + 1) break;
+        data[k] = cell->data;
+        mln_ring_store(&(cell->seq), pos + k + r->mask + 1);
+    }
+    if (k) mln_ring_store(&(r->head.s.pos), pos + k);
+    return k;
+}
+
@@ -11,17 +11,114 @@
 #include "mln_sha.h"
 #include "mln_base64.h"
 #include <sys/time.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define MLN_WS_AVX2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#if defined(MLN_ZLIB)
+#include <zlib.h>
+
+/*
+ * A small compressed frame can inflate to gigabytes, so inflating is
+ * always bounded even if no max message size is set.
+ */
+#define mln_websocket_inflate_limit(ws) \
+    ((ws)->max_message_size? (ws)->max_message_size: M_WS_DEFLATE_MAX_MESSAGE_SIZE)
+
+struct mln_websocket_deflate_s {
+    z_stream                 zin;
+    z_stream                 zout;
+    mln_string_t            *response;/*negotiated parameters sent back by server*/
+    mln_u8ptr_t              dictionary;
+    mln_size_t               dictionary_len;
+    mln_size_t               threshold;
+    mln_u32_t                zout_init:1;/*0 if outgoing messages are never compressed*/
+    mln_u32_t                zout_reset:1;/*no context takeover for outgoing messages*/
+    mln_u32_t                zin_reset:1;/*no context takeover for incoming messages*/
+    mln_u32_t                compress:1;/*the outgoing message is compressed*/
+    mln_u32_t                decompress:1;/*the incoming message is compressed*/
+    mln_u32_t                inflated:1;/*the payload of the last parsed frame is inflated*/
+    mln_u32_t                retry_set:1;/*retry holds the payload of the frame left in 'in'*/
+    mln_u32_t                trailer_fed:3;/*bytes of the streaming trailer fed to zin*/
+    mln_u8ptr_t              retry;
+    mln_u64_t                retry_len;
+};
+
+struct mln_websocket_deflate_params {
+    mln_u32_t                server_max_window_bits;
+    mln_u32_t                client_max_window_bits;
+    mln_u32_t                server_no_context_takeover:1;
+    mln_u32_t                client_no_context_takeover:1;
+    mln_u32_t                server_bits:1;/*server_max_window_bits is given*/
+    mln_u32_t                client_bits:1;/*client_max_window_bits is given*/
+    mln_u32_t                client_bits_value:1;/*client_max_window_bits has a value*/
+};
+#endif
+
+typedef void (*mln_websocket_mask_handler_t)(mln_u8ptr_t, mln_u8ptr_t, mln_u64_t, mln_u64_t);
+static mln_websocket_mask_handler_t mln_websocket_mask_handler = NULL;
 
-static mln_u64_t mln_websocket_hash_calc(mln_hash_t *h, void *key);
-static int mln_websocket_hash_cmp(mln_hash_t *h, void *key1, void *key2);
 static void mln_websocket_hash_free(void *data);
 static int mln_websocket_match_iterate_handler(mln_hash_t *h, void *key, void *val, void *data);
 static int mln_websocket_validate_accept(mln_http_t *http, mln_string_t *wskey);
 static mln_string_t *mln_websocket_accept_field(mln_http_t *http);
+static void mln_websocket_trim(mln_u8ptr_t *ps, mln_u8ptr_t *pe)
+{
+    mln_u8ptr_t s = *ps, e = *pe;
+
+    while (s < e && (*s == ' ' || *s == '\t')) ++s;
+    while (e > s && (e[-1] == ' ' || e[-1] == '\t')) --e;
+    *ps = s;
+    *pe = e;
+}
+
+static int mln_websocket_extension_is_deflate(mln_string_t *token)
+{
+    mln_string_t name;
+    mln_u8ptr_t s = token->data, e = token->data + token->len, semi;
+
+    if ((semi = (mln_u8ptr_t)memchr(s, ';', token->len)) != NULL) e = semi;
+    mln_websocket_trim(&s, &e);
+    mln_string_nset(&name, s, e - s);
+    return !mln_string_const_strcasecmp(&name, "permessage-deflate");
+}
+
 static int mln_websocket_iterate_set_fields(mln_hash_t *h, void *key, void *val, void *data);
 static mln_string_t *mln_websocket_client_handshake_key_generate(mln_alloc_t *pool);
 static mln_string_t *mln_websocket_extension_tokens(mln_alloc_t *pool, mln_string_t *in);
 static mln_u32_t mln_websocket_masking_key_generate(void);
+static mln_websocket_mask_handler_t mln_websocket_mask_select(void);
+static void mln_websocket_mask(mln_u8ptr_t dst, mln_u8ptr_t src, mln_u64_t len, mln_u32_t masking_key, mln_u64_t offset);
+static int mln_websocket_chain_next(mln_chain_t **pc, mln_u8ptr_t *pp, mln_u8ptr_t *pend);
+static int mln_websocket_chain_read(mln_chain_t **pc, mln_u8ptr_t *pp, mln_u8ptr_t *pend, mln_u8ptr_t out, mln_size_t n);
+static void mln_websocket_chain_consume(mln_chain_t **in, mln_chain_t *c, mln_u8ptr_t p);
+static int mln_websocket_stream_deliver(mln_websocket_t *ws, mln_u8ptr_t data, mln_size_t len, int end, mln_size_t *used);
+static inline mln_size_t mln_websocket_length_size(mln_u64_t clen);
+static mln_u8ptr_t mln_websocket_header_write(mln_u8ptr_t p, mln_u8_t b1, mln_u32_t mask, mln_u64_t clen);
+static void mln_websocket_trim(mln_u8ptr_t *ps, mln_u8ptr_t *pe);
+static int mln_websocket_extension_is_deflate(mln_string_t *token);
+#if defined(MLN_ZLIB)
+static voidpf mln_websocket_zalloc(voidpf opaque, uInt items, uInt size);
+static void mln_websocket_zfree(voidpf opaque, voidpf address);
+static mln_u32_t mln_websocket_deflate_bits(mln_u32_t bits);
+static int mln_websocket_deflate_params_parse(mln_u8ptr_t p, mln_u8ptr_t end, struct mln_websocket_deflate_params *params);
+static int mln_websocket_deflate_server(mln_websocket_t *ws, struct mln_websocket_deflate_attr *attr, struct mln_websocket_deflate_params *params);
+static int mln_websocket_deflate_client(mln_websocket_t *ws, struct mln_websocket_deflate_attr *attr, struct mln_websocket_deflate_params *params);
+static int mln_websocket_deflate_enable(mln_websocket_t *ws, \
+                                        struct mln_websocket_deflate_attr *attr, \
+                                        mln_u32_t out_bits, \
+                                        mln_u32_t in_bits, \
+                                        int out_reset, \
+                                        int in_reset);
+static int mln_websocket_deflate_dictionary(mln_websocket_deflate_t *d, int in);
+static void mln_websocket_deflate_free(mln_websocket_deflate_t *d);
+static mln_string_t *mln_websocket_deflate_response(mln_alloc_t *pool, mln_string_t *response, mln_string_t *others);
+static int mln_websocket_deflate_compress(mln_websocket_t *ws, mln_u8ptr_t *content, mln_u64_t *clen, mln_u8ptr_t *zbuf);
+static int mln_websocket_deflate_decompress(mln_websocket_t *ws);
+static int mln_websocket_deflate_stream(mln_websocket_t *ws, mln_u8ptr_t data, mln_size_t len, int end, mln_size_t *used);
+#endif
 
 int mln_websocket_init(mln_websocket_t *ws, mln_http_t *http)
 {
@@ -29,11 +126,11 @@ int mln_websocket_init(mln_websocket_t *ws, mln_http_t *http)
     hattr.pool = mln_http_pool_get(http);
     hattr.pool_alloc = (hash_pool_alloc_handler)mln_alloc_m;
     hattr.pool_free = (hash_pool_free_handler)mln_alloc_free;
-    hattr.hash = mln_websocket_hash_calc;
-    hattr.cmp = mln_websocket_hash_cmp;
+    hattr.hash = mln_hash_string_case;
+    hattr.cmp = mln_hash_string_case_cmp;
     hattr.free_key = mln_websocket_hash_free;
     hattr.free_val = mln_websocket_hash_free;
-    hattr.len_base = 37;
+    hattr.len_base = 32;
     hattr.expandable = 0;
     hattr.calc_prime = 0;
 
@@ -45,7 +142,14 @@ int mln_websocket_init(mln_websocket_t *ws, mln_http_t *http)
 
     ws->data = NULL;
     ws->content = NULL;
+    ws->content_chain = NULL;
     ws->extension_handler = NULL;
+    ws->deflate = NULL;
+    ws->stream_handler = NULL;
+    ws->max_message_size = 0;
+    ws->message_len = ws->frame_left = ws->frame_offset = 0;
+    ws->in_message = ws->in_frame = ws->stream_compressed = ws->stream_end = 0;
+    ws->message_opcode = 0;
     ws->content_len = 0;
     ws->content_free = 0;
     ws->fin = 0;
@@ -58,24 +162,6 @@ int mln_websocket_init(mln_websocket_t *ws, mln_http_t *http)
     return 0;
 }
 
-static mln_u64_t mln_websocket_hash_calc(mln_hash_t *h, void *key)
-{
-    mln_string_t *k = (mln_string_t *)key;
-    mln_u64_t index = 0;
-    mln_u8ptr_t p, end = k->data + k->len;
-
-    for (p = k->data; p < end; ++p) {
-        index += (*p * 3);
-    }
-
-    return index % h->len;
-}
-
-static int mln_websocket_hash_cmp(mln_hash_t *h, void *key1, void *key2)
-{
-    return !mln_string_strcasecmp((mln_string_t *)key1, (mln_string_t *)key2);
-}
-
 static void mln_websocket_hash_free(void *data)
 {
     if (data == NULL) return;
@@ -101,6 +187,10 @@ void mln_websocket_destroy(mln_websocket_t *ws)
     if (ws->args != NULL) mln_string_free(ws->args);
     if (ws->key != NULL) mln_string_free(ws->key);
     if (ws->content_free) mln_alloc_free(ws->content);
+    if (ws->content_chain != NULL) mln_chain_pool_release(ws->content_chain);
+#if defined(MLN_ZLIB)
+    mln_websocket_deflate_free(ws->deflate);
+#endif
 }
 
 void mln_websocket_free(mln_websocket_t *ws)
@@ -136,7 +226,20 @@ void mln_websocket_reset(mln_websocket_t *ws)
     } else {
         ws->content = NULL;
     }
+    if (ws->content_chain != NULL) {
+        mln_chain_pool_release(ws->content_chain);
+        ws->content_chain = NULL;
+    }
     ws->extension_handler = NULL;
+#if defined(MLN_ZLIB)
+    mln_websocket_deflate_free(ws->deflate);
+#endif
+    ws->deflate = NULL;
+    ws->stream_handler = NULL;
+    ws->max_message_size = 0;
+    ws->message_len = ws->frame_left = ws->frame_offset = 0;
+    ws->in_message = ws->in_frame = ws->stream_compressed = ws->stream_end = 0;
+    ws->message_opcode = 0;
     ws->content_len = 0;
     ws->fin = 0;
     ws->rsv1 = ws->rsv2 = ws->rsv3 = 0;
@@ -271,7 +374,21 @@ int mln_websocket_handshake_response_generate(mln_websocket_t *ws, mln_chain_t *
             if (protocol_val != NULL) mln_string_free(protocol_val);
             return M_WS_RET_FAILED;
         }
+        if (!extension_val->len) {
+            mln_string_free(extension_val);
+            extension_val = NULL;
+        }
     }
+#if defined(MLN_ZLIB)
+    if (ws->deflate != NULL && ws->deflate->response != NULL) {
+        tmp = mln_websocket_deflate_response(ws->pool, ws->deflate->response, extension_val);
+        if (extension_val != NULL) mln_string_free(extension_val);
+        if ((extension_val = tmp) == NULL) {
+            if (protocol_val != NULL) mln_string_free(protocol_val);
+            return M_WS_RET_FAILED;
+        }
+    }
+#endif
 
     mln_string_t *accept = mln_websocket_accept_field(http);
     if (accept == NULL) {
@@ -335,12 +452,23 @@ static mln_string_t *mln_websocket_extension_tokens(mln_alloc_t *pool, mln_strin
     mln_s8ptr_t pos, buf;
     mln_uauto_t size = 0;
     for (; p->len; ++p) {
+        /*
+         * permessage-deflate is handled by mln_websocket_deflate_negotiate,
+         * it must not be echoed back if it is not negotiated.
+         */
+        if (mln_websocket_extension_is_deflate(p)) continue;
         if ((pos = strchr((char *)(p->data), ';')) == NULL) {
             size += (p->len + 1);
         } else {
             size += (pos - (char *)(p->data) + 1);
         }
     }
+    if (!size) {
+        mln_string_slice_free(array);
+        mln_string_free(tmp);
+        mln_string_t empty = mln_string("");
+        return mln_string_pool_dup(pool, &empty);
+    }
     --size;
     buf = (mln_s8ptr_t)mln_alloc_m(pool, size);
     if (buf == NULL) {
@@ -349,6 +477,7 @@ static mln_string_t *mln_websocket_extension_tokens(mln_alloc_t *pool, mln_strin
         return NULL;
     }
     for (size = 0, p = array; p->len; ++p) {
+        if (mln_websocket_extension_is_deflate(p)) continue;
         if ((pos = strchr((char *)(p->data), ';')) == NULL) {
             memcpy(buf+size, p->data, p->len);
             size += p->len;
@@ -561,6 +690,7 @@ int mln_websocket_close_generate(mln_websocket_t *ws, \
     mln_websocket_set_content(ws, reason);
     if (reason == NULL) mln_websocket_set_content_len(ws, 0);
     else mln_websocket_set_content_len(ws, strlen(reason));
+    mln_websocket_set_status(ws, status);
     mln_websocket_set_fin(ws);
     mln_websocket_reset_rsv1(ws);
     mln_websocket_reset_rsv2(ws);
@@ -638,6 +768,181 @@ static mln_u32_t mln_websocket_masking_key_generate(void)
     return ((mln_u32_t)tmp | (mln_u32_t)rand());
 }
 
+/*
+ * Payload masking.
+ * The 4-byte masking key is expanded into a 64-bit pattern whose bytes are in memory order,
+ * so every kernel just XORs 8/16/32 bytes at a time regardless of byte order.
+ * All block sizes are multiples of 4, so the key phase never changes inside a kernel.
+ */
+static inline void mln_websocket_mask_scalar(mln_u8ptr_t dst, mln_u8ptr_t src, mln_u64_t len, mln_u64_t key)
+{
+    mln_u64_t w, i;
+    mln_u8ptr_t k = (mln_u8ptr_t)&key;
+
+    for (; len >= 8; len -= 8, src += 8, dst += 8) {
+        memcpy(&w, src, 8);
+        w ^= key;
+        memcpy(dst, &w, 8);
+    }
+    for (i = 0; i < len; ++i)
+        dst[i] = src[i] ^ k[i];
+}
+
+#if !defined(__SSE2__) && !defined(__ARM_NEON)
+static void mln_websocket_mask_word(mln_u8ptr_t dst, mln_u8ptr_t src, mln_u64_t len, mln_u64_t key)
+{
+    mln_websocket_mask_scalar(dst, src, len, key);
+}
+#endif
+
+#if defined(__SSE2__)
+static void mln_websocket_mask_sse2(mln_u8ptr_t dst, mln_u8ptr_t src, mln_u64_t len, mln_u64_t key)
+{
+    __m128i k = _mm_set1_epi64x((long long)key);
+
+    for (; len >= 64; len -= 64, src += 64, dst += 64) {
+        _mm_storeu_si128((__m128i *)dst, _mm_xor_si128(_mm_loadu_si128((const __m128i *)src), k));
+        _mm_storeu_si128((__m128i *)(dst + 16), _mm_xor_si128(_mm_loadu_si128((const __m128i *)(src + 16)), k));
+        _mm_storeu_si128((__m128i *)(dst + 32), _mm_xor_si128(_mm_loadu_si128((const __m128i *)(src + 32)), k));
+        _mm_storeu_si128((__m128i *)(dst + 48), _mm_xor_si128(_mm_loadu_si128((const __m128i *)(src + 48)), k));
+    }
+    for (; len >= 16; len -= 16, src += 16, dst += 16)
+        _mm_storeu_si128((__m128i *)dst, _mm_xor_si128(_mm_loadu_si128((const __m128i *)src), k));
+    mln_websocket_mask_scalar(dst, src, len, key);
+}
+#endif
+
+#if defined(MLN_WS_AVX2)
+__attribute__((target("avx2")))
+static void mln_websocket_mask_avx2(mln_u8ptr_t dst, mln_u8ptr_t src, mln_u64_t len, mln_u64_t key)
+{
+    __m256i k = _mm256_set1_epi64x((long long)key);
+
+    for (; len >= 128; len -= 128, src += 128, dst += 128) {
+        _mm256_storeu_si256((__m256i *)dst, _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)src), k));
+        _mm256_storeu_si256((__m256i *)(dst + 32), _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(src + 32)), k));
+        _mm256_storeu_si256((__m256i *)(dst + 64), _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(src + 64)), k));
+        _mm256_storeu_si256((__m256i *)(dst + 96), _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(src + 96)), k));
+    }
+    for (; len >= 32; len -= 32, src += 32, dst += 32)
+        _mm256_storeu_si256((__m256i *)dst, _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)src), k));
+    mln_websocket_mask_scalar(dst, src, len, key);
+}
+#endif
+
+#if defined(__ARM_NEON)
+static void mln_websocket_mask_neon(mln_u8ptr_t dst, mln_u8ptr_t src, mln_u64_t len, mln_u64_t key)
+{
+    uint8x16_t k = vreinterpretq_u8_u64(vdupq_n_u64(key));
+
+    for (; len >= 64; len -= 64, src += 64, dst += 64) {
+        vst1q_u8(dst, veorq_u8(vld1q_u8(src), k));
+        vst1q_u8(dst + 16, veorq_u8(vld1q_u8(src + 16), k));
+        vst1q_u8(dst + 32, veorq_u8(vld1q_u8(src + 32), k));
+        vst1q_u8(dst + 48, veorq_u8(vld1q_u8(src + 48), k));
+    }
+    for (; len >= 16; len -= 16, src += 16, dst += 16)
+        vst1q_u8(dst, veorq_u8(vld1q_u8(src), k));
+    mln_websocket_mask_scalar(dst, src, len, key);
+}
+#endif
+
+static mln_websocket_mask_handler_t mln_websocket_mask_select(void)
+{
+#if defined(MLN_WS_AVX2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return mln_websocket_mask_avx2;
+#endif
+#if defined(__SSE2__)
+    return mln_websocket_mask_sse2;
+#elif defined(__ARM_NEON)
+    return mln_websocket_mask_neon;
+#else
+    return mln_websocket_mask_word;
+#endif
+}
+
+/*
+ * offset is the position of src in the payload, it decides which key byte is used first.
+ * dst and src can be the same buffer.
+ */
+static void mln_websocket_mask(mln_u8ptr_t dst, mln_u8ptr_t src, mln_u64_t len, mln_u32_t masking_key, mln_u64_t offset)
+{
+    mln_u8_t k[8];
+    mln_u64_t key;
+    int i;
+
+    if (!len) return;
+    for (i = 0; i < 8; ++i)
+        k[i] = (masking_key >> ((3 - ((offset + i) & 3)) << 3)) & 0xff;
+    memcpy(&key, k, 8);
+
+    /*the handler is selected only once, a race here is harmless*/
+    if (mln_websocket_mask_handler == NULL)
+        mln_websocket_mask_handler = mln_websocket_mask_select();
+    mln_websocket_mask_handler(dst, src, len, key);
+}
+
+static int mln_websocket_chain_next(mln_chain_t **pc, mln_u8ptr_t *pp, mln_u8ptr_t *pend)
+{
+    mln_chain_t *c;
+
+    for (c = (*pc)->next; c != NULL; c = c->next) {
+        if (c->buf == NULL || mln_buf_left_size(c->buf) == 0) continue;
+        *pc = c;
+        *pp = c->buf->left_pos;
+        *pend = c->buf->last;
+        return 0;
+    }
+    return -1;
+}
+
+static int mln_websocket_chain_read(mln_chain_t **pc, mln_u8ptr_t *pp, mln_u8ptr_t *pend, mln_u8ptr_t out, mln_size_t n)
+{
+    mln_size_t len;
+
+    while (n) {
+        if (*pp >= *pend && mln_websocket_chain_next(pc, pp, pend) < 0) return -1;
+        len = *pend - *pp;
+        if (len > n) len = n;
+        memcpy(out, *pp, len);
+        out += len;
+        *pp += len;
+        n -= len;
+    }
+    return 0;
+}
+
+static inline mln_size_t mln_websocket_length_size(mln_u64_t clen)
+{
+    if (clen > 125) return (clen >> 16)? 8: 2;
+    return 0;
+}
+
+/*
+ * Write the first two bytes and the extended payload length, return the position of masking key.
+ */
+static mln_u8ptr_t mln_websocket_header_write(mln_u8ptr_t p, mln_u8_t b1, mln_u32_t mask, mln_u64_t clen)
+{
+    int i;
+
+    *p++ = b1;
+    if (clen > 125) {
+        if ((clen >> 16)) {
+            *p++ = (mask? 0x80: 0) | 127;
+            for (i = 56; i >= 0; i -= 8)
+                *p++ = (clen >> i) & 0xff;
+        } else {
+            *p++ = (mask? 0x80: 0) | 126;
+            *p++ = ((clen >> 8) & 0xff);
+            *p++ = (clen & 0xff);
+        }
+    } else {
+        *p++ = (mask? 0x80: 0) | clen;
+    }
+    return p;
+}
+
 int mln_websocket_generate(mln_websocket_t *ws, mln_chain_t **out_cnode)
 {
     mln_size_t size = 2;
@@ -645,8 +950,8 @@ int mln_websocket_generate(mln_websocket_t *ws, mln_chain_t **out_cnode)
     mln_buf_t *b;
     mln_chain_t *c;
     mln_alloc_t *pool = ws->pool;
-    mln_u8_t payload_length = 0;
-    mln_u8ptr_t content = NULL;
+    mln_u8_t b1;
+    mln_u8ptr_t content = NULL, zbuf = NULL;
     mln_u64_t clen = 0;
     mln_u32_t opcode = mln_websocket_get_opcode(ws);
 
@@ -659,6 +964,13 @@ int mln_websocket_generate(mln_websocket_t *ws, mln_chain_t **out_cnode)
     clen = mln_websocket_get_content_len(ws);
     if (content == NULL && clen) return M_WS_RET_ERROR;
 
+#if defined(MLN_ZLIB)
+    if (ws->deflate != NULL) {
+        int ret = mln_websocket_deflate_compress(ws, &content, &clen, &zbuf);
+        if (ret != M_WS_RET_OK) return ret;
+    }
+#endif
+
     if (opcode == M_WS_OPCODE_CLOSE) {
         clen += 2;
     }
@@ -668,32 +980,26 @@ int mln_websocket_generate(mln_websocket_t *ws, mln_chain_t **out_cnode)
         clen > 125)
         return M_WS_RET_ERROR;
 
-    if (clen > 125) {
-        if ((clen >> 16)) {
-            size += 8;
-            payload_length = 127;
-        } else {
-            size += 2;
-            payload_length = 126;
-        }
-    } else {
-        payload_length = clen;
-    }
-    size += clen;
+    size += mln_websocket_length_size(clen) + clen;
 
     if (mln_websocket_get_maskbit(ws)) size += 4;
 
     c = mln_chain_new(pool);
-    if (c == NULL) return M_WS_RET_FAILED;
+    if (c == NULL) {
+        if (zbuf != NULL) mln_alloc_free(zbuf);
+        return M_WS_RET_FAILED;
+    }
     b = mln_buf_new(pool);
     if (b == NULL) {
         mln_chain_pool_release(c);
+        if (zbuf != NULL) mln_alloc_free(zbuf);
         return M_WS_RET_FAILED;
     }
     c->buf = b;
     buf = (mln_u8ptr_t)mln_alloc_m(pool, size);
     if (buf == NULL) {
         mln_chain_pool_release(c);
+        if (zbuf != NULL) mln_alloc_free(zbuf);
         return M_WS_RET_FAILED;
     }
     b->left_pos = b->pos = b->start = buf;
@@ -703,36 +1009,16 @@ int mln_websocket_generate(mln_websocket_t *ws, mln_chain_t **out_cnode)
     if (mln_websocket_get_fin(ws)) b->last_in_chain = 1;
     *out_cnode = c;
 
-    p = buf;
-    *p = 0;
-    if (mln_websocket_get_fin(ws)) *p |= 0x80;
-    if (mln_websocket_get_rsv1(ws)) *p |= 0x40;
-    if (mln_websocket_get_rsv2(ws)) *p |= 0x20;
-    if (mln_websocket_get_rsv3(ws)) *p |= 0x10;
-    *p++ |= (opcode & 0xf);
-
-    *p = 0;
-    if (mln_websocket_get_maskbit(ws)) *p |= 0x80;
-    *p++ |= (payload_length & 0x7f);
-
-    if (payload_length == 126) {
-        *p++ = ((clen >> 8) & 0xff);
-        *p++ = (clen & 0xff);
-    } else if (payload_length == 127) {
-        *p++ = ((clen >> 56) & 0xff);
-        *p++ = ((clen >> 48) & 0xff);
-        *p++ = ((clen >> 40) & 0xff);
-        *p++ = ((clen >> 32) & 0xff);
-        *p++ = ((clen >> 24) & 0xff);
-        *p++ = ((clen >> 16) & 0xff);
-        *p++ = ((clen >> 8) & 0xff);
-        *p++ = (clen & 0xff);
-    }
+    b1 = opcode & 0xf;
+    if (mln_websocket_get_fin(ws)) b1 |= 0x80;
+    if (mln_websocket_get_rsv1(ws)) b1 |= 0x40;
+    if (mln_websocket_get_rsv2(ws)) b1 |= 0x20;
+    if (mln_websocket_get_rsv3(ws)) b1 |= 0x10;
+    p = mln_websocket_header_write(buf, b1, mln_websocket_get_maskbit(ws), clen);
 
     if (mln_websocket_get_maskbit(ws)) {
         mln_u8_t tmpkey[4];
-        mln_u32_t i, j, m = mln_websocket_get_masking_key(ws);
-        mln_u8ptr_t pc = (mln_u8ptr_t)content;
+        mln_u32_t i, m = mln_websocket_get_masking_key(ws);
         *p++ = tmpkey[0] = ((m >> 24) & 0xff);
         *p++ = tmpkey[1] = ((m >> 16) & 0xff);
         *p++ = tmpkey[2] = ((m >> 8) & 0xff);
@@ -740,12 +1026,10 @@ int mln_websocket_generate(mln_websocket_t *ws, mln_chain_t **out_cnode)
 
         i = 0;
         if (opcode == M_WS_OPCODE_CLOSE) {
-            *p++ = ((mln_websocket_get_status(ws) >> 8) & 0xff) ^ tmpkey[i++%4];
-            *p++ = (mln_websocket_get_status(ws) & 0xff) ^ tmpkey[i++%4];
-        }
-        for (j = 0; i < clen; ++i, ++j) {
-            *p++ = pc[j] ^ tmpkey[i%4];
+            *p++ = ((mln_websocket_get_status(ws) >> 8) & 0xff) ^ tmpkey[i++];
+            *p++ = (mln_websocket_get_status(ws) & 0xff) ^ tmpkey[i++];
         }
+        mln_websocket_mask(p, content, clen - i, m, i);
     } else {
         if (opcode == M_WS_OPCODE_CLOSE) {
             *p++ = (mln_websocket_get_status(ws) >> 8) & 0xff;
@@ -754,149 +1038,149 @@ int mln_websocket_generate(mln_websocket_t *ws, mln_chain_t **out_cnode)
         }
         if (content != NULL) memcpy(p, content, clen);
     }
+    if (zbuf != NULL) mln_alloc_free(zbuf);
 
     return M_WS_RET_OK;
 }
 
+/*
+ * Broadcast.
+ * Server frames are not masked, so a frame can be generated only once
+ * and shared by all connections. It is never compressed by permessage-deflate,
+ * that is allowed no matter what is negotiated.
+ */
+mln_buf_shared_t *mln_websocket_broadcast_generate(mln_u32_t opcode, void *buf, mln_size_t len, mln_u32_t flags)
+{
+    mln_buf_shared_t *s;
+    mln_u8ptr_t p;
+    mln_u8_t b1;
+
+    if (opcode & 0x8) {
+        if (len > 125) return NULL;
+        flags |= M_WS_FLAG_NEW | M_WS_FLAG_END;
+    }
+    if (buf == NULL && len) return NULL;
+
+    b1 = (flags & M_WS_FLAG_NEW)? (opcode & 0xf): M_WS_OPCODE_CONTINUE;
+    if (flags & M_WS_FLAG_END) b1 |= 0x80;
+
+    if ((s = mln_buf_shared_new(2 + mln_websocket_length_size(len) + len)) == NULL) return NULL;
+    p = mln_websocket_header_write(s->data, b1, 0, len);
+    if (len) memcpy(p, buf, len);
+
+    return s;
+}
+
+int mln_websocket_broadcast_append(mln_tcp_conn_t *tc, mln_buf_shared_t *frame)
+{
+    mln_chain_t *c = mln_chain_shared_new(mln_tcp_conn_pool_get(tc), frame);
+    if (c == NULL) return M_WS_RET_FAILED;
+    if (frame->data[0] & 0x80) c->buf->last_in_chain = 1;
+    mln_tcp_conn_append(tc, c, M_C_SEND);
+    return M_WS_RET_OK;
+}
+
 int mln_websocket_parse(mln_websocket_t *ws, mln_chain_t **in)
 {
-    mln_chain_t *c = *in;
+    mln_chain_t *c, *hold = NULL, *keep, *next;
     mln_u8ptr_t p = NULL, end = NULL, content = NULL;
-    mln_u64_t len, i, tmp;
+    mln_u8_t hdr[8], b1, b2;
+    mln_u64_t len, i, n, off = 0;
     mln_u32_t masking_key = 0;
-    mln_u8_t b1 = 0, b2 = 0;
+    mln_u16_t status = 0;
+    int inplace;
 
-    for (i = 0; c != NULL; c = c->next) {
+    for (c = *in; c != NULL; c = c->next) {
         if (c->buf == NULL || mln_buf_left_size(c->buf) == 0) continue;
         p = c->buf->left_pos;
-        for (end = c->buf->end; p < end; ++p) {
-             if (i == 0) {
-                 b1 = *p;
-                 ++i;
-             } else {
-                 b2 = *p++;
-                 ++i;
-                 break;
-             }
-        }
-        if (i >= 2) break;
+        end = c->buf->last;
+        break;
     }
-    if (i < 2) return M_WS_RET_NOTYET;
+    if (c == NULL) return M_WS_RET_NOTYET;
+
+    if (mln_websocket_chain_read(&c, &p, &end, hdr, 2) < 0) return M_WS_RET_NOTYET;
+    b1 = hdr[0];
+    b2 = hdr[1];
 
     len = b2 & 0x7f;
     if (len == 127) {
-        tmp = p - end;
-        if (tmp > 8) tmp = 8;
-        len = 0;
-        i = 0;
-again127:
-        for (; i < tmp; ++i) {
-            len |= ((*p++) << ((7 - i)<<3));
-        }
-        if (tmp < 8) {
-            for (c = c->next; c != NULL; c = c->next) {
-                if (c->buf == NULL || mln_buf_left_size(c->buf) == 0) continue;
-                p = c->buf->left_pos;
-                end = c->buf->end;
-                break;
-            }
-            if (c == NULL) return M_WS_RET_NOTYET;
-            tmp = (8-tmp > p-end)? tmp+(mln_u32_t)(p-end): 8;
-            goto again127;
+        if (mln_websocket_chain_read(&c, &p, &end, hdr, 8) < 0) return M_WS_RET_NOTYET;
+        for (len = 0, i = 0; i < 8; ++i) {
+            len = (len << 8) | hdr[i];
         }
     } else if (len == 126) {
-        tmp = p - end;
-        if (tmp > 2) tmp = 2;
-        len = 0;
-        i = 0;
-again126:
-        for (; i < tmp; ++i) {
-            len |= ((*p++) << ((1 - i)<<3));
-        }
-        if (tmp < 2) {
-            for (c = c->next; c != NULL; c = c->next) {
-                if (c->buf == NULL || mln_buf_left_size(c->buf) == 0) continue;
-                p = c->buf->left_pos;
-                end = c->buf->end;
-                break;
-            }
-            if (c == NULL) return M_WS_RET_NOTYET;
-            tmp = (2-tmp > p-end)? tmp+(mln_u32_t)(p-end): 2;
-            goto again126;
-        }
+        if (mln_websocket_chain_read(&c, &p, &end, hdr, 2) < 0) return M_WS_RET_NOTYET;
+        len = ((mln_u64_t)hdr[0] << 8) | hdr[1];
     }
 
     if (b2 & 0x80) {
-        tmp = p - end;
-        if (tmp > 4) tmp = 4;
-        i = 0;
-againm:
-        for (; i < tmp; ++i) {
-            masking_key |= ((*p++) << ((3 - i) << 3));
-        }
-        if (tmp < 4) {
-            for (c = c->next; c != NULL; c = c->next) {
-                if (c->buf == NULL || mln_buf_left_size(c->buf) == 0) continue;
-                p = c->buf->left_pos;
-                end = c->buf->end;
-                break;
-            }
-            if (c == NULL) return M_WS_RET_NOTYET;
-            tmp = (4-tmp > p-end)? tmp+(mln_u32_t)(p-end): 4;
-            goto againm;
-        }
+        if (mln_websocket_chain_read(&c, &p, &end, hdr, 4) < 0) return M_WS_RET_NOTYET;
+        masking_key = ((mln_u32_t)hdr[0] << 24) | ((mln_u32_t)hdr[1] << 16) | ((mln_u32_t)hdr[2] << 8) | hdr[3];
+    }
+
+    /*
+     * The limit applies to a whole message, so the data frames of it are
+     * added up in message_len. It is only updated once the frame is
+     * consumed, since the frame may be parsed again. A compressed message
+     * is checked while it is being inflated.
+     */
+    if (!(b1 & 0x8) && (b1 & 0xf) != M_WS_OPCODE_CONTINUE) {
+        ws->message_len = 0;
+        ws->stream_compressed = (b1 & 0x40) && ws->deflate != NULL;
+    }
+    if (b1 & 0x8) {
+        if (ws->max_message_size && len > ws->max_message_size) goto too_big;
+    } else if (ws->max_message_size && !ws->stream_compressed && len > ws->max_message_size - ws->message_len) {
+        goto too_big;
     }
 
     if (len) {
         if ((b1&0xf) == M_WS_OPCODE_CLOSE && len > 1) {
-            mln_u16_t status = 0;
-
-            tmp = p - end;
-            if (tmp > 2) tmp = 2;
-            i = 0;
-against:
-            for (; i < tmp; ++i) {
-                status |= ((*p++) << ((1 - i)<<3));
-            }
-            if (tmp < 2) {
-                for (c = c->next; c != NULL; c = c->next) {
-                    if (c->buf == NULL || mln_buf_left_size(c->buf) == 0) continue;
-                    p = c->buf->left_pos;
-                    end = c->buf->end;
-                    break;
-                }
-                if (c == NULL) return M_WS_RET_NOTYET;
-                tmp = (2-tmp > p-end)? tmp+(mln_u32_t)(p-end): 2;
-                goto against;
+            if (mln_websocket_chain_read(&c, &p, &end, hdr, 2) < 0) return M_WS_RET_NOTYET;
+            if (b2 & 0x80) {
+                hdr[0] ^= (masking_key >> 24) & 0xff;
+                hdr[1] ^= (masking_key >> 16) & 0xff;
             }
-
-            mln_websocket_set_status(ws, status);
+            status = ((mln_u16_t)hdr[0] << 8) | hdr[1];
             len -= 2;
-        } else {
-            mln_websocket_set_status(ws, 0);
+            off = 2;
         }
-        content = (mln_u8ptr_t)mln_alloc_m(mln_websocket_get_pool(ws), len);
-        if (content == NULL) return M_WS_RET_FAILED;
-        tmp = p - end;
-        if (tmp > len) tmp = len;
-        i = 0;
-againc:
-        if (tmp > 0) memcpy(content+i, p, tmp);
-        i += tmp;
-        p += tmp;
-        if (tmp < len) {
-            for (c = c->next; c != NULL; c = c->next) {
-                if (c->buf == NULL || mln_buf_left_size(c->buf) == 0) continue;
-                p = c->buf->left_pos;
-                end = c->buf->end;
-                break;
-            }
-            if (c == NULL) {
-                mln_alloc_free(content);
-                return M_WS_RET_NOTYET;
+    }
+
+    if (len) {
+        if (p >= end && mln_websocket_chain_next(&c, &p, &end) < 0) return M_WS_RET_NOTYET;
+        /*
+         * If the deflate step or the extension handler fails, the frame is
+         * left in 'in' and parsed again, so a masked payload is only
+         * unmasked in place when neither of them runs after it.
+         */
+        inplace = !(b2 & 0x80) || (!c->buf->temporary && mln_websocket_get_ext_handler(ws) == NULL);
+#if defined(MLN_ZLIB)
+        if (ws->deflate != NULL && (b2 & 0x80)) inplace = 0;
+#endif
+        if (len <= (mln_u64_t)(end - p) && inplace) {
+            /*
+             * The whole payload is in one buf, so it is unmasked in place
+             * and the buf is held by ws instead of being copied.
+             */
+            content = p;
+            p += len;
+            hold = c;
+            if (b2 & 0x80) mln_websocket_mask(content, content, len, masking_key, off);
+        } else {
+            content = (mln_u8ptr_t)mln_alloc_m(mln_websocket_get_pool(ws), len);
+            if (content == NULL) return M_WS_RET_FAILED;
+            for (i = 0; i < len; i += n) {
+                if (p >= end && mln_websocket_chain_next(&c, &p, &end) < 0) {
+                    mln_alloc_free(content);
+                    return M_WS_RET_NOTYET;
+                }
+                n = end - p;
+                if (n > len - i) n = len - i;
+                if (b2 & 0x80) mln_websocket_mask(content + i, p, n, masking_key, off + i);
+                else memcpy(content + i, p, n);
+                p += n;
             }
-            tmp = (len-tmp > p-end)? p-end: len-tmp;
-            goto againc;
         }
     }
 
@@ -904,9 +1188,14 @@ againc:
         mln_alloc_free(mln_websocket_get_content(ws));
         mln_websocket_reset_content_free(ws);
     }
+    if (ws->content_chain != NULL) {
+        mln_chain_pool_release(ws->content_chain);
+        ws->content_chain = NULL;
+    }
     mln_websocket_set_content(ws, content);
-    if (content != NULL) mln_websocket_set_content_free(ws);
+    if (content != NULL && hold == NULL) mln_websocket_set_content_free(ws);
     mln_websocket_set_content_len(ws, len);
+    mln_websocket_set_status(ws, status);
     if (b1 & 0x80) mln_websocket_set_fin(ws);
     else mln_websocket_reset_fin(ws);
     if (b1 & 0x40) mln_websocket_set_rsv1(ws);
@@ -918,54 +1207,780 @@ againc:
     mln_websocket_set_opcode(ws, b1&0xf);
     if (b2 & 0x80) mln_websocket_set_maskbit(ws);
     else mln_websocket_reset_maskbit(ws);
-    if (b2 & 0x80) mln_websocket_set_masking_key(ws, masking_key);
-    else mln_websocket_set_masking_key(ws, 0);
+    mln_websocket_set_masking_key(ws, masking_key);
 
-    if (mln_websocket_get_maskbit(ws)) {
-        mln_u8_t tmpkey[4];
-        mln_u16_t status = mln_websocket_get_status(ws);
-        tmpkey[0] = (masking_key >> 24) & 0xff;
-        tmpkey[1] = (masking_key >> 16) & 0xff;
-        tmpkey[2] = (masking_key >> 8) & 0xff;
-        tmpkey[3] = masking_key & 0xff;
-        i = 0;
-        if (mln_websocket_get_opcode(ws) == M_WS_OPCODE_CLOSE && status != 0) {
-            status = ((((status >> 8) & 0xff) ^ tmpkey[i++%4]) << 8) | (status & 0xff);
-            status = (((status >> 8) & 0xff) << 8) | ((status & 0xff) ^ tmpkey[i++%4]);
-            mln_websocket_set_status(ws, status);
-        }
-        if (content != NULL) {
-            for (tmp = 0; tmp < len; ++tmp) {
-                content[tmp] ^= tmpkey[i++%4];
-            }
-        }
+#if defined(MLN_ZLIB)
+    if (ws->deflate != NULL) {
+        int ret = mln_websocket_deflate_decompress(ws);
+        if (ret != M_WS_RET_OK) return ret;
+        /*the payload is inflated into a new buffer, so the held buf is not needed any more*/
+        if (mln_websocket_get_content(ws) != content) hold = NULL;
     }
+#endif
 
     if (mln_websocket_get_ext_handler(ws) != NULL) {
         int ret = mln_websocket_get_ext_handler(ws)(ws);
-        if (ret != M_WS_RET_OK) return ret;
+        if (ret != M_WS_RET_OK) {
+#if defined(MLN_ZLIB)
+            /*
+             * The inflate stream can not be fed with the frame twice, so its
+             * payload is kept for the next parse of the same frame.
+             */
+            if (ws->deflate != NULL && ws->deflate->inflated) {
+                ws->deflate->retry = (mln_u8ptr_t)mln_websocket_get_content(ws);
+                ws->deflate->retry_len = mln_websocket_get_content_len(ws);
+                ws->deflate->retry_set = 1;
+                mln_websocket_reset_content_free(ws);
+            }
+#endif
+            return ret;
+        }
     }
 
-    if (c != NULL && c->buf != NULL) c->buf->left_pos = p;
-    for (; c != NULL; c = c->next) {
-        if (c->buf == NULL || mln_buf_left_size(c->buf)==0) continue;
+    if (!(b1 & 0x8)) ws->message_len += mln_websocket_get_content_len(ws);
+
+    /*
+     * All bufs before c are consumed. If the held buf is consumed too,
+     * it is moved into ws->content_chain, otherwise it stays in 'in'
+     * and content is valid until 'in' is released.
+     */
+    c->buf->left_pos = p;
+    for (keep = c; keep != NULL; keep = keep->next) {
+        if (keep->buf == NULL || mln_buf_left_size(keep->buf) == 0) continue;
         break;
     }
+    for (c = *in; c != keep; c = next) {
+        next = c->next;
+        c->next = NULL;
+        if (c == hold) ws->content_chain = c;
+        else mln_chain_pool_release(c);
+    }
+    *in = keep;
 
-    if (c == NULL) {
-        mln_chain_pool_release_all(*in);
-        *in = NULL;
+    return M_WS_RET_OK;
+
+too_big:
+    mln_websocket_set_status(ws, M_WS_STATUS_MESSAGE_TOO_BIG);
+    return M_WS_RET_ERROR;
+}
+
+
+/*
+ * Streaming parse.
+ * Payload of data frames is delivered to stream_handler slice by slice as soon as
+ * it arrives, so a message is never buffered as a whole. Control frames are parsed
+ * by mln_websocket_parse and returned to caller with M_WS_RET_OK.
+ */
+int mln_websocket_stream_parse(mln_websocket_t *ws, mln_chain_t **in)
+{
+    mln_chain_t *c;
+    mln_u8ptr_t p = NULL, end = NULL;
+    mln_u8_t hdr[8], b1, b2, opcode, tmp[4096];
+    mln_u64_t len, i, n, k;
+    mln_size_t used;
+    int ret, last;
+
+    if (ws->stream_handler == NULL) return M_WS_RET_ERROR;
+
+    while (1) {
+        for (c = *in; c != NULL; c = c->next) {
+            if (c->buf == NULL || mln_buf_left_size(c->buf) == 0) continue;
+            p = c->buf->left_pos;
+            end = c->buf->last;
+            break;
+        }
+
+        if (!ws->in_frame) {
+            if (c == NULL) return M_WS_RET_NOTYET;
+            if (mln_websocket_chain_read(&c, &p, &end, hdr, 2) < 0) return M_WS_RET_NOTYET;
+            b1 = hdr[0];
+            b2 = hdr[1];
+            opcode = b1 & 0xf;
+
+            if (opcode & 0x8) {
+                if (!(b1 & 0x80) || (b2 & 0x7f) > 125) goto protocol_error;
+                return mln_websocket_parse(ws, in);
+            }
+
+            len = b2 & 0x7f;
+            if (len == 127) {
+                if (mln_websocket_chain_read(&c, &p, &end, hdr, 8) < 0) return M_WS_RET_NOTYET;
+                for (len = 0, i = 0; i < 8; ++i) {
+                    len = (len << 8) | hdr[i];
+                }
+            } else if (len == 126) {
+                if (mln_websocket_chain_read(&c, &p, &end, hdr, 2) < 0) return M_WS_RET_NOTYET;
+                len = ((mln_u64_t)hdr[0] << 8) | hdr[1];
+            }
+            if (b2 & 0x80) {
+                if (mln_websocket_chain_read(&c, &p, &end, hdr, 4) < 0) return M_WS_RET_NOTYET;
+                mln_websocket_set_masking_key(ws, ((mln_u32_t)hdr[0] << 24) | ((mln_u32_t)hdr[1] << 16) | ((mln_u32_t)hdr[2] << 8) | hdr[3]);
+                mln_websocket_set_maskbit(ws);
+            } else {
+                mln_websocket_set_masking_key(ws, 0);
+                mln_websocket_reset_maskbit(ws);
+            }
+
+            if (opcode == M_WS_OPCODE_CONTINUE) {
+                if (!ws->in_message) goto protocol_error;
+                if ((b1 & 0x40) && ws->deflate != NULL) goto protocol_error;
+            } else if (opcode == M_WS_OPCODE_TEXT || opcode == M_WS_OPCODE_BINARY) {
+                if (ws->in_message) goto protocol_error;
+                ws->in_message = 1;
+                ws->message_len = 0;
+                ws->message_opcode = opcode;
+                ws->stream_compressed = (b1 & 0x40) && ws->deflate != NULL;
+            } else {
+                goto protocol_error;
+            }
+            /*compressed message is checked while it is being inflated*/
+            if (ws->max_message_size && !ws->stream_compressed && len > ws->max_message_size - ws->message_len) {
+                mln_websocket_set_status(ws, M_WS_STATUS_MESSAGE_TOO_BIG);
+                return M_WS_RET_ERROR;
+            }
+
+            mln_websocket_chain_consume(in, c, p);
+            if (b1 & 0x80) mln_websocket_set_fin(ws);
+            else mln_websocket_reset_fin(ws);
+            if ((b1 & 0x40) && !ws->stream_compressed) mln_websocket_set_rsv1(ws);
+            else mln_websocket_reset_rsv1(ws);
+            if (b1 & 0x20) mln_websocket_set_rsv2(ws);
+            else mln_websocket_reset_rsv2(ws);
+            if (b1 & 0x10) mln_websocket_set_rsv3(ws);
+            else mln_websocket_reset_rsv3(ws);
+            ws->frame_left = len;
+            ws->frame_offset = 0;
+            ws->in_frame = 1;
+            ws->stream_end = 0;
+            continue;
+        }
+
+        /*
+         * A slice is consumed once it is delivered, even if stream_handler fails,
+         * so the next call goes on with the bytes after it.
+         */
+        if (ws->frame_left) {
+            if (c == NULL) return M_WS_RET_NOTYET;
+            n = end - p;
+            if (n > ws->frame_left) n = ws->frame_left;
+            last = mln_websocket_get_fin(ws) && n == ws->frame_left;
+            if (!mln_websocket_get_maskbit(ws)) {
+                ret = mln_websocket_stream_deliver(ws, p, n, last, &used);
+            } else if (!c->buf->temporary) {
+                mln_websocket_mask(p, p, n, mln_websocket_get_masking_key(ws), ws->frame_offset);
+                ret = mln_websocket_stream_deliver(ws, p, n, last, &used);
+                /*bytes not taken by inflate are masked back, they will be unmasked again*/
+                if (used < n) mln_websocket_mask(p + used, p + used, n - used, mln_websocket_get_masking_key(ws), ws->frame_offset + used);
+            } else {
+                /*the memory of temporary buf can not be modified*/
+                for (i = 0, ret = M_WS_RET_OK; i < n && ret == M_WS_RET_OK; i += used) {
+                    k = n - i > sizeof(tmp)? sizeof(tmp): n - i;
+                    mln_websocket_mask(tmp, p + i, k, mln_websocket_get_masking_key(ws), ws->frame_offset + i);
+                    ret = mln_websocket_stream_deliver(ws, tmp, k, last && i + k == n, &used);
+                }
+                used = i;
+            }
+            p += used;
+            ws->frame_left -= used;
+            ws->frame_offset += used;
+            mln_websocket_chain_consume(in, c, p);
+            if (ret != M_WS_RET_OK) return ret;
+            if (ws->frame_left) continue;
+        }
+        if (mln_websocket_get_fin(ws) && !ws->stream_end) {
+            /*an empty final frame, or the tail of an inflated one, still ends the message*/
+            ret = mln_websocket_stream_deliver(ws, NULL, 0, 1, &used);
+            if (ret != M_WS_RET_OK) return ret;
+        }
+
+        ws->in_frame = 0;
+        if (mln_websocket_get_fin(ws)) ws->in_message = 0;
+    }
+
+protocol_error:
+    mln_websocket_set_status(ws, M_WS_STATUS_PROTOCOL_ERROR);
+    return M_WS_RET_ERROR;
+}
+
+/*
+ * used is set to the length of data consumed, which is len unless inflate stops in it.
+ */
+static int mln_websocket_stream_deliver(mln_websocket_t *ws, mln_u8ptr_t data, mln_size_t len, int end, mln_size_t *used)
+{
+    mln_u32_t flags = M_WS_FLAG_NONE;
+
+    mln_websocket_set_opcode(ws, ws->message_opcode);
+#if defined(MLN_ZLIB)
+    if (ws->stream_compressed) return mln_websocket_deflate_stream(ws, data, len, end, used);
+#endif
+    if (!ws->message_len) flags |= M_WS_FLAG_NEW;
+    if (end) {
+        flags |= M_WS_FLAG_END;
+        ws->stream_end = 1;
+    }
+    ws->message_len += len;
+    *used = len;
+    return ws->stream_handler(ws, data, len, flags);
+}
+
+static void mln_websocket_chain_consume(mln_chain_t **in, mln_chain_t *c, mln_u8ptr_t p)
+{
+    mln_chain_t *keep, *next;
+
+    c->buf->left_pos = p;
+    for (keep = c; keep != NULL; keep = keep->next) {
+        if (keep->buf == NULL || mln_buf_left_size(keep->buf) == 0) continue;
+        break;
+    }
+    for (c = *in; c != keep; c = next) {
+        next = c->next;
+        mln_chain_pool_release(c);
+    }
+    *in = keep;
+}
+
+/*
+ * permessage-deflate
+ */
+int mln_websocket_deflate_offer(mln_websocket_t *ws, struct mln_websocket_deflate_attr *attr)
+{
+#if defined(MLN_ZLIB)
+    char buf[160];
+    int n;
+    mln_string_t key = mln_string("Sec-WebSocket-Extensions"), val;
+    mln_u32_t server_bits = mln_websocket_deflate_bits(attr->server_max_window_bits);
+    mln_u32_t client_bits = mln_websocket_deflate_bits(attr->client_max_window_bits);
+
+    n = snprintf(buf, sizeof(buf), "permessage-deflate%s%s", \
+                 attr->server_no_context_takeover? "; server_no_context_takeover": "", \
+                 attr->client_no_context_takeover? "; client_no_context_takeover": "");
+    if (server_bits < 15)
+        n += snprintf(buf + n, sizeof(buf) - n, "; server_max_window_bits=%u", server_bits);
+    /*client_max_window_bits without value tells server that client supports it*/
+    if (client_bits < 15)
+        n += snprintf(buf + n, sizeof(buf) - n, "; client_max_window_bits=%u", client_bits);
+    else
+        n += snprintf(buf + n, sizeof(buf) - n, "; client_max_window_bits");
+    mln_string_nset(&val, buf, n);
+    return mln_websocket_set_field(ws, &key, &val);
+#else
+    return M_WS_RET_DECLINED;
+#endif
+}
+
+int mln_websocket_deflate_negotiate(mln_websocket_t *ws, struct mln_websocket_deflate_attr *attr)
+{
+#if defined(MLN_ZLIB)
+    mln_string_t key = mln_string("Sec-WebSocket-Extensions"), *val;
+    struct mln_websocket_deflate_params params;
+    mln_u8ptr_t p, e, end;
+    int ret = 1, server = mln_http_type_get(ws->http) == M_HTTP_REQUEST;
+
+    if (ws->deflate != NULL) return M_WS_RET_ERROR;
+    if ((val = mln_http_field_get(ws->http, &key)) == NULL) return M_WS_RET_DECLINED;
+
+    for (p = val->data, end = val->data + val->len; ; p = e + 1) {
+        for (e = p; e < end && *e != ','; ++e)
+            ;
+        ret = mln_websocket_deflate_params_parse(p, e, &params);
+        if (!ret) break;
+        /*server just skips the offers it does not understand, but client has to fail*/
+        if (ret < 0 && !server) return M_WS_RET_ERROR;
+        if (e >= end) break;
+    }
+    if (ret) return M_WS_RET_DECLINED;
+
+    if (server) return mln_websocket_deflate_server(ws, attr, &params);
+    return mln_websocket_deflate_client(ws, attr, &params);
+#else
+    return M_WS_RET_DECLINED;
+#endif
+}
+
+#if defined(MLN_ZLIB)
+static voidpf mln_websocket_zalloc(voidpf opaque, uInt items, uInt size)
+{
+    return mln_alloc_m((mln_alloc_t *)opaque, (mln_size_t)items * size);
+}
+
+static void mln_websocket_zfree(voidpf opaque, voidpf address)
+{
+    mln_alloc_free(address);
+}
+
+static mln_u32_t mln_websocket_deflate_bits(mln_u32_t bits)
+{
+    return bits < 8 || bits > 15? 15: bits;
+}
+
+/*
+ * p ~ end is one element of Sec-WebSocket-Extensions.
+ * Return 1 if it is not permessage-deflate, -1 if its parameters are invalid.
+ */
+static int mln_websocket_deflate_params_parse(mln_u8ptr_t p, mln_u8ptr_t end, struct mln_websocket_deflate_params *params)
+{
+    mln_u8ptr_t s, e, eq, vs, ve;
+    mln_string_t name;
+    mln_u32_t bits;
+    int first = 1;
+
+    memset(params, 0, sizeof(struct mln_websocket_deflate_params));
+
+    for (; ; p = e + 1) {
+        for (e = p; e < end && *e != ';'; ++e)
+            ;
+        s = p;
+        ve = e;
+        if ((eq = (mln_u8ptr_t)memchr(s, '=', e - s)) != NULL) ve = eq;
+        mln_websocket_trim(&s, &ve);
+        mln_string_nset(&name, s, ve - s);
+
+        if (first) {
+            if (eq != NULL || mln_string_const_strcasecmp(&name, "permessage-deflate")) return 1;
+            first = 0;
+            if (e >= end) break;
+            continue;
+        }
+
+        bits = 0;
+        if (eq != NULL) {
+            vs = eq + 1;
+            ve = e;
+            mln_websocket_trim(&vs, &ve);
+            if (ve - vs >= 2 && *vs == '"' && ve[-1] == '"') {
+                ++vs;
+                --ve;
+            }
+            if (vs >= ve || ve - vs > 2) return -1;
+            for (; vs < ve; ++vs) {
+                if (*vs < '0' || *vs > '9') return -1;
+                bits = bits * 10 + (*vs - '0');
+            }
+            if (bits < 8 || bits > 15) return -1;
+        }
+
+        if (!mln_string_const_strcasecmp(&name, "server_no_context_takeover")) {
+            if (eq != NULL || params->server_no_context_takeover) return -1;
+            params->server_no_context_takeover = 1;
+        } else if (!mln_string_const_strcasecmp(&name, "client_no_context_takeover")) {
+            if (eq != NULL || params->client_no_context_takeover) return -1;
+            params->client_no_context_takeover = 1;
+        } else if (!mln_string_const_strcasecmp(&name, "server_max_window_bits")) {
+            if (eq == NULL || params->server_bits) return -1;
+            params->server_bits = 1;
+            params->server_max_window_bits = bits;
+        } else if (!mln_string_const_strcasecmp(&name, "client_max_window_bits")) {
+            if (params->client_bits) return -1;
+            params->client_bits = 1;
+            if (eq != NULL) {
+                params->client_bits_value = 1;
+                params->client_max_window_bits = bits;
+            }
+        } else {
+            return -1;
+        }
+
+        if (e >= end) break;
+    }
+
+    return 0;
+}
+
+static int mln_websocket_deflate_server(mln_websocket_t *ws, struct mln_websocket_deflate_attr *attr, struct mln_websocket_deflate_params *params)
+{
+    char buf[160];
+    int n, ret;
+    mln_string_t tmp;
+    mln_u32_t server_bits = mln_websocket_deflate_bits(attr->server_max_window_bits), client_bits = 15;
+    int server_reset = attr->server_no_context_takeover || params->server_no_context_takeover;
+    int client_reset = attr->client_no_context_takeover || params->client_no_context_takeover;
+
+    if (params->server_bits && params->server_max_window_bits < server_bits)
+        server_bits = params->server_max_window_bits;
+    /*client window can only be limited if client declares that it supports client_max_window_bits*/
+    if (params->client_bits) {
+        client_bits = mln_websocket_deflate_bits(attr->client_max_window_bits);
+        if (params->client_bits_value && params->client_max_window_bits < client_bits)
+            client_bits = params->client_max_window_bits;
+    }
+
+    n = snprintf(buf, sizeof(buf), "permessage-deflate%s%s", \
+                 server_reset? "; server_no_context_takeover": "", \
+                 client_reset? "; client_no_context_takeover": "");
+    if (server_bits < 15 || params->server_bits)
+        n += snprintf(buf + n, sizeof(buf) - n, "; server_max_window_bits=%u", server_bits);
+    if (client_bits < 15)
+        n += snprintf(buf + n, sizeof(buf) - n, "; client_max_window_bits=%u", client_bits);
+
+    ret = mln_websocket_deflate_enable(ws, attr, server_bits, client_bits, server_reset, client_reset);
+    if (ret != M_WS_RET_OK) return ret;
+
+    mln_string_nset(&tmp, buf, n);
+    if ((ws->deflate->response = mln_string_pool_dup(ws->pool, &tmp)) == NULL) {
+        mln_websocket_deflate_free(ws->deflate);
+        ws->deflate = NULL;
+        return M_WS_RET_FAILED;
+    }
+
+    return M_WS_RET_OK;
+}
+
+static int mln_websocket_deflate_client(mln_websocket_t *ws, struct mln_websocket_deflate_attr *attr, struct mln_websocket_deflate_params *params)
+{
+    mln_u32_t server_bits = 15, client_bits = mln_websocket_deflate_bits(attr->client_max_window_bits);
+
+    if (params->server_bits) {
+        if (params->server_max_window_bits > mln_websocket_deflate_bits(attr->server_max_window_bits))
+            return M_WS_RET_ERROR;
+        server_bits = params->server_max_window_bits;
+    }
+    if (attr->server_no_context_takeover && !params->server_no_context_takeover)
+        return M_WS_RET_ERROR;
+    if (params->client_bits) {
+        if (!params->client_bits_value || params->client_max_window_bits > client_bits)
+            return M_WS_RET_ERROR;
+        client_bits = params->client_max_window_bits;
+    }
+
+    return mln_websocket_deflate_enable(ws, attr, client_bits, server_bits, \
+                                        attr->client_no_context_takeover || params->client_no_context_takeover, \
+                                        params->server_no_context_takeover);
+}
+
+static int mln_websocket_deflate_enable(mln_websocket_t *ws, \
+                                        struct mln_websocket_deflate_attr *attr, \
+                                        mln_u32_t out_bits, \
+                                        mln_u32_t in_bits, \
+                                        int out_reset, \
+                                        int in_reset)
+{
+    mln_websocket_deflate_t *d;
+
+    d = (mln_websocket_deflate_t *)mln_alloc_m(ws->pool, sizeof(mln_websocket_deflate_t));
+    if (d == NULL) return M_WS_RET_FAILED;
+    memset(d, 0, sizeof(mln_websocket_deflate_t));
+    d->dictionary = attr->dictionary;
+    d->dictionary_len = attr->dictionary == NULL? 0: attr->dictionary_len;
+    d->threshold = attr->threshold;
+    d->zout_reset = out_reset? 1: 0;
+    d->zin_reset = in_reset? 1: 0;
+
+    d->zin.zalloc = mln_websocket_zalloc;
+    d->zin.zfree = mln_websocket_zfree;
+    d->zin.opaque = ws->pool;
+    if (inflateInit2(&d->zin, -(int)in_bits) != Z_OK) {
+        mln_alloc_free(d);
+        return M_WS_RET_FAILED;
+    }
+    if (mln_websocket_deflate_dictionary(d, 1) < 0) {
+        inflateEnd(&d->zin);
+        mln_alloc_free(d);
+        return M_WS_RET_FAILED;
+    }
+
+    /*
+     * zlib can not compress with a 256-byte window, so outgoing messages
+     * are left uncompressed in that case, which is always allowed.
+     */
+    if (out_bits > 8) {
+        d->zout.zalloc = mln_websocket_zalloc;
+        d->zout.zfree = mln_websocket_zfree;
+        d->zout.opaque = ws->pool;
+        if (deflateInit2(&d->zout, attr->level, Z_DEFLATED, -(int)out_bits, \
+                         attr->mem_level > 0 && attr->mem_level <= 9? attr->mem_level: 8, \
+                         Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            inflateEnd(&d->zin);
+            mln_alloc_free(d);
+            return M_WS_RET_FAILED;
+        }
+        d->zout_init = 1;
+        if (mln_websocket_deflate_dictionary(d, 0) < 0) {
+            mln_websocket_deflate_free(d);
+            return M_WS_RET_FAILED;
+        }
+    }
+
+    ws->deflate = d;
+    return M_WS_RET_OK;
+}
+
+static int mln_websocket_deflate_dictionary(mln_websocket_deflate_t *d, int in)
+{
+    int ret;
+
+    if (d->dictionary == NULL || !d->dictionary_len) return 0;
+    if (in) ret = inflateSetDictionary(&d->zin, d->dictionary, d->dictionary_len);
+    else ret = deflateSetDictionary(&d->zout, d->dictionary, d->dictionary_len);
+    return ret == Z_OK? 0: -1;
+}
+
+static void mln_websocket_deflate_free(mln_websocket_deflate_t *d)
+{
+    if (d == NULL) return;
+    inflateEnd(&d->zin);
+    if (d->zout_init) deflateEnd(&d->zout);
+    if (d->response != NULL) mln_string_free(d->response);
+    if (d->retry != NULL) mln_alloc_free(d->retry);
+    mln_alloc_free(d);
+}
+
+static mln_string_t *mln_websocket_deflate_response(mln_alloc_t *pool, mln_string_t *response, mln_string_t *others)
+{
+    mln_string_t *s;
+    mln_size_t len = response->len;
+
+    if (others != NULL) len += others->len + 2;
+    if ((s = mln_string_pool_alloc(pool, len)) == NULL) return NULL;
+    memcpy(s->data, response->data, response->len);
+    if (others != NULL) {
+        memcpy(s->data + response->len, ", ", 2);
+        memcpy(s->data + response->len + 2, others->data, others->len);
+    }
+    s->data[len] = 0;
+    return s;
+}
+
+/*
+ * Every frame of a compressed message is flushed by Z_SYNC_FLUSH,
+ * and the trailing 0x00 0x00 0xff 0xff of the last frame is removed.
+ * The output is stored in *zbuf which should be freed by caller.
+ */
+static int mln_websocket_deflate_compress(mln_websocket_t *ws, mln_u8ptr_t *content, mln_u64_t *clen, mln_u8ptr_t *zbuf)
+{
+    mln_websocket_deflate_t *d = ws->deflate;
+    mln_u32_t opcode = mln_websocket_get_opcode(ws);
+    mln_u8ptr_t buf, tmp, in = *content;
+    mln_u64_t left = *clen, n;
+    mln_size_t size, used = 0;
+
+    if (opcode == M_WS_OPCODE_TEXT || opcode == M_WS_OPCODE_BINARY) {
+        d->compress = d->zout_init && (!mln_websocket_get_fin(ws) || *clen >= d->threshold);
+        if (!d->compress) return M_WS_RET_OK;
+        mln_websocket_set_rsv1(ws);
+    } else if (opcode != M_WS_OPCODE_CONTINUE || !d->compress) {
+        return M_WS_RET_OK;
+    }
+
+    size = deflateBound(&d->zout, left > 0x40000000? 0x40000000: left) + 16;
+    if ((buf = (mln_u8ptr_t)mln_alloc_m(ws->pool, size)) == NULL) return M_WS_RET_FAILED;
+
+    d->zout.avail_in = 0;
+    while (1) {
+        if (!d->zout.avail_in && left) {
+            n = left > 0x40000000? 0x40000000: left;
+            d->zout.next_in = in;
+            d->zout.avail_in = n;
+            in += n;
+            left -= n;
+        }
+        if (used == size) {
+            if ((tmp = (mln_u8ptr_t)mln_alloc_m(ws->pool, size << 1)) == NULL) {
+                mln_alloc_free(buf);
+                return M_WS_RET_FAILED;
+            }
+            memcpy(tmp, buf, used);
+            mln_alloc_free(buf);
+            buf = tmp;
+            size <<= 1;
+        }
+        d->zout.next_out = buf + used;
+        d->zout.avail_out = size - used;
+        if (deflate(&d->zout, left? Z_NO_FLUSH: Z_SYNC_FLUSH) == Z_STREAM_ERROR) {
+            mln_alloc_free(buf);
+            return M_WS_RET_ERROR;
+        }
+        used = size - d->zout.avail_out;
+        if (!left && !d->zout.avail_in && d->zout.avail_out) break;
+    }
+
+    if (mln_websocket_get_fin(ws)) {
+        if (used >= 4 && !memcmp(buf + used - 4, "\x00\x00\xff\xff", 4)) used -= 4;
+        /*an empty message is sent as a single 0x00 byte (RFC 7692 7.2.3.6)*/
+        if (!used) buf[used++] = 0;
+        if (d->zout_reset) {
+            deflateReset(&d->zout);
+            if (mln_websocket_deflate_dictionary(d, 0) < 0) {
+                mln_alloc_free(buf);
+                return M_WS_RET_FAILED;
+            }
+        }
+    }
+
+    *content = *zbuf = buf;
+    *clen = used;
+    return M_WS_RET_OK;
+}
+
+/*
+ * The inflated payload replaces ws->content, and rsv1 is reset.
+ */
+static int mln_websocket_deflate_decompress(mln_websocket_t *ws)
+{
+    mln_websocket_deflate_t *d = ws->deflate;
+    mln_u32_t opcode = mln_websocket_get_opcode(ws), fin = mln_websocket_get_fin(ws), tail = 0;
+    mln_u8ptr_t buf, tmp, in = (mln_u8ptr_t)mln_websocket_get_content(ws);
+    mln_u64_t left = mln_websocket_get_content_len(ws), n;
+    mln_size_t size, used = 0;
+    static mln_u8_t trailer[4] = {0x00, 0x00, 0xff, 0xff};
+    int ret;
+
+    d->inflated = 0;
+    if (opcode & 0x8) return mln_websocket_get_rsv1(ws)? M_WS_RET_ERROR: M_WS_RET_OK;
+    if (d->retry_set) {
+        /*the frame was inflated already, but the extension handler failed*/
+        buf = d->retry;
+        used = d->retry_len;
+        d->retry_set = 0;
+        d->retry = NULL;
+        goto done;
+    }
+    if (opcode == M_WS_OPCODE_CONTINUE) {
+        if (mln_websocket_get_rsv1(ws)) return M_WS_RET_ERROR;
     } else {
-        if (c != *in) {
-            mln_chain_t *tmpc = *in;
-            *in = c;
-            for (c = tmpc; c->next != *in; c = c->next)
-                ;
-            c->next = NULL;
-            mln_chain_pool_release_all(tmpc);
+        d->decompress = mln_websocket_get_rsv1(ws);
+    }
+    if (!d->decompress) return M_WS_RET_OK;
+
+    size = left > 0x10000000? left: (left << 2);
+    if (size < 256) size = 256;
+    if ((buf = (mln_u8ptr_t)mln_alloc_m(ws->pool, size)) == NULL) return M_WS_RET_FAILED;
+
+    d->zin.avail_in = 0;
+    do {
+        if (!d->zin.avail_in) {
+            if (left) {
+                n = left > 0x40000000? 0x40000000: left;
+                d->zin.next_in = in;
+                d->zin.avail_in = n;
+                in += n;
+                left -= n;
+            } else if (fin && !tail) {
+                tail = 1;
+                d->zin.next_in = trailer;
+                d->zin.avail_in = sizeof(trailer);
+            }
+        }
+        if (used == size) {
+            if ((tmp = (mln_u8ptr_t)mln_alloc_m(ws->pool, size << 1)) == NULL) {
+                mln_alloc_free(buf);
+                return M_WS_RET_FAILED;
+            }
+            memcpy(tmp, buf, used);
+            mln_alloc_free(buf);
+            buf = tmp;
+            size <<= 1;
+        }
+        d->zin.next_out = buf + used;
+        d->zin.avail_out = size - used;
+        ret = inflate(&d->zin, Z_SYNC_FLUSH);
+        used = size - d->zin.avail_out;
+        if (used > mln_websocket_inflate_limit(ws) - ws->message_len) {
+            mln_alloc_free(buf);
+            mln_websocket_set_status(ws, M_WS_STATUS_MESSAGE_TOO_BIG);
+            return M_WS_RET_ERROR;
+        }
+        if (ret == Z_STREAM_END) {
+            /*BFINAL is set, the next message starts with a new stream*/
+            inflateReset(&d->zin);
+            if (mln_websocket_deflate_dictionary(d, 1) < 0) {
+                mln_alloc_free(buf);
+                return M_WS_RET_FAILED;
+            }
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            mln_alloc_free(buf);
+            return ret == Z_MEM_ERROR? M_WS_RET_FAILED: M_WS_RET_ERROR;
+        }
+    } while (d->zin.avail_in || left || (fin && !tail) || !d->zin.avail_out);
+
+    if (fin) {
+        d->decompress = 0;
+        if (d->zin_reset) {
+            inflateReset(&d->zin);
+            if (mln_websocket_deflate_dictionary(d, 1) < 0) {
+                mln_alloc_free(buf);
+                return M_WS_RET_FAILED;
+            }
         }
     }
 
+done:
+    if (mln_websocket_get_content_free(ws)) {
+        mln_alloc_free(mln_websocket_get_content(ws));
+        mln_websocket_reset_content_free(ws);
+    }
+    if (used) {
+        mln_websocket_set_content(ws, buf);
+        mln_websocket_set_content_free(ws);
+    } else {
+        mln_alloc_free(buf);
+        mln_websocket_set_content(ws, NULL);
+    }
+    mln_websocket_set_content_len(ws, used);
+    mln_websocket_reset_rsv1(ws);
+    d->inflated = 1;
+
     return M_WS_RET_OK;
 }
+/*
+ * Inflate a slice of streaming message, and deliver the output to stream_handler.
+ * If stream_handler fails, used tells how much of data is taken by zin, and the
+ * output pending in zin is delivered by the next call.
+ */
+static int mln_websocket_deflate_stream(mln_websocket_t *ws, mln_u8ptr_t data, mln_size_t len, int end, mln_size_t *used)
+{
+    mln_websocket_deflate_t *d = ws->deflate;
+    mln_u8_t out[16384];
+    static mln_u8_t trailer[4] = {0x00, 0x00, 0xff, 0xff};
+    mln_u32_t flags, tail = 0;
+    mln_size_t n;
+    int ret, done;
+
+    *used = 0;
+    d->zin.next_in = data;
+    d->zin.avail_in = len;
+    do {
+        if (!d->zin.avail_in && end && d->trailer_fed < sizeof(trailer)) {
+            tail = 1;
+            d->zin.next_in = trailer + d->trailer_fed;
+            d->zin.avail_in = sizeof(trailer) - d->trailer_fed;
+        }
+        d->zin.next_out = out;
+        d->zin.avail_out = sizeof(out);
+        ret = inflate(&d->zin, Z_SYNC_FLUSH);
+        if (tail) d->trailer_fed = sizeof(trailer) - d->zin.avail_in;
+        else *used = len - d->zin.avail_in;
+        if (ret == Z_STREAM_END) {
+            inflateReset(&d->zin);
+            if (mln_websocket_deflate_dictionary(d, 1) < 0) return M_WS_RET_FAILED;
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            return ret == Z_MEM_ERROR? M_WS_RET_FAILED: M_WS_RET_ERROR;
+        }
+        n = sizeof(out) - d->zin.avail_out;
+        done = !d->zin.avail_in && (!end || d->trailer_fed == sizeof(trailer)) && d->zin.avail_out;
+
+        if (n || (done && end)) {
+            if (n > mln_websocket_inflate_limit(ws) - ws->message_len) {
+                mln_websocket_set_status(ws, M_WS_STATUS_MESSAGE_TOO_BIG);
+                return M_WS_RET_ERROR;
+            }
+            flags = M_WS_FLAG_NONE;
+            if (!ws->message_len) flags |= M_WS_FLAG_NEW;
+            if (done && end) {
+                flags |= M_WS_FLAG_END;
+                ws->stream_end = 1;
+                d->trailer_fed = 0;
+                if (d->zin_reset) {
+                    inflateReset(&d->zin);
+                    if (mln_websocket_deflate_dictionary(d, 1) < 0) return M_WS_RET_FAILED;
+                }
+            }
+            ws->message_len += n;
+            ret = ws->stream_handler(ws, out, n, flags);
+            if (ret != M_WS_RET_OK) return ret;
+        }
+    } while (!done);
 
+    return M_WS_RET_OK;
+}
+#endif
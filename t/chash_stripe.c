@@ -0,0 +1,64 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+/*
+ * The stripe of a key is chosen independently of its bucket in the stripe,
+ * so the keys of one stripe are spread over all of its buckets.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "mln_chash.h"
+
+#define NR_STRIPE 16
+#define NR_BUCKET 1024
+#define NR_KEY    (NR_STRIPE * NR_BUCKET * 2)
+
+static mln_u64_t keys[NR_KEY];
+
+static mln_u64_t test_hash(mln_hash_t *h, void *key)
+{
+    return mln_hash_u64(h, key);
+}
+
+static int test_cmp(mln_hash_t *h, void *k1, void *k2)
+{
+    return *(mln_u64_t *)k1 == *(mln_u64_t *)k2;
+}
+
+int main(void)
+{
+    struct mln_hash_attr hattr;
+    mln_chash_t *ch;
+    mln_hash_t *h;
+    mln_u64_t i, j, used;
+    int fail = 0;
+
+    memset(&hattr, 0, sizeof(hattr));
+    hattr.hash = test_hash;
+    hattr.cmp = test_cmp;
+    hattr.len_base = NR_STRIPE * NR_BUCKET;
+    if ((ch = mln_chash_new(&hattr, NR_STRIPE, 0)) == NULL) return 1;
+
+    for (i = 0; i < NR_KEY; ++i) {
+        keys[i] = i;
+        if (mln_chash_insert(ch, &keys[i], &keys[i]) < 0) return 1;
+    }
+
+    /*two keys per bucket on average, about 86% of the buckets are used*/
+    for (i = 0; i < ch->nr_stripes; ++i) {
+        h = ch->stripes[i].s.h;
+        for (used = 0, j = 0; j < h->len; ++j) {
+            if (h->tbl[j].head != NULL) ++used;
+        }
+        if (used * 4 < h->len * 3) {
+            fprintf(stderr, "stripe %d uses %d of %d buckets\n", (int)i, (int)used, (int)h->len);
+            fail = 1;
+        }
+    }
+
+    mln_chash_free(ch, M_HASH_F_NONE);
+    return fail? 1: 0;
+}
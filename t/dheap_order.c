@@ -0,0 +1,91 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+/*
+ * A 4-ary heap is only created with a cmp, and extracts its keys in order
+ * after some of them are deleted or decreased.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mln_dheap.h"
+
+#define NR_NODE 1000
+
+static int test_cmp(const void *a, const void *b)
+{
+    return *(long *)a < *(long *)b? 0: 1;
+}
+
+static void test_copy(void *a, void *b)
+{
+    *(long *)a = *(long *)b;
+}
+
+int main(void)
+{
+    static mln_dheap_node_t nodes[NR_NODE];
+    static long keys[NR_NODE];
+    struct mln_dheap_attr dattr;
+    mln_dheap_node_t *dn;
+    mln_dheap_t *dh;
+    long prev, k;
+    int i, n = 0, fail = 0;
+
+    if (mln_dheap_new(NULL) != NULL) {
+        fprintf(stderr, "a heap is created without attr\n");
+        fail = 1;
+    }
+    memset(&dattr, 0, sizeof(dattr));
+    if (mln_dheap_new(&dattr) != NULL) {
+        fprintf(stderr, "a heap is created without cmp\n");
+        fail = 1;
+    }
+
+    dattr.cmp = test_cmp;
+    dattr.copy = test_copy;
+    if ((dh = mln_dheap_new(&dattr)) == NULL) return 1;
+
+    srand(13);
+    for (i = 0; i < NR_NODE; ++i) {
+        keys[i] = rand() % 10000;
+        mln_dheap_node_init(&nodes[i], &keys[i]);
+        if (mln_dheap_insert(dh, &nodes[i]) < 0) return 1;
+    }
+    for (i = 0; i < NR_NODE; i += 3) {
+        mln_dheap_delete(dh, &nodes[i]);
+    }
+    for (i = 1; i < NR_NODE; i += 7) {
+        if (i % 3 == 0) continue;/*deleted*/
+        k = -i;
+        if (mln_dheap_decrease_key(dh, &nodes[i], &k) < 0) {
+            fprintf(stderr, "decreasing key %d failed\n", i);
+            fail = 1;
+        }
+    }
+    k = 20000;
+    if (mln_dheap_decrease_key(dh, &nodes[2], &k) == 0) {
+        fprintf(stderr, "a key is increased\n");
+        fail = 1;
+    }
+
+    for (prev = -NR_NODE; (dn = mln_dheap_extract_min(dh)) != NULL; ++n) {
+        k = *(long *)mln_dheap_node_key(dn);
+        if (k < prev) {
+            fprintf(stderr, "%ld is extracted after %ld\n", k, prev);
+            fail = 1;
+        }
+        prev = k;
+    }
+    if (n != NR_NODE - (NR_NODE + 2) / 3) {
+        fprintf(stderr, "%d keys are extracted\n", n);
+        fail = 1;
+    }
+
+    mln_dheap_free(dh);
+    return fail? 1: 0;
+}
+
@@ -0,0 +1,126 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+/*
+ * An open addressing table keeps the element removed by an iterate handler
+ * pending until the handler returns. Inserting enough in the handler to fill
+ * the table must not move it to another slot.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "mln_hash.h"
+
+#define NR_FIRST  48
+#define NR_INSIDE 12
+#define NR_AFTER  1000
+#define NR_REC    (NR_FIRST + NR_INSIDE + NR_AFTER)
+
+typedef struct {
+    mln_u64_t key;
+    int       freed;
+} test_rec_t;
+
+static test_rec_t recs[NR_REC];
+static int double_free = 0;
+
+static mln_u64_t test_hash(mln_hash_t *h, void *key)
+{
+    return mln_hash_u64(h, key);
+}
+
+static int test_cmp(mln_hash_t *h, void *k1, void *k2)
+{
+    return *(mln_u64_t *)k1 == *(mln_u64_t *)k2;
+}
+
+static void test_free(void *val)
+{
+    test_rec_t *r = (test_rec_t *)val;
+    if (r->freed++) ++double_free;
+}
+
+static int test_insert(mln_hash_t *h, int i)
+{
+    recs[i].key = (mln_u64_t)i * 0x9e3779b97f4a7c15ULL;
+    recs[i].freed = 0;
+    return mln_hash_insert(h, &(recs[i].key), &recs[i]);
+}
+
+static int test_handler(mln_hash_t *h, void *key, void *val, void *udata)
+{
+    int *removed = (int *)udata, i;
+
+    if (*removed >= 0) return 0;
+    *removed = (test_rec_t *)val - recs;
+    mln_hash_remove(h, key, M_HASH_F_VAL);
+    for (i = NR_FIRST; i < NR_FIRST + NR_INSIDE; ++i) {
+        if (test_insert(h, i) < 0) return -1;
+    }
+    return 0;
+}
+
+static int test_check(mln_hash_t *h, int n, int removed)
+{
+    test_rec_t *r;
+    int i;
+
+    for (i = 0; i < n; ++i) {
+        r = (test_rec_t *)mln_hash_search(h, &(recs[i].key));
+        if (i == removed) {
+            if (r != NULL || recs[i].freed != 1) {
+                fprintf(stderr, "the removed element %d is %s\n", i, r != NULL? "found": "not freed");
+                return -1;
+            }
+            continue;
+        }
+        if (r != &recs[i] || recs[i].freed) {
+            fprintf(stderr, "element %d is %s\n", i, r == NULL? "missing": "wrong");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main(void)
+{
+    struct mln_hash_attr hattr;
+    int removed = -1, i, fail = 0;
+    mln_hash_t *h;
+
+    memset(&hattr, 0, sizeof(hattr));
+    hattr.hash = test_hash;
+    hattr.cmp = test_cmp;
+    hattr.free_val = test_free;
+    hattr.len_base = NR_FIRST;
+    if ((h = mln_hash_new_mode(&hattr, M_HASH_OPEN_ADDRESSING)) == NULL) return 1;
+
+    for (i = 0; i < NR_FIRST; ++i) {
+        if (test_insert(h, i) < 0) return 1;
+    }
+    if (mln_hash_iterate(h, test_handler, &removed) < 0) {
+        fprintf(stderr, "iterate failed\n");
+        fail = 1;
+    } else if (test_check(h, NR_FIRST + NR_INSIDE, removed) < 0) {
+        fail = 1;
+    }
+
+    /*the table grows again after the iteration*/
+    for (i = NR_FIRST + NR_INSIDE; !fail && i < NR_REC; ++i) {
+        if (test_insert(h, i) < 0) fail = 1;
+    }
+    if (!fail && test_check(h, NR_REC, removed) < 0) fail = 1;
+
+    mln_hash_free(h, M_HASH_F_VAL);
+    for (i = 0; i < NR_REC; ++i) {
+        if (!fail && recs[i].freed != 1) {
+            fprintf(stderr, "element %d is freed %d times\n", i, recs[i].freed);
+            fail = 1;
+        }
+    }
+    if (double_free) fail = 1;
+
+    return fail? 1: 0;
+}
@@ -0,0 +1,397 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+/*
+ * Frames received by a server: padded HEADERS and DATA frames are delivered
+ * without their padding but counted in flow control, a header block split
+ * into CONTINUATION frames is delivered once and must not be interleaved
+ * with any other frame, and SETTINGS_INITIAL_WINDOW_SIZE moves the send
+ * window of every open stream by the difference to the old value.
+ * The input is also fed byte by byte.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "mln_http2.h"
+
+/*RFC 7541 C.3.1: GET http://www.example.com/*/
+static mln_u8_t test_hblock[] = {
+    0x82, 0x86, 0x84, 0x41, 0x0f, 0x77, 0x77, 0x77, 0x2e, 0x65,
+    0x78, 0x61, 0x6d, 0x70, 0x6c, 0x65, 0x2e, 0x63, 0x6f, 0x6d
+};
+
+static mln_u8_t test_in[1024];
+static mln_size_t test_in_len;
+static mln_chain_t *test_chain;
+static int nheaders, nwindow;
+static mln_u8_t got[64];
+static mln_size_t got_len;
+
+static int test_headers_handler(mln_http2_t *h2, mln_http2_stream_t *stream, int end_stream)
+{
+    mln_string_t name = mln_string(":authority");
+    mln_string_t *v = mln_http2_field_get(stream, &name);
+
+    if (v == NULL || mln_string_const_strcmp(v, "www.example.com") || mln_http2_stream_nfields_get(stream) != 4)
+        return M_HTTP2_RET_ERROR;
+    ++nheaders;
+    return M_HTTP2_RET_OK;
+}
+
+static int test_data_handler(mln_http2_t *h2, mln_http2_stream_t *stream, mln_u8ptr_t data, mln_size_t len, int end_stream)
+{
+    if (got_len + len > sizeof(got)) return M_HTTP2_RET_ERROR;
+    memcpy(got + got_len, data, len);
+    got_len += len;
+    return M_HTTP2_RET_OK;
+}
+
+static void test_window_handler(mln_http2_t *h2, mln_http2_stream_t *stream)
+{
+    ++nwindow;
+}
+
+static void test_frame(mln_u8_t type, mln_u8_t flags, mln_u32_t id, mln_u8ptr_t payload, mln_size_t len)
+{
+    mln_u8ptr_t p = test_in + test_in_len;
+
+    p[0] = (len >> 16) & 0xff;
+    p[1] = (len >> 8) & 0xff;
+    p[2] = len & 0xff;
+    p[3] = type;
+    p[4] = flags;
+    p[5] = (id >> 24) & 0x7f;
+    p[6] = (id >> 16) & 0xff;
+    p[7] = (id >> 8) & 0xff;
+    p[8] = id & 0xff;
+    if (len) memcpy(p + 9, payload, len);
+    test_in_len += 9 + len;
+}
+
+static void test_settings(mln_u32_t initial_window_size)
+{
+    mln_u8_t p[6] = {0, M_HTTP2_SETTINGS_INITIAL_WINDOW_SIZE, 0, 0, 0, 0};
+
+    p[2] = (initial_window_size >> 24) & 0xff;
+    p[3] = (initial_window_size >> 16) & 0xff;
+    p[4] = (initial_window_size >> 8) & 0xff;
+    p[5] = initial_window_size & 0xff;
+    test_frame(M_HTTP2_FRAME_SETTINGS, 0, 0, p, sizeof(p));
+}
+
+/*
+ * Parse the frames built so far, piece bytes at a time.
+ */
+static int test_feed(mln_http2_t *h2, mln_size_t piece)
+{
+    mln_alloc_t *pool = mln_http2_pool_get(h2);
+    mln_chain_t *c, *tail;
+    mln_u8ptr_t data;
+    mln_size_t off, n;
+    int ret = M_HTTP2_RET_OK;
+
+    for (off = 0; off < test_in_len && ret == M_HTTP2_RET_OK; off += n) {
+        n = test_in_len - off > piece? piece: test_in_len - off;
+        if ((c = mln_chain_new(pool)) == NULL) return -1;
+        if ((c->buf = mln_buf_new(pool)) == NULL) return -1;
+        if ((data = (mln_u8ptr_t)mln_alloc_m(pool, n)) == NULL) return -1;
+        memcpy(data, test_in + off, n);
+        c->buf->left_pos = c->buf->pos = c->buf->start = data;
+        c->buf->last = c->buf->end = data + n;
+        c->buf->in_memory = 1;
+        for (tail = test_chain; tail != NULL && tail->next != NULL; tail = tail->next)
+            ;
+        if (tail == NULL) test_chain = c;
+        else tail->next = c;
+        ret = mln_http2_parse(h2, &test_chain);
+    }
+    test_in_len = 0;
+    return ret;
+}
+
+/*
+ * Count and release the frames of type in the send chain,
+ * error returns the error code of the last GOAWAY.
+ */
+static int test_sent(mln_http2_t *h2, mln_u8_t type, mln_u8_t flags, mln_u32_t *error)
+{
+    mln_chain_t *head = mln_tcp_conn_remove(mln_http2_connection_get(h2), M_C_SEND), *c;
+    mln_u8ptr_t p;
+    int n = 0;
+
+    for (c = head; c != NULL; c = c->next) {
+        p = c->buf->left_pos;
+        if (p[3] != type || (p[4] & flags) != flags) continue;
+        ++n;
+        if (type == M_HTTP2_FRAME_GOAWAY && error != NULL)
+            *error = ((mln_u32_t)p[13] << 24) | ((mln_u32_t)p[14] << 16) | ((mln_u32_t)p[15] << 8) | p[16];
+    }
+    mln_chain_pool_release_all(head);
+    return n;
+}
+
+static mln_http2_t *test_open(mln_tcp_conn_t *tc, mln_size_t piece)
+{
+    mln_http2_t *h2;
+
+    if (mln_tcp_conn_init(tc, -1) < 0) return NULL;
+    if ((h2 = mln_http2_init(tc, M_HTTP2_SERVER, NULL)) == NULL) return NULL;
+    mln_http2_headers_handler_set(h2, test_headers_handler);
+    mln_http2_data_handler_set(h2, test_data_handler);
+    mln_http2_window_handler_set(h2, test_window_handler);
+    nheaders = nwindow = 0;
+    got_len = 0;
+    test_chain = NULL;
+
+    memcpy(test_in, "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n", 24);
+    test_in_len = 24;
+    test_frame(M_HTTP2_FRAME_SETTINGS, 0, 0, NULL, 0);
+    if (test_feed(h2, piece) != M_HTTP2_RET_OK || test_sent(h2, M_HTTP2_FRAME_SETTINGS, M_HTTP2_FLAG_ACK, NULL) != 1) {
+        fprintf(stderr, "preface failed\n");
+        mln_http2_destroy(h2);
+        return NULL;
+    }
+    return h2;
+}
+
+static void test_close(mln_tcp_conn_t *tc, mln_http2_t *h2)
+{
+    mln_chain_pool_release_all(test_chain);
+    test_chain = NULL;
+    mln_http2_destroy(h2);
+    mln_tcp_conn_destroy(tc);
+}
+
+/*
+ * The frames built so far must be the connection error expect, answered with GOAWAY.
+ */
+static int test_error(mln_http2_t *h2, const char *name, mln_u32_t expect)
+{
+    mln_u32_t error = M_HTTP2_NO_ERROR;
+    int ret = test_feed(h2, 7);
+
+    if (ret != M_HTTP2_RET_ERROR || mln_http2_error_get(h2) != expect || \
+        test_sent(h2, M_HTTP2_FRAME_GOAWAY, 0, &error) != 1 || error != expect)
+    {
+        fprintf(stderr, "%s: parse returns %d, error %u, GOAWAY error %u\n", \
+                name, ret, (unsigned)mln_http2_error_get(h2), (unsigned)error);
+        return -1;
+    }
+    return 0;
+}
+
+static int test_padding(mln_size_t piece)
+{
+    mln_tcp_conn_t tc;
+    mln_http2_t *h2;
+    mln_http2_stream_t *stream;
+    mln_u8_t p[64];
+    mln_size_t n;
+    int ret, fail = 0;
+
+    if ((h2 = test_open(&tc, piece)) == NULL) return -1;
+
+    /*pad length 5, priority (stream 0, weight 16), header block, padding*/
+    memset(p, 0, sizeof(p));
+    p[0] = 5;
+    p[5] = 15;
+    memcpy(p + 6, test_hblock, sizeof(test_hblock));
+    n = 6 + sizeof(test_hblock) + 5;
+    test_frame(M_HTTP2_FRAME_HEADERS, M_HTTP2_FLAG_PADDED|M_HTTP2_FLAG_PRIORITY|M_HTTP2_FLAG_END_HEADERS, 1, p, n);
+    /*pad length 10, "hello", padding*/
+    memset(p, 0, sizeof(p));
+    p[0] = 10;
+    memcpy(p + 1, "hello", 5);
+    test_frame(M_HTTP2_FRAME_DATA, M_HTTP2_FLAG_PADDED|M_HTTP2_FLAG_END_STREAM, 1, p, 16);
+
+    if ((ret = test_feed(h2, piece)) != M_HTTP2_RET_OK) {
+        fprintf(stderr, "padding piece %lu: parse returns %d\n", (unsigned long)piece, ret);
+        fail = 1;
+    } else if (nheaders != 1 || got_len != 5 || memcmp(got, "hello", 5)) {
+        fprintf(stderr, "padding piece %lu: %d header blocks, data \"%.*s\"\n", \
+                (unsigned long)piece, nheaders, (int)got_len, (char *)got);
+        fail = 1;
+    } else if ((stream = mln_http2_stream_search(h2, 1)) == NULL || \
+               mln_http2_stream_state_get(stream) != M_HTTP2_STATE_HALF_CLOSED_REMOTE || \
+               stream->recv_window != M_HTTP2_DEFAULT_WINDOW_SIZE - 16 || \
+               h2->recv_window != M_HTTP2_DEFAULT_WINDOW_SIZE - 16)
+    {
+        fprintf(stderr, "padding piece %lu: the padding is not counted in flow control\n", (unsigned long)piece);
+        fail = 1;
+    }
+    test_close(&tc, h2);
+
+    /*the padding must be shorter than the payload*/
+    if ((h2 = test_open(&tc, piece)) == NULL) return -1;
+    test_frame(M_HTTP2_FRAME_HEADERS, M_HTTP2_FLAG_END_HEADERS, 1, test_hblock, sizeof(test_hblock));
+    memset(p, 0, sizeof(p));
+    p[0] = 5;
+    test_frame(M_HTTP2_FRAME_DATA, M_HTTP2_FLAG_PADDED, 1, p, 5);
+    if (test_error(h2, "DATA padding", M_HTTP2_PROTOCOL_ERROR) < 0 || got_len) fail = 1;
+    test_close(&tc, h2);
+
+    if ((h2 = test_open(&tc, piece)) == NULL) return -1;
+    memset(p, 0, sizeof(p));
+    p[0] = sizeof(test_hblock) + 1;
+    memcpy(p + 1, test_hblock, sizeof(test_hblock));
+    test_frame(M_HTTP2_FRAME_HEADERS, M_HTTP2_FLAG_PADDED|M_HTTP2_FLAG_END_HEADERS, 1, p, 1 + sizeof(test_hblock));
+    if (test_error(h2, "HEADERS padding", M_HTTP2_PROTOCOL_ERROR) < 0 || nheaders) fail = 1;
+    test_close(&tc, h2);
+
+    return fail? -1: 0;
+}
+
+static int test_continuation(void)
+{
+    mln_tcp_conn_t tc;
+    mln_http2_t *h2;
+    mln_u8_t ping[8] = {0}, wu[4] = {0, 0, 0, 1};
+    int ret, i, fail = 0;
+
+    /*the header block is delivered once the last CONTINUATION arrives*/
+    if ((h2 = test_open(&tc, 3)) == NULL) return -1;
+    test_frame(M_HTTP2_FRAME_HEADERS, M_HTTP2_FLAG_END_STREAM, 1, test_hblock, 8);
+    test_frame(M_HTTP2_FRAME_CONTINUATION, 0, 1, test_hblock + 8, 0);
+    test_frame(M_HTTP2_FRAME_CONTINUATION, 0, 1, test_hblock + 8, 7);
+    test_frame(M_HTTP2_FRAME_CONTINUATION, M_HTTP2_FLAG_END_HEADERS, 1, test_hblock + 15, sizeof(test_hblock) - 15);
+    if ((ret = test_feed(h2, 3)) != M_HTTP2_RET_OK || nheaders != 1 || \
+        mln_http2_stream_search(h2, 1) == NULL || \
+        mln_http2_stream_state_get(mln_http2_stream_search(h2, 1)) != M_HTTP2_STATE_HALF_CLOSED_REMOTE)
+    {
+        fprintf(stderr, "CONTINUATION: parse returns %d, %d header blocks\n", ret, nheaders);
+        fail = 1;
+    }
+    test_close(&tc, h2);
+
+    /*any other frame before END_HEADERS is a connection error*/
+    for (i = 0; i < 5; ++i) {
+        if ((h2 = test_open(&tc, 3)) == NULL) return -1;
+        test_frame(M_HTTP2_FRAME_HEADERS, 0, 1, test_hblock, 8);
+        switch (i) {
+            case 0:
+                test_frame(M_HTTP2_FRAME_PING, 0, 0, ping, sizeof(ping));
+                break;
+            case 1:
+                test_frame(M_HTTP2_FRAME_DATA, 0, 1, (mln_u8ptr_t)"hello", 5);
+                break;
+            case 2:
+                test_frame(M_HTTP2_FRAME_WINDOW_UPDATE, 0, 0, wu, sizeof(wu));
+                break;
+            case 3:
+                test_frame(M_HTTP2_FRAME_HEADERS, M_HTTP2_FLAG_END_HEADERS, 3, test_hblock, sizeof(test_hblock));
+                break;
+            default:
+                test_frame(M_HTTP2_FRAME_CONTINUATION, M_HTTP2_FLAG_END_HEADERS, 3, test_hblock + 8, sizeof(test_hblock) - 8);
+                break;
+        }
+        if (test_error(h2, "interleaved CONTINUATION", M_HTTP2_PROTOCOL_ERROR) < 0 || nheaders || got_len) {
+            fprintf(stderr, "case %d\n", i);
+            fail = 1;
+        }
+        test_close(&tc, h2);
+    }
+
+    /*a CONTINUATION without HEADERS*/
+    if ((h2 = test_open(&tc, 3)) == NULL) return -1;
+    test_frame(M_HTTP2_FRAME_CONTINUATION, M_HTTP2_FLAG_END_HEADERS, 1, test_hblock, sizeof(test_hblock));
+    if (test_error(h2, "stray CONTINUATION", M_HTTP2_PROTOCOL_ERROR) < 0 || nheaders) fail = 1;
+    test_close(&tc, h2);
+
+    return fail? -1: 0;
+}
+
+static int test_window_check(mln_http2_t *h2, const char *name, mln_s64_t window, int nhandler)
+{
+    mln_http2_stream_t *stream = NULL;
+    int ret, nack;
+
+    ret = test_feed(h2, 5);
+    nack = test_sent(h2, M_HTTP2_FRAME_SETTINGS, M_HTTP2_FLAG_ACK, NULL);
+    if (ret != M_HTTP2_RET_OK || (stream = mln_http2_stream_search(h2, 1)) == NULL || \
+        mln_http2_stream_send_window_get(stream) != window || nwindow != nhandler || \
+        (!strncmp(name, "SETTINGS", 8) && nack != 1))
+    {
+        fprintf(stderr, "%s: parse returns %d, window %ld, window handler is called %d times, %d ACKs\n", \
+                name, ret, stream == NULL? 0L: (long)mln_http2_stream_send_window_get(stream), nwindow, nack);
+        return -1;
+    }
+    return 0;
+}
+
+static int test_sendable(mln_http2_t *h2, mln_size_t expect)
+{
+    mln_u8_t buf[1000];
+    mln_size_t sent = 0;
+
+    memset(buf, 'x', sizeof(buf));
+    if (mln_http2_data_generate(h2, mln_http2_stream_search(h2, 1), buf, sizeof(buf), 0, &sent) != M_HTTP2_RET_OK || \
+        sent != expect || test_sent(h2, M_HTTP2_FRAME_DATA, 0, NULL) != (expect? 1: 0))
+    {
+        fprintf(stderr, "%lu bytes are sent instead of %lu\n", (unsigned long)sent, (unsigned long)expect);
+        return -1;
+    }
+    return 0;
+}
+
+static int test_initial_window_size(void)
+{
+    mln_tcp_conn_t tc;
+    mln_http2_t *h2;
+    mln_u8_t wu[4];
+    mln_u32_t inc;
+    int fail = 0;
+
+    if ((h2 = test_open(&tc, 5)) == NULL) return -1;
+    test_frame(M_HTTP2_FRAME_HEADERS, M_HTTP2_FLAG_END_HEADERS, 1, test_hblock, sizeof(test_hblock));
+    if (test_window_check(h2, "HEADERS", M_HTTP2_DEFAULT_WINDOW_SIZE, 0) < 0) fail = 1;
+
+    test_settings(100);
+    if (test_window_check(h2, "SETTINGS 100", 100, 0) < 0) fail = 1;
+    if (test_sendable(h2, 100) < 0) fail = 1;
+    /*100 -> 300 opens the window by 200*/
+    test_settings(300);
+    if (test_window_check(h2, "SETTINGS 300", 200, 1) < 0) fail = 1;
+    /*300 -> 0 leaves the window negative*/
+    test_settings(0);
+    if (test_window_check(h2, "SETTINGS 0", -100, 1) < 0) fail = 1;
+    if (test_sendable(h2, 0) < 0) fail = 1;
+    wu[0] = wu[1] = wu[2] = 0;
+    wu[3] = 150;
+    test_frame(M_HTTP2_FRAME_WINDOW_UPDATE, 0, 1, wu, sizeof(wu));
+    if (test_window_check(h2, "WINDOW_UPDATE 150", 50, 2) < 0) fail = 1;
+    if (test_sendable(h2, 50) < 0) fail = 1;
+
+    test_settings(0x80000000);
+    if (test_error(h2, "SETTINGS 0x80000000", M_HTTP2_FLOW_CONTROL_ERROR) < 0) fail = 1;
+    test_close(&tc, h2);
+
+    /*a delta must not overflow the window of any stream*/
+    if ((h2 = test_open(&tc, 5)) == NULL) return -1;
+    test_frame(M_HTTP2_FRAME_HEADERS, M_HTTP2_FLAG_END_HEADERS, 1, test_hblock, sizeof(test_hblock));
+    inc = M_HTTP2_MAX_WINDOW_SIZE - M_HTTP2_DEFAULT_WINDOW_SIZE;
+    wu[0] = (inc >> 24) & 0xff;
+    wu[1] = (inc >> 16) & 0xff;
+    wu[2] = (inc >> 8) & 0xff;
+    wu[3] = inc & 0xff;
+    test_frame(M_HTTP2_FRAME_WINDOW_UPDATE, 0, 1, wu, sizeof(wu));
+    if (test_window_check(h2, "WINDOW_UPDATE", M_HTTP2_MAX_WINDOW_SIZE, 1) < 0) fail = 1;
+    test_settings(M_HTTP2_DEFAULT_WINDOW_SIZE + 1);
+    if (test_error(h2, "SETTINGS overflow", M_HTTP2_FLOW_CONTROL_ERROR) < 0) fail = 1;
+    test_close(&tc, h2);
+
+    return fail? -1: 0;
+}
+
+int main(void)
+{
+    int fail = 0;
+
+    fail |= test_padding(4096);
+    fail |= test_padding(1);
+    fail |= test_continuation();
+    fail |= test_initial_window_size();
+    return fail? 1: 0;
+}
+
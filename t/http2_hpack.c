@@ -0,0 +1,220 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+/*
+ * HPACK examples of RFC 7541 appendix C: requests without Huffman coding
+ * (C.3), requests with Huffman coding (C.4) and responses with Huffman coding
+ * and evictions (C.6). Every header block is decoded to the listed fields and
+ * dynamic table size, and C.4 and C.6 are also encoded to the listed bytes
+ * (or to a block of the same length where our choice of literal differs).
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "mln_http2.h"
+
+typedef struct {
+    const char *hex;
+    const char *fields[16];/*name, value, ..., NULL*/
+    mln_size_t  size;/*dynamic table size after the block*/
+    const char *encoded;/*our encoding if it differs from hex*/
+} test_block_t;
+
+static test_block_t test_c3[] = {
+    {
+        "828684410f7777772e6578616d706c652e636f6d",
+        {":method", "GET", ":scheme", "http", ":path", "/", ":authority", "www.example.com", NULL},
+        57
+    },
+    {
+        "828684be58086e6f2d6361636865",
+        {":method", "GET", ":scheme", "http", ":path", "/", ":authority", "www.example.com", \
+         "cache-control", "no-cache", NULL},
+        110
+    },
+    {
+        "828785bf400a637573746f6d2d6b65790c637573746f6d2d76616c7565",
+        {":method", "GET", ":scheme", "https", ":path", "/index.html", ":authority", "www.example.com", \
+         "custom-key", "custom-value", NULL},
+        164
+    },
+    {NULL, {NULL}, 0, NULL}
+};
+
+static test_block_t test_c4[] = {
+    {
+        "828684418cf1e3c2e5f23a6ba0ab90f4ff",
+        {":method", "GET", ":scheme", "http", ":path", "/", ":authority", "www.example.com", NULL},
+        57
+    },
+    {
+        "828684be5886a8eb10649cbf",
+        {":method", "GET", ":scheme", "http", ":path", "/", ":authority", "www.example.com", \
+         "cache-control", "no-cache", NULL},
+        110
+    },
+    {
+        "828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf",
+        {":method", "GET", ":scheme", "https", ":path", "/index.html", ":authority", "www.example.com", \
+         "custom-key", "custom-value", NULL},
+        164
+    },
+    {NULL, {NULL}, 0, NULL}
+};
+
+static test_block_t test_c6[] = {
+    {
+        "488264025885aec3771a4b6196d07abe941054d444a8200595040b8166e082a62d1bff6e919d29ad171863c78f0b97c8e9ae82ae43d3",
+        {":status", "302", "cache-control", "private", "date", "Mon, 21 Oct 2013 20:13:21 GMT", \
+         "location", "https://www.example.com", NULL},
+        222
+    },
+    {
+        "4883640effc1c0bf",
+        {":status", "307", "cache-control", "private", "date", "Mon, 21 Oct 2013 20:13:21 GMT", \
+         "location", "https://www.example.com", NULL},
+        222,
+        /*Huffman coding is only used if it is shorter, "307" is 3 bytes either way*/
+        "4803333037c1c0bf"
+    },
+    {
+        "88c16196d07abe941054d444a8200595040b8166e084a62d1bffc05a839bd9ab77ad94e7821dd7f2e6c7b335dfdfcd5b3960d5af27087f3672c1ab270fb5291f9587316065c003ed4ee5b1063d5007",
+        {":status", "200", "cache-control", "private", "date", "Mon, 21 Oct 2013 20:13:22 GMT", \
+         "location", "https://www.example.com", "content-encoding", "gzip", \
+         "set-cookie", "foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1", NULL},
+        215
+    },
+    {NULL, {NULL}, 0, NULL}
+};
+
+static void test_field_free(void *data)
+{
+    mln_http2_field_t *f = (mln_http2_field_t *)data;
+    mln_string_free(f->name);
+    mln_string_free(f->value);
+}
+
+static mln_size_t test_unhex(const char *hex, mln_u8ptr_t out)
+{
+    mln_size_t n = 0;
+    unsigned int b;
+
+    for (; hex[0] && hex[1]; hex += 2) {
+        sscanf(hex, "%2x", &b);
+        out[n++] = (mln_u8_t)b;
+    }
+    return n;
+}
+
+static int test_decode(mln_alloc_t *pool, const char *name, test_block_t *blocks, mln_size_t table_size)
+{
+    mln_http2_hpack_t hp;
+    struct mln_array_attr attr;
+    mln_array_t *fields;
+    mln_http2_field_t *f;
+    mln_u8_t buf[256];
+    mln_size_t len, i, n;
+    test_block_t *b;
+    int fail = 0;
+
+    mln_http2_hpack_init(&hp, pool, table_size);
+    attr.pool = pool;
+    attr.pool_alloc = (array_pool_alloc_handler)mln_alloc_m;
+    attr.pool_free = (array_pool_free_handler)mln_alloc_free;
+    attr.free = test_field_free;
+    attr.size = sizeof(mln_http2_field_t);
+    attr.nalloc = 8;
+
+    for (b = blocks; b->hex != NULL; ++b) {
+        if ((fields = mln_array_new(&attr)) == NULL) return -1;
+        len = test_unhex(b->hex, buf);
+        if (mln_http2_hpack_decode(&hp, buf, len, fields) != M_HTTP2_RET_OK) {
+            fprintf(stderr, "%s.%d: decode failed\n", name, (int)(b - blocks) + 1);
+            fail = 1;
+            mln_array_free(fields);
+            break;
+        }
+        for (n = 0; b->fields[n] != NULL; n += 2)
+            ;
+        f = (mln_http2_field_t *)mln_array_elts(fields);
+        if (mln_array_nelts(fields) != n / 2) {
+            fprintf(stderr, "%s.%d: %lu fields are decoded\n", name, (int)(b - blocks) + 1, (unsigned long)mln_array_nelts(fields));
+            fail = 1;
+        } else {
+            for (i = 0; i < n; i += 2, ++f) {
+                if (mln_string_const_strcmp(f->name, (char *)b->fields[i]) || \
+                    mln_string_const_strcmp(f->value, (char *)b->fields[i + 1]))
+                {
+                    fprintf(stderr, "%s.%d: %s: %s is decoded as %.*s: %.*s\n", \
+                            name, (int)(b - blocks) + 1, b->fields[i], b->fields[i + 1], \
+                            (int)f->name->len, (char *)f->name->data, (int)f->value->len, (char *)f->value->data);
+                    fail = 1;
+                }
+            }
+        }
+        if (hp.size != b->size) {
+            fprintf(stderr, "%s.%d: the table size is %lu\n", name, (int)(b - blocks) + 1, (unsigned long)hp.size);
+            fail = 1;
+        }
+        mln_array_free(fields);
+    }
+
+    mln_http2_hpack_destroy(&hp);
+    return fail? -1: 0;
+}
+
+static int test_encode(mln_alloc_t *pool, const char *name, test_block_t *blocks, mln_size_t table_size)
+{
+    mln_http2_hpack_t hp;
+    mln_http2_field_t fields[8];
+    mln_string_t strs[16];
+    mln_u8_t expect[256], out[1024];
+    mln_size_t len, n, i;
+    test_block_t *b;
+    int fail = 0;
+
+    mln_http2_hpack_init(&hp, pool, table_size);
+    for (b = blocks; b->hex != NULL; ++b) {
+        for (n = 0; b->fields[n] != NULL; ++n) {
+            mln_string_nset(&strs[n], b->fields[n], strlen(b->fields[n]));
+        }
+        for (i = 0; i < n; i += 2) {
+            fields[i / 2].name = &strs[i];
+            fields[i / 2].value = &strs[i + 1];
+        }
+        len = test_unhex(b->encoded != NULL? b->encoded: b->hex, expect);
+        n = mln_http2_hpack_encode(&hp, fields, n / 2, out, sizeof(out));
+        if (n != len || memcmp(out, expect, len)) {
+            fprintf(stderr, "%s.%d: encoded to ", name, (int)(b - blocks) + 1);
+            for (i = 0; i < n; ++i) fprintf(stderr, "%02x", out[i]);
+            fprintf(stderr, "\n");
+            fail = 1;
+        }
+        if (hp.size != b->size) {
+            fprintf(stderr, "%s.%d: the encoder table size is %lu\n", name, (int)(b - blocks) + 1, (unsigned long)hp.size);
+            fail = 1;
+        }
+    }
+    mln_http2_hpack_destroy(&hp);
+    return fail? -1: 0;
+}
+
+int main(void)
+{
+    mln_alloc_t *pool;
+    int fail = 0;
+
+    if ((pool = mln_alloc_init(NULL)) == NULL) return 1;
+
+    fail |= test_decode(pool, "C.3", test_c3, 4096);
+    fail |= test_decode(pool, "C.4", test_c4, 4096);
+    fail |= test_decode(pool, "C.6", test_c6, 256);
+    fail |= test_encode(pool, "C.4", test_c4, 4096);
+    fail |= test_encode(pool, "C.6", test_c6, 256);
+
+    mln_alloc_destroy(pool);
+    return fail? 1: 0;
+}
+
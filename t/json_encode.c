@@ -0,0 +1,156 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+/*
+ * mln_json_encode_buf works like snprintf: it returns the whole length and
+ * writes only what fits, at every buffer size. mln_json_encode_chain writes
+ * the same bytes into as many bufs as needed, and the pretty form puts one
+ * member on a line with two spaces of indentation per level.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "mln_json.h"
+
+#define TEST_SIZE 65536
+
+static mln_u8_t buf[TEST_SIZE];
+
+static char pretty[] = "{\n" \
+                       "  \"a\": [\n" \
+                       "    1,\n" \
+                       "    {\n" \
+                       "      \"b\": null\n" \
+                       "    },\n" \
+                       "    [],\n" \
+                       "    {}\n" \
+                       "  ],\n" \
+                       "  \"c\": \"q\\\"\\\\/\",\n" \
+                       "  \"d\": {\n" \
+                       "    \"e\": [\n" \
+                       "      true,\n" \
+                       "      -1.5\n" \
+                       "    ]\n" \
+                       "  }\n" \
+                       "}";
+
+/*
+ * Encode j into every buffer size up to its length, and check the prefix.
+ */
+static int test_sizes(mln_json_t *j, mln_string_t *expect, mln_u32_t flags)
+{
+    mln_size_t size, n;
+
+    if (mln_json_encode_buf(j, NULL, 0, flags) != expect->len) return -1;
+    for (size = 0; size <= expect->len; ++size) {
+        memset(buf, 0xa5, size + 1);
+        n = mln_json_encode_buf(j, buf, size, flags);
+        if (n != expect->len || memcmp(buf, expect->data, size) || buf[size] != 0xa5) {
+            fprintf(stderr, "flags %x size %lu: %lu bytes are written wrongly\n", \
+                    (unsigned)flags, (unsigned long)size, (unsigned long)n);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Encode j into a chain after a node already there, and compare with
+ * mln_json_encode_buf.
+ */
+static int test_chain(mln_alloc_t *pool, mln_json_t *j, mln_u32_t flags)
+{
+    mln_chain_t *head = NULL, *tail = NULL, *first, *c;
+    mln_size_t len, off = 0;
+    int nbufs = 0, fail = 0;
+
+    if ((len = mln_json_encode_buf(j, buf, sizeof(buf), flags)) > sizeof(buf)) return -1;
+    if ((first = mln_chain_new(pool)) == NULL) return -1;
+    mln_chain_add(&head, &tail, first);
+    if (mln_json_encode_chain(j, pool, &head, &tail, flags) < 0) return -1;
+
+    if (head != first) fail = 1;
+    for (c = first->next; c != NULL && !fail; c = c->next, ++nbufs) {
+        if (c->buf == NULL || off + mln_buf_size(c->buf) > len || \
+            memcmp(c->buf->pos, buf + off, mln_buf_size(c->buf)) || \
+            c->buf->last_buf != (c->next == NULL) || (c->next == NULL) != (c == tail))
+        {
+            fail = 1;
+        } else {
+            off += mln_buf_size(c->buf);
+        }
+    }
+    if (fail || off != len) {
+        fprintf(stderr, "flags %x: the chain of %d bufs does not hold the %lu bytes\n", \
+                (unsigned)flags, nbufs, (unsigned long)len);
+        fail = 1;
+    }
+    mln_chain_pool_release_all(head);
+    return fail? -1: nbufs;
+}
+
+int main(void)
+{
+    char text[] = "{\"a\":[1,{\"b\":null},[],{}],\"c\":\"q\\\"\\\\\\/\",\"d\":{\"e\":[true,-1.5]}}";
+    mln_string_t in, expect, *s;
+    mln_alloc_t *pool;
+    mln_json_t j, v;
+    int i, n, fail = 0;
+
+    if ((pool = mln_alloc_init(NULL)) == NULL) return 1;
+    mln_string_nset(&in, text, strlen(text));
+    if (mln_json_decode(&in, &j) < 0) return 1;
+
+    /*compact, the same as mln_json_encode*/
+    if ((s = mln_json_encode(&j)) == NULL) return 1;
+    if (mln_string_const_strcmp(s, "{\"a\":[1,{\"b\":null},[],{}],\"c\":\"q\\\"\\\\/\",\"d\":{\"e\":[true,-1.5]}}")) {
+        fprintf(stderr, "%.*s is encoded\n", (int)s->len, (char *)s->data);
+        fail = 1;
+    }
+    if (test_sizes(&j, s, 0) < 0) fail = 1;
+    mln_string_free(s);
+
+    /*pretty*/
+    mln_string_nset(&expect, pretty, strlen(pretty));
+    if (test_sizes(&j, &expect, M_JSON_ENCODE_PRETTY) < 0) fail = 1;
+
+    /*binary forms, with the pretty flag ignored*/
+    if ((s = mln_json_cbor_encode(&j)) == NULL) return 1;
+    if (test_sizes(&j, s, M_JSON_ENCODE_CBOR) < 0 || test_sizes(&j, s, M_JSON_ENCODE_CBOR|M_JSON_ENCODE_PRETTY) < 0) fail = 1;
+    mln_string_free(s);
+    if ((s = mln_json_msgpack_encode(&j)) == NULL) return 1;
+    if (test_sizes(&j, s, M_JSON_ENCODE_MSGPACK) < 0) fail = 1;
+    mln_string_free(s);
+
+    if (test_chain(pool, &j, 0) != 1 || test_chain(pool, &j, M_JSON_ENCODE_PRETTY) != 1) fail = 1;
+    mln_json_destroy(&j);
+
+    /*more than a chain buf, and a string longer than one*/
+    if (mln_json_array_init(&j) < 0) return 1;
+    for (i = 0; i < 2000; ++i) {
+        n = snprintf(text, sizeof(text), "item-%d", i);
+        mln_string_nset(&in, text, n);
+        if ((s = mln_string_dup(&in)) == NULL) return 1;
+        mln_json_string_init(&v, s);
+        if (mln_json_array_append(&j, &v) < 0) return 1;
+    }
+    memset(buf, 'x', 10000);
+    mln_string_nset(&in, buf, 10000);
+    if ((s = mln_string_dup(&in)) == NULL) return 1;
+    mln_json_string_init(&v, s);
+    if (mln_json_array_append(&j, &v) < 0) return 1;
+    if ((n = test_chain(pool, &j, 0)) < 3 || test_chain(pool, &j, M_JSON_ENCODE_PRETTY) < 3) {
+        fprintf(stderr, "the long array is in %d bufs\n", n);
+        fail = 1;
+    }
+    mln_json_destroy(&j);
+
+    /*nothing to encode*/
+    if (mln_json_encode_buf(NULL, buf, sizeof(buf), 0) != 0) fail = 1;
+
+    mln_alloc_destroy(pool);
+    return fail? 1: 0;
+}
+
@@ -0,0 +1,175 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+/*
+ * The structural index of mln_json_decode is built 64 bytes at a time, so
+ * quotes, runs of backslashes, blanks and scalars are put at every offset
+ * across block boundaries, and documents with more tokens than the index
+ * window are decoded. Structural characters inside strings are ignored,
+ * and an escaped closing quote leaves a string unterminated.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mln_json.h"
+
+#define TEST_SIZE 65536
+
+static char doc[TEST_SIZE];
+static int doc_len;
+
+/*
+ * Append s to doc as a JSON string.
+ */
+static void test_string(const char *s)
+{
+    doc[doc_len++] = '"';
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\') doc[doc_len++] = '\\';
+        doc[doc_len++] = *s;
+    }
+    doc[doc_len++] = '"';
+}
+
+static void test_blanks(int n)
+{
+    static const char blanks[] = " \t\n\r";
+    while (n-- > 0) doc[doc_len++] = blanks[n & 3];
+}
+
+/*
+ * Decode doc and check it is [shift blanks] ["s", {"k\"ey": "s"}, 123, true, null].
+ */
+static int test_decode(int shift, const char *s)
+{
+    mln_string_t in, key = mln_string("k\"ey"), *v;
+    mln_json_t j, *e;
+    int ret = -1;
+
+    mln_string_nset(&in, doc, doc_len);
+    if (mln_json_decode(&in, &j) < 0) {
+        fprintf(stderr, "shift %d: %.*s is not decoded\n", shift, doc_len, doc);
+        return -1;
+    }
+    if (!mln_json_is_array(&j) || mln_json_array_length(&j) != 5) goto out;
+    if ((e = mln_json_array_search(&j, 0)) == NULL || !mln_json_is_string(e)) goto out;
+    v = mln_json_string_data_get(e);
+    if (v->len != strlen(s) || memcmp(v->data, s, v->len)) goto out;
+    if ((e = mln_json_array_search(&j, 1)) == NULL || (e = mln_json_obj_search(e, &key)) == NULL) goto out;
+    if (!mln_json_is_string(e) || mln_string_const_strcmp(mln_json_string_data_get(e), (char *)s)) goto out;
+    if ((e = mln_json_array_search(&j, 2)) == NULL || !mln_json_is_int(e) || mln_json_int_data_get(e) != 123) goto out;
+    if ((e = mln_json_array_search(&j, 3)) == NULL || !mln_json_is_true(e)) goto out;
+    if ((e = mln_json_array_search(&j, 4)) == NULL || !mln_json_is_null(e)) goto out;
+    ret = 0;
+out:
+    if (ret < 0) fprintf(stderr, "shift %d: %.*s is decoded wrongly\n", shift, doc_len, doc);
+    mln_json_destroy(&j);
+    return ret;
+}
+
+static int test_shifts(const char *s)
+{
+    int shift, fail = 0;
+
+    for (shift = 0; shift < 130; ++shift) {
+        doc_len = 0;
+        test_blanks(shift);
+        doc[doc_len++] = '[';
+        test_string(s);
+        doc[doc_len++] = ',';
+        test_blanks(shift % 7);
+        doc[doc_len++] = '{';
+        test_string("k\"ey");
+        doc[doc_len++] = ':';
+        test_string(s);
+        memcpy(doc + doc_len, "},123", 5);
+        doc_len += 5;
+        test_blanks(shift % 5);
+        memcpy(doc + doc_len, ",true,null]", 11);
+        doc_len += 11;
+        test_blanks(shift % 3);
+        if (test_decode(shift, s) < 0) fail = 1;
+    }
+    return fail? -1: 0;
+}
+
+/*
+ * A backslash right before the closing quote at every offset.
+ */
+static int test_unterminated(void)
+{
+    mln_string_t in;
+    mln_json_t j;
+    int shift, fail = 0;
+
+    for (shift = 0; shift < 130; ++shift) {
+        doc_len = 0;
+        test_blanks(shift);
+        memcpy(doc + doc_len, "[\"abc\\\"]", 8);
+        doc_len += 8;
+        mln_string_nset(&in, doc, doc_len);
+        if (mln_json_decode(&in, &j) == 0) {
+            fprintf(stderr, "shift %d: %.*s is decoded\n", shift, doc_len, doc);
+            mln_json_destroy(&j);
+            fail = 1;
+        }
+    }
+    return fail? -1: 0;
+}
+
+/*
+ * More tokens than the index window holds.
+ */
+static int test_many(void)
+{
+    mln_string_t in;
+    mln_json_t j, *e;
+    int i, n = 5000, fail = 0;
+
+    doc_len = 0;
+    doc[doc_len++] = '[';
+    for (i = 0; i < n; ++i) {
+        doc_len += snprintf(doc + doc_len, sizeof(doc) - doc_len, i % 3 == 0? "%d,": (i % 3 == 1? "\"%d\",": "[%d],"), i);
+    }
+    doc[doc_len - 1] = ']';
+    mln_string_nset(&in, doc, doc_len);
+    if (mln_json_decode(&in, &j) < 0) return -1;
+    if (mln_json_array_length(&j) != (mln_uauto_t)n) fail = 1;
+    for (i = 0; i < n && !fail; ++i) {
+        e = mln_json_array_search(&j, i);
+        if (i % 3 == 0) fail = !mln_json_is_int(e) || mln_json_int_data_get(e) != i;
+        else if (i % 3 == 1) fail = !mln_json_is_string(e) || atoi((char *)mln_json_string_data_get(e)->data) != i;
+        else fail = !mln_json_is_array(e) || mln_json_int_data_get(mln_json_array_search(e, 0)) != i;
+    }
+    if (fail) fprintf(stderr, "an array of %d elements is decoded wrongly\n", n);
+    mln_json_destroy(&j);
+    return fail? -1: 0;
+}
+
+int main(void)
+{
+    char s[256];
+    int i, fail = 0;
+
+    if (test_shifts("") < 0) fail = 1;
+    if (test_shifts("plain") < 0) fail = 1;
+    if (test_shifts("{[,:]} \" inside") < 0) fail = 1;
+    /*runs of backslashes, odd and even, followed by a quote*/
+    for (i = 1; i <= 9; ++i) {
+        memset(s, '\\', i);
+        strcpy(s + i, "\"x");
+        if (test_shifts(s) < 0) fail = 1;
+    }
+    /*a string longer than a block*/
+    for (i = 0; i < 150; ++i) s[i] = "ab\\\"c:,[]{}"[i % 11];
+    s[i] = 0;
+    if (test_shifts(s) < 0) fail = 1;
+
+    if (test_unterminated() < 0) fail = 1;
+    if (test_many() < 0) fail = 1;
+    return fail? 1: 0;
+}
+
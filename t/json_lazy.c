@@ -0,0 +1,170 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+/*
+ * Lazy values find members and elements past values that contain tricky
+ * strings, only check the values on the path they walk, and decode strings
+ * that need no unescaping as views into the input.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "mln_json.h"
+
+static char doc[] = " {\"skip\" : {\"a\":[1, 2, {\"b\":\"}]\\\"[{,\"}], \"s\":\"x\\\\\\\"y\"},\n" \
+                    "  \"arr\":[10, \"twenty\", [30], {\"k\" : 40}, null, true],\n" \
+                    "  \"dup\":1, \"dup\":2, \"name\":\"melon\", \"esc\":\"a\\nb\\u00e9\", \"num\":-2.5e3,\n" \
+                    "  \"bad\":[1,,2] }";
+
+/*
+ * Walk keys, and indexes for the keys being NULL, from the root.
+ */
+static int test_walk(mln_json_lazy_t *root, mln_json_lazy_t *out, char **keys, mln_uauto_t *indexes)
+{
+    mln_json_lazy_t cur = *root;
+    mln_string_t k;
+    int i;
+
+    for (i = 0; keys[i] != NULL || indexes[i] != (mln_uauto_t)-1; ++i) {
+        if (keys[i] != NULL) {
+            mln_string_nset(&k, keys[i], strlen(keys[i]));
+            if (mln_json_lazy_obj_search(&cur, &k, out) < 0) return -1;
+        } else if (mln_json_lazy_array_search(&cur, indexes[i], out) < 0) {
+            return -1;
+        }
+        cur = *out;
+    }
+    return 0;
+}
+
+static int test_string(mln_json_lazy_t *root, mln_alloc_t *pool, char *key, char *expect, int view)
+{
+    char *keys[] = {key, NULL};
+    mln_uauto_t indexes[] = {0, (mln_uauto_t)-1};
+    mln_json_lazy_t v;
+    mln_json_t j;
+    mln_string_t *s;
+    int inside, ret = 0;
+
+    if (test_walk(root, &v, keys, indexes) < 0 || mln_json_lazy_type(&v) != M_JSON_STRING || \
+        mln_json_lazy_decode(&v, pool, &j) < 0)
+    {
+        fprintf(stderr, "\"%s\" is not found\n", key);
+        return -1;
+    }
+    s = mln_json_string_data_get(&j);
+    inside = s->data >= (mln_u8ptr_t)doc && s->data < (mln_u8ptr_t)doc + sizeof(doc);
+    if (mln_string_const_strcmp(s, expect) || inside != view) {
+        fprintf(stderr, "\"%s\" is decoded to \"%.*s\", view %d\n", key, (int)s->len, (char *)s->data, inside);
+        ret = -1;
+    }
+    mln_json_destroy(&j);
+    return ret;
+}
+
+int main(void)
+{
+    char *k_arr_k[] = {"arr", NULL, "k", NULL}, *k_arr_2_0[] = {"arr", NULL, NULL, NULL};
+    char *k_dup[] = {"dup", NULL}, *k_num[] = {"num", NULL}, *k_skip_s[] = {"skip", "s", NULL};
+    char *k_arr[] = {"arr", NULL, NULL}, *k_missing[] = {"missing", NULL}, *k_bad[] = {"bad", NULL, NULL};
+    char *k_name_0[] = {"name", NULL, NULL};
+    mln_uauto_t i_arr_k[] = {0, 3, 0, (mln_uauto_t)-1}, i_arr_2_0[] = {0, 2, 0, (mln_uauto_t)-1};
+    mln_uauto_t i_one[] = {0, (mln_uauto_t)-1}, i_skip_s[] = {0, 0, (mln_uauto_t)-1};
+    mln_uauto_t i_arr_6[] = {0, 6, (mln_uauto_t)-1}, i_arr_5[] = {0, 5, (mln_uauto_t)-1};
+    mln_uauto_t i_bad_2[] = {0, 2, (mln_uauto_t)-1}, i_bad_0[] = {0, 0, (mln_uauto_t)-1};
+    mln_string_t in = mln_string(doc), scalar = mln_string(" 123 ");
+    mln_json_lazy_t root, v;
+    mln_alloc_t *pool;
+    mln_json_t j, whole;
+    mln_string_t *a, *b;
+    int fail = 0;
+
+    if ((pool = mln_alloc_init(NULL)) == NULL) return 1;
+    if (mln_json_lazy_init(&root, &in) < 0 || mln_json_lazy_type(&root) != M_JSON_OBJECT) return 1;
+    if (mln_json_lazy_init(&v, &scalar) == 0) {
+        fprintf(stderr, "a lazy value is made of a scalar\n");
+        fail = 1;
+    }
+
+    /*past a value holding "}]\"[{," in strings*/
+    if (test_walk(&root, &v, k_arr_k, i_arr_k) < 0 || mln_json_lazy_type(&v) != M_JSON_NUM || \
+        mln_json_lazy_decode(&v, NULL, &j) < 0 || mln_json_number_data_get(&j) != 40)
+    {
+        fprintf(stderr, "arr[3].k is not 40\n");
+        fail = 1;
+    }
+    if (test_walk(&root, &v, k_arr_2_0, i_arr_2_0) < 0 || mln_json_lazy_decode(&v, NULL, &j) < 0 || \
+        mln_json_number_data_get(&j) != 30)
+    {
+        fprintf(stderr, "arr[2][0] is not 30\n");
+        fail = 1;
+    }
+    if (test_walk(&root, &v, k_arr, i_arr_5) < 0 || mln_json_lazy_type(&v) != M_JSON_TRUE) {
+        fprintf(stderr, "arr[5] is not true\n");
+        fail = 1;
+    }
+    /*the first one of duplicated keys*/
+    if (test_walk(&root, &v, k_dup, i_one) < 0 || mln_json_lazy_decode(&v, NULL, &j) < 0 || \
+        mln_json_number_data_get(&j) != 1)
+    {
+        fprintf(stderr, "dup is not 1\n");
+        fail = 1;
+    }
+    if (test_walk(&root, &v, k_num, i_one) < 0 || mln_json_lazy_decode(&v, NULL, &j) < 0 || \
+        mln_json_number_data_get(&j) != -2500)
+    {
+        fprintf(stderr, "num is not -2500\n");
+        fail = 1;
+    }
+
+    /*views into the input, and unescaped copies*/
+    fail |= test_string(&root, NULL, "name", "melon", 1);
+    fail |= test_string(&root, pool, "name", "melon", 1);
+    fail |= test_string(&root, NULL, "esc", "a\nb\xc3\xa9", 0);
+    fail |= test_string(&root, pool, "esc", "a\nb\xc3\xa9", 0);
+    if (test_walk(&root, &v, k_skip_s, i_skip_s) < 0 || mln_json_lazy_decode(&v, pool, &j) < 0 || \
+        mln_string_const_strcmp(mln_json_string_data_get(&j), "x\\\"y"))
+    {
+        fprintf(stderr, "skip.s is decoded wrongly\n");
+        fail = 1;
+    }
+    mln_json_destroy(&j);
+
+    /*missing, out of range, wrong types*/
+    if (test_walk(&root, &v, k_missing, i_one) == 0 || test_walk(&root, &v, k_arr, i_arr_6) == 0 || \
+        test_walk(&root, &v, k_name_0, i_bad_0) == 0)
+    {
+        fprintf(stderr, "a value that does not exist is found\n");
+        fail = 1;
+    }
+    /*a malformed value is only found out when it is walked*/
+    if (test_walk(&root, &v, k_bad, i_bad_0) < 0 || test_walk(&root, &v, k_bad, i_bad_2) == 0) {
+        fprintf(stderr, "the malformed array is walked wrongly\n");
+        fail = 1;
+    }
+
+    /*a sub-tree is decoded like mln_json_decode*/
+    if (test_walk(&root, &v, k_arr, i_one) < 0 || mln_json_lazy_decode(&v, pool, &j) < 0) {
+        fprintf(stderr, "arr is not decoded\n");
+        fail = 1;
+    } else {
+        mln_string_t arr = mln_string("[10, \"twenty\", [30], {\"k\" : 40}, null, true]");
+        if (mln_json_decode(&arr, &whole) < 0) return 1;
+        a = mln_json_encode(&j);
+        b = mln_json_encode(&whole);
+        if (a == NULL || b == NULL || mln_string_strcmp(a, b) || mln_json_array_data_get(&j)->pool != pool) {
+            fprintf(stderr, "arr is decoded wrongly\n");
+            fail = 1;
+        }
+        if (a != NULL) mln_string_free(a);
+        if (b != NULL) mln_string_free(b);
+        mln_json_destroy(&whole);
+        mln_json_destroy(&j);
+    }
+
+    mln_alloc_destroy(pool);
+    return fail? 1: 0;
+}
+
@@ -0,0 +1,128 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+/*
+ * Numbers written by mln_json_encode read back to the same double, including
+ * -0 and the cases where Grisu2 does not give the shortest form. Numbers built
+ * by hand without mln_json_number_init are doubles.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "mln_json.h"
+
+static int test_number(double d, const char *text)
+{
+    mln_json_t j, out, *v;
+    mln_string_t *s, in;
+    char buf[64];
+    double r;
+    int ret = -1;
+
+    mln_json_number_init(&j, d);
+    if ((s = mln_json_encode(&j)) == NULL) {
+        fprintf(stderr, "encode %s failed\n", text);
+        return -1;
+    }
+    if (s->len != strlen(text) || memcmp(s->data, text, s->len)) {
+        fprintf(stderr, "%s is encoded as %.*s\n", text, (int)s->len, (char *)s->data);
+        mln_string_free(s);
+        return -1;
+    }
+    mln_string_free(s);
+
+    /*a scalar is not decoded at the top level*/
+    snprintf(buf, sizeof(buf), "[%s]", text);
+    mln_string_nset(&in, buf, strlen(buf));
+    if (mln_json_decode(&in, &out) < 0) {
+        fprintf(stderr, "decode %s failed\n", buf);
+        return -1;
+    }
+    v = mln_json_array_search(&out, 0);
+    if (v == NULL || !mln_json_is_number(v)) {
+        fprintf(stderr, "%s is not decoded as a number\n", text);
+        goto out;
+    }
+    r = mln_json_number_data_get(v);
+    if (r != d || !signbit(r) != !signbit(d)) {
+        fprintf(stderr, "%s is decoded as %.17g\n", text, r);
+        goto out;
+    }
+    ret = 0;
+
+out:
+    mln_json_destroy(&out);
+    return ret;
+}
+
+static int test_encoded(mln_json_t *j, const char *text)
+{
+    mln_string_t *s;
+    int ret = 0;
+
+    if ((s = mln_json_encode(j)) == NULL) {
+        fprintf(stderr, "encode %s failed\n", text);
+        return -1;
+    }
+    if (s->len != strlen(text) || memcmp(s->data, text, s->len)) {
+        fprintf(stderr, "%s is encoded as %.*s\n", text, (int)s->len, (char *)s->data);
+        ret = -1;
+    }
+    mln_string_free(s);
+    return ret;
+}
+
+static int test_hand_built(void)
+{
+    mln_json_t j;
+    int fail = 0;
+
+    /*the type is set, then the value*/
+    memset(&j, 0xff, sizeof(j));
+    mln_json_number_type_set(&j);
+    j.data.m_j_number = 2.5;
+    fail |= test_encoded(&j, "2.5");
+
+    /*initialized, then the fields are set*/
+    memset(&j, 0xff, sizeof(j));
+    mln_json_init(&j);
+    j.type = M_JSON_NUM;
+    j.data.m_j_number = -4.25;
+    fail |= test_encoded(&j, "-4.25");
+
+    /*zero filled*/
+    memset(&j, 0, sizeof(j));
+    j.type = M_JSON_NUM;
+    j.data.m_j_number = 1e100;
+    fail |= test_encoded(&j, "1e100");
+
+    /*the setter replaces an integer*/
+    mln_json_int_init(&j, 7);
+    mln_json_number_data_set(&j, 0.5);
+    if (mln_json_is_int(&j) || mln_json_number_data_get(&j) != 0.5) {
+        fprintf(stderr, "the number is not set to 0.5\n");
+        fail = 1;
+    }
+    fail |= test_encoded(&j, "0.5");
+
+    return fail? -1: 0;
+}
+
+int main(void)
+{
+    int fail = 0;
+
+    fail |= test_number(0.0, "0");
+    fail |= test_number(-0.0, "-0");
+    fail |= test_number(0.1, "0.1");
+    fail |= test_number(-1.5, "-1.5");
+    fail |= test_number(1e23, "9.999999999999999e22");
+    fail |= test_number(5e-324, "5e-324");
+    fail |= test_number(1.7976931348623157e308, "1.7976931348623157e308");
+    fail |= test_hand_built();
+
+    return fail? 1: 0;
+}
@@ -0,0 +1,108 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+/*
+ * Members of an indexed object are still found, in insertion order, after
+ * members are removed from any position.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "mln_json.h"
+
+#define NR_MEMBER 300
+
+static int test_add(mln_json_t *j, int i)
+{
+    mln_json_t k, v;
+    mln_string_t s;
+    char buf[32];
+
+    snprintf(buf, sizeof(buf), "key%d", i);
+    mln_string_nset(&s, buf, strlen(buf));
+    if (mln_json_string_init(&k, mln_string_dup(&s)) < 0) return -1;
+    mln_json_number_init(&v, i);
+    return mln_json_obj_update(j, &k, &v);
+}
+
+/*
+ * order holds the members expected, in insertion order.
+ */
+static int test_check(mln_json_t *j, const int *order, int n)
+{
+    mln_array_t *kvs = &(mln_json_object_data_get(j)->kvs);
+    char present[NR_MEMBER];
+    mln_json_kv_t *kv;
+    mln_json_t *v;
+    mln_string_t s;
+    char buf[32];
+    int i;
+
+    if (mln_array_nelts(kvs) != (mln_size_t)n) {
+        fprintf(stderr, "%d members, %d expected\n", (int)mln_array_nelts(kvs), n);
+        return -1;
+    }
+    memset(present, 0, sizeof(present));
+    for (i = 0; i < n; ++i) {
+        kv = &((mln_json_kv_t *)mln_array_elts(kvs))[i];
+        if (mln_json_number_data_get(&(kv->val)) != order[i]) {
+            fprintf(stderr, "member %d is out of order\n", i);
+            return -1;
+        }
+        present[order[i]] = 1;
+    }
+
+    for (i = 0; i < NR_MEMBER; ++i) {
+        snprintf(buf, sizeof(buf), "key%d", i);
+        mln_string_nset(&s, buf, strlen(buf));
+        v = mln_json_obj_search(j, &s);
+        if ((v != NULL) != present[i] || (v != NULL && mln_json_number_data_get(v) != i)) {
+            fprintf(stderr, "%s is %s\n", buf, v == NULL? "missing": "wrong");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main(void)
+{
+    int order[NR_MEMBER], n, i, k, m;
+    mln_string_t s;
+    mln_json_t j;
+    char buf[32];
+
+    if (mln_json_obj_init(&j) < 0) return 1;
+    for (n = 0; n < NR_MEMBER; ++n) {
+        if (test_add(&j, n) < 0) return 1;
+        order[n] = n;
+    }
+
+    for (k = 0; k < NR_MEMBER; ++k) {
+        i = (k * 7919) % NR_MEMBER;
+        snprintf(buf, sizeof(buf), "key%d", i);
+        mln_string_nset(&s, buf, strlen(buf));
+        mln_json_obj_remove(&j, &s);
+        for (m = 0; m < n && order[m] != i; ++m)
+            ;
+        if (m < n) {
+            memmove(&order[m], &order[m + 1], (n - m - 1) * sizeof(int));
+            --n;
+        }
+        if (k % 10 == 0 && test_check(&j, order, n) < 0) goto err;
+        /*put some back to the end to make the clusters longer*/
+        if (k % 3 == 0) {
+            if (test_add(&j, i) < 0) goto err;
+            order[n++] = i;
+        }
+    }
+    if (test_check(&j, order, n) < 0) goto err;
+
+    mln_json_destroy(&j);
+    return 0;
+
+err:
+    mln_json_destroy(&j);
+    return 1;
+}
@@ -0,0 +1,80 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+/*
+ * A path walking a deeply nested document fails instead of running out of
+ * stack, and documents within the limit are still searched.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mln_json.h"
+
+/*
+ * depth arrays with {"x":1} in the innermost one.
+ */
+static char *test_nested(int depth, mln_string_t *out)
+{
+    char *buf, *p;
+    int i;
+
+    if ((p = buf = (char *)malloc(depth * 2 + 8)) == NULL) return NULL;
+    for (i = 0; i < depth; ++i) *p++ = '[';
+    memcpy(p, "{\"x\":1}", 7);
+    p += 7;
+    for (i = 0; i < depth; ++i) *p++ = ']';
+    mln_string_nset(out, buf, p - buf);
+    return buf;
+}
+
+/*
+ * tree is not set for documents too deep to be decoded.
+ */
+static int test_depth(mln_json_path_t *path, int depth, int tree, int expect)
+{
+    mln_string_t text;
+    mln_json_t j;
+    char *buf;
+    int n, ret = 0;
+
+    if ((buf = test_nested(depth, &text)) == NULL) return -1;
+
+    if ((n = mln_json_path_decode(path, NULL, &text, NULL, NULL)) != expect) {
+        fprintf(stderr, "mln_json_path_decode on %d levels returns %d\n", depth, n);
+        ret = -1;
+    }
+    if (tree) {
+        if (mln_json_decode(&text, &j) < 0) {
+            fprintf(stderr, "decode %d levels failed\n", depth);
+            free(buf);
+            return -1;
+        }
+        if ((n = mln_json_path_search(path, &j, NULL, NULL)) != expect) {
+            fprintf(stderr, "mln_json_path_search on %d levels returns %d\n", depth, n);
+            ret = -1;
+        }
+        mln_json_destroy(&j);
+    }
+
+    free(buf);
+    return ret;
+}
+
+int main(void)
+{
+    mln_string_t exp = mln_string("$..x");
+    mln_json_path_t *path;
+    int fail = 0;
+
+    if ((path = mln_json_path_compile(&exp)) == NULL) return 1;
+
+    fail |= test_depth(path, 100, 1, 1);
+    fail |= test_depth(path, 2000, 1, -1);
+    fail |= test_depth(path, 200000, 0, -1);
+
+    mln_json_path_free(path);
+    return fail? 1: 0;
+}
@@ -0,0 +1,138 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+/*
+ * mln_json_pool_decode builds the same tree as mln_json_decode, with every
+ * object, array and string in the pool, so the document can be dropped
+ * with the pool. A pool-backed tree also grows from the pool, and can
+ * still be released by mln_json_destroy.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "mln_json.h"
+
+/*
+ * Check val, and key if any, live in the pool data.
+ */
+static int test_in_pool(mln_json_t *key, mln_json_t *val, void *data)
+{
+    mln_alloc_t *pool = (mln_alloc_t *)data;
+    mln_json_t *elem, *end;
+
+    if (key != NULL && !mln_json_string_data_get(key)->pool) return -1;
+    switch (val->type) {
+        case M_JSON_OBJECT:
+            if (mln_json_object_data_get(val)->kvs.pool != pool) return -1;
+            return mln_json_object_iterate(val, test_in_pool, pool);
+        case M_JSON_ARRAY:
+            if (mln_json_array_data_get(val)->pool != pool) return -1;
+            elem = (mln_json_t *)mln_array_elts(mln_json_array_data_get(val));
+            end = elem + mln_array_nelts(mln_json_array_data_get(val));
+            for (; elem < end; ++elem) {
+                if (test_in_pool(NULL, elem, pool) < 0) return -1;
+            }
+            return 0;
+        case M_JSON_STRING:
+            return mln_json_string_data_get(val)->pool? 0: -1;
+        default:
+            return 0;
+    }
+}
+
+/*
+ * Decode text in both ways and compare their encodings.
+ */
+static int test_decode(mln_alloc_t *pool, char *text, mln_json_t *out)
+{
+    mln_string_t in, *a, *b;
+    mln_json_t j;
+    int ret = -1;
+
+    mln_string_nset(&in, text, strlen(text));
+    if (mln_json_decode(&in, &j) < 0) return -1;
+    if (mln_json_pool_decode(pool, &in, out) < 0) {
+        fprintf(stderr, "pool decode failed: %s\n", text);
+        mln_json_destroy(&j);
+        return -1;
+    }
+    a = mln_json_encode(&j);
+    b = mln_json_encode(out);
+    if (a == NULL || b == NULL || mln_string_strcmp(a, b)) {
+        fprintf(stderr, "%s is decoded to %.*s from the pool\n", \
+                text, b == NULL? 0: (int)b->len, b == NULL? "": (char *)b->data);
+    } else if (test_in_pool(NULL, out, pool) < 0) {
+        fprintf(stderr, "not all of %s is in the pool\n", text);
+    } else {
+        ret = 0;
+    }
+    if (a != NULL) mln_string_free(a);
+    if (b != NULL) mln_string_free(b);
+    mln_json_destroy(&j);
+    return ret;
+}
+
+int main(void)
+{
+    char doc[4096];
+    char *bad[] = {"{\"a\":[1,2,{\"b\":\"x\"}", "[\"abc]", "{\"a\" 1}", "[1,2]]", NULL};
+    mln_string_t in, *s;
+    mln_alloc_t *pool;
+    mln_json_t j, k, v, *p;
+    int i, n, fail = 0;
+
+    /*more members than M_JSON_OBJ_SMALL, so the object is indexed*/
+    n = snprintf(doc, sizeof(doc), "{\"name\":\"melon\",\"esc\":\"tab\\there \\\"q\\\" \\u00e9\\ud83d\\ude00\"," \
+                 "\"nums\":[0,-1,1.5,1e300,18446744073709551615],\"flags\":[true,false,null],\"empty\":{},\"list\":[]");
+    for (i = 0; i < 20; ++i) {
+        n += snprintf(doc + n, sizeof(doc) - n, ",\"k%d\":{\"v\":[%d,\"s%d\",{\"deep\":[[\"x\"]]}]}", i, i, i);
+    }
+    snprintf(doc + n, sizeof(doc) - n, "}");
+
+    /*the document is dropped with the pool, nothing is left in malloc*/
+    if ((pool = mln_alloc_init(NULL)) == NULL) return 1;
+    if (test_decode(pool, doc, &j) < 0) fail = 1;
+    if (test_decode(pool, "[\"a\",[],{},[[{\"x\":\"y\"}]]]", &v) < 0) fail = 1;
+    mln_alloc_destroy(pool);
+
+    /*grow it from the pool, and release it with mln_json_destroy*/
+    if ((pool = mln_alloc_init(NULL)) == NULL) return 1;
+    if (test_decode(pool, doc, &j) < 0) fail = 1;
+    for (i = 0; i < 40; ++i) {
+        snprintf(doc, sizeof(doc), "added%d", i);
+        if ((s = mln_string_pool_new(pool, doc)) == NULL) return 1;
+        mln_json_string_init(&k, s);
+        mln_json_int_init(&v, i);
+        if (mln_json_obj_update(&j, &k, &v) < 0) return 1;
+        mln_string_nset(&in, "nums", 4);
+        if ((p = mln_json_obj_search(&j, &in)) == NULL || mln_json_array_append(p, &v) < 0) return 1;
+    }
+    if (test_in_pool(NULL, &j, pool) < 0) {
+        fprintf(stderr, "the tree does not grow from the pool\n");
+        fail = 1;
+    }
+    mln_string_nset(&in, "added39", 7);
+    p = mln_json_obj_search(&j, &in);
+    mln_string_nset(&in, "nums", 4);
+    if (p == NULL || mln_json_int_data_get(p) != 39 || mln_json_array_length(mln_json_obj_search(&j, &in)) != 45) {
+        fprintf(stderr, "the members added to a pool-backed tree are lost\n");
+        fail = 1;
+    }
+    mln_json_destroy(&j);
+
+    /*malformed input*/
+    for (i = 0; bad[i] != NULL; ++i) {
+        mln_string_nset(&in, bad[i], strlen(bad[i]));
+        if (mln_json_pool_decode(pool, &in, &j) == 0) {
+            fprintf(stderr, "%s is decoded\n", bad[i]);
+            mln_json_destroy(&j);
+            fail = 1;
+        }
+    }
+    mln_alloc_destroy(pool);
+
+    return fail? 1: 0;
+}
+
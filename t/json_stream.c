@@ -0,0 +1,176 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+/*
+ * The push parser is fed documents split at every offset, so strings,
+ * escapes, \u surrogate pairs, numbers and literals are cut between chunks,
+ * and it must build the same trees as mln_json_decode. Back to back
+ * documents are returned one per call, with the rest kept in the chain.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "mln_json.h"
+
+static char *docs[] = {
+    "{\"name\":\"melon\",\"esc\":\"tab\\there \\\"q\\\" \\\\ \\/ \\u00e9\\ud83d\\ude00\"," \
+    "\"nums\":[0,-1,1.5,-12.5e-3,1E+300,18446744073709551615],\"flags\":[true,false,null]," \
+    "\"empty\":{},\"list\":[ ],\"deep\":[[[[[[[[[[[[{\"x\":[[[\"y\"]]]}]]]]]]]]]]]]," \
+    "\"long\":\"0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz\"}",
+    " \r\n\t[1, \"two\", {\"three\" : 3}]",
+    "\n[]",
+    NULL
+};
+
+static char *bad[] = {"[1,,2]", "{\"a\" 1}", "[tru]", "[\"\\x\"]", "]", "[1}", "{1:2}", "[01]", "[1 2]", NULL};
+
+static char text[4096];
+static mln_size_t text_len;
+
+/*
+ * A chain of temporary bufs over text[off, off+len), piece bytes each.
+ */
+static mln_chain_t *test_split(mln_alloc_t *pool, mln_size_t off, mln_size_t len, mln_size_t piece)
+{
+    mln_chain_t *head = NULL, *tail = NULL, *c;
+    mln_size_t n;
+
+    for (; len > 0; off += n, len -= n) {
+        n = len < piece? len: piece;
+        if ((c = mln_chain_new(pool)) == NULL) return NULL;
+        if ((c->buf = mln_buf_new(pool)) == NULL) return NULL;
+        c->buf->left_pos = c->buf->pos = c->buf->start = (mln_u8ptr_t)text + off;
+        c->buf->last = c->buf->end = (mln_u8ptr_t)text + off + n;
+        c->buf->in_memory = 1;
+        c->buf->temporary = 1;
+        mln_chain_add(&head, &tail, c);
+    }
+    return head;
+}
+
+/*
+ * Check out is docs[i], and the containers are in the pool of the stream.
+ */
+static int test_check(mln_json_t *out, int i, mln_alloc_t *pool)
+{
+    mln_string_t in, *a, *b;
+    mln_json_t j;
+    int ret = 0;
+
+    mln_string_nset(&in, docs[i], strlen(docs[i]));
+    if (mln_json_decode(&in, &j) < 0) return -1;
+    a = mln_json_encode(&j);
+    b = mln_json_encode(out);
+    if (a == NULL || b == NULL || mln_string_strcmp(a, b)) ret = -1;
+    if (mln_json_is_array(out) && mln_json_array_data_get(out)->pool != pool) ret = -1;
+    if (mln_json_is_object(out) && mln_json_object_data_get(out)->kvs.pool != pool) ret = -1;
+    if (a != NULL) mln_string_free(a);
+    if (b != NULL) mln_string_free(b);
+    mln_json_destroy(&j);
+    mln_json_destroy(out);
+    return ret;
+}
+
+/*
+ * Feed text piece bytes a call, or all pieces in one chain if whole is set.
+ */
+static int test_feed(mln_alloc_t *pool, mln_alloc_t *spool, mln_size_t piece, int whole)
+{
+    mln_json_stream_t s;
+    mln_chain_t *in = NULL;
+    mln_json_t out;
+    mln_size_t off = 0, len;
+    int rc, n = 0, fail = 0;
+
+    if (mln_json_stream_init(&s, spool) < 0) return -1;
+    while (!fail && (in != NULL || off < text_len)) {
+        if (in == NULL) {
+            len = whole || text_len - off < piece? text_len - off: piece;
+            if ((in = test_split(pool, off, len, piece)) == NULL) return -1;
+            off += len;
+        }
+        rc = mln_json_stream_parse(&s, &in, &out);
+        if (rc == M_JSON_STREAM_DONE) {
+            if (docs[n] == NULL || test_check(&out, n, spool) < 0) fail = 1;
+            else ++n;
+        } else if (rc != M_JSON_STREAM_NOTYET || in != NULL) {
+            fail = 1;
+        }
+    }
+    if (docs[n] != NULL) fail = 1;
+    if (fail) fprintf(stderr, "piece %lu whole %d pool %d: document %d is parsed wrongly\n", \
+                      (unsigned long)piece, whole, spool != NULL, n);
+    mln_chain_pool_release_all(in);
+    mln_json_stream_destroy(&s);
+    return fail? -1: 0;
+}
+
+/*
+ * Malformed documents fail split at every offset, and the parser stays failed.
+ */
+static int test_bad(mln_alloc_t *pool, char *doc)
+{
+    mln_json_stream_t s;
+    mln_chain_t *in;
+    mln_json_t out;
+    mln_size_t piece, off, n;
+    int rc = M_JSON_STREAM_NOTYET, fail = 0;
+
+    text_len = strlen(doc);
+    memcpy(text, doc, text_len);
+    for (piece = 1; piece <= text_len; ++piece) {
+        if (mln_json_stream_init(&s, NULL) < 0) return -1;
+        for (off = 0; off < text_len; off += n) {
+            n = text_len - off < piece? text_len - off: piece;
+            if ((in = test_split(pool, off, n, piece)) == NULL) return -1;
+            rc = mln_json_stream_parse(&s, &in, &out);
+            mln_chain_pool_release_all(in);
+            if (rc != M_JSON_STREAM_NOTYET) break;
+        }
+        if (rc != M_JSON_STREAM_ERROR) {
+            fprintf(stderr, "piece %lu: %s returns %d\n", (unsigned long)piece, doc, rc);
+            if (rc == M_JSON_STREAM_DONE) mln_json_destroy(&out);
+            fail = 1;
+        } else {
+            if ((in = test_split(pool, 0, text_len, text_len)) == NULL) return -1;
+            if (mln_json_stream_parse(&s, &in, &out) != M_JSON_STREAM_ERROR) {
+                fprintf(stderr, "%s: the parser goes on after an error\n", doc);
+                fail = 1;
+            }
+            mln_chain_pool_release_all(in);
+        }
+        mln_json_stream_destroy(&s);
+    }
+    return fail? -1: 0;
+}
+
+int main(void)
+{
+    mln_alloc_t *pool, *spool;
+    mln_size_t piece;
+    int i, fail = 0;
+
+    if ((pool = mln_alloc_init(NULL)) == NULL) return 1;
+    if ((spool = mln_alloc_init(NULL)) == NULL) return 1;
+
+    for (text_len = 0, i = 0; docs[i] != NULL; ++i) {
+        memcpy(text + text_len, docs[i], strlen(docs[i]));
+        text_len += strlen(docs[i]);
+    }
+    for (piece = 1; piece <= text_len; ++piece) {
+        if (test_feed(pool, NULL, piece, 0) < 0) fail = 1;
+        if (test_feed(pool, spool, piece, 0) < 0) fail = 1;
+        if (test_feed(pool, NULL, piece, 1) < 0) fail = 1;
+    }
+
+    for (i = 0; bad[i] != NULL; ++i) {
+        if (test_bad(pool, bad[i]) < 0) fail = 1;
+    }
+
+    mln_alloc_destroy(spool);
+    mln_alloc_destroy(pool);
+    return fail? 1: 0;
+}
+
@@ -0,0 +1,197 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+/*
+ * A broadcast frame is encoded once and appended to many connections by
+ * reference: every queued buf points to the same data, holds one reference
+ * and drops it when its chain is released, sent or not, and the frame is
+ * freed with the last reference.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "mln_websocket.h"
+
+#define NR_CONN  8
+#define TEST_LEN 70000
+
+static int test_frame(mln_buf_shared_t *frame, mln_u8_t b1, mln_u8ptr_t payload, mln_size_t len)
+{
+    mln_u8ptr_t p = frame->data;
+    mln_size_t hlen = len < 126? 2: (len <= 0xffff? 4: 10);
+
+    if (frame->size != hlen + len || p[0] != b1 || (p[1] & 0x80)) return -1;
+    if (len < 126 && p[1] != len) return -1;
+    if (len >= 126 && len <= 0xffff && (p[1] != 126 || p[2] != (len >> 8) || p[3] != (len & 0xff))) return -1;
+    if (len > 0xffff && p[1] != 127) return -1;
+    return len && memcmp(p + hlen, payload, len)? -1: 0;
+}
+
+/*
+ * Queue frame on NR_CONN connections and release them one by one.
+ */
+static int test_fanout(mln_buf_shared_t *frame)
+{
+    mln_tcp_conn_t tcs[NR_CONN];
+    mln_chain_t *c;
+    int i, fail = 0;
+
+    for (i = 0; i < NR_CONN; ++i) {
+        if (mln_tcp_conn_init(&tcs[i], -1) < 0) return -1;
+        /*twice on every connection*/
+        if (mln_websocket_broadcast_append(&tcs[i], frame) != M_WS_RET_OK) return -1;
+        if (mln_websocket_broadcast_append(&tcs[i], frame) != M_WS_RET_OK) return -1;
+    }
+    if (frame->refs != 1 + 2 * NR_CONN) {
+        fprintf(stderr, "%u references after appending\n", frame->refs);
+        fail = 1;
+    }
+    for (i = 0; i < NR_CONN; ++i) {
+        for (c = mln_tcp_conn_head(&tcs[i], M_C_SEND); c != NULL; c = c->next) {
+            if (c->buf->shared != frame || c->buf->pos != frame->data || \
+                c->buf->last != frame->data + frame->size || !c->buf->last_in_chain)
+            {
+                fprintf(stderr, "connection %d does not refer to the frame\n", i);
+                fail = 1;
+            }
+        }
+    }
+
+    /*the send queue is released by a connection*/
+    for (i = 0; i < NR_CONN / 2; ++i) {
+        mln_tcp_conn_destroy(&tcs[i]);
+    }
+    if (frame->refs != 1 + NR_CONN) {
+        fprintf(stderr, "%u references after destroying connections\n", frame->refs);
+        fail = 1;
+    }
+    /*or taken out and released by the caller*/
+    for (; i < NR_CONN; ++i) {
+        mln_chain_pool_release_all(mln_tcp_conn_remove(&tcs[i], M_C_SEND));
+        mln_tcp_conn_destroy(&tcs[i]);
+    }
+    if (frame->refs != 1) {
+        fprintf(stderr, "%u references after releasing all chains\n", frame->refs);
+        fail = 1;
+    }
+    return fail? -1: 0;
+}
+
+/*
+ * The frame is sent through a socket, and parsed by a client.
+ */
+static int test_send(mln_buf_shared_t *frame, mln_u8ptr_t payload, mln_size_t len)
+{
+    mln_tcp_conn_t tcs, tcc;
+    mln_http_t *http;
+    mln_websocket_t *ws;
+    mln_chain_t *in;
+    mln_buf_shared_t *copy;
+    mln_u8_t buf[256];
+    ssize_t n;
+    int fds[2], ret, fail = 0;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) return -1;
+    if (mln_tcp_conn_init(&tcs, fds[0]) < 0 || mln_tcp_conn_init(&tcc, fds[1]) < 0) return -1;
+    if (mln_websocket_broadcast_append(&tcs, frame) != M_WS_RET_OK) return -1;
+    if ((ret = mln_tcp_conn_send(&tcs)) != M_C_FINISH || !mln_tcp_conn_send_empty(&tcs)) {
+        fprintf(stderr, "send returns %d\n", ret);
+        fail = 1;
+    }
+    /*the sent chain still refers to the frame until it is released*/
+    if (frame->refs != 2) {
+        fprintf(stderr, "%u references after sending\n", frame->refs);
+        fail = 1;
+    }
+    mln_chain_pool_release_all(mln_tcp_conn_remove(&tcs, M_C_SENT));
+    if (frame->refs != 1) {
+        fprintf(stderr, "%u references after releasing the sent chain\n", frame->refs);
+        fail = 1;
+    }
+
+    if ((n = read(fds[1], buf, sizeof(buf))) != (ssize_t)frame->size || memcmp(buf, frame->data, n)) {
+        fprintf(stderr, "%ld bytes are received\n", (long)n);
+        fail = 1;
+    }
+
+    /*a client parses it from a buf referring to a copy*/
+    if ((http = mln_http_init(&tcc, NULL, NULL)) == NULL) return -1;
+    if ((ws = mln_websocket_new(http)) == NULL) return -1;
+    if ((copy = mln_buf_shared_new(n)) == NULL) return -1;
+    memcpy(copy->data, buf, n);
+    if ((in = mln_chain_shared_new(mln_tcp_conn_pool_get(&tcc), copy)) == NULL) return -1;
+    mln_buf_shared_free(copy);
+    if (mln_websocket_parse(ws, &in) != M_WS_RET_OK || \
+        mln_websocket_get_opcode(ws) != M_WS_OPCODE_TEXT || \
+        mln_websocket_get_content_len(ws) != len || \
+        memcmp(mln_websocket_get_content(ws), payload, len))
+    {
+        fprintf(stderr, "the frame is parsed wrongly\n");
+        fail = 1;
+    }
+    mln_chain_pool_release_all(in);
+    mln_websocket_free(ws);
+    mln_http_destroy(http);
+
+    mln_tcp_conn_destroy(&tcs);
+    mln_tcp_conn_destroy(&tcc);
+    close(fds[0]);
+    close(fds[1]);
+    return fail? -1: 0;
+}
+
+int main(void)
+{
+    char text[] = "hello, subscribers";
+    static mln_u8_t big[TEST_LEN];
+    mln_buf_shared_t *frame;
+    mln_size_t i;
+    int fail = 0;
+
+    for (i = 0; i < sizeof(big); ++i) big[i] = (mln_u8_t)(i * 7);
+
+    if ((frame = mln_websocket_broadcast_generate(M_WS_OPCODE_TEXT, text, strlen(text), M_WS_FLAG_NEW|M_WS_FLAG_END)) == NULL)
+        return 1;
+    if (test_frame(frame, 0x80|M_WS_OPCODE_TEXT, (mln_u8ptr_t)text, strlen(text)) < 0) {
+        fprintf(stderr, "the text frame is encoded wrongly\n");
+        fail = 1;
+    }
+    if (test_fanout(frame) < 0) fail = 1;
+    if (test_send(frame, (mln_u8ptr_t)text, strlen(text)) < 0) fail = 1;
+    mln_buf_shared_free(frame);
+
+    /*extended lengths, and a fragment that is not final*/
+    if ((frame = mln_websocket_broadcast_generate(M_WS_OPCODE_BINARY, big, 1000, M_WS_FLAG_NEW)) == NULL) return 1;
+    if (test_frame(frame, M_WS_OPCODE_BINARY, big, 1000) < 0) {
+        fprintf(stderr, "the 1000-byte frame is encoded wrongly\n");
+        fail = 1;
+    }
+    mln_buf_shared_free(frame);
+    if ((frame = mln_websocket_broadcast_generate(M_WS_OPCODE_BINARY, big, TEST_LEN, M_WS_FLAG_END)) == NULL) return 1;
+    if (test_frame(frame, 0x80|M_WS_OPCODE_CONTINUE, big, TEST_LEN) < 0) {
+        fprintf(stderr, "the %d-byte frame is encoded wrongly\n", TEST_LEN);
+        fail = 1;
+    }
+    if (test_fanout(frame) < 0) fail = 1;
+    mln_buf_shared_free(frame);
+
+    /*control frames are final and short*/
+    if ((frame = mln_websocket_broadcast_generate(M_WS_OPCODE_PING, NULL, 0, 0)) == NULL || \
+        test_frame(frame, 0x80|M_WS_OPCODE_PING, NULL, 0) < 0)
+    {
+        fprintf(stderr, "the ping frame is encoded wrongly\n");
+        fail = 1;
+    }
+    mln_buf_shared_free(frame);
+    if (mln_websocket_broadcast_generate(M_WS_OPCODE_PING, big, 126, 0) != NULL) {
+        fprintf(stderr, "a 126-byte ping frame is encoded\n");
+        fail = 1;
+    }
+
+    return fail? 1: 0;
+}
+
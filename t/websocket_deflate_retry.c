@@ -0,0 +1,137 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+/*
+ * A compressed frame left in 'in' because the extension handler failed is
+ * parsed again to the same payload, for a fragmented message and across
+ * messages sharing the inflate window.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "mln_websocket.h"
+
+#if defined(MLN_ZLIB)
+
+static int calls = 0;
+
+/*
+ * Fails the first time each frame is seen.
+ */
+static int test_ext_handler(mln_websocket_t *ws)
+{
+    return (++calls & 1)? M_WS_RET_NOTYET: M_WS_RET_OK;
+}
+
+static int test_negotiate(mln_websocket_t *s, mln_websocket_t *c)
+{
+    struct mln_websocket_deflate_attr attr;
+    mln_string_t ek = mln_string("Sec-WebSocket-Extensions");
+    mln_string_t kk = mln_string("Sec-WebSocket-Key"), kv = mln_string("dGhlIHNhbXBsZSBub25jZQ==");
+    mln_chain_t *head = NULL, *tail = NULL;
+    mln_string_t *v;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.level = 6;
+    attr.server_max_window_bits = attr.client_max_window_bits = 15;
+
+    if (mln_websocket_deflate_offer(c, &attr) != M_WS_RET_OK) return -1;
+    if ((v = mln_websocket_get_field(c, &ek)) == NULL) return -1;
+
+    mln_http_type_set(mln_websocket_get_http(s), M_HTTP_REQUEST);
+    if (mln_http_field_set(mln_websocket_get_http(s), &ek, v) < 0) return -1;
+    if (mln_http_field_set(mln_websocket_get_http(s), &kk, &kv) < 0) return -1;
+    if (mln_websocket_deflate_negotiate(s, &attr) != M_WS_RET_OK) return -1;
+    if (mln_websocket_handshake_response_generate(s, &head, &tail) != M_WS_RET_OK) return -1;
+    mln_chain_pool_release_all(head);
+    if ((v = mln_http_field_get(mln_websocket_get_http(s), &ek)) == NULL) return -1;
+
+    mln_http_type_set(mln_websocket_get_http(c), M_HTTP_RESPONSE);
+    if (mln_http_field_set(mln_websocket_get_http(c), &ek, v) < 0) return -1;
+    if (mln_websocket_deflate_negotiate(c, &attr) != M_WS_RET_OK) return -1;
+    return mln_websocket_get_deflate(c) != NULL && mln_websocket_get_deflate(s) != NULL? 0: -1;
+}
+
+/*
+ * Send text in nfrag frames from c to s, and parse every frame twice.
+ */
+static int test_message(mln_websocket_t *c, mln_websocket_t *s, const char *text, int nfrag)
+{
+    mln_chain_t *in = NULL, *tail = NULL, *frame;
+    mln_size_t len = strlen(text), off = 0, n, got = 0;
+    mln_u8_t out[1024];
+    mln_u32_t flags;
+    int i, ret;
+
+    for (i = 0; i < nfrag; ++i) {
+        n = i == nfrag - 1? len - off: len / nfrag;
+        flags = M_WS_FLAG_CLIENT;
+        if (i == 0) flags |= M_WS_FLAG_NEW;
+        if (i == nfrag - 1) flags |= M_WS_FLAG_END;
+        frame = NULL;
+        if (mln_websocket_text_generate(c, &frame, (mln_u8ptr_t)text + off, n, flags) != M_WS_RET_OK) return -1;
+        mln_chain_add(&in, &tail, frame);
+        off += n;
+    }
+
+    while (in != NULL) {
+        if ((ret = mln_websocket_parse(s, &in)) != M_WS_RET_NOTYET) {
+            fprintf(stderr, "the first parse returns %d\n", ret);
+            return -1;
+        }
+        if ((ret = mln_websocket_parse(s, &in)) != M_WS_RET_OK) {
+            fprintf(stderr, "the second parse returns %d\n", ret);
+            return -1;
+        }
+        n = mln_websocket_get_content_len(s);
+        if (got + n > sizeof(out)) return -1;
+        memcpy(out + got, mln_websocket_get_content(s), n);
+        got += n;
+    }
+    if (got != len || memcmp(out, text, len)) {
+        fprintf(stderr, "\"%s\" is parsed as \"%.*s\"\n", text, (int)got, (char *)out);
+        return -1;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    const char *text = "the quick brown fox jumps over the lazy dog0123456789";
+    mln_tcp_conn_t tcs, tcc;
+    mln_http_t *hs, *hc;
+    mln_websocket_t *s, *c;
+    int fail = 0;
+
+    if (mln_tcp_conn_init(&tcs, -1) < 0 || mln_tcp_conn_init(&tcc, -1) < 0) return 1;
+    if ((hs = mln_http_init(&tcs, NULL, NULL)) == NULL || (hc = mln_http_init(&tcc, NULL, NULL)) == NULL) return 1;
+    if ((s = mln_websocket_new(hs)) == NULL || (c = mln_websocket_new(hc)) == NULL) return 1;
+    if (test_negotiate(s, c) < 0) {
+        fprintf(stderr, "negotiate failed\n");
+        return 1;
+    }
+    mln_websocket_set_ext_handler(s, test_ext_handler);
+
+    /*fragmented*/
+    fail |= test_message(c, s, "hello websocket permessage-deflate", 3);
+    /*the second and third ones refer back to the window filled by the first one*/
+    fail |= test_message(c, s, text, 1);
+    fail |= test_message(c, s, text, 1);
+    fail |= test_message(c, s, text, 2);
+
+    mln_websocket_free(s);
+    mln_websocket_free(c);
+    return fail? 1: 0;
+}
+
+#else
+
+int main(void)
+{
+    return 0;
+}
+
+#endif
+
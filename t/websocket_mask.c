@@ -0,0 +1,203 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+/*
+ * Masked client frames of lengths around the widths of the masking kernels
+ * are generated to payload ^ key[i % 4], and parsed back from one buf or
+ * from misaligned pieces. A payload in one modifiable buf is unmasked in
+ * place, while a temporary buf, or a buf that an extension handler may ask
+ * to parse again, is left masked.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mln_websocket.h"
+
+#define TEST_LEN 70000
+
+static mln_u8_t frame[TEST_LEN + 16];
+static mln_size_t frame_len;
+static int calls;
+
+static int test_ext_handler(mln_websocket_t *ws)
+{
+    return (++calls & 1)? M_WS_RET_NOTYET: M_WS_RET_OK;
+}
+
+/*
+ * Copy the frame chain into frame, and check the payload is masked.
+ */
+static int test_flatten(mln_chain_t *out, mln_u8ptr_t msg, mln_size_t len, mln_size_t off)
+{
+    mln_u8ptr_t p, key;
+    mln_size_t n, i;
+    mln_chain_t *c;
+
+    for (frame_len = 0, c = out; c != NULL; c = c->next) {
+        if (c->buf == NULL) continue;
+        n = c->buf->last - c->buf->left_pos;
+        if (frame_len + n > sizeof(frame)) return -1;
+        memcpy(frame + frame_len, c->buf->left_pos, n);
+        frame_len += n;
+    }
+    mln_chain_pool_release_all(out);
+
+    if (!(frame[1] & 0x80)) return -1;
+    n = frame[1] & 0x7f;
+    p = frame + 2 + (n == 126? 2: (n == 127? 8: 0));
+    key = p;
+    p += 4;
+    if (frame + frame_len - p != len + off) return -1;
+    for (i = 0; i < len; ++i) {
+        if ((p[off + i] ^ key[(off + i) & 3]) != msg[i]) {
+            fprintf(stderr, "length %lu: byte %lu is masked wrongly\n", (unsigned long)len, (unsigned long)i);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Put frame into bufs of piece bytes each, every buf starts at an odd address.
+ */
+static mln_chain_t *test_split(mln_alloc_t *pool, mln_size_t piece, int temporary)
+{
+    mln_chain_t *c, *head = NULL, *tail = NULL;
+    mln_u8ptr_t data;
+    mln_size_t off, n;
+
+    for (off = 0; off < frame_len; off += n) {
+        n = frame_len - off > piece? piece: frame_len - off;
+        if ((c = mln_chain_new(pool)) == NULL) return NULL;
+        if ((c->buf = mln_buf_new(pool)) == NULL) return NULL;
+        if ((data = (mln_u8ptr_t)mln_alloc_m(pool, n + 1)) == NULL) return NULL;
+        memcpy(data + 1, frame + off, n);
+        c->buf->start = data;
+        c->buf->left_pos = c->buf->pos = data + 1;
+        c->buf->last = c->buf->end = data + 1 + n;
+        c->buf->in_memory = 1;
+        c->buf->temporary = temporary;
+        mln_chain_add(&head, &tail, c);
+    }
+    return head;
+}
+
+static int test_parse(mln_websocket_t *s, mln_u8ptr_t msg, mln_size_t len, mln_size_t piece, int temporary, int ext)
+{
+    mln_chain_t *in = test_split(mln_websocket_get_pool(s), piece, temporary);
+    mln_size_t size = piece < frame_len? piece: frame_len;
+    mln_u8ptr_t data, content;
+    int ret, inplace;
+
+    if (in == NULL) return -1;
+    data = in->buf->left_pos;
+    inplace = piece >= frame_len && !temporary && !ext;
+
+    calls = 0;
+    mln_websocket_set_ext_handler(s, ext? test_ext_handler: NULL);
+    while ((ret = mln_websocket_parse(s, &in)) == M_WS_RET_NOTYET && ext && calls == 1)
+        ;
+    mln_websocket_set_ext_handler(s, NULL);
+
+    content = (mln_u8ptr_t)mln_websocket_get_content(s);
+    if (ret != M_WS_RET_OK || mln_websocket_get_content_len(s) != len || (len && memcmp(content, msg, len))) {
+        fprintf(stderr, "length %lu piece %lu temporary %d ext %d: parse returns %d\n", \
+                (unsigned long)len, (unsigned long)piece, temporary, ext, ret);
+        goto err;
+    }
+    if (len && inplace != (content >= data && content < data + size)) {
+        fprintf(stderr, "length %lu piece %lu temporary %d ext %d: the payload is%s unmasked in place\n", \
+                (unsigned long)len, (unsigned long)piece, temporary, ext, inplace? " not": "");
+        goto err;
+    }
+    if (!inplace && piece >= frame_len && memcmp(data, frame, frame_len)) {
+        fprintf(stderr, "length %lu temporary %d ext %d: the input is modified\n", \
+                (unsigned long)len, temporary, ext);
+        goto err;
+    }
+    mln_chain_pool_release_all(in);
+    return 0;
+
+err:
+    mln_chain_pool_release_all(in);
+    return -1;
+}
+
+static int test_length(mln_websocket_t *c, mln_websocket_t *s, mln_u8ptr_t msg, mln_size_t len)
+{
+    static mln_size_t pieces[] = {1, 3, 8, 61, 4099, TEST_LEN + 16};
+    mln_chain_t *out = NULL;
+    mln_size_t i;
+    int fail = 0;
+
+    if (mln_websocket_binary_generate(c, &out, msg, len, M_WS_FLAG_NEW|M_WS_FLAG_END|M_WS_FLAG_CLIENT) != M_WS_RET_OK)
+        return -1;
+    if (test_flatten(out, msg, len, 0) < 0) return -1;
+
+    for (i = 0; i < sizeof(pieces) / sizeof(pieces[0]); ++i) {
+        if (len > 1000 && pieces[i] < 61) continue;
+        fail |= test_parse(s, msg, len, pieces[i], 0, 0);
+        fail |= test_parse(s, msg, len, pieces[i], 1, 0);
+    }
+    fail |= test_parse(s, msg, len, TEST_LEN + 16, 0, 1);
+    return fail;
+}
+
+/*
+ * The payload of a close frame is masked from offset 2 on after the status.
+ */
+static int test_close(mln_websocket_t *c, mln_websocket_t *s)
+{
+    char reason[] = "going away, the masking key starts at byte 2 of it";
+    mln_chain_t *out = NULL, *in;
+    int fail = 0;
+
+    if (mln_websocket_close_generate(c, &out, reason, 1001, M_WS_FLAG_CLIENT) != M_WS_RET_OK) return -1;
+    if (test_flatten(out, (mln_u8ptr_t)reason, strlen(reason), 2) < 0) return -1;
+    if ((in = test_split(mln_websocket_get_pool(s), 5, 0)) == NULL) return -1;
+    if (mln_websocket_parse(s, &in) != M_WS_RET_OK || \
+        mln_websocket_get_opcode(s) != M_WS_OPCODE_CLOSE || \
+        mln_websocket_get_status(s) != 1001 || \
+        mln_websocket_get_content_len(s) != strlen(reason) || \
+        memcmp(mln_websocket_get_content(s), reason, strlen(reason)))
+    {
+        fprintf(stderr, "the close frame is parsed wrongly\n");
+        fail = 1;
+    }
+    mln_chain_pool_release_all(in);
+    return fail? -1: 0;
+}
+
+int main(void)
+{
+    static mln_size_t lens[] = {
+        0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 125, 126, 127,
+        1000, 65535, 65536, TEST_LEN
+    };
+    mln_tcp_conn_t tcs, tcc;
+    mln_http_t *hs, *hc;
+    mln_websocket_t *s, *c;
+    static mln_u8_t msg[TEST_LEN];
+    mln_size_t i;
+    int fail = 0;
+
+    srand(11);
+    for (i = 0; i < sizeof(msg); ++i) msg[i] = (mln_u8_t)rand();
+
+    if (mln_tcp_conn_init(&tcs, -1) < 0 || mln_tcp_conn_init(&tcc, -1) < 0) return 1;
+    if ((hs = mln_http_init(&tcs, NULL, NULL)) == NULL || (hc = mln_http_init(&tcc, NULL, NULL)) == NULL) return 1;
+    if ((s = mln_websocket_new(hs)) == NULL || (c = mln_websocket_new(hc)) == NULL) return 1;
+
+    for (i = 0; i < sizeof(lens) / sizeof(lens[0]); ++i) {
+        if (test_length(c, s, msg, lens[i]) < 0) fail = 1;
+    }
+    if (test_close(c, s) < 0) fail = 1;
+
+    mln_websocket_free(s);
+    mln_websocket_free(c);
+    return fail? 1: 0;
+}
+
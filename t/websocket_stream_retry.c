@@ -0,0 +1,189 @@
+
+/*
+ * Copyright (C) Niklaus F.Schen.
+ */
+
+/*
+ * A slice passed to the stream handler is consumed even if the handler fails,
+ * so parsing again goes on after it: the message is delivered exactly once,
+ * with M_WS_FLAG_NEW and M_WS_FLAG_END once each, for masked payload in
+ * modifiable and temporary bufs, with and without permessage-deflate.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mln_websocket.h"
+
+#define TEST_LEN 50000
+
+static mln_u8_t got[TEST_LEN];
+static mln_size_t got_len, nnew, nend;
+static int calls;
+
+/*
+ * Fails every other call after the slice is taken.
+ */
+static int test_stream_handler(mln_websocket_t *ws, mln_u8ptr_t data, mln_size_t len, mln_u32_t flags)
+{
+    if (flags & M_WS_FLAG_NEW) {
+        if (got_len) ++nnew;/*NEW in the middle of a message*/
+        ++nnew;
+    }
+    if (flags & M_WS_FLAG_END) ++nend;
+    if (got_len + len > sizeof(got)) return M_WS_RET_ERROR;
+    memcpy(got + got_len, data, len);
+    got_len += len;
+    return (++calls & 1)? M_WS_RET_NOTYET: M_WS_RET_OK;
+}
+
+#if defined(MLN_ZLIB)
+static int test_negotiate(mln_websocket_t *s, mln_websocket_t *c)
+{
+    struct mln_websocket_deflate_attr attr;
+    mln_string_t ek = mln_string("Sec-WebSocket-Extensions");
+    mln_string_t kk = mln_string("Sec-WebSocket-Key"), kv = mln_string("dGhlIHNhbXBsZSBub25jZQ==");
+    mln_chain_t *head = NULL, *tail = NULL;
+    mln_string_t *v;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.level = 6;
+    attr.server_max_window_bits = attr.client_max_window_bits = 15;
+
+    if (mln_websocket_deflate_offer(c, &attr) != M_WS_RET_OK) return -1;
+    if ((v = mln_websocket_get_field(c, &ek)) == NULL) return -1;
+
+    mln_http_type_set(mln_websocket_get_http(s), M_HTTP_REQUEST);
+    if (mln_http_field_set(mln_websocket_get_http(s), &ek, v) < 0) return -1;
+    if (mln_http_field_set(mln_websocket_get_http(s), &kk, &kv) < 0) return -1;
+    if (mln_websocket_deflate_negotiate(s, &attr) != M_WS_RET_OK) return -1;
+    if (mln_websocket_handshake_response_generate(s, &head, &tail) != M_WS_RET_OK) return -1;
+    mln_chain_pool_release_all(head);
+    if ((v = mln_http_field_get(mln_websocket_get_http(s), &ek)) == NULL) return -1;
+
+    mln_http_type_set(mln_websocket_get_http(c), M_HTTP_RESPONSE);
+    if (mln_http_field_set(mln_websocket_get_http(c), &ek, v) < 0) return -1;
+    if (mln_websocket_deflate_negotiate(c, &attr) != M_WS_RET_OK) return -1;
+    return mln_websocket_get_deflate(c) != NULL && mln_websocket_get_deflate(s) != NULL? 0: -1;
+}
+#endif
+
+/*
+ * Copy the frames into bufs of piece bytes each.
+ */
+static mln_chain_t *test_split(mln_alloc_t *pool, mln_chain_t *frames, mln_size_t piece, int temporary)
+{
+    mln_chain_t *c, *head = NULL, *tail = NULL;
+    mln_u8ptr_t data;
+    mln_size_t n;
+    mln_buf_t *b;
+
+    for (; frames != NULL; frames = frames->next) {
+        b = frames->buf;
+        while (b->left_pos < b->last) {
+            n = b->last - b->left_pos > piece? piece: b->last - b->left_pos;
+            if ((c = mln_chain_new(pool)) == NULL) return NULL;
+            if ((c->buf = mln_buf_new(pool)) == NULL) return NULL;
+            if ((data = (mln_u8ptr_t)mln_alloc_m(pool, n)) == NULL) return NULL;
+            memcpy(data, b->left_pos, n);
+            c->buf->left_pos = c->buf->pos = c->buf->start = data;
+            c->buf->last = c->buf->end = data + n;
+            c->buf->in_memory = 1;
+            c->buf->temporary = temporary;
+            mln_chain_add(&head, &tail, c);
+            b->left_pos += n;
+        }
+    }
+    return head;
+}
+
+static int test_message(mln_websocket_t *c, mln_websocket_t *s, mln_u8ptr_t msg, mln_size_t len, int nfrag, mln_size_t piece, int temporary)
+{
+    mln_chain_t *frames = NULL, *tail = NULL, *frame, *in;
+    mln_size_t off = 0, n;
+    mln_u32_t flags;
+    int i, ret, loops = 0;
+
+    for (i = 0; i < nfrag; ++i) {
+        n = i == nfrag - 1? len - off: len / nfrag;
+        flags = M_WS_FLAG_CLIENT;
+        if (i == 0) flags |= M_WS_FLAG_NEW;
+        if (i == nfrag - 1) flags |= M_WS_FLAG_END;
+        frame = NULL;
+        if (mln_websocket_binary_generate(c, &frame, msg + off, n, flags) != M_WS_RET_OK) return -1;
+        mln_chain_add(&frames, &tail, frame);
+        off += n;
+    }
+    in = test_split(mln_websocket_get_pool(s), frames, piece, temporary);
+    mln_chain_pool_release_all(frames);
+    if (in == NULL) return -1;
+
+    got_len = nnew = nend = 0;
+    while (in != NULL || !nend) {
+        ret = mln_websocket_stream_parse(s, &in);
+        if (ret == M_WS_RET_ERROR || ret == M_WS_RET_FAILED || ++loops > 100000) {
+            fprintf(stderr, "stream parse returns %d\n", ret);
+            return -1;
+        }
+    }
+
+    if (got_len != len || memcmp(got, msg, len) || nnew != 1 || nend != 1) {
+        fprintf(stderr, "len %lu nfrag %d piece %lu temporary %d: got %lu bytes, NEW %lu, END %lu\n", \
+                (unsigned long)len, nfrag, (unsigned long)piece, temporary, \
+                (unsigned long)got_len, (unsigned long)nnew, (unsigned long)nend);
+        return -1;
+    }
+    return 0;
+}
+
+static int test_messages(mln_websocket_t *c, mln_websocket_t *s, mln_u8ptr_t msg)
+{
+    int fail = 0;
+
+    fail |= test_message(c, s, msg, TEST_LEN, 1, TEST_LEN + 16, 0);
+    fail |= test_message(c, s, msg, TEST_LEN, 3, 1000, 0);
+    fail |= test_message(c, s, msg, TEST_LEN, 1, TEST_LEN + 16, 1);
+    fail |= test_message(c, s, msg, TEST_LEN, 2, 9000, 1);
+    fail |= test_message(c, s, msg, 0, 1, 16, 0);
+    fail |= test_message(c, s, msg, 100, 2, 7, 1);
+    return fail;
+}
+
+int main(void)
+{
+    mln_tcp_conn_t tcs, tcc;
+    mln_http_t *hs, *hc;
+    mln_websocket_t *s, *c;
+    mln_u8_t msg[TEST_LEN];
+    mln_size_t i;
+    int fail = 0;
+
+    srand(7);
+    for (i = 0; i < sizeof(msg); ++i) {
+        msg[i] = i & 1? (mln_u8_t)rand(): "melon"[i % 5];
+    }
+
+    if (mln_tcp_conn_init(&tcs, -1) < 0 || mln_tcp_conn_init(&tcc, -1) < 0) return 1;
+    if ((hs = mln_http_init(&tcs, NULL, NULL)) == NULL || (hc = mln_http_init(&tcc, NULL, NULL)) == NULL) return 1;
+
+    if ((s = mln_websocket_new(hs)) == NULL || (c = mln_websocket_new(hc)) == NULL) return 1;
+    mln_websocket_set_stream_handler(s, test_stream_handler);
+    fail |= test_messages(c, s, msg);
+    mln_websocket_free(s);
+    mln_websocket_free(c);
+
+#if defined(MLN_ZLIB)
+    if ((s = mln_websocket_new(hs)) == NULL || (c = mln_websocket_new(hc)) == NULL) return 1;
+    if (test_negotiate(s, c) < 0) {
+        fprintf(stderr, "negotiate failed\n");
+        return 1;
+    }
+    mln_websocket_set_stream_handler(s, test_stream_handler);
+    fail |= test_messages(c, s, msg);
+    mln_websocket_free(s);
+    mln_websocket_free(c);
+#endif
+
+    return fail? 1: 0;
+}
+
@@ -22,12 +22,19 @@ option("melang_lib_path")
     set_default("/usr/local/lib/melang")
 option("melang_dylib_path")
     set_default("/usr/local/lib/melang_dynamic")
+option("zlib")
+    set_default(false)
+    set_showmenu(true)
+    set_description("Enable websocket permessage-deflate, zlib is required")
+    add_defines("MLN_ZLIB")
+    add_links("z")
 
 target("melon")
     set_kind("$(kind)")
     add_files(path.join("src", "*.c"))
     add_includedirs("include", {public = true})
     add_headerfiles(path.join("include", "*.h"))
+    add_options("zlib")
     if is_plat("windows") then 
         add_defines("WIN32_LEAN_AND_MEAN")
         add_defines("WIN32")